@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <array>
 #include <iostream>
+#include <map>
 #include <vector>
 
 #include "common/goal.h"
@@ -29,6 +30,8 @@
 #include "common/lizardfs_version.h"
 #include "common/moosefs_string.h"
 #include "common/moosefs_vector.h"
+#include "protocol/cltoma.h"
+#include "protocol/matocl.h"
 #include "protocol/packet.h"
 #include "common/serialization.h"
 #include "common/serialization_macros.h"
@@ -63,7 +66,8 @@ std::string ListMountsCommand::name() const {
 LizardFsProbeCommand::SupportedOptions ListMountsCommand::supportedOptions() const {
 	return {
 		{kPorcelainMode, kPorcelainModeDescription},
-		{kVerboseMode,   "Be a little more verbose and show goal and trash time limits."},
+		{kVerboseMode,   "Be a little more verbose and show goal and trash time limits "
+				"and request scheduling statistics."},
 	};
 }
 
@@ -86,6 +90,25 @@ void ListMountsCommand::run(const Options& options) const {
 	uint16_t dummy;
 	deserializeAllMooseFsPacketDataNoHeader(response, dummy, mounts);
 
+	// Request scheduling statistics are available in masters since 3.14.0
+	std::map<uint32_t, SessionQueueInfo> queues;
+	if (options.isSet(kVerboseMode)) {
+		request = cltoma::metadataserversList::build();
+		response = connection.sendAndReceive(request, LIZ_MATOCL_METADATASERVERS_LIST);
+		std::vector<MetadataserverListEntry> shadows;
+		uint32_t masterVersion;
+		matocl::metadataserversList::deserialize(response, masterVersion, shadows);
+		if (masterVersion >= kSessionQueuesVersion) {
+			request = cltoma::listSessionQueues::build();
+			response = connection.sendAndReceive(request, LIZ_MATOCL_LIST_SESSION_QUEUES);
+			std::vector<SessionQueueInfo> sessions;
+			matocl::listSessionQueues::deserialize(response, sessions);
+			for (const SessionQueueInfo &session : sessions) {
+				queues[session.sessionId] = session;
+			}
+		}
+	}
+
 	std::sort(mounts.begin(), mounts.end(),
 			[](const MountEntry& a, const MountEntry& b) -> bool
 			{ return a.sessionId < b.sessionId; });
@@ -99,6 +122,8 @@ void ListMountsCommand::run(const Options& options) const {
 		bool shouldPrintGoal = GoalId::isValid(mount.minGoal) && GoalId::isValid(mount.maxGoal);
 		bool shouldPrintTrashTime = mount.minTrashTime < mount.maxTrashTime
 				&& (mount.minTrashTime != 0 || mount.maxTrashTime != 0xFFFFFFFF);
+		auto queue = queues.find(mount.sessionId);
+		bool shouldPrintQueue = queue != queues.end();
 
 		if (!options.isSet(kPorcelainMode)) {
 			std::cout << "session " << mount.sessionId << ": " << '\n'
@@ -130,6 +155,18 @@ void ListMountsCommand::run(const Options& options) const {
 				} else {
 					std::cout << "\tmin trash time: -\n\tmax trash time: -" << std::endl;
 				}
+
+				if (shouldPrintQueue) {
+					const SessionQueueInfo &info = queue->second;
+					std::cout << "\trequest weight: " << static_cast<uint32_t>(info.weight) << std::endl
+							<< "\tqueued requests: " << info.queueDepth << std::endl
+							<< "\thandled requests: " << info.handledRequests << std::endl
+							<< "\trequest latency: " << info.avgLatencyUs << "us (avg), "
+							<< info.maxLatencyUs << "us (max this hour)" << std::endl;
+				} else {
+					std::cout << "\trequest weight: -\n\tqueued requests: -\n"
+							<< "\thandled requests: -\n\trequest latency: -" << std::endl;
+				}
 			}
 		} else {
 			std::cout << mount.sessionId
@@ -160,6 +197,17 @@ void ListMountsCommand::run(const Options& options) const {
 				} else {
 					std::cout << " - -";
 				}
+
+				if (shouldPrintQueue) {
+					const SessionQueueInfo &info = queue->second;
+					std::cout << ' ' << static_cast<uint32_t>(info.weight)
+							<< ' ' << info.queueDepth
+							<< ' ' << info.handledRequests
+							<< ' ' << info.avgLatencyUs
+							<< ' ' << info.maxLatencyUs;
+				} else {
+					std::cout << " - - - - -";
+				}
 			}
 			std::cout << std::endl;
 		}
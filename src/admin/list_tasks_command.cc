@@ -19,10 +19,13 @@
 #include "common/platform.h"
 #include "admin/list_tasks_command.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "admin/registered_admin_connection.h"
 #include "common/job_info.h"
+#include "common/lizardfs_version.h"
+#include "common/metadataserver_list_entry.h"
 #include "protocol/cltoma.h"
 #include "protocol/matocl.h"
 
@@ -41,22 +44,45 @@ void ListTasksCommand::run(const Options& options) const {
 	}
 
 	ServerConnection connection(options.argument(0), options.argument(1));
-	std::vector<JobInfo> jobs_info;
 
-	auto request = cltoma::listTasks::build(true);
-	auto response = connection.sendAndReceive(request, LIZ_MATOCL_LIST_TASKS);
-	matocl::listTasks::deserialize(response, jobs_info);
+	auto request = cltoma::metadataserversList::build();
+	auto response = connection.sendAndReceive(request, LIZ_MATOCL_METADATASERVERS_LIST);
+	std::vector<MetadataserverListEntry> shadows;
+	uint32_t masterVersion;
+	matocl::metadataserversList::deserialize(response, masterVersion, shadows);
+
+	std::vector<JobProgressInfo> jobs_info;
+	if (masterVersion >= kTaskProgressVersion) {
+		request = cltoma::listTasks::build();
+		response = connection.sendAndReceive(request, LIZ_MATOCL_LIST_TASKS);
+		matocl::listTasks::deserialize(response, jobs_info);
+	} else {
+		std::vector<JobInfo> legacy_jobs_info;
+		request = cltoma::listTasks::build(true);
+		response = connection.sendAndReceive(request, LIZ_MATOCL_LIST_TASKS);
+		matocl::listTasks::deserialize(response, legacy_jobs_info);
+		for (const JobInfo &job_info : legacy_jobs_info) {
+			jobs_info.emplace_back(job_info.id, job_info.description, 0, 0);
+		}
+	}
 	if (jobs_info.empty()) {
 		std::cout << "No tasks are being executed" << std::endl;
 	}
 
-	for (const JobInfo &job_info : jobs_info) {
+	for (const JobProgressInfo &job_info : jobs_info) {
 		std::ios::fmtflags f(std::cout.flags());
 		std::cout << "Id: 0x";
 		std::cout.width(5);
 		std::cout << std::left << std::hex << job_info.id << "  -  ";
 		std::cout.width(15);
-		std::cout << std::left << job_info.description << std::endl;
+		std::cout << std::left << job_info.description;
 		std::cout.flags(f);
+		if (job_info.processed_nodes > 0) {
+			uint64_t rate =
+			        job_info.processed_nodes / std::max<uint32_t>(job_info.running_time, 1);
+			std::cout << "  (processed nodes: " << job_info.processed_nodes
+			          << ", rate: " << rate << " nodes/s)";
+		}
+		std::cout << std::endl;
 	}
 }
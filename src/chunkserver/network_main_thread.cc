@@ -24,6 +24,7 @@
 #include <netinet/in.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <syslog.h>
@@ -43,6 +44,7 @@
 #include "chunkserver/network_stats.h"
 #include "chunkserver/network_worker_thread.h"
 #include "chunkserver/chunk_replicator.h"
+#include "common/chunk_connector.h"
 #include "common/cfg.h"
 #include "common/charts.h"
 #include "common/event_loop.h"
@@ -62,6 +64,9 @@
 
 static int lsock;
 static int32_t lsockpdescpos;
+static int localsock = -1; // UNIX socket for clients from the same host
+static int32_t localsockpdescpos = -1;
+static std::string gLocalSocketPath;
 
 std::list<std::thread> networkThreads;
 std::list<NetworkWorkerThread> networkThreadObjects;
@@ -76,6 +81,7 @@ static char *ListenPort;
 static uint32_t gNrOfNetworkWorkers;
 static uint32_t gNrOfHddWorkersPerNetworkWorker;
 static uint32_t gBgjobsCountPerNetworkWorker;
+static std::string gLocalSocketDir;
 
 void chunkReplicatorReload() {
 	unsigned rep_total = cfg_get_minmaxvalue<unsigned>("REPLICATION_TOTAL_TIMEOUT_MS",
@@ -110,6 +116,7 @@ void mainNetworkThreadReload(void) {
 			"NR_OF_HDD_WORKERS_PER_NETWORK_WORKER", gNrOfHddWorkersPerNetworkWorker);
 	cfg_warning_on_value_change(
 			"BGJOBSCNT_PER_NETWORK_WORKER", gBgjobsCountPerNetworkWorker);
+	cfg_warning_on_value_change("CSSERV_LOCAL_SOCKET_DIR", gLocalSocketDir);
 
 	try {
 		replicationBandwidthLimitReload();
@@ -180,12 +187,20 @@ void mainNetworkThreadDesc(std::vector<pollfd> &pdesc) {
 	TRACETHIS();
 	pdesc.push_back({lsock, POLLIN, 0});
 	lsockpdescpos = pdesc.size() - 1;
+	if (localsock >= 0) {
+		pdesc.push_back({localsock, POLLIN, 0});
+		localsockpdescpos = pdesc.size() - 1;
+	}
 }
 
 void mainNetworkThreadTerm(void) {
 	TRACETHIS();
 	lzfs_pretty_syslog(LOG_NOTICE, "closing %s:%s", ListenHost, ListenPort);
 	tcpclose(lsock);
+	if (localsock >= 0) {
+		tcpclose(localsock);
+		unlink(gLocalSocketPath.c_str());
+	}
 
 	free(ListenHost);
 	free(ListenPort);
@@ -198,28 +213,56 @@ void mainNetworkThreadTerm(void) {
 	}
 }
 
+static void mainNetworkThreadAccept(int listenSocketFD) {
+	int newSocketFD = tcpaccept(listenSocketFD);
+	if (newSocketFD < 0) {
+		lzfs_silent_errlog(LOG_NOTICE, "accept error");
+	} else {
+		if (nextNetworkThread == networkThreadObjects.end()) {
+			nextNetworkThread = networkThreadObjects.begin();
+		}
+		if (job_pool_jobs_count(nextNetworkThread->bgJobPool())
+				>= (gBgjobsCountPerNetworkWorker * 9) / 10) {
+			lzfs_pretty_syslog(LOG_WARNING, "jobs queue is full !!!");
+			tcpclose(newSocketFD);
+		} else {
+			nextNetworkThread->addConnection(newSocketFD);
+		}
+		++nextNetworkThread;
+	}
+}
+
 void mainNetworkThreadServe(const std::vector<pollfd> &pdesc) {
 	TRACETHIS();
-	int newSocketFD;
-
 	if (lsockpdescpos >= 0 && (pdesc[lsockpdescpos].revents & POLLIN)) {
-		newSocketFD = tcpaccept(lsock);
-		if (newSocketFD < 0) {
-			lzfs_silent_errlog(LOG_NOTICE, "accept error");
-		} else {
-			if (nextNetworkThread == networkThreadObjects.end()) {
-				nextNetworkThread = networkThreadObjects.begin();
-			}
-			if (job_pool_jobs_count(nextNetworkThread->bgJobPool())
-					>= (gBgjobsCountPerNetworkWorker * 9) / 10) {
-				lzfs_pretty_syslog(LOG_WARNING, "jobs queue is full !!!");
-				tcpclose(newSocketFD);
-			} else {
-				nextNetworkThread->addConnection(newSocketFD);
-			}
-			++nextNetworkThread;
-		}
+		mainNetworkThreadAccept(lsock);
+	}
+	if (localsock >= 0 && localsockpdescpos >= 0 && (pdesc[localsockpdescpos].revents & POLLIN)) {
+		mainNetworkThreadAccept(localsock);
+	}
+}
+
+/// Creates UNIX socket for clients running on the same host, they use it instead of TCP.
+static void mainNetworkThreadInitLocalSocket() {
+	gLocalSocketDir = cfg_get("CSSERV_LOCAL_SOCKET_DIR", std::string());
+	if (gLocalSocketDir.empty()) {
+		return;
+	}
+	gLocalSocketPath = ChunkConnector::localSocketPath(gLocalSocketDir,
+			NetworkAddress(mylistenip, mylistenport));
+	localsock = unixsocket();
+	if (localsock < 0) {
+		throw InitializeException("main server module: can't create UNIX socket: " +
+				errorString(errno));
+	}
+	tcpnonblock(localsock);
+	if (unixlisten(localsock, gLocalSocketPath.c_str(), 100) < 0) {
+		throw InitializeException("main server module: can't listen on UNIX socket " +
+				gLocalSocketPath + ": " + errorString(errno));
 	}
+	// access is not restricted more than for the TCP socket, which any local user can connect
+	chmod(gLocalSocketPath.c_str(), 0666);
+	lzfs_pretty_syslog(LOG_NOTICE, "main server module: listen on %s", gLocalSocketPath.c_str());
 }
 
 int mainNetworkThreadInit(void) {
@@ -255,6 +298,7 @@ int mainNetworkThreadInit(void) {
 				errorString(errno));
 	}
 	lzfs_pretty_syslog(LOG_NOTICE, "main server module: listen on %s:%s", ListenHost, ListenPort);
+	mainNetworkThreadInitLocalSocket();
 
 	eventloop_reloadregister(mainNetworkThreadReload);
 	eventloop_destructregister(mainNetworkThreadTerm);
@@ -20,7 +20,13 @@
 #include "common/chunk_connector.h"
 
 #include <errno.h>
+#ifndef _WIN32
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#endif
 #include <algorithm>
+#include <mutex>
+#include <unordered_set>
 
 #include "common/exceptions.h"
 #include "common/mfserr.h"
@@ -31,12 +37,83 @@ static int64_t timeoutTime(int64_t rtt, uint8_t tryCounter) {
 	return rtt * (1 << (tryCounter / 2)) * 3 / (tryCounter % 2 == 0 ? 3 : 2);
 }
 
+#ifndef _WIN32
+/// Checks if \p ip is an address of this host, addresses of interfaces are read once a minute.
+static bool isLocalAddress(uint32_t ip) {
+	static std::mutex mutex;
+	static std::unordered_set<uint32_t> addresses;
+	static SteadyTimePoint readTime;
+	static bool addressesRead = false;
+
+	if ((ip >> 24) == 127) {
+		return true;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!addressesRead || SteadyClock::now() - readTime > std::chrono::minutes(1)) {
+		struct ifaddrs *ifaddrs;
+		addresses.clear();
+		if (getifaddrs(&ifaddrs) == 0) {
+			for (struct ifaddrs *ifa = ifaddrs; ifa != nullptr; ifa = ifa->ifa_next) {
+				if (ifa->ifa_addr != nullptr && ifa->ifa_addr->sa_family == AF_INET) {
+					auto sa = reinterpret_cast<const struct sockaddr_in*>(ifa->ifa_addr);
+					addresses.insert(ntohl(sa->sin_addr.s_addr));
+				}
+			}
+			freeifaddrs(ifaddrs);
+		}
+		readTime = SteadyClock::now();
+		addressesRead = true;
+	}
+	return addresses.count(ip) > 0;
+}
+#endif
+
 ChunkConnector::ChunkConnector(uint32_t sourceIp) : roundTripTime_ms_(20), sourceIp_(sourceIp) {
 }
 
+std::string ChunkConnector::localSocketPath(const std::string& directory,
+		const NetworkAddress& address) {
+	return directory + "/chunkserver." + ipToString(address.ip) + "." +
+			std::to_string(address.port) + ".sock";
+}
+
+int ChunkConnector::connectLocalSocket(const NetworkAddress& server) const {
+#ifndef _WIN32
+	if (localSocketDirectory_.empty() || !isLocalAddress(server.ip)) {
+		return -1;
+	}
+	int fd = unixsocket();
+	if (fd < 0) {
+		return -1;
+	}
+	if (unixconnect(fd, localSocketPath(localSocketDirectory_, server).c_str()) == 0) {
+		return fd;
+	}
+	// the chunkserver may listen on all addresses of this host
+	tcpclose(fd);
+	fd = unixsocket();
+	if (fd < 0) {
+		return -1;
+	}
+	NetworkAddress anyAddress(0, server.port);
+	if (unixconnect(fd, localSocketPath(localSocketDirectory_, anyAddress).c_str()) < 0) {
+		// the chunkserver doesn't listen on a UNIX socket, TCP will be used
+		tcpclose(fd);
+		return -1;
+	}
+	return fd;
+#else
+	(void)server;
+	return -1;
+#endif
+}
+
 int ChunkConnector::startUsingConnection(const NetworkAddress& server,
 		const Timeout& timeout) const {
-	int fd = -1;
+	int fd = connectLocalSocket(server);
+	if (fd >= 0) {
+		return fd;
+	}
 	int retries = 0;
 	int err = ETIMEDOUT;  // we want to return ETIMEDOUT on timeout.expired()
 	while (!timeout.expired()) {
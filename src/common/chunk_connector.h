@@ -20,6 +20,8 @@
 
 #include "common/platform.h"
 
+#include <string>
+
 #include "common/connection_pool.h"
 #include "common/sockets.h"
 #include "common/time_utils.h"
@@ -41,12 +43,28 @@ public:
 		sourceIp_ = sourceIp;
 	}
 
+	/// A setter, empty directory disables connecting chunkservers of this host with UNIX sockets.
+	void setLocalSocketDirectory(const std::string& directory) {
+		localSocketDirectory_ = directory;
+	}
+
+	/// Path of the UNIX socket of a chunkserver of this host listening on \p address
+	/// (address with ip 0 for a chunkserver listening on all addresses).
+	static std::string localSocketPath(const std::string& directory,
+			const NetworkAddress& address);
+
 private:
+	/// Connects a chunkserver of this host with its UNIX socket, returns -1 if it is not possible.
+	int connectLocalSocket(const NetworkAddress& server) const;
+
 	/// Time after which SYN packet will be considered lost during the first retry of tcptoconnect.
 	uint32_t roundTripTime_ms_;
 
 	/// IP address to bind to when connecting chunkservers.
 	uint32_t sourceIp_;
+
+	/// Directory with UNIX sockets of chunkservers running on this host.
+	std::string localSocketDirectory_;
 };
 
 class Connection {
@@ -0,0 +1,150 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/chunk_connector.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "common/sockets.h"
+#include "unittests/TemporaryDirectory.h"
+
+static const uint32_t kLocalhost = (127U << 24) + 1;
+
+class ChunkConnectorTests : public ::testing::Test {
+protected:
+	ChunkConnectorTests() : directory_("/tmp", "chunk_connector") {
+		connector_.setLocalSocketDirectory(directory_.name());
+	}
+
+	~ChunkConnectorTests() {
+		for (int fd : fds_) {
+			tcpclose(fd);
+		}
+	}
+
+	// Creates a nonblocking UNIX socket listening on the given path
+	int listenOn(const std::string &path) {
+		int fd = unixsocket();
+		EXPECT_GE(fd, 0);
+		EXPECT_EQ(0, unixlisten(fd, path.c_str(), 10));
+		EXPECT_EQ(0, tcpnonblock(fd));
+		fds_.push_back(fd);
+		return fd;
+	}
+
+	int listenAs(const NetworkAddress &address) {
+		return listenOn(ChunkConnector::localSocketPath(directory_.name(), address));
+	}
+
+	// Checks if a connection is waiting to be accepted by a nonblocking listening socket
+	bool accepted(int fd, uint32_t timeout_ms = 0) {
+		int client = timeout_ms > 0 ? tcptoaccept(fd, timeout_ms) : tcpaccept(fd);
+		if (client < 0) {
+			return false;
+		}
+		tcpclose(client);
+		return true;
+	}
+
+	void close(int fd) {
+		tcpclose(fd);
+		fds_.erase(std::find(fds_.begin(), fds_.end(), fd));
+	}
+
+	int connect(const NetworkAddress &server) {
+		int fd = connector_.startUsingConnection(server, Timeout(std::chrono::seconds(5)));
+		EXPECT_GE(fd, 0);
+		fds_.push_back(fd);
+		return fd;
+	}
+
+	TemporaryDirectory directory_;
+	ChunkConnector connector_;
+	std::vector<int> fds_;
+};
+
+TEST_F(ChunkConnectorTests, LocalSocketPath) {
+	EXPECT_EQ("/run/lizardfs/chunkserver.127.0.0.1.9422.sock",
+			ChunkConnector::localSocketPath("/run/lizardfs", NetworkAddress(kLocalhost, 9422)));
+	EXPECT_EQ("/run/lizardfs/chunkserver.0.0.0.0.9522.sock",
+			ChunkConnector::localSocketPath("/run/lizardfs", NetworkAddress(0, 9522)));
+}
+
+TEST_F(ChunkConnectorTests, ExactAddressBeforeAnyAddress) {
+	NetworkAddress server(kLocalhost, 9422);
+	int exact = listenAs(server);
+	int any = listenAs(NetworkAddress(0, server.port));
+	int other = listenAs(NetworkAddress(kLocalhost, server.port + 1));
+
+	connect(server);
+	EXPECT_TRUE(accepted(exact));
+	EXPECT_FALSE(accepted(any));
+	EXPECT_FALSE(accepted(other));
+
+	// a chunkserver listening on all addresses
+	close(exact);
+	unlink(ChunkConnector::localSocketPath(directory_.name(), server).c_str());
+	connect(server);
+	EXPECT_TRUE(accepted(any));
+	EXPECT_FALSE(accepted(other));
+}
+
+TEST_F(ChunkConnectorTests, TcpWithoutLocalSocket) {
+	int tcp = tcpsocket();
+	ASSERT_GE(tcp, 0);
+	fds_.push_back(tcp);
+	ASSERT_EQ(0, tcpnumlisten(tcp, kLocalhost, 0, 10));
+	uint32_t ip;
+	uint16_t port;
+	ASSERT_EQ(0, tcpgetmyaddr(tcp, &ip, &port));
+	NetworkAddress server(kLocalhost, port);
+
+	// a socket left by a chunkserver which is no longer running
+	close(listenAs(server));
+
+	connect(server);
+	EXPECT_TRUE(accepted(tcp, 5000));
+
+	// connecting chunkservers of this host with UNIX sockets disabled
+	connector_.setLocalSocketDirectory("");
+	int local = listenAs(server);
+	connect(server);
+	EXPECT_FALSE(accepted(local));
+	EXPECT_TRUE(accepted(tcp, 5000));
+}
+
+TEST_F(ChunkConnectorTests, UnixListenReplacesOnlyStaleSockets) {
+	std::string path = directory_.name() + "/test.sock";
+	int first = listenOn(path);
+
+	int second = unixsocket();
+	ASSERT_GE(second, 0);
+	fds_.push_back(second);
+	EXPECT_EQ(-1, unixlisten(second, path.c_str(), 10));
+	EXPECT_EQ(EADDRINUSE, errno);
+
+	// the socket file is left behind, but nobody accepts connections anymore
+	close(first);
+	EXPECT_EQ(0, unixlisten(second, path.c_str(), 10));
+}
@@ -0,0 +1,34 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <vector>
+
+#include "common/chunk_type_with_address.h"
+#include "common/serialization_macros.h"
+
+/// Version and locations of a chunk, as needed by a client to read it.
+SERIALIZABLE_CLASS_BEGIN(ChunkWithLocations)
+SERIALIZABLE_CLASS_BODY(ChunkWithLocations,
+	uint64_t, chunk_id,
+	uint32_t, chunk_version,
+	std::vector<ChunkTypeWithAddress>, locations)
+SERIALIZABLE_CLASS_END;
@@ -19,12 +19,42 @@
 #include "common/platform.h"
 #include "common/chunkserver_stats.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <mutex>
 #include <unordered_map>
 
+#include "protocol/MFSCommunication.h"
+
+// MovingAverage implementation
+
+constexpr double ChunkserverStats::ChunkserverEntry::MovingAverage::kWeight;
+constexpr double ChunkserverStats::ChunkserverEntry::MovingAverage::kLifetime_s;
+
+void ChunkserverStats::ChunkserverEntry::MovingAverage::add(double sample) {
+	double current = value();
+	value_ = hasSamples_ ? current + kWeight * (sample - current) : sample;
+	hasSamples_ = true;
+	lastSample_.reset();
+}
+
+double ChunkserverStats::ChunkserverEntry::MovingAverage::value() const {
+	if (!hasSamples_) {
+		return 0;
+	}
+	double age_s = lastSample_.elapsed_us() / 1000000.;
+	return value_ * std::exp(-age_s / kLifetime_s);
+}
+
 // ChunkserverEntry implementation
 
 constexpr int ChunkserverStats::ChunkserverEntry::defectiveTimeout_ms;
+constexpr double ChunkserverStats::ChunkserverEntry::kReferenceBlockTime_us;
+constexpr int ChunkserverStats::ChunkserverEntry::kReadSamples;
+constexpr int ChunkserverStats::ChunkserverEntry::kMinReadSamplesForPercentile;
+constexpr double ChunkserverStats::kHedgeTokensPerRead;
+constexpr double ChunkserverStats::kMaxHedgeTokens;
 
 ChunkserverStats::ChunkserverEntry::ChunkserverEntry(): pendingReads_(0), pendingWrites_(0),
 		defects_(0), defectiveTimeout_(std::chrono::milliseconds(defectiveTimeout_ms)) {
@@ -38,6 +68,13 @@ const ChunkserverStats::ChunkserverEntry ChunkserverStats::getStatisticsFor(
 	return chunkserverEntries_[address];
 }
 
+std::vector<std::pair<NetworkAddress, ChunkserverStats::ChunkserverEntry>>
+ChunkserverStats::getAllStatistics() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return std::vector<std::pair<NetworkAddress, ChunkserverEntry>>(
+			chunkserverEntries_.begin(), chunkserverEntries_.end());
+}
+
 void ChunkserverStats::registerReadOperation(const NetworkAddress& address) {
 	std::unique_lock<std::mutex> lock(mutex_);
 	chunkserverEntries_[address].pendingReads_++;
@@ -72,12 +109,81 @@ void ChunkserverStats::markDefective(const NetworkAddress& address) {
 	chunkserver.defectiveTimeout_.reset();
 }
 
+void ChunkserverStats::reportReadTime(const NetworkAddress& address, uint32_t bytes,
+		int64_t time_us) {
+	time_us = std::max<int64_t>(time_us, 1);
+	PerThreadLatencyHistograms *histograms = latencyHistograms_.load(std::memory_order_acquire);
+	if (histograms) {
+		histograms->add(readLatencySeries_, time_us);
+	}
+	uint32_t blocks = std::max<uint32_t>((bytes + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE, 1);
+	std::unique_lock<std::mutex> lock(mutex_);
+	ChunkserverEntry &chunkserver = chunkserverEntries_[address];
+	chunkserver.readBlockTime_.add(double(time_us) / blocks);
+	chunkserver.readThroughput_.add(bytes * 1000000. / time_us);
+	if (chunkserver.readBlockTimeSamples_.full()) {
+		chunkserver.readBlockTimeSamples_.pop_front();
+	}
+	chunkserver.readBlockTimeSamples_.push_back(double(time_us) / blocks);
+	hedgeTokens_ = std::min(hedgeTokens_ + kHedgeTokensPerRead, kMaxHedgeTokens);
+}
+
+void ChunkserverStats::reportWriteTime(const NetworkAddress& address, uint32_t bytes,
+		int64_t time_us) {
+	time_us = std::max<int64_t>(time_us, 1);
+	PerThreadLatencyHistograms *histograms = latencyHistograms_.load(std::memory_order_acquire);
+	if (histograms) {
+		histograms->add(writeLatencySeries_, time_us);
+	}
+	uint32_t blocks = std::max<uint32_t>((bytes + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE, 1);
+	std::unique_lock<std::mutex> lock(mutex_);
+	ChunkserverEntry &chunkserver = chunkserverEntries_[address];
+	chunkserver.writeBlockTime_.add(double(time_us) / blocks);
+	chunkserver.writeThroughput_.add(bytes * 1000000. / time_us);
+}
+
+void ChunkserverStats::setLatencyHistograms(PerThreadLatencyHistograms *histograms) {
+	readLatencySeries_ = histograms->series("chunkserver_ops.read");
+	writeLatencySeries_ = histograms->series("chunkserver_ops.write");
+	latencyHistograms_.store(histograms, std::memory_order_release);
+}
+
+bool ChunkserverStats::tryAcquireHedge() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (hedgeTokens_ < 1) {
+		return false;
+	}
+	hedgeTokens_ -= 1;
+	return true;
+}
+
+double ChunkserverStats::ChunkserverEntry::readBlockTimePercentile_us(double percentile) const {
+	int count = readBlockTimeSamples_.size();
+	if (count < kMinReadSamplesForPercentile) {
+		return 0;
+	}
+	std::array<float, kReadSamples> samples;
+	for (int i = 0; i < count; ++i) {
+		samples[i] = readBlockTimeSamples_[i];
+	}
+	int n = std::min<int>(count - 1, percentile * count);
+	std::nth_element(samples.begin(), samples.begin() + n, samples.begin() + count);
+	return samples[n];
+}
+
 float ChunkserverStats::ChunkserverEntry::score() const {
+	float score = 1;
 	if (defects_ > 0 && !defectiveTimeout_.expired()) {
-		return 1. / (defects_ + 1);
-	} else {
-		return 1;
+		score = 1. / (defects_ + 1);
+	}
+	// Expected time of an operation queued after all pending ones. The result is kept in
+	// (0.5, 1], so that a working chunkserver is always preferred over a defective one.
+	double blockTime_us = std::max(readBlockTime_.value(), writeBlockTime_.value());
+	if (blockTime_us > 0) {
+		double expected_us = blockTime_us * (1 + getOperationCount());
+		score *= 0.5 + 0.5 * kReferenceBlockTime_us / (kReferenceBlockTime_us + expected_us);
 	}
+	return score;
 }
 
 // ChunkserverStatsProxy implementation
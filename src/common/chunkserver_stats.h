@@ -20,11 +20,16 @@
 
 #include "common/platform.h"
 
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "common/latency_histogram.h"
 #include "common/network_address.h"
+#include "common/ring_buffer.h"
 #include "common/time_utils.h"
 
 // For each chunkserver, track how many operations on this chunksrever are being performed by us
@@ -42,6 +47,20 @@
 //
 // Successful operations on chunkservers considered "defective" should call markWorking().
 //
+// Finished operations should report their duration with reportReadTime() or reportWriteTime().
+// Exponentially weighted moving averages of the time needed to transfer one block and of the
+// throughput are kept for each chunkserver, so that among working chunkservers the ones which
+// respond faster (and have less pending operations) get a higher score. The averages fade away
+// when a chunkserver isn't used for a while, so that it is tried again eventually.
+//
+// Durations of all reported operations can also be recorded in latency histograms
+// (series chunkserver_ops.read and chunkserver_ops.write), see setLatencyHistograms().
+//
+// Readers may hedge reads which take longer than a percentile of recent read times of the
+// chunkserver (see readBlockTimePercentile_us()). Each hedge has to take a token from a global
+// budget (tryAcquireHedge()), which grows with each finished read, so that hedges never add
+// more than a small fraction of extra load.
+//
 // All methods are thread safe.
 //
 class ChunkserverStats {
@@ -62,15 +81,67 @@ public:
 			return pendingWrites_;
 		}
 
+		// Average time (in microseconds) needed to read/write one block, 0 if unknown
+		double readBlockTime_us() const {
+			return readBlockTime_.value();
+		}
+
+		double writeBlockTime_us() const {
+			return writeBlockTime_.value();
+		}
+
+		// Average throughput (in bytes per second) of reads/writes, 0 if unknown
+		double readThroughput() const {
+			return readThroughput_.value();
+		}
+
+		double writeThroughput() const {
+			return writeThroughput_.value();
+		}
+
+		uint32_t defects() const {
+			return defects_;
+		}
+
+		// Given percentile (0..1) of recent times (in microseconds) needed to read one block,
+		// 0 if there are too few samples
+		double readBlockTimePercentile_us(double percentile) const;
+
 		float score() const;
 
 	private:
+		// Exponentially weighted moving average of reported samples. Its value decays
+		// towards 0 ("unknown") when no samples are reported.
+		class MovingAverage {
+		public:
+			MovingAverage() : value_(0), hasSamples_(false) {}
+
+			void add(double sample);
+			double value() const;
+
+		private:
+			static constexpr double kWeight = 0.2;
+			static constexpr double kLifetime_s = 10.;
+
+			double value_;
+			bool hasSamples_;
+			Timer lastSample_;
+		};
+
 		static constexpr int defectiveTimeout_ms = 2000;
+		static constexpr double kReferenceBlockTime_us = 10000.;
+		static constexpr int kReadSamples = 32;
+		static constexpr int kMinReadSamplesForPercentile = 8;
 
 		uint32_t pendingReads_;
 		uint32_t pendingWrites_;
 		uint32_t defects_;
 		Timeout defectiveTimeout_;
+		MovingAverage readBlockTime_;
+		MovingAverage writeBlockTime_;
+		MovingAverage readThroughput_;
+		MovingAverage writeThroughput_;
+		RingBuffer<float, kReadSamples> readBlockTimeSamples_;
 
 		friend class ChunkserverStats;
 	};
@@ -79,6 +150,9 @@ public:
 
 	const ChunkserverEntry getStatisticsFor(const NetworkAddress& address);
 
+	// returns a copy of entries of all known chunkservers
+	std::vector<std::pair<NetworkAddress, ChunkserverEntry>> getAllStatistics();
+
 	void registerReadOperation(const NetworkAddress& address);
 	void unregisterReadOperation(const NetworkAddress& address);
 
@@ -88,8 +162,26 @@ public:
 	void markDefective(const NetworkAddress& address);
 	void markWorking(const NetworkAddress& address);
 
+	// report a successfully finished operation which transferred 'bytes' in 'time_us'
+	void reportReadTime(const NetworkAddress& address, uint32_t bytes, int64_t time_us);
+	void reportWriteTime(const NetworkAddress& address, uint32_t bytes, int64_t time_us);
+
+	// takes a token from the hedging budget, returns false if there is none left
+	bool tryAcquireHedge();
+
+	// records durations of reported operations in the given histograms from now on
+	void setLatencyHistograms(PerThreadLatencyHistograms *histograms);
+
 private:
+	// fraction of finished reads which may be hedged and the maximal number of saved tokens
+	static constexpr double kHedgeTokensPerRead = 0.05;
+	static constexpr double kMaxHedgeTokens = 16.;
+
 	std::mutex mutex_;
+	std::atomic<PerThreadLatencyHistograms*> latencyHistograms_{nullptr};
+	unsigned readLatencySeries_ = 0;
+	unsigned writeLatencySeries_ = 0;
+	double hedgeTokens_ = 0;
 	std::unordered_map<NetworkAddress, ChunkserverEntry> chunkserverEntries_;
 };
 
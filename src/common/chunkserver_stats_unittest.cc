@@ -21,6 +21,8 @@
 
 #include <gtest/gtest.h>
 
+#include "protocol/MFSCommunication.h"
+
 TEST(ChunkserverStatsTests, ChunkserverStatsCounters) {
 	ChunkserverStats stats;
 	NetworkAddress server1(1111, 11);
@@ -138,3 +140,80 @@ TEST(ChunkserverStatsTests, AllPendingDefectiveLonger) {
 	EXPECT_EQ(stats.getStatisticsFor(server1).score(), 1.);
 	EXPECT_LT(stats.getStatisticsFor(server2).score(), 1.);
 }
+
+TEST(ChunkserverStatsTests, LatencyTracking) {
+	ChunkserverStats stats;
+	NetworkAddress fast(1111, 11);
+	NetworkAddress slow(2222, 22);
+
+	EXPECT_EQ(0., stats.getStatisticsFor(fast).readBlockTime_us());
+	for (int i = 0; i < 10; ++i) {
+		stats.reportReadTime(fast, 4 * MFSBLOCKSIZE, 4000);
+		stats.reportReadTime(slow, MFSBLOCKSIZE, 50000);
+	}
+	EXPECT_NEAR(1000., stats.getStatisticsFor(fast).readBlockTime_us(), 10.);
+	EXPECT_NEAR(50000., stats.getStatisticsFor(slow).readBlockTime_us(), 500.);
+	EXPECT_NEAR(4. * MFSBLOCKSIZE * 250, stats.getStatisticsFor(fast).readThroughput(),
+			MFSBLOCKSIZE * 10.);
+
+	// both are working, so both are still preferred over a defective one
+	EXPECT_GT(stats.getStatisticsFor(fast).score(), stats.getStatisticsFor(slow).score());
+	EXPECT_GT(stats.getStatisticsFor(slow).score(), 0.5);
+	stats.markDefective(fast);
+	EXPECT_LE(stats.getStatisticsFor(fast).score(), 0.5);
+	stats.markWorking(fast);
+
+	// pending operations make a chunkserver less attractive
+	float idle_score = stats.getStatisticsFor(fast).score();
+	stats.registerReadOperation(fast);
+	EXPECT_LT(stats.getStatisticsFor(fast).score(), idle_score);
+	stats.unregisterReadOperation(fast);
+
+	// a slow write is taken into account, too
+	stats.reportWriteTime(fast, MFSBLOCKSIZE, 1000000);
+	EXPECT_LT(stats.getStatisticsFor(fast).score(), stats.getStatisticsFor(slow).score());
+	EXPECT_EQ(2u, stats.getAllStatistics().size());
+}
+
+TEST(ChunkserverStatsTests, ReadTimePercentile) {
+	ChunkserverStats stats;
+	NetworkAddress server1(1111, 11);
+
+	for (int i = 1; i < 8; ++i) {
+		stats.reportReadTime(server1, MFSBLOCKSIZE, i * 1000);
+	}
+	// too few samples
+	EXPECT_EQ(0., stats.getStatisticsFor(server1).readBlockTimePercentile_us(0.95));
+
+	for (int i = 8; i <= 100; ++i) {
+		stats.reportReadTime(server1, 2 * MFSBLOCKSIZE, 2 * i * 1000);
+	}
+	// only the most recent samples (69..100 ms) are taken into account
+	EXPECT_EQ(69000., stats.getStatisticsFor(server1).readBlockTimePercentile_us(0.));
+	EXPECT_EQ(85000., stats.getStatisticsFor(server1).readBlockTimePercentile_us(0.5));
+	EXPECT_EQ(99000., stats.getStatisticsFor(server1).readBlockTimePercentile_us(0.95));
+	EXPECT_EQ(100000., stats.getStatisticsFor(server1).readBlockTimePercentile_us(1.));
+}
+
+TEST(ChunkserverStatsTests, HedgeBudget) {
+	ChunkserverStats stats;
+	NetworkAddress server1(1111, 11);
+
+	EXPECT_FALSE(stats.tryAcquireHedge());
+	for (int i = 0; i < 30; ++i) {
+		stats.reportReadTime(server1, MFSBLOCKSIZE, 1000);
+	}
+	// 5% of reads may be hedged
+	EXPECT_TRUE(stats.tryAcquireHedge());
+	EXPECT_FALSE(stats.tryAcquireHedge());
+
+	// tokens don't accumulate without limit
+	for (int i = 0; i < 100000; ++i) {
+		stats.reportReadTime(server1, MFSBLOCKSIZE, 1000);
+	}
+	int hedges = 0;
+	while (stats.tryAcquireHedge()) {
+		++hedges;
+	}
+	EXPECT_EQ(16, hedges);
+}
@@ -0,0 +1,400 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*! \brief Set of half-open intervals [start, end) allowing fast overlap queries.
+ *
+ * Elements are kept in a treap ordered by (start, end, insertion order), each node
+ * is augmented with the greatest end of intervals in its subtree. Insertion and
+ * removal take O(log n), finding intervals overlapping a given range takes O(log n + k)
+ * expected time. Elements with equal bounds are kept in insertion order.
+ *
+ * T has to provide 'start' and 'end' members convertible to Offset. Iterators give
+ * mutable access to elements, but their bounds must not be modified in place.
+ */
+template <typename T, typename Offset = uint64_t>
+class interval_tree {
+	struct Node {
+		template <typename... Args>
+		Node(uint64_t sequence, Args &&... args)
+		    : value(std::forward<Args>(args)...),
+		      max_end(value.end),
+		      sequence(sequence),
+		      priority(mix(sequence)),
+		      left(nullptr),
+		      right(nullptr),
+		      parent(nullptr) {
+		}
+
+		T value;
+		Offset max_end;
+		uint64_t sequence;
+		uint64_t priority;
+		Node *left;
+		Node *right;
+		Node *parent;
+	};
+
+public:
+	template <typename NodeType, typename ValueType>
+	class iterator_base {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef ValueType value_type;
+		typedef ValueType &reference;
+		typedef ValueType *pointer;
+		typedef std::ptrdiff_t difference_type;
+
+		iterator_base() : node_(nullptr) {
+		}
+
+		explicit iterator_base(NodeType *node) : node_(node) {
+		}
+
+		// Conversion from iterator to const_iterator
+		template <typename OtherNode, typename OtherValue,
+		          typename = typename std::enable_if<std::is_convertible<OtherNode *,
+		                                                                 NodeType *>::value>::type>
+		iterator_base(const iterator_base<OtherNode, OtherValue> &other) : node_(other.node_) {
+		}
+
+		reference operator*() const {
+			return node_->value;
+		}
+
+		pointer operator->() const {
+			return &node_->value;
+		}
+
+		iterator_base &operator++() {
+			node_ = interval_tree::next(node_);
+			return *this;
+		}
+
+		iterator_base operator++(int) {
+			iterator_base result = *this;
+			++(*this);
+			return result;
+		}
+
+		bool operator==(const iterator_base &other) const {
+			return node_ == other.node_;
+		}
+
+		bool operator!=(const iterator_base &other) const {
+			return node_ != other.node_;
+		}
+
+	private:
+		NodeType *node_;
+
+		template <typename, typename>
+		friend class iterator_base;
+		friend class interval_tree;
+	};
+
+	typedef T value_type;
+	typedef std::size_t size_type;
+	typedef iterator_base<Node, T> iterator;
+	typedef iterator_base<const Node, const T> const_iterator;
+
+	interval_tree() : root_(nullptr), size_(0), sequence_(0) {
+	}
+
+	interval_tree(interval_tree &&other) noexcept
+	    : root_(other.root_), size_(other.size_), sequence_(other.sequence_) {
+		other.root_ = nullptr;
+		other.size_ = 0;
+	}
+
+	interval_tree &operator=(interval_tree &&other) noexcept {
+		std::swap(root_, other.root_);
+		std::swap(size_, other.size_);
+		std::swap(sequence_, other.sequence_);
+		return *this;
+	}
+
+	interval_tree(const interval_tree &other) = delete;
+	interval_tree &operator=(const interval_tree &other) = delete;
+
+	~interval_tree() {
+		clear();
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	size_type size() const {
+		return size_;
+	}
+
+	iterator begin() {
+		return iterator(leftmost(root_));
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+	const_iterator begin() const {
+		return const_iterator(leftmost(root_));
+	}
+
+	const_iterator end() const {
+		return const_iterator();
+	}
+
+	template <typename... Args>
+	iterator emplace(Args &&... args) {
+		Node *node = new Node(sequence_++, std::forward<Args>(args)...);
+		Node *parent = nullptr;
+		Node **link = &root_;
+		while (*link) {
+			parent = *link;
+			parent->max_end = std::max<Offset>(parent->max_end, node->max_end);
+			link = less(node, parent) ? &parent->left : &parent->right;
+		}
+		*link = node;
+		node->parent = parent;
+		while (node->parent && node->parent->priority < node->priority) {
+			rotate_up(node);
+		}
+		++size_;
+		return iterator(node);
+	}
+
+	iterator insert(const T &value) {
+		return emplace(value);
+	}
+
+	iterator insert(T &&value) {
+		return emplace(std::move(value));
+	}
+
+	/*! \brief Removes an element.
+	 * \return iterator following the removed element
+	 */
+	iterator erase(const_iterator position) {
+		Node *node = const_cast<Node *>(position.node_);
+		assert(node);
+		Node *following = next(node);
+		remove(node);
+		return iterator(following);
+	}
+
+	void clear() {
+		destroy(root_);
+		root_ = nullptr;
+		size_ = 0;
+	}
+
+	/*! \brief Finds the first (in order) element overlapping with [start, end) for which
+	 * pred returns true.
+	 */
+	template <typename UnaryPredicate>
+	iterator find_overlapping(Offset start, Offset end, UnaryPredicate pred) {
+		Node *result = nullptr;
+		visit_overlapping(root_, start, end, [&result, &pred](Node *node) {
+			if (pred(static_cast<const T &>(node->value))) {
+				result = node;
+				return true;
+			}
+			return false;
+		});
+		return iterator(result);
+	}
+
+	template <typename UnaryPredicate>
+	const_iterator find_overlapping(Offset start, Offset end, UnaryPredicate pred) const {
+		return const_cast<interval_tree *>(this)->find_overlapping(start, end, pred);
+	}
+
+	/*! \brief Calls func for all elements overlapping with [start, end) in order. */
+	template <typename Func>
+	void for_each_overlapping(Offset start, Offset end, Func func) {
+		visit_overlapping(root_, start, end, [&func](Node *node) {
+			func(node->value);
+			return false;
+		});
+	}
+
+	/*! \brief Moves all elements overlapping with [start, end) to output in order
+	 * and removes them.
+	 */
+	template <typename OutputIterator>
+	void extract_overlapping(Offset start, Offset end, OutputIterator output) {
+		std::vector<Node *> found;
+		visit_overlapping(root_, start, end, [&found](Node *node) {
+			found.push_back(node);
+			return false;
+		});
+		// Removal rotates the tree, but it doesn't invalidate other nodes
+		for (Node *node : found) {
+			*output++ = std::move(node->value);
+			remove(node);
+		}
+	}
+
+private:
+	static uint64_t mix(uint64_t x) {
+		// splitmix64 finalizer - deterministic, but well distributed priorities
+		x += 0x9E3779B97F4A7C15ULL;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
+	}
+
+	static bool less(const Node *a, const Node *b) {
+		if (a->value.start != b->value.start) {
+			return a->value.start < b->value.start;
+		}
+		if (a->value.end != b->value.end) {
+			return a->value.end < b->value.end;
+		}
+		return a->sequence < b->sequence;
+	}
+
+	template <typename NodeType>
+	static NodeType *leftmost(NodeType *node) {
+		if (node) {
+			while (node->left) {
+				node = node->left;
+			}
+		}
+		return node;
+	}
+
+	template <typename NodeType>
+	static NodeType *next(NodeType *node) {
+		if (node->right) {
+			return leftmost(node->right);
+		}
+		while (node->parent && node->parent->right == node) {
+			node = node->parent;
+		}
+		return node->parent;
+	}
+
+	static void update(Node *node) {
+		Offset max_end = node->value.end;
+		if (node->left) {
+			max_end = std::max<Offset>(max_end, node->left->max_end);
+		}
+		if (node->right) {
+			max_end = std::max<Offset>(max_end, node->right->max_end);
+		}
+		node->max_end = max_end;
+	}
+
+	void replace_child(Node *parent, Node *child, Node *replacement) {
+		if (!parent) {
+			root_ = replacement;
+		} else if (parent->left == child) {
+			parent->left = replacement;
+		} else {
+			parent->right = replacement;
+		}
+		if (replacement) {
+			replacement->parent = parent;
+		}
+	}
+
+	/*! \brief Rotates node above its parent. */
+	void rotate_up(Node *node) {
+		Node *parent = node->parent;
+		replace_child(parent->parent, parent, node);
+		if (parent->left == node) {
+			parent->left = node->right;
+			if (node->right) {
+				node->right->parent = parent;
+			}
+			node->right = parent;
+		} else {
+			parent->right = node->left;
+			if (node->left) {
+				node->left->parent = parent;
+			}
+			node->left = parent;
+		}
+		parent->parent = node;
+		update(parent);
+		update(node);
+	}
+
+	void remove(Node *node) {
+		while (node->left || node->right) {
+			Node *child = node->left;
+			if (!child || (node->right && node->right->priority > child->priority)) {
+				child = node->right;
+			}
+			rotate_up(child);
+		}
+		Node *parent = node->parent;
+		replace_child(parent, node, nullptr);
+		for (; parent; parent = parent->parent) {
+			update(parent);
+		}
+		delete node;
+		--size_;
+	}
+
+	static void destroy(Node *node) {
+		while (node) {
+			destroy(node->right);
+			Node *left = node->left;
+			delete node;
+			node = left;
+		}
+	}
+
+	/*! \brief Visits nodes overlapping with [start, end) in order until visitor returns true.
+	 */
+	template <typename Visitor>
+	static bool visit_overlapping(Node *node, Offset start, Offset end, Visitor &&visitor) {
+		while (node && node->max_end > start) {
+			if (visit_overlapping(node->left, start, end, visitor)) {
+				return true;
+			}
+			if (!(node->value.start < end)) {
+				return false;
+			}
+			if (start < node->value.end && visitor(node)) {
+				return true;
+			}
+			node = node->right;
+		}
+		return false;
+	}
+
+	Node *root_;
+	size_type size_;
+	uint64_t sequence_;
+};
@@ -0,0 +1,110 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/interval_tree.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Interval {
+	uint64_t start;
+	uint64_t end;
+	int id;
+};
+
+std::vector<int> ids(const std::vector<Interval> &intervals) {
+	std::vector<int> result;
+	for (const auto &interval : intervals) {
+		result.push_back(interval.id);
+	}
+	return result;
+}
+
+} // anonymous namespace
+
+TEST(IntervalTreeTests, OrderAndOverlap) {
+	interval_tree<Interval> tree;
+	tree.insert({10, 20, 1});
+	tree.insert({0, 100, 2});
+	tree.insert({10, 20, 3});
+	tree.insert({30, 40, 4});
+	tree.insert({5, 6, 5});
+	EXPECT_EQ(5U, tree.size());
+
+	std::vector<Interval> all(tree.begin(), tree.end());
+	EXPECT_EQ(std::vector<int>({2, 5, 1, 3, 4}), ids(all));
+
+	std::vector<Interval> found;
+	tree.for_each_overlapping(15, 35, [&found](const Interval &i) { found.push_back(i); });
+	EXPECT_EQ(std::vector<int>({2, 1, 3, 4}), ids(found));
+
+	auto it = tree.find_overlapping(6, 31, [](const Interval &i) { return i.id > 2; });
+	ASSERT_NE(tree.end(), it);
+	EXPECT_EQ(3, it->id);
+
+	found.clear();
+	tree.extract_overlapping(20, 30, std::back_inserter(found));
+	EXPECT_EQ(std::vector<int>({2}), ids(found));
+	all.assign(tree.begin(), tree.end());
+	EXPECT_EQ(std::vector<int>({5, 1, 3, 4}), ids(all));
+}
+
+TEST(IntervalTreeTests, RandomizedAgainstVector) {
+	std::mt19937 random(42);
+	interval_tree<Interval> tree;
+	std::vector<Interval> reference;
+
+	for (int id = 0; id < 5000; ++id) {
+		uint64_t start = random() % 10000;
+		uint64_t end = start + random() % (id % 10 == 0 ? 5000 : 50) + 1;
+		if (random() % 3 == 0 && !reference.empty()) {
+			auto position = reference.begin() + random() % reference.size();
+			auto it = std::find_if(tree.begin(), tree.end(),
+					[&position](const Interval &i) { return i.id == position->id; });
+			ASSERT_NE(tree.end(), it);
+			tree.erase(it);
+			reference.erase(position);
+		} else {
+			tree.insert({start, end, id});
+			reference.push_back({start, end, id});
+		}
+
+		std::vector<Interval> found, expected;
+		tree.for_each_overlapping(start, end, [&found](const Interval &i) { found.push_back(i); });
+		std::copy_if(reference.begin(), reference.end(), std::back_inserter(expected),
+				[start, end](const Interval &i) { return i.start < end && start < i.end; });
+		std::sort(expected.begin(), expected.end(), [](const Interval &a, const Interval &b) {
+			return a.start < b.start
+				|| (a.start == b.start && (a.end < b.end || (a.end == b.end && a.id < b.id)));
+		});
+		ASSERT_EQ(ids(expected), ids(found));
+	}
+	EXPECT_EQ(reference.size(), tree.size());
+
+	std::vector<Interval> extracted;
+	tree.extract_overlapping(0, 20000, std::back_inserter(extracted));
+	EXPECT_EQ(reference.size(), extracted.size());
+	EXPECT_TRUE(tree.empty());
+	EXPECT_EQ(tree.begin(), tree.end());
+}
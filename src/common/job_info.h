@@ -24,3 +24,14 @@
 LIZARDFS_DEFINE_SERIALIZABLE_CLASS(JobInfo,
 		uint64_t, id,
 		std::string, description);
+
+/*! \brief JobInfo extended with progress of the job.
+ *
+ * processed_nodes is the number of nodes handled by the job so far and running_time
+ * the number of seconds since the job was submitted.
+ */
+LIZARDFS_DEFINE_SERIALIZABLE_CLASS(JobProgressInfo,
+		uint64_t, id,
+		std::string, description,
+		uint64_t, processed_nodes,
+		uint32_t, running_time);
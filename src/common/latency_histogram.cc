@@ -0,0 +1,185 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/latency_histogram.h"
+
+#include <cmath>
+
+#include "common/massert.h"
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+	for (int i = 0; i < kBuckets; ++i) {
+		buckets_[i] += other.buckets_[i];
+	}
+	sum_us_ += other.sum_us_;
+}
+
+void LatencyHistogram::subtract(const LatencyHistogram& other) {
+	for (int i = 0; i < kBuckets; ++i) {
+		buckets_[i] -= std::min(buckets_[i], other.buckets_[i]);
+	}
+	sum_us_ -= std::min(sum_us_, other.sum_us_);
+}
+
+uint64_t LatencyHistogram::count() const {
+	uint64_t result = 0;
+	for (uint64_t bucket_count : buckets_) {
+		result += bucket_count;
+	}
+	return result;
+}
+
+uint64_t LatencyHistogram::percentile_us(double percentile) const {
+	uint64_t total = count();
+	if (total == 0) {
+		return 0;
+	}
+	// number of samples not greater than the percentile, at least 1
+	uint64_t rank = std::max<uint64_t>(std::ceil(total * percentile / 100.), 1);
+	uint64_t seen = 0;
+	for (int i = 0; i < kBuckets; ++i) {
+		seen += buckets_[i];
+		if (seen >= rank) {
+			return bucketLimit_us(i);
+		}
+	}
+	return bucketLimit_us(kBuckets - 1);
+}
+
+PerThreadLatencyHistograms::Counters::Counters() : sum_us(0) {
+	for (auto& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+}
+
+PerThreadLatencyHistograms::ThreadHistograms::ThreadHistograms(PerThreadLatencyHistograms *owner)
+		: owner(owner),
+		  used(true) {
+	for (auto& counters : series) {
+		counters.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+PerThreadLatencyHistograms::ThreadHistograms::~ThreadHistograms() {
+	for (auto& counters : series) {
+		delete counters.load(std::memory_order_relaxed);
+	}
+}
+
+PerThreadLatencyHistograms::PerThreadLatencyHistograms() {
+	eassert(pthread_key_create(&key_, &PerThreadLatencyHistograms::releaseThreadHistograms) == 0);
+}
+
+PerThreadLatencyHistograms::~PerThreadLatencyHistograms() {
+	pthread_key_delete(key_);
+}
+
+unsigned PerThreadLatencyHistograms::series(const std::string& name) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = std::find(names_.begin(), names_.end(), name);
+	if (it != names_.end()) {
+		return it - names_.begin();
+	}
+	if (names_.size() >= kMaxSeries) {
+		return kMaxSeries;
+	}
+	names_.push_back(name);
+	baseline_.emplace_back();
+	return names_.size() - 1;
+}
+
+void PerThreadLatencyHistograms::add(unsigned series, uint64_t time_us) {
+	if (series >= kMaxSeries) {
+		return;
+	}
+	ThreadHistograms *histograms = threadHistograms();
+	Counters *counters = histograms->series[series].load(std::memory_order_relaxed);
+	if (counters == nullptr) {
+		counters = new Counters();
+		histograms->series[series].store(counters, std::memory_order_release);
+	}
+	// Only this thread modifies the counters, collect() may read them at any time
+	std::atomic<uint64_t>& bucket = counters->buckets[LatencyHistogram::bucket(time_us)];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	counters->sum_us.store(counters->sum_us.load(std::memory_order_relaxed) + time_us,
+			std::memory_order_relaxed);
+}
+
+PerThreadLatencyHistograms::ThreadHistograms *PerThreadLatencyHistograms::threadHistograms() {
+	void *histograms = pthread_getspecific(key_);
+	if (histograms != nullptr) {
+		return static_cast<ThreadHistograms*>(histograms);
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	ThreadHistograms *result = nullptr;
+	for (const auto& thread : threads_) {
+		if (!thread->used) {
+			thread->used = true;
+			result = thread.get();
+			break;
+		}
+	}
+	if (result == nullptr) {
+		threads_.emplace_back(new ThreadHistograms(this));
+		result = threads_.back().get();
+	}
+	pthread_setspecific(key_, result);
+	return result;
+}
+
+void PerThreadLatencyHistograms::releaseThreadHistograms(void *histograms) {
+	ThreadHistograms *thread = static_cast<ThreadHistograms*>(histograms);
+	std::unique_lock<std::mutex> lock(thread->owner->mutex_);
+	thread->used = false;
+}
+
+std::vector<LatencyHistogram> PerThreadLatencyHistograms::collectAll() const {
+	std::vector<LatencyHistogram> result(names_.size());
+	for (const auto& thread : threads_) {
+		for (unsigned i = 0; i < result.size(); ++i) {
+			const Counters *counters = thread->series[i].load(std::memory_order_acquire);
+			if (counters == nullptr) {
+				continue;
+			}
+			for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+				result[i].buckets_[b] += counters->buckets[b].load(std::memory_order_relaxed);
+			}
+			result[i].sum_us_ += counters->sum_us.load(std::memory_order_relaxed);
+		}
+	}
+	return result;
+}
+
+std::vector<std::pair<std::string, LatencyHistogram>> PerThreadLatencyHistograms::collect() const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	std::vector<LatencyHistogram> histograms = collectAll();
+	std::vector<std::pair<std::string, LatencyHistogram>> result;
+	for (unsigned i = 0; i < histograms.size(); ++i) {
+		histograms[i].subtract(baseline_[i]);
+		if (histograms[i].count() > 0) {
+			result.emplace_back(names_[i], histograms[i]);
+		}
+	}
+	return result;
+}
+
+void PerThreadLatencyHistograms::reset() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	baseline_ = collectAll();
+}
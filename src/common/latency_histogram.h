@@ -0,0 +1,144 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <pthread.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*! \brief Histogram of operation latencies.
+ *
+ * Bucket 0 counts latencies shorter than 1 us, bucket i > 0 counts latencies
+ * in [2^(i-1), 2^i) us. The last bucket counts all latencies longer than that too.
+ */
+class LatencyHistogram {
+public:
+	static constexpr int kBuckets = 32;
+
+	LatencyHistogram() : buckets_(), sum_us_(0) {
+	}
+
+	void add(uint64_t time_us) {
+		buckets_[bucket(time_us)]++;
+		sum_us_ += time_us;
+	}
+
+	void add(const LatencyHistogram& other);
+	void subtract(const LatencyHistogram& other);
+
+	uint64_t count() const;
+
+	uint64_t sum_us() const {
+		return sum_us_;
+	}
+
+	uint64_t bucketCount(int bucket) const {
+		return buckets_[bucket];
+	}
+
+	/// Returns upper bound of the bucket containing the given percentile, 0 if empty.
+	uint64_t percentile_us(double percentile) const;
+
+	/// Returns the (exclusive) upper bound of latencies counted in the given bucket.
+	static uint64_t bucketLimit_us(int bucket) {
+		return uint64_t(1) << bucket;
+	}
+
+	static int bucket(uint64_t time_us) {
+		int b = time_us == 0 ? 0 : 64 - __builtin_clzll(time_us);
+		return std::min(b, kBuckets - 1);
+	}
+
+private:
+	friend class PerThreadLatencyHistograms;
+
+	std::array<uint64_t, kBuckets> buckets_;
+	uint64_t sum_us_;
+};
+
+/*! \brief Latency histograms of many kinds of operations executed by many threads.
+ *
+ * Each kind of operations is a series registered by name with series(). Each thread records
+ * latencies in its own histograms, without locks and atomic read-modify-write instructions,
+ * so that recording can stay enabled in hot paths. collect() merges histograms of all threads.
+ *
+ * Histograms of a finished thread are taken over by the next new thread, so no samples are lost.
+ * reset() doesn't touch histograms of other threads, it only remembers current values
+ * to be subtracted by the following calls to collect().
+ */
+class PerThreadLatencyHistograms {
+public:
+	static constexpr unsigned kMaxSeries = 256;
+
+	PerThreadLatencyHistograms();
+	~PerThreadLatencyHistograms();
+
+	PerThreadLatencyHistograms(const PerThreadLatencyHistograms&) = delete;
+	PerThreadLatencyHistograms& operator=(const PerThreadLatencyHistograms&) = delete;
+
+	/// Returns id of the series with the given name, registering it if needed.
+	/// Returns kMaxSeries (ignored by add()) if there are too many series.
+	unsigned series(const std::string& name);
+
+	/// Records latency of an operation of the given series. Lock-free.
+	void add(unsigned series, uint64_t time_us);
+
+	/// Returns histograms of all non-empty series merged from all threads
+	/// (since the last reset()), in the order of registration.
+	std::vector<std::pair<std::string, LatencyHistogram>> collect() const;
+
+	void reset();
+
+private:
+	struct Counters {
+		Counters();
+
+		std::atomic<uint64_t> buckets[LatencyHistogram::kBuckets];
+		std::atomic<uint64_t> sum_us;
+	};
+
+	// Histograms recorded by one thread, allocated by the thread when it needs them
+	struct ThreadHistograms {
+		ThreadHistograms(PerThreadLatencyHistograms *owner);
+		~ThreadHistograms();
+
+		PerThreadLatencyHistograms *owner;
+		bool used;  // guarded by owner->mutex_
+		std::array<std::atomic<Counters*>, kMaxSeries> series;
+	};
+
+	ThreadHistograms *threadHistograms();
+	static void releaseThreadHistograms(void *histograms);
+	std::vector<LatencyHistogram> collectAll() const;
+
+	pthread_key_t key_;
+	mutable std::mutex mutex_;
+	std::vector<std::string> names_;
+	std::vector<std::unique_ptr<ThreadHistograms>> threads_;
+	std::vector<LatencyHistogram> baseline_;
+};
@@ -0,0 +1,101 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/latency_histogram.h"
+
+#include <thread>
+#include <gtest/gtest.h>
+
+TEST(LatencyHistogramTests, Buckets) {
+	EXPECT_EQ(0, LatencyHistogram::bucket(0));
+	EXPECT_EQ(1, LatencyHistogram::bucket(1));
+	EXPECT_EQ(2, LatencyHistogram::bucket(2));
+	EXPECT_EQ(2, LatencyHistogram::bucket(3));
+	EXPECT_EQ(11, LatencyHistogram::bucket(1024));
+	EXPECT_EQ(LatencyHistogram::kBuckets - 1, LatencyHistogram::bucket(UINT64_MAX));
+	for (uint64_t time_us : {1, 5, 1000, 123456}) {
+		EXPECT_LT(time_us, LatencyHistogram::bucketLimit_us(LatencyHistogram::bucket(time_us)));
+	}
+}
+
+TEST(LatencyHistogramTests, Percentiles) {
+	LatencyHistogram histogram;
+	EXPECT_EQ(0u, histogram.percentile_us(50));
+
+	for (int i = 0; i < 990; ++i) {
+		histogram.add(100);
+	}
+	for (int i = 0; i < 10; ++i) {
+		histogram.add(10000);
+	}
+	EXPECT_EQ(1000u, histogram.count());
+	EXPECT_EQ(990u * 100 + 10u * 10000, histogram.sum_us());
+	EXPECT_EQ(128u, histogram.percentile_us(50));
+	EXPECT_EQ(128u, histogram.percentile_us(99));
+	EXPECT_EQ(16384u, histogram.percentile_us(99.9));
+	EXPECT_EQ(16384u, histogram.percentile_us(100));
+}
+
+TEST(LatencyHistogramTests, PerThreadHistograms) {
+	PerThreadLatencyHistograms histograms;
+	unsigned read = histograms.series("read");
+	unsigned write = histograms.series("write");
+	EXPECT_NE(read, write);
+	EXPECT_EQ(read, histograms.series("read"));
+	EXPECT_TRUE(histograms.collect().empty());
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&histograms, read]() {
+			for (int i = 0; i < 1000; ++i) {
+				histograms.add(read, 10);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	histograms.add(write, 3000);
+
+	auto collected = histograms.collect();
+	ASSERT_EQ(2u, collected.size());
+	EXPECT_EQ("read", collected[0].first);
+	EXPECT_EQ(4000u, collected[0].second.count());
+	EXPECT_EQ(40000u, collected[0].second.sum_us());
+	EXPECT_EQ("write", collected[1].first);
+	EXPECT_EQ(4096u, collected[1].second.percentile_us(50));
+
+	histograms.reset();
+	EXPECT_TRUE(histograms.collect().empty());
+	std::thread([&histograms, read]() { histograms.add(read, 1); }).join();
+	collected = histograms.collect();
+	ASSERT_EQ(1u, collected.size());
+	EXPECT_EQ(1u, collected[0].second.count());
+}
+
+TEST(LatencyHistogramTests, TooManySeries) {
+	PerThreadLatencyHistograms histograms;
+	for (unsigned i = 0; i < PerThreadLatencyHistograms::kMaxSeries; ++i) {
+		EXPECT_EQ(i, histograms.series("series" + std::to_string(i)));
+	}
+	unsigned overflow = histograms.series("overflow");
+	EXPECT_EQ(PerThreadLatencyHistograms::kMaxSeries, overflow);
+	histograms.add(overflow, 1);
+	EXPECT_TRUE(histograms.collect().empty());
+}
@@ -45,3 +45,8 @@ constexpr uint32_t kFirstECVersion = lizardfsVersion(3, 9, 5);
 constexpr uint32_t kACL11Version = lizardfsVersion(3, 11, 0);
 constexpr uint32_t kRichACLVersion = lizardfsVersion(3, 12, 0);
 constexpr uint32_t kEC2Version = lizardfsVersion(3, 13, 0);
+constexpr uint32_t kReadChunksVersion = lizardfsVersion(3, 14, 0);
+constexpr uint32_t kCompoundRequestVersion = lizardfsVersion(3, 14, 0);
+constexpr uint32_t kCacheInvalidationVersion = lizardfsVersion(3, 14, 0);
+constexpr uint32_t kSessionQueuesVersion = lizardfsVersion(3, 14, 0);
+constexpr uint32_t kTaskProgressVersion = lizardfsVersion(3, 14, 0);
@@ -0,0 +1,229 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/output_buffer_chain.h"
+
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "common/datapack.h"
+#include "common/massert.h"
+
+constexpr uint32_t OutputBufferChain::kPageSize;
+constexpr uint32_t OutputBufferChain::kCopyThreshold;
+constexpr int OutputBufferChain::kMaxIovecs;
+
+namespace {
+
+// Free pages are linked through their first bytes. Pages may be allocated by one thread
+// and released by another one (eg. by network I/O threads), so the pool is shared and
+// guarded by a mutex, which is taken once per page, not once per packet.
+// At most kMaxPooledPages are kept, the rest is freed.
+struct FreePage {
+	FreePage *next;
+};
+
+const uint32_t kMaxPooledPages = 1024;
+
+std::mutex gFreePagesMutex;
+FreePage *gFreePages = nullptr;
+uint32_t gFreePagesCount = 0;
+
+uint8_t *getPage() {
+	{
+		std::lock_guard<std::mutex> lock(gFreePagesMutex);
+		if (gFreePages != nullptr) {
+			FreePage *page = gFreePages;
+			gFreePages = page->next;
+			--gFreePagesCount;
+			return reinterpret_cast<uint8_t*>(page);
+		}
+	}
+	uint8_t *page = static_cast<uint8_t*>(malloc(OutputBufferChain::kPageSize));
+	passert(page);
+	return page;
+}
+
+void putPage(uint8_t *data) {
+	std::unique_lock<std::mutex> lock(gFreePagesMutex);
+	if (gFreePagesCount >= kMaxPooledPages) {
+		lock.unlock();
+		free(data);
+		return;
+	}
+	FreePage *page = reinterpret_cast<FreePage*>(data);
+	page->next = gFreePages;
+	gFreePages = page;
+	++gFreePagesCount;
+}
+
+} // anonymous namespace
+
+uint8_t *OutputBufferChain::allocate(uint32_t size) {
+	bytes_ += size;
+	appended_ += size;
+	if (size > kPageSize) {
+		segments_.push_back(Segment{nullptr, 0, size, 0, MessageBuffer(size)});
+		segments_.back().data = segments_.back().external.data();
+		return segments_.back().data;
+	}
+	if (segments_.size() > head_) {
+		Segment &last = segments_.back();
+		if (last.capacity > 0 && last.capacity - last.end >= size) {
+			uint8_t *ret = last.data + last.end;
+			last.end += size;
+			return ret;
+		}
+	}
+	segments_.push_back(Segment{getPage(), 0, size, kPageSize, MessageBuffer()});
+	return segments_.back().data;
+}
+
+uint8_t *OutputBufferChain::allocatePacket(uint32_t type, uint32_t length) {
+	uint8_t *ptr = allocate(PacketHeader::kSize + length);
+	packetAppended();
+	put32bit(&ptr, type);
+	put32bit(&ptr, length);
+	return ptr;
+}
+
+void OutputBufferChain::append(const uint8_t *data, uint32_t size) {
+	if (size > 0) {
+		memcpy(allocate(size), data, size);
+	}
+}
+
+void OutputBufferChain::append(const MessageBuffer& buffer) {
+	append(buffer.data(), buffer.size());
+	packetAppended();
+}
+
+void OutputBufferChain::append(MessageBuffer&& buffer) {
+	if (buffer.size() < kCopyThreshold) {
+		append(buffer.data(), buffer.size());
+		packetAppended();
+		return;
+	}
+	uint32_t size = buffer.size();
+	bytes_ += size;
+	appended_ += size;
+	segments_.push_back(Segment{nullptr, 0, size, 0, std::move(buffer)});
+	segments_.back().data = segments_.back().external.data();
+	packetAppended();
+}
+
+ssize_t OutputBufferChain::writeTo(int fd) {
+	struct iovec iov[kMaxIovecs];
+	int iovcnt = 0;
+	for (uint32_t i = head_; i < segments_.size() && iovcnt < kMaxIovecs; ++i) {
+		Segment &segment = segments_[i];
+		iov[iovcnt].iov_base = segment.data + segment.begin;
+		iov[iovcnt].iov_len = segment.end - segment.begin;
+		++iovcnt;
+	}
+	if (iovcnt == 0) {
+		return 0;
+	}
+	ssize_t ret = (iovcnt == 1 ? write(fd, iov[0].iov_base, iov[0].iov_len)
+			: writev(fd, iov, iovcnt));
+	if (ret <= 0) {
+		return ret;
+	}
+	bytes_ -= ret;
+	sent_ += ret;
+	while (!packetEnds_.empty() && packetEnds_.front() <= sent_) {
+		packetEnds_.pop_front();
+		++sentPackets_;
+	}
+	size_t toConsume = ret;
+	while (toConsume > 0) {
+		Segment &segment = segments_[head_];
+		uint32_t left = segment.end - segment.begin;
+		if (left > toConsume) {
+			segment.begin += toConsume;
+			break;
+		}
+		toConsume -= left;
+		segment.begin = segment.end;
+		// Keep the last page if it still has room for new packets
+		if (head_ + 1 == segments_.size() && segment.capacity > 0) {
+			segment.begin = segment.end = 0;
+			break;
+		}
+		releaseFront();
+	}
+	return ret;
+}
+
+void OutputBufferChain::releaseFront() {
+	Segment &segment = segments_[head_];
+	if (segment.capacity > 0) {
+		putPage(segment.data);
+	} else {
+		MessageBuffer().swap(segment.external);
+	}
+	segment.data = nullptr;
+	++head_;
+	if (head_ == segments_.size()) {
+		segments_.clear();
+		head_ = 0;
+	} else if (head_ >= kMaxIovecs && 2 * head_ >= segments_.size()) {
+		segments_.erase(segments_.begin(), segments_.begin() + head_);
+		head_ = 0;
+	}
+}
+
+void OutputBufferChain::splice(OutputBufferChain& other) {
+	for (uint32_t i = other.head_; i < other.segments_.size(); ++i) {
+		Segment &segment = other.segments_[i];
+		if (segment.begin == segment.end && segment.capacity > 0) {
+			putPage(segment.data);
+			continue;
+		}
+		segments_.push_back(std::move(segment));
+	}
+	// data not sent by the other queue starts at the current end of this one
+	for (uint64_t end : other.packetEnds_) {
+		packetEnds_.push_back(end - other.sent_ + appended_);
+	}
+	bytes_ += other.bytes_;
+	appended_ += other.bytes_;
+	other.segments_.clear();
+	other.head_ = 0;
+	other.bytes_ = 0;
+	other.sent_ = other.appended_;
+	other.packetEnds_.clear();
+}
+
+void OutputBufferChain::clear() {
+	while (segments_.size() > head_) {
+		releaseFront();
+	}
+	bytes_ = 0;
+	sent_ = appended_;
+	packetEnds_.clear();
+}
+
+uint32_t OutputBufferChain::pooledPages() {
+	std::lock_guard<std::mutex> lock(gFreePagesMutex);
+	return gFreePagesCount;
+}
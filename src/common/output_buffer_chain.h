@@ -0,0 +1,121 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <sys/types.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "protocol/packet.h"
+
+/*
+ * Output queue of a nonblocking connection.
+ *
+ * Small packets are written directly into fixed-size pages which are recycled through
+ * a global pool, so queueing a reply costs neither malloc nor free in the steady state.
+ * Big packets which are already serialized into a MessageBuffer are kept as separate
+ * segments to avoid copying. All pending segments are flushed with a single writev call.
+ * Ends of packets are remembered, so that the number of packets which were completely
+ * written can be reported.
+ */
+class OutputBufferChain {
+public:
+	/// Size of a single pooled page.
+	static constexpr uint32_t kPageSize = 64 * 1024;
+	/// MessageBuffers of at least this size are queued without copying.
+	static constexpr uint32_t kCopyThreshold = 4 * 1024;
+	/// Maximal number of segments sent in one writev call.
+	static constexpr int kMaxIovecs = 64;
+
+	OutputBufferChain() : head_(0), bytes_(0), appended_(0), sent_(0), sentPackets_(0) {}
+	~OutputBufferChain() {
+		clear();
+	}
+
+	OutputBufferChain(const OutputBufferChain&) = delete;
+	OutputBufferChain& operator=(const OutputBufferChain&) = delete;
+
+	/// Appends \p size bytes to the queue and returns a pointer to fill them.
+	/// The returned memory is contiguous and valid until the next call modifying the queue.
+	uint8_t *allocate(uint32_t size);
+
+	/// Appends a packet with the given header and returns a pointer to its data part.
+	uint8_t *allocatePacket(uint32_t type, uint32_t length);
+
+	void append(const uint8_t *data, uint32_t size);
+	/// Appends a whole packet.
+	void append(const MessageBuffer& buffer);
+	/// Appends a whole packet.
+	void append(MessageBuffer&& buffer);
+
+	bool empty() const {
+		return bytes_ == 0;
+	}
+
+	/// Number of bytes waiting to be sent.
+	uint64_t bytesPending() const {
+		return bytes_;
+	}
+
+	/// Sends as much data as possible using one writev call.
+	/// \return value returned by writev
+	ssize_t writeTo(int fd);
+
+	/// Returns number of packets completely written since the last call.
+	uint32_t takeSentPackets() {
+		uint32_t ret = sentPackets_;
+		sentPackets_ = 0;
+		return ret;
+	}
+
+	/// Moves all data queued in \p other to the end of this queue without copying.
+	void splice(OutputBufferChain& other);
+
+	/// Drops all queued data. Dropped packets are not counted as sent.
+	void clear();
+
+	/// Number of pages cached in the pool.
+	static uint32_t pooledPages();
+
+private:
+	struct Segment {
+		uint8_t *data;
+		uint32_t begin;     ///< first byte which has not been sent yet
+		uint32_t end;       ///< end of valid data
+		uint32_t capacity;  ///< 0 for segments holding an external buffer
+		MessageBuffer external;
+	};
+
+	void releaseFront();
+
+	void packetAppended() {
+		packetEnds_.push_back(appended_);
+	}
+
+	std::vector<Segment> segments_;
+	uint32_t head_;
+	uint64_t bytes_;
+	uint64_t appended_;               ///< number of bytes appended so far
+	uint64_t sent_;                   ///< number of bytes written so far
+	std::deque<uint64_t> packetEnds_; ///< values of appended_ after packets not sent yet
+	uint32_t sentPackets_;
+};
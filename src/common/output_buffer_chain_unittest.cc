@@ -0,0 +1,149 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "common/output_buffer_chain.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <gtest/gtest.h>
+
+#include "common/datapack.h"
+
+static std::vector<uint8_t> drain(OutputBufferChain& chain, int readFd, int writeFd) {
+	std::vector<uint8_t> result;
+	uint8_t buffer[16 * 1024];
+	while (!chain.empty()) {
+		EXPECT_GT(chain.writeTo(writeFd), 0);
+		ssize_t bytes;
+		while ((bytes = read(readFd, buffer, sizeof(buffer))) > 0) {
+			result.insert(result.end(), buffer, buffer + bytes);
+		}
+	}
+	return result;
+}
+
+class OutputBufferChainTests : public ::testing::Test {
+protected:
+	void SetUp() override {
+		ASSERT_NE(pipe(fds_), -1);
+		ASSERT_NE(fcntl(fds_[0], F_SETFL, O_NONBLOCK), -1);
+		ASSERT_NE(fcntl(fds_[1], F_SETFL, O_NONBLOCK), -1);
+	}
+
+	void TearDown() override {
+		close(fds_[0]);
+		close(fds_[1]);
+	}
+
+	int fds_[2];
+};
+
+TEST_F(OutputBufferChainTests, SmallPackets) {
+	OutputBufferChain chain;
+	std::vector<uint8_t> expected;
+	for (uint32_t i = 0; i < 10000; ++i) {
+		uint8_t *ptr = chain.allocatePacket(i, 4);
+		put32bit(&ptr, 2 * i);
+		uint8_t packet[12];
+		ptr = packet;
+		put32bit(&ptr, i);
+		put32bit(&ptr, 4);
+		put32bit(&ptr, 2 * i);
+		expected.insert(expected.end(), packet, packet + sizeof(packet));
+	}
+	EXPECT_EQ(chain.bytesPending(), expected.size());
+	EXPECT_EQ(drain(chain, fds_[0], fds_[1]), expected);
+	EXPECT_TRUE(chain.empty());
+	EXPECT_EQ(10000U, chain.takeSentPackets());
+	EXPECT_EQ(0U, chain.takeSentPackets());
+}
+
+TEST_F(OutputBufferChainTests, MixedBuffers) {
+	OutputBufferChain chain;
+	std::vector<uint8_t> expected;
+	for (uint32_t i = 0; i < 100; ++i) {
+		MessageBuffer small(i + 1, i);
+		MessageBuffer big(OutputBufferChain::kCopyThreshold + 7 * i, 255 - i);
+		MessageBuffer huge(OutputBufferChain::kPageSize + 1, i % 3);
+		expected.insert(expected.end(), small.begin(), small.end());
+		expected.insert(expected.end(), big.begin(), big.end());
+		expected.insert(expected.end(), huge.begin(), huge.end());
+		chain.append(small);
+		chain.append(std::move(big));
+		memcpy(chain.allocate(huge.size()), huge.data(), huge.size());
+	}
+	EXPECT_EQ(drain(chain, fds_[0], fds_[1]), expected);
+}
+
+TEST_F(OutputBufferChainTests, PagesAreReused) {
+	OutputBufferChain chain;
+	for (uint32_t i = 0; i < 3 * OutputBufferChain::kPageSize / 1000; ++i) {
+		chain.allocate(1000);
+	}
+	drain(chain, fds_[0], fds_[1]);
+	chain.clear();
+	uint32_t pooled = OutputBufferChain::pooledPages();
+	EXPECT_GE(pooled, 3U);
+	chain.allocate(OutputBufferChain::kPageSize);
+	EXPECT_EQ(OutputBufferChain::pooledPages(), pooled - 1);
+	chain.clear();
+	EXPECT_EQ(OutputBufferChain::pooledPages(), pooled);
+}
+
+TEST_F(OutputBufferChainTests, Splice) {
+	OutputBufferChain chain, other;
+	std::vector<uint8_t> expected;
+	for (uint32_t i = 0; i < 1000; ++i) {
+		MessageBuffer packet(100 + i, i);
+		expected.insert(expected.end(), packet.begin(), packet.end());
+		other.append(std::move(packet));
+		if (i % 10 == 9) {
+			chain.splice(other);
+			EXPECT_TRUE(other.empty());
+		}
+	}
+	EXPECT_EQ(chain.bytesPending(), expected.size());
+	EXPECT_EQ(drain(chain, fds_[0], fds_[1]), expected);
+	EXPECT_EQ(1000U, chain.takeSentPackets());
+	EXPECT_EQ(0U, other.takeSentPackets());
+}
+
+TEST_F(OutputBufferChainTests, OnlyWrittenPacketsAreCounted) {
+	// a pipe can't take all of these at once
+	OutputBufferChain chain;
+	for (int i = 0; i < 4; ++i) {
+		chain.append(MessageBuffer(40 * 1024, i));
+	}
+	ASSERT_GT(chain.writeTo(fds_[1]), 0);
+	uint32_t sent = chain.takeSentPackets();
+	EXPECT_LT(sent, 4U);
+	EXPECT_FALSE(chain.empty());
+
+	// packets dropped together with the queue were not sent
+	chain.clear();
+	EXPECT_EQ(0U, chain.takeSentPackets());
+
+	uint8_t buffer[16 * 1024];
+	while (read(fds_[0], buffer, sizeof(buffer)) > 0) {
+	}
+	chain.append(MessageBuffer(100, 0));
+	drain(chain, fds_[0], fds_[1]);
+	EXPECT_EQ(1U, chain.takeSentPackets());
+}
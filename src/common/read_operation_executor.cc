@@ -81,6 +81,7 @@ void ReadOperationExecutor::sendReadRequest(const Timeout& timeout) {
 				+ std::string(strerr(tcpgetlasterror())),
 				server_);
 	}
+	requestTimer_.reset();
 	setState(kReceivingHeader);
 }
 
@@ -88,6 +88,27 @@ public:
 		return readOperation_.wave;
 	}
 
+	/**
+	 * A getter.
+	 */
+	const ReadPlan::ReadOperation &readOperation() const {
+		return readOperation_;
+	}
+
+	/**
+	 * Number of bytes requested from the chunkserver.
+	 */
+	uint32_t requestSize() const {
+		return readOperation_.request_size;
+	}
+
+	/**
+	 * Time (in microseconds) since the request was sent to the chunkserver.
+	 */
+	int64_t requestTime_us() const {
+		return requestTimer_.elapsed_us();
+	}
+
 private:
 	enum ReadOperationState {
 		kSendingRequest,
@@ -123,6 +144,9 @@ private:
 	/* Current state of the operation */
 	ReadOperationState state_;
 
+	/* Measures time since the request was sent */
+	Timer requestTimer_;
+
 	/* The address when the next data read from the socket should be placed */
 	uint8_t *destination_;
 
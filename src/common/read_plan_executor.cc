@@ -19,6 +19,7 @@
 #include "common/platform.h"
 #include "common/read_plan_executor.h"
 
+#include <algorithm>
 #include <chrono>
 #include <map>
 #include <set>
@@ -39,13 +40,21 @@
 std::atomic<uint64_t> ReadPlanExecutor::executions_total_;
 std::atomic<uint64_t> ReadPlanExecutor::executions_with_additional_operations_;
 std::atomic<uint64_t> ReadPlanExecutor::executions_finished_by_additional_operations_;
+std::atomic<uint64_t> ReadPlanExecutor::hedges_issued_;
+std::atomic<uint64_t> ReadPlanExecutor::hedges_won_;
+
+// Read operations taking longer than this percentile of recent read times are hedged
+static constexpr double kHedgePercentile = 0.95;
+// Minimal time after which a read operation may be hedged
+static constexpr int64_t kMinHedgeDelay_us = 5000;
 
 ReadPlanExecutor::ReadPlanExecutor(ChunkserverStats &chunkserver_stats, uint64_t chunk_id,
 		uint32_t chunk_version, std::unique_ptr<ReadPlan> plan)
 	: stats_(chunkserver_stats),
 	  chunk_id_(chunk_id),
 	  chunk_version_(chunk_version),
-	  plan_(std::move(plan)) {
+	  plan_(std::move(plan)),
+	  wave_hedged_(false) {
 }
 
 /*! \brief A function which starts single read operation from chunkserver.
@@ -89,9 +98,11 @@ bool ReadPlanExecutor::startReadOperation(ExecuteParams &params, ChunkPartType c
 			tcpclose(fd);
 			throw;
 		}
+		scheduleHedge(params, fd, ctwa.address, chunk_type, op);
 		return true;
 	} catch (ChunkserverConnectionException &ex) {
 		last_connection_failure_ = ctwa.address;
+		stats_.unregisterReadOperation(ctwa.address);
 		stats_.markDefective(ctwa.address);
 		networking_failures_.push_back(chunk_type);
 		return false;
@@ -192,6 +203,212 @@ void ReadPlanExecutor::startPrefetchForWave(ExecuteParams &params, int wave) {
 	}
 }
 
+/*! \brief A function which sets a deadline after which a read operation should be hedged.
+ *
+ * The deadline is based on a percentile of recent read times of the chunkserver. Operations
+ * are hedged with a read from another copy of the same part or, in the first wave, by starting
+ * the next wave (which reads parts needed to recover the slow one) earlier.
+ *
+ * \param params Execution parameters pack.
+ * \param fd Descriptor of the read operation.
+ * \param server Chunkserver executing the read operation.
+ * \param chunk_type Chunk part type being read.
+ * \param op Structure describing read operation.
+ */
+void ReadPlanExecutor::scheduleHedge(ExecuteParams &params, int fd, const NetworkAddress &server,
+		ChunkPartType chunk_type, const ReadPlan::ReadOperation &op) {
+	bool other_copy_available = params.hedge_locations && params.hedge_locations->count(chunk_type);
+	bool next_wave_available = op.wave == 0 && !wave_hedged_ &&
+	    std::any_of(plan_->read_operations.begin(), plan_->read_operations.end(),
+	                [](const std::pair<ChunkPartType, ReadPlan::ReadOperation> &read_operation) {
+		                return read_operation.second.wave > 0;
+	                });
+	if (!other_copy_available && !next_wave_available) {
+		return;
+	}
+
+	double block_time_us = stats_.getStatisticsFor(server).readBlockTimePercentile_us(
+	    kHedgePercentile);
+	if (block_time_us <= 0) {
+		// too few samples to tell what is slow
+		return;
+	}
+	int blocks = std::max<int>(1, (op.request_size + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE);
+	int64_t delay_us = std::max<int64_t>(kMinHedgeDelay_us, block_time_us * blocks);
+	hedge_deadlines_[fd] = SteadyClock::now() + std::chrono::microseconds(delay_us);
+}
+
+/*! \brief A function that hedges read operations which have passed their deadlines.
+ *
+ * Each hedge has to take a token from the global hedging budget.
+ *
+ * \param params Execution parameters pack.
+ * \param wave Index of the current wave.
+ *
+ * \return true if the next wave should be started.
+ */
+bool ReadPlanExecutor::startHedges(ExecuteParams &params, int wave) {
+	bool start_next_wave = false;
+	SteadyTimePoint now = SteadyClock::now();
+	for (auto it = hedge_deadlines_.begin(); it != hedge_deadlines_.end();) {
+		if (it->second > now) {
+			++it;
+			continue;
+		}
+		int fd = it->first;
+		it = hedge_deadlines_.erase(it);
+
+		const ReadOperationExecutor &executor = executors_.at(fd);
+		bool use_other_copy =
+		    params.hedge_locations && params.hedge_locations->count(executor.chunkType());
+		bool use_next_wave = !use_other_copy && executor.getWave() == wave && wave == 0 &&
+		                     !wave_hedged_;
+		if ((!use_other_copy && !use_next_wave) || !stats_.tryAcquireHedge()) {
+			continue;
+		}
+
+		++hedges_issued_;
+		if (use_other_copy) {
+			startHedgeOperation(params, fd);
+		} else {
+			wave_hedged_ = true;
+			start_next_wave = true;
+		}
+	}
+	return start_next_wave;
+}
+
+/*! \brief A function which starts a read of another copy of the part read by a slow operation.
+ *
+ * The hedge receives data into its own buffer, which is copied to the read buffer only if the
+ * hedge finishes first.
+ *
+ * \param params Execution parameters pack.
+ * \param original_fd Descriptor of the hedged read operation.
+ */
+void ReadPlanExecutor::startHedgeOperation(ExecuteParams &params, int original_fd) {
+	const ReadOperationExecutor &original = executors_.at(original_fd);
+	ChunkPartType chunk_type = original.chunkType();
+	ReadPlan::ReadOperation op = original.readOperation();
+	const ChunkTypeWithAddress &ctwa = params.hedge_locations->at(chunk_type);
+
+	Hedge hedge{original_fd, op.buffer_offset, std::vector<uint8_t>(op.request_size)};
+	op.buffer_offset = 0;
+	stats_.registerReadOperation(ctwa.address);
+
+	try {
+		Timeout connect_timeout(std::chrono::milliseconds(params.connect_timeout));
+		int fd = params.connector.startUsingConnection(ctwa.address, connect_timeout);
+		try {
+			ReadOperationExecutor executor(op, chunk_id_, chunk_version_, chunk_type, ctwa.address,
+			                               ctwa.chunkserver_version, fd, hedge.buffer.data());
+			executor.sendReadRequest(connect_timeout);
+			executors_.insert(std::make_pair(fd, std::move(executor)));
+		} catch (...) {
+			tcpclose(fd);
+			throw;
+		}
+		hedged_[original_fd] = fd;
+		hedges_[fd] = std::move(hedge);
+	} catch (ChunkserverConnectionException &ex) {
+		// The hedged operation is still running, so it is not a failure of the read
+		stats_.unregisterReadOperation(ctwa.address);
+		stats_.markDefective(ctwa.address);
+	}
+}
+
+/*! \brief A function which stops a read operation which is no longer needed.
+ *
+ * The operation would have taken at least as long as it has been running, so this time is
+ * reported to make the chunkserver less attractive if it is slow.
+ *
+ * \param fd Descriptor of the read operation.
+ */
+void ReadPlanExecutor::cancelReadOperation(int fd) {
+	const ReadOperationExecutor &executor = executors_.at(fd);
+	tcpclose(fd);
+	stats_.unregisterReadOperation(executor.server());
+	stats_.reportReadTime(executor.server(), executor.requestSize(), executor.requestTime_us());
+	executors_.erase(fd);
+	hedge_deadlines_.erase(fd);
+}
+
+/*! \brief A function which should be called when a read operation finishes.
+ *
+ * If the operation was hedged (or was a hedge), the other one is cancelled. Data received
+ * by a winning hedge are moved to their place in the read buffer.
+ *
+ * \param params Execution parameters pack.
+ * \param fd Descriptor of the finished read operation.
+ */
+void ReadPlanExecutor::finishHedging(ExecuteParams &params, int fd) {
+	hedge_deadlines_.erase(fd);
+
+	auto hedge = hedges_.find(fd);
+	if (hedge != hedges_.end()) {
+		std::copy(hedge->second.buffer.begin(), hedge->second.buffer.end(),
+		          params.buffer + hedge->second.buffer_offset);
+		int original_fd = hedge->second.original_fd;
+		hedges_.erase(hedge);
+		++hedges_won_;
+		if (original_fd >= 0) {
+			hedged_.erase(original_fd);
+			cancelReadOperation(original_fd);
+		}
+		return;
+	}
+
+	auto original = hedged_.find(fd);
+	if (original != hedged_.end()) {
+		int hedge_fd = original->second;
+		hedged_.erase(original);
+		hedges_.erase(hedge_fd);
+		cancelReadOperation(hedge_fd);
+	}
+}
+
+/*! \brief A function which should be called when a read operation fails.
+ *
+ * \param fd Descriptor of the failed read operation.
+ *
+ * \return true if another read of the same part is still running.
+ */
+bool ReadPlanExecutor::abandonHedging(int fd) {
+	hedge_deadlines_.erase(fd);
+
+	auto hedge = hedges_.find(fd);
+	if (hedge != hedges_.end()) {
+		if (hedge->second.original_fd >= 0) {
+			hedged_.erase(hedge->second.original_fd);
+		}
+		bool original_running = hedge->second.original_fd >= 0;
+		hedges_.erase(hedge);
+		return original_running;
+	}
+
+	auto original = hedged_.find(fd);
+	if (original != hedged_.end()) {
+		hedges_.at(original->second).original_fd = -1;
+		hedged_.erase(original);
+		return true;
+	}
+	return false;
+}
+
+/*! \brief Function returns time to the nearest hedging deadline (or -1 if there is none). */
+int ReadPlanExecutor::hedgeWaitTime_ms() const {
+	if (hedge_deadlines_.empty()) {
+		return -1;
+	}
+	SteadyTimePoint deadline = std::min_element(hedge_deadlines_.begin(), hedge_deadlines_.end(),
+	    [](const std::pair<const int, SteadyTimePoint> &a,
+	       const std::pair<const int, SteadyTimePoint> &b) { return a.second < b.second; })->second;
+	auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+	    deadline - SteadyClock::now()).count();
+	// round up, so that poll doesn't return just before the deadline
+	return std::max<int64_t>(0, wait + 1);
+}
+
 /*! \brief Function waits for data from chunkservers.
  *
  * \param params Execution parameters pack.
@@ -215,6 +432,10 @@ bool ReadPlanExecutor::waitForData(ExecuteParams &params, Timeout &wave_timeout,
 	// Call poll
 	int poll_timeout = std::max(
 	    0, (int)std::min(params.total_timeout.remaining_ms(), wave_timeout.remaining_ms()));
+	int hedge_wait_time = hedgeWaitTime_ms();
+	if (hedge_wait_time >= 0) {
+		poll_timeout = std::min(poll_timeout, hedge_wait_time);
+	}
 	int status = tcppoll(poll_fds, poll_timeout);
 	if (status < 0) {
 #ifdef _WIN32
@@ -248,10 +469,16 @@ bool ReadPlanExecutor::readSomeData(ExecuteParams &params, const pollfd &poll_fd
 			throw ChunkserverConnectionException("Read from chunkserver (poll) error", server);
 		}
 	} catch (ChunkserverConnectionException &ex) {
+		stats_.unregisterReadOperation(server);
 		stats_.markDefective(server);
-		networking_failures_.push_back(executor.chunkType());
+		ChunkPartType chunk_type = executor.chunkType();
 		tcpclose(poll_fd.fd);
 		executors_.erase(poll_fd.fd);
+		if (abandonHedging(poll_fd.fd)) {
+			// the same part is still being read from another chunkserver
+			return true;
+		}
+		networking_failures_.push_back(chunk_type);
 		if (!plan_->isFinishingPossible(networking_failures_)) {
 			throw;
 		}
@@ -261,9 +488,11 @@ bool ReadPlanExecutor::readSomeData(ExecuteParams &params, const pollfd &poll_fd
 	if (executor.isFinished()) {
 		stats_.unregisterReadOperation(server);
 		stats_.markWorking(server);
+		stats_.reportReadTime(server, executor.requestSize(), executor.requestTime_us());
 		params.connector.endUsingConnection(poll_fd.fd, server);
 		available_parts_.push_back(executor.chunkType());
 		executors_.erase(poll_fd.fd);
+		finishHedging(params, poll_fd.fd);
 	}
 
 	return true;
@@ -298,6 +527,10 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 			throw RecoverableReadException("Chunkservers communication timed out");
 		}
 
+		if (startHedges(params, wave)) {
+			++failed_reads;
+		}
+
 		if (wave_timeout.expired() || failed_reads) {
 			// start next wave
 			executions_with_additional_operations_ += wave == 0;
@@ -325,9 +558,13 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 				continue;
 			}
 
-			ReadOperationExecutor &executor = executors_.at(poll_fd.fd);
+			auto executor_it = executors_.find(poll_fd.fd);
+			if (executor_it == executors_.end()) {
+				// cancelled, because another read of the same part has finished
+				continue;
+			}
 
-			if (!readSomeData(params, poll_fd, executor)) {
+			if (!readSomeData(params, poll_fd, executor_it->second)) {
 				++failed_reads;
 			}
 		}
@@ -335,6 +572,7 @@ void ReadPlanExecutor::executeReadOperations(ExecuteParams &params) {
 		// Check if we are finished now
 		if (plan_->isReadingFinished(available_parts_)) {
 			executions_finished_by_additional_operations_ += wave > 0;
+			hedges_won_ += wave > 0 && wave_hedged_;
 			break;
 		}
 	}
@@ -403,10 +641,14 @@ void ReadPlanExecutor::checkPlan(uint8_t *buffer_start) {
 void ReadPlanExecutor::executePlan(std::vector<uint8_t> &buffer,
 		const ChunkTypeLocations &locations, ChunkConnector &connector,
 		int connect_timeout, int level_timeout,
-		const Timeout &total_timeout) {
+		const Timeout &total_timeout, const ChunkTypeLocations *hedge_locations) {
 	executors_.clear();
 	networking_failures_.clear();
 	available_parts_.clear();
+	hedge_deadlines_.clear();
+	hedges_.clear();
+	hedged_.clear();
+	wave_hedged_ = false;
 	++executions_total_;
 
 	std::size_t initial_size_of_buffer = buffer.size();
@@ -415,7 +657,8 @@ void ReadPlanExecutor::executePlan(std::vector<uint8_t> &buffer,
 	checkPlan(buffer.data() + initial_size_of_buffer);
 
 	ExecuteParams params{buffer.data() + initial_size_of_buffer + plan_->readOffset(), locations,
-	                     connector, connect_timeout, level_timeout, total_timeout};
+	                     connector, connect_timeout, level_timeout, total_timeout,
+	                     hedge_locations};
 
 	try {
 		executeReadOperations(params);
@@ -63,13 +63,16 @@ public:
 	 * \param connect_timeout connection timeout
 	 * \param wave_timeout wave timeout
 	 * \param totalTimeout timeout of the whole operation
+	 * \param hedge_locations other locations of ChunkPartTypes from the plan, used to hedge
+	 *        read operations which take much longer than usual (may be null)
 	 */
 	void executePlan(std::vector<uint8_t>& buffer,
 			const ChunkTypeLocations& locations,
 			ChunkConnector& connector,
 			int connect_timeout,
 			int wave_timeout,
-			const Timeout& total_timeout);
+			const Timeout& total_timeout,
+			const ChunkTypeLocations* hedge_locations = nullptr);
 
 	/*! \brief Function Return parts that couldn't be read in execution phase.
 	 *
@@ -88,6 +91,12 @@ public:
 	/// Counter for the .lizardfds_tweaks file.
 	static std::atomic<uint64_t> executions_finished_by_additional_operations_;
 
+	/// Counter for the .lizardfds_tweaks file.
+	static std::atomic<uint64_t> hedges_issued_;
+
+	/// Counter for the .lizardfds_tweaks file.
+	static std::atomic<uint64_t> hedges_won_;
+
 protected:
 	struct ExecuteParams {
 		uint8_t *buffer;
@@ -96,6 +105,14 @@ protected:
 		int connect_timeout;
 		int wave_timeout;
 		const Timeout &total_timeout;
+		const ChunkTypeLocations *hedge_locations;
+	};
+
+	/// Duplicate of a slow read operation, sent to another copy of the same chunk part.
+	struct Hedge {
+		int original_fd; /*!< Descriptor of the hedged operation, -1 if it has failed. */
+		int buffer_offset; /*!< Offset in read buffer of the hedged operation. */
+		std::vector<uint8_t> buffer; /*!< Buffer for data received by the hedge. */
 	};
 
 	void checkPlan(uint8_t *buffer_start);
@@ -111,6 +128,15 @@ protected:
 	                  ReadOperationExecutor &executor);
 	void executeReadOperations(ExecuteParams &params);
 
+	void scheduleHedge(ExecuteParams &params, int fd, const NetworkAddress &server,
+	                   ChunkPartType chunk_type, const ReadPlan::ReadOperation &op);
+	bool startHedges(ExecuteParams &params, int wave);
+	void startHedgeOperation(ExecuteParams &params, int original_fd);
+	void cancelReadOperation(int fd);
+	void finishHedging(ExecuteParams &params, int fd);
+	bool abandonHedging(int fd);
+	int hedgeWaitTime_ms() const;
+
 private:
 	ChunkserverStats& stats_;
 	const uint64_t chunk_id_;
@@ -121,4 +147,9 @@ private:
 	ReadPlan::PartsContainer available_parts_;
 	ReadPlan::PartsContainer networking_failures_;
 	NetworkAddress last_connection_failure_;
+
+	std::map<int, SteadyTimePoint> hedge_deadlines_; /*!< Deadlines of hedgeable operations. */
+	std::map<int, Hedge> hedges_; /*!< Running hedges by their descriptors. */
+	std::map<int, int> hedged_; /*!< Descriptors of hedges by descriptors of hedged operations. */
+	bool wave_hedged_; /*!< True if the next wave was started early to hedge a slow one. */
 };
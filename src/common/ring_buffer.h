@@ -16,6 +16,8 @@
    along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#pragma once
+
 #include "common/platform.h"
 
 #include <array>
@@ -54,12 +56,12 @@ public:
 	}
 
 	T &operator[](long pos) {
-		assert(pos >= 0 && pos < size());
+		assert(pos >= 0 && pos < (long)size());
 		return data_[advance(start_, pos)];
 	}
 
 	const T &operator[](long pos) const {
-		assert(pos >= 0 && pos < size());
+		assert(pos >= 0 && pos < (long)size());
 		return data_[advance(start_, pos)];
 	}
 
@@ -39,6 +39,7 @@
 #include <netinet/tcp.h>
 #include <poll.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #endif
 
 /* Acid's simple socket library - ver 2.0 */
@@ -663,6 +664,66 @@ int tcptoaccept(int sock, uint32_t msecto) {
 	return -1;
 }
 
+/* ---------------- UNIX ---------------- */
+
+#ifndef _WIN32
+static inline int sockaddrunfill(struct sockaddr_un *sa, const char *path) {
+	memset(sa, 0, sizeof(struct sockaddr_un));
+	sa->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa->sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(sa->sun_path, path);
+	return 0;
+}
+
+int unixsocket(void) {
+	return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+int unixlisten(int sock, const char *path, uint16_t queue) {
+	struct sockaddr_un sa;
+	if (sockaddrunfill(&sa, path) < 0) {
+		return -1;
+	}
+	// Remove a socket left by a previous instance, but not one which still accepts connections
+	int probe = unixsocket();
+	if (probe >= 0) {
+		socknonblock(probe);
+		int result = connect(probe, (struct sockaddr *)&sa, sizeof(struct sockaddr_un));
+		int err = errno;
+		close(probe);
+		if (result == 0 || err == EAGAIN) {
+			errno = EADDRINUSE;
+			return -1;
+		}
+		if (err == ECONNREFUSED) {
+			unlink(path);
+		}
+	}
+	if (bind(sock, (struct sockaddr *)&sa, sizeof(struct sockaddr_un)) < 0) {
+		return -1;
+	}
+	if (listen(sock, queue) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+int unixconnect(int sock, const char *path) {
+	struct sockaddr_un sa;
+	if (sockaddrunfill(&sa, path) < 0) {
+		return -1;
+	}
+	if (socknonblock(sock) < 0) {
+		return -1;
+	}
+	// connecting to a local socket never waits for the peer, it fails if the backlog is full
+	return connect(sock, (struct sockaddr *)&sa, sizeof(struct sockaddr_un));
+}
+#endif
+
 /* ----------------- UDP ----------------- */
 
 int udpsocket(void) {
@@ -84,6 +84,14 @@ int32_t tcptoread(int sock, void *buff, uint32_t leng, int msecto);
 int32_t tcptowrite(int sock, const void *buff, uint32_t leng, int msecto);
 int tcptoaccept(int sock, uint32_t msecto);
 
+/* ---------------- UNIX ---------------- */
+
+#ifndef _WIN32
+int unixsocket(void);
+int unixlisten(int sock, const char *path, uint16_t queue);
+int unixconnect(int sock, const char *path);
+#endif
+
 /* ----------------- UDP ----------------- */
 
 int udpsocket(void);
@@ -19,6 +19,7 @@
 #include "common/platform.h"
 #include "common/write_executor.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
@@ -102,6 +103,7 @@ void WriteExecutor::addDataPacket(uint32_t writeId,
 			chunkId_, writeId, block, offset, size, crc);
 	packet.data = data;
 	packet.dataSize = size;
+	packet.writeId = writeId;
 
 	increaseUnconfirmedPacketCount();
 }
@@ -134,6 +136,10 @@ void WriteExecutor::sendData() {
 				"Write error: " + std::string(strerr(tcpgetlasterror())), server());
 	}
 	if (!bufferWriter_.hasDataToSend()) {
+		const Packet& packet = pendingPackets_.front();
+		if (packet.data != nullptr) {
+			sentPackets_.push_back({packet.writeId, packet.dataSize, SteadyClock::now()});
+		}
 		bufferWriter_.reset();
 		pendingPackets_.pop_front();
 	}
@@ -190,5 +196,17 @@ void WriteExecutor::increaseUnconfirmedPacketCount() {
 WriteExecutor::Status WriteExecutor::processStatusMessage(const std::vector<uint8_t>& message) {
 	Status status;
 	cstocl::writeStatus::deserialize(message, status.chunkId, status.writeId, status.status);
+	// Statuses usually come in the order of sent packets, so the search is short
+	auto it = std::find_if(sentPackets_.begin(), sentPackets_.end(),
+			[&status](const SentPacket& packet) { return packet.writeId == status.writeId; });
+	if (it != sentPackets_.end()) {
+		if (status.status == LIZARDFS_STATUS_OK) {
+			// The time covers the whole chain, but only its head is known to be involved
+			int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+					SteadyClock::now() - it->sendTime).count();
+			chunkserverStats_.reportWriteTime(chainHead_, it->dataSize, time_us);
+		}
+		sentPackets_.erase(it);
+	}
 	return status;
 }
@@ -27,6 +27,7 @@
 #include "common/chunkserver_stats.h"
 #include "common/message_receive_buffer.h"
 #include "common/multi_buffer_writer.h"
+#include "common/time_utils.h"
 
 class WriteExecutor {
 public:
@@ -99,8 +100,16 @@ private:
 		std::vector<uint8_t> buffer;
 		const uint8_t* data;
 		uint32_t dataSize;
+		uint32_t writeId;
+
+		Packet() : data(nullptr), dataSize(0), writeId(0) {}
+	};
 
-		Packet() : data(nullptr), dataSize(0) {}
+	/// Data packet sent to the chunkserver and waiting for its status
+	struct SentPacket {
+		uint32_t writeId;
+		uint32_t dataSize;
+		SteadyTimePoint sendTime;
 	};
 
 	ChunkserverStats& chunkserverStats_;
@@ -113,6 +122,7 @@ private:
 	const uint32_t chunkserver_version_;
 	const int chainHeadFd_;
 	std::list<Packet> pendingPackets_;
+	std::list<SentPacket> sentPackets_;
 	MultiBufferWriter bufferWriter_;
 	MessageReceiveBuffer receiveBuffer_;
 
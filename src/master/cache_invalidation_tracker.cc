@@ -0,0 +1,113 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "master/cache_invalidation_tracker.h"
+
+#include <algorithm>
+
+void CacheInvalidationTracker::setCapacity(uint32_t capacity) {
+	capacity_ = capacity;
+	while (lru_.size() > capacity_) {
+		removeOldest();
+	}
+}
+
+void CacheInvalidationTracker::access(uint32_t inode, SessionId session) {
+	if (capacity_ == 0) {
+		return;
+	}
+	auto &inodeHolders = holders_[inode];
+	for (const auto &it : inodeHolders) {
+		if (it->session == session) {
+			lru_.splice(lru_.end(), lru_, it);
+			return;
+		}
+	}
+	if (lru_.size() >= capacity_) {
+		removeOldest();
+	}
+	// removeOldest() might have invalidated the reference
+	holders_[inode].push_back(lru_.insert(lru_.end(), Holder{inode, session}));
+}
+
+void CacheInvalidationTracker::nodeChanged(uint32_t inode) {
+	auto holdersIt = holders_.find(inode);
+	if (holdersIt == holders_.end()) {
+		return;
+	}
+	for (const auto &it : holdersIt->second) {
+		pending_[it->session].inodes.push_back(inode);
+		lru_.erase(it);
+	}
+	holders_.erase(holdersIt);
+}
+
+void CacheInvalidationTracker::entryChanged(uint32_t parent, const std::string &name) {
+	auto holdersIt = holders_.find(parent);
+	if (holdersIt == holders_.end()) {
+		return;
+	}
+	for (const auto &it : holdersIt->second) {
+		Notification &notification = pending_[it->session];
+		notification.entries.emplace_back(name, parent);
+		notification.inodes.push_back(parent);
+		lru_.erase(it);
+	}
+	holders_.erase(holdersIt);
+}
+
+void CacheInvalidationTracker::removeSession(SessionId session) {
+	for (auto it = lru_.begin(); it != lru_.end();) {
+		if (it->session != session) {
+			++it;
+			continue;
+		}
+		auto holdersIt = holders_.find(it->inode);
+		auto &inodeHolders = holdersIt->second;
+		inodeHolders.erase(std::find(inodeHolders.begin(), inodeHolders.end(), it));
+		if (inodeHolders.empty()) {
+			holders_.erase(holdersIt);
+		}
+		it = lru_.erase(it);
+	}
+	pending_.erase(session);
+}
+
+CacheInvalidationTracker::Notification CacheInvalidationTracker::collectNotifications(
+		SessionId session) {
+	Notification result;
+	auto it = pending_.find(session);
+	if (it != pending_.end()) {
+		std::swap(result, it->second);
+		pending_.erase(it);
+	}
+	return result;
+}
+
+void CacheInvalidationTracker::removeOldest() {
+	auto it = lru_.begin();
+	auto holdersIt = holders_.find(it->inode);
+	auto &inodeHolders = holdersIt->second;
+	inodeHolders.erase(std::find(inodeHolders.begin(), inodeHolders.end(), it));
+	if (inodeHolders.empty()) {
+		holders_.erase(holdersIt);
+	}
+	pending_[it->session].inodes.push_back(it->inode);
+	lru_.erase(it);
+}
@@ -0,0 +1,99 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol/named_inode_entry.h"
+
+/*! \brief Remembers which sessions cache metadata of which inodes.
+ *
+ * A session which got attributes of an inode (or entries of a directory) is registered
+ * as its holder with access(). When the inode changes, all its holders get a notification
+ * and are forgotten -- they will be registered again when they ask for the inode next time.
+ * Thanks to that, the number of notifications waiting for a session is bounded by the number
+ * of pairs remembered for it, even if the session doesn't collect them for a long time.
+ * The number of remembered (inode, session) pairs is bounded; when the oldest pair has to
+ * be dropped, its session is notified as if the inode changed, so that no session
+ * can keep stale metadata in its cache.
+ */
+class CacheInvalidationTracker {
+public:
+	typedef uint32_t SessionId;
+
+	/// Changes to be sent to one session.
+	struct Notification {
+		std::vector<uint32_t> inodes;           ///< nodes with changed attributes
+		std::vector<NamedInodeEntry> entries;   ///< added or removed directory entries (inode of a parent)
+
+		bool empty() const {
+			return inodes.empty() && entries.empty();
+		}
+	};
+
+	/// \param capacity maximal number of remembered (inode, session) pairs, 0 disables tracking
+	explicit CacheInvalidationTracker(uint32_t capacity = 0) : capacity_(capacity) {}
+
+	void setCapacity(uint32_t capacity);
+
+	/// Registers \p session as a holder of cached metadata of \p inode.
+	void access(uint32_t inode, SessionId session);
+
+	/// Notifies holders of \p inode that its attributes changed.
+	void nodeChanged(uint32_t inode);
+
+	/// Notifies holders of directory \p parent that its entry \p name was added or removed.
+	/// The directory itself is treated as changed too.
+	void entryChanged(uint32_t parent, const std::string &name);
+
+	/// Forgets everything about \p session.
+	void removeSession(SessionId session);
+
+	/// Returns (and forgets) notifications waiting for \p session.
+	Notification collectNotifications(SessionId session);
+
+	bool hasNotifications() const {
+		return !pending_.empty();
+	}
+
+	/// Number of remembered (inode, session) pairs.
+	size_t size() const {
+		return lru_.size();
+	}
+
+private:
+	struct Holder {
+		uint32_t inode;
+		SessionId session;
+	};
+	typedef std::list<Holder> Lru;
+
+	void removeOldest();
+
+	uint32_t capacity_;
+	Lru lru_; // the least recently used pair goes first
+	std::unordered_map<uint32_t, std::vector<Lru::iterator>> holders_;
+	std::unordered_map<SessionId, Notification> pending_;
+};
@@ -0,0 +1,94 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/cache_invalidation_tracker.h"
+
+#include <gtest/gtest.h>
+
+TEST(CacheInvalidationTrackerTests, NodeChanged) {
+	CacheInvalidationTracker tracker(100);
+	tracker.access(10, 1);
+	tracker.access(10, 2);
+	tracker.access(10, 2);
+	tracker.access(11, 1);
+	EXPECT_EQ(3U, tracker.size());
+
+	tracker.nodeChanged(10);
+	tracker.nodeChanged(12);
+	EXPECT_EQ(std::vector<uint32_t>({10}), tracker.collectNotifications(1).inodes);
+	EXPECT_EQ(std::vector<uint32_t>({10}), tracker.collectNotifications(2).inodes);
+	EXPECT_FALSE(tracker.hasNotifications());
+	EXPECT_EQ(1U, tracker.size());
+
+	// holders are forgotten after the first notification
+	tracker.nodeChanged(10);
+	EXPECT_FALSE(tracker.hasNotifications());
+}
+
+TEST(CacheInvalidationTrackerTests, EntryChanged) {
+	CacheInvalidationTracker tracker(100);
+	tracker.access(1, 7);
+	tracker.entryChanged(1, "file");
+	tracker.entryChanged(2, "other");
+	auto notification = tracker.collectNotifications(7);
+	ASSERT_EQ(1U, notification.entries.size());
+	EXPECT_EQ("file", notification.entries[0].name);
+	EXPECT_EQ(1U, notification.entries[0].inode);
+	EXPECT_EQ(std::vector<uint32_t>({1}), notification.inodes);
+	EXPECT_FALSE(tracker.hasNotifications());
+	EXPECT_EQ(0U, tracker.size());
+}
+
+TEST(CacheInvalidationTrackerTests, EvictionNotifiesHolder) {
+	CacheInvalidationTracker tracker(2);
+	tracker.access(10, 1);
+	tracker.access(11, 1);
+	tracker.access(10, 1); // 11 becomes the least recently used one
+	tracker.access(12, 2);
+	EXPECT_EQ(2U, tracker.size());
+	EXPECT_TRUE(tracker.collectNotifications(2).empty());
+	EXPECT_EQ(std::vector<uint32_t>({11}), tracker.collectNotifications(1).inodes);
+
+	tracker.setCapacity(1);
+	EXPECT_EQ(std::vector<uint32_t>({10}), tracker.collectNotifications(1).inodes);
+	EXPECT_EQ(1U, tracker.size());
+}
+
+TEST(CacheInvalidationTrackerTests, RemoveSession) {
+	CacheInvalidationTracker tracker(100);
+	tracker.access(10, 1);
+	tracker.access(10, 2);
+	tracker.access(11, 1);
+	tracker.access(12, 1);
+	tracker.entryChanged(11, "x");
+	tracker.removeSession(1);
+	EXPECT_EQ(1U, tracker.size());
+	tracker.nodeChanged(12);
+	tracker.nodeChanged(10);
+	EXPECT_TRUE(tracker.collectNotifications(1).empty());
+	EXPECT_EQ(std::vector<uint32_t>({10}), tracker.collectNotifications(2).inodes);
+}
+
+TEST(CacheInvalidationTrackerTests, Disabled) {
+	CacheInvalidationTracker tracker(0);
+	tracker.access(10, 1);
+	tracker.nodeChanged(10);
+	EXPECT_EQ(0U, tracker.size());
+	EXPECT_FALSE(tracker.hasNotifications());
+}
@@ -90,8 +90,12 @@
 #define CHARTS_PACKETSSENT 22
 #define CHARTS_BYTESRCVD 23
 #define CHARTS_BYTESSENT 24
+#define CHARTS_CHUNKLOCKS 25
+#define CHARTS_LOCKSEXPIRED 26
+#define CHARTS_LOCKHOLDAVG 27
+#define CHARTS_LOCKHOLDMAX 28
 
-#define CHARTS 25
+#define CHARTS 29
 
 /* name , join mode , percent , scale , multiplier , divisor */
 #define STATDEFS { \
@@ -120,6 +124,10 @@
 	{"psent"        ,CHARTS_MODE_ADD,0,CHARTS_SCALE_MILI ,1000,60}, \
 	{"brcvd"        ,CHARTS_MODE_ADD,0,CHARTS_SCALE_MILI ,8000,60}, \
 	{"bsent"        ,CHARTS_MODE_ADD,0,CHARTS_SCALE_MILI ,8000,60}, \
+	{"chunklocks"   ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"lockexpired"  ,CHARTS_MODE_ADD,0,CHARTS_SCALE_NONE ,   1, 1}, \
+	{"lockholdavg"  ,CHARTS_MODE_MAX,0,CHARTS_SCALE_MILI ,   1, 1}, \
+	{"lockholdmax"  ,CHARTS_MODE_MAX,0,CHARTS_SCALE_MILI ,   1, 1}, \
 	{NULL           ,0              ,0,0                 ,   0, 0}  \
 };
 
@@ -156,6 +164,7 @@ void chartsdata_refresh(void) {
 	uint64_t data[CHARTS];
 	std::array<uint32_t, FsStats::Size> fsdata;
 	uint32_t i,del,repl; //,bin,bout,opr,opw,dbr,dbw,dopr,dopw,repl;
+	uint32_t locks,expired,avghold,maxhold;
 #ifdef CPU_USAGE
 	struct itimerval uc,pc;
 	uint32_t ucusec,pcusec;
@@ -231,6 +240,11 @@ void chartsdata_refresh(void) {
 	chunk_stats(&del,&repl);
 	data[CHARTS_DELCHUNK]=del;
 	data[CHARTS_REPLCHUNK]=repl;
+	chunk_lock_stats(&locks,&expired,&avghold,&maxhold);
+	data[CHARTS_CHUNKLOCKS]=locks;
+	data[CHARTS_LOCKSEXPIRED]=expired;
+	data[CHARTS_LOCKHOLDAVG]=avghold;
+	data[CHARTS_LOCKHOLDMAX]=maxhold;
 	fs_retrieve_stats(fsdata);
 	for (i = 0 ; i < FsStats::Size; ++i) {
 		data[CHARTS_STATFS + i] = fsdata[i];
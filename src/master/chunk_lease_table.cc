@@ -0,0 +1,49 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/chunk_lease_table.h"
+
+#include <algorithm>
+
+void ChunkLeaseTable::acquire(uint64_t chunkId, uint32_t expiry, uint64_t now_ms) {
+	auto inserted = leases_.insert({chunkId, Lease{now_ms, expiry}});
+	if (inserted.second) {
+		stats_.acquired++;
+	} else if (inserted.first->second.expiry == expiry) {
+		return;
+	} else {
+		inserted.first->second.expiry = expiry;
+	}
+	// leases which should have already expired are noticed during the next tick
+	uint32_t tick = std::max(expiry, nextTick_);
+	wheel_[tick % kWheelSize].emplace_back(chunkId, expiry);
+}
+
+bool ChunkLeaseTable::release(uint64_t chunkId, uint64_t now_ms) {
+	auto it = leases_.find(chunkId);
+	if (it == leases_.end()) {
+		return false;
+	}
+	uint64_t holdTime_ms = now_ms > it->second.start_ms ? now_ms - it->second.start_ms : 0;
+	leases_.erase(it);
+	stats_.released++;
+	stats_.totalHoldTime_ms += holdTime_ms;
+	stats_.maxHoldTime_ms = std::max<uint64_t>(stats_.maxHoldTime_ms, holdTime_ms);
+	return true;
+}
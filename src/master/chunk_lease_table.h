@@ -0,0 +1,152 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*! \brief Table of write leases (locks) of chunks.
+ *
+ * The lock itself is a part of metadata (Chunk::lockid and Chunk::lockedto), this table
+ * only indexes chunks which are locked by writers, so that expired leases are noticed as soon
+ * as they expire instead of when the chunk loop visits the chunk. Expiry times are kept
+ * in a timer wheel with one second slots. The table also gathers statistics of lease hold times.
+ *
+ * Expiry times are given in seconds (like Chunk::lockedto, a lease is valid until the end of
+ * its expiry second), hold times are measured in milliseconds.
+ */
+class ChunkLeaseTable {
+public:
+	struct Stats {
+		Stats() : acquired(0), released(0), expired(0), totalHoldTime_ms(0), maxHoldTime_ms(0) {
+		}
+
+		uint32_t acquired;         /// number of new leases
+		uint32_t released;         /// number of leases released by their owners
+		uint32_t expired;          /// number of leases which expired
+		uint64_t totalHoldTime_ms; /// sum of hold times of released leases
+		uint32_t maxHoldTime_ms;   /// maximal hold time of a released lease
+	};
+
+	ChunkLeaseTable() : leases_(), wheel_(), nextTick_(0), stats_() {
+	}
+
+	/*! \brief Adds a lease of a chunk or extends the existing one. */
+	void acquire(uint64_t chunkId, uint32_t expiry, uint64_t now_ms);
+
+	/*! \brief Removes a lease of a chunk.
+	 * \return true if the chunk had a lease
+	 */
+	bool release(uint64_t chunkId, uint64_t now_ms);
+
+	/*! \brief Removes leases which expired before 'now' and calls func(chunkId) for each of them.
+	 */
+	template <typename Func>
+	void expire(uint32_t now, Func func) {
+		if (leases_.empty()) {
+			// all entries are stale, drop them without walking the slots
+			clearWheel();
+			nextTick_ = now;
+			return;
+		}
+		if (nextTick_ + kWheelSize < now) {
+			// every slot will be visited once anyway
+			nextTick_ = now - kWheelSize;
+		}
+		std::vector<uint64_t> expired;
+		for (; nextTick_ < now; ++nextTick_) {
+			auto &slot = wheel_[nextTick_ % kWheelSize];
+			size_t kept = 0;
+			for (size_t i = 0; i < slot.size(); ++i) {
+				auto it = leases_.find(slot[i].first);
+				if (it == leases_.end() || it->second.expiry != slot[i].second) {
+					// stale entry - the lease was released or extended
+					continue;
+				}
+				if (slot[i].second <= nextTick_) {
+					leases_.erase(it);
+					expired.push_back(slot[i].first);
+				} else {
+					// the lease expires in one of the next rounds of the wheel
+					slot[kept++] = slot[i];
+				}
+			}
+			slot.resize(kept);
+		}
+		stats_.expired += expired.size();
+		for (uint64_t chunkId : expired) {
+			func(chunkId);
+		}
+	}
+
+	/*! \brief Returns statistics gathered since the previous call and resets them. */
+	Stats takeStats() {
+		Stats result = stats_;
+		stats_ = Stats();
+		return result;
+	}
+
+	bool contains(uint64_t chunkId) const {
+		return leases_.count(chunkId) > 0;
+	}
+
+	size_t size() const {
+		return leases_.size();
+	}
+
+	/*! \brief Returns number of entries in the timer wheel, including stale ones. */
+	size_t wheelEntries() const {
+		size_t result = 0;
+		for (const auto &slot : wheel_) {
+			result += slot.size();
+		}
+		return result;
+	}
+
+	void clear() {
+		leases_.clear();
+		clearWheel();
+	}
+
+private:
+	static constexpr uint32_t kWheelSize = 256;
+
+	void clearWheel() {
+		for (auto &slot : wheel_) {
+			slot.clear();
+		}
+	}
+
+	struct Lease {
+		uint64_t start_ms;
+		uint32_t expiry;
+	};
+
+	std::unordered_map<uint64_t, Lease> leases_;
+	// each slot contains (chunkId, expiry) pairs; entries no longer matching leases_ are stale
+	std::array<std::vector<std::pair<uint64_t, uint32_t>>, kWheelSize> wheel_;
+	uint32_t nextTick_; // first second which wasn't processed by expire()
+	Stats stats_;
+};
@@ -0,0 +1,104 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/chunk_lease_table.h"
+
+#include <vector>
+#include <gtest/gtest.h>
+
+static std::vector<uint64_t> expire(ChunkLeaseTable &table, uint32_t now) {
+	std::vector<uint64_t> result;
+	table.expire(now, [&result](uint64_t chunkId) { result.push_back(chunkId); });
+	return result;
+}
+
+TEST(ChunkLeaseTableTests, ExpireAndRelease) {
+	ChunkLeaseTable table;
+	uint32_t now = 1000000;
+	EXPECT_EQ(std::vector<uint64_t>(), expire(table, now));
+
+	table.acquire(1, now + 120, now * 1000ULL);
+	table.acquire(2, now + 120, now * 1000ULL);
+	table.acquire(3, now + 10, now * 1000ULL);
+	EXPECT_EQ(3U, table.size());
+
+	EXPECT_TRUE(table.release(2, now * 1000ULL + 1500));
+	EXPECT_FALSE(table.release(2, now * 1000ULL + 1500));
+	// a lease is valid until the end of its expiry second
+	EXPECT_EQ(std::vector<uint64_t>(), expire(table, now + 10));
+	EXPECT_EQ(std::vector<uint64_t>({3}), expire(table, now + 11));
+
+	// extending a lease
+	table.acquire(1, now + 200, now * 1000ULL + 5000);
+	EXPECT_EQ(std::vector<uint64_t>(), expire(table, now + 150));
+	EXPECT_TRUE(table.contains(1));
+	EXPECT_EQ(std::vector<uint64_t>({1}), expire(table, now + 201));
+	EXPECT_EQ(0U, table.size());
+
+	ChunkLeaseTable::Stats stats = table.takeStats();
+	EXPECT_EQ(3U, stats.acquired);
+	EXPECT_EQ(1U, stats.released);
+	EXPECT_EQ(2U, stats.expired);
+	EXPECT_EQ(1500U, stats.totalHoldTime_ms);
+	EXPECT_EQ(1500U, stats.maxHoldTime_ms);
+	EXPECT_EQ(0U, table.takeStats().acquired);
+}
+
+TEST(ChunkLeaseTableTests, LongLeasesAndLateTicks) {
+	ChunkLeaseTable table;
+	uint32_t now = 5000;
+	expire(table, now);
+	// longer than a round of the wheel
+	table.acquire(1, now + 1000, now * 1000ULL);
+	table.acquire(2, now + 3, now * 1000ULL);
+	EXPECT_EQ(std::vector<uint64_t>({2}), expire(table, now + 500));
+	EXPECT_TRUE(table.contains(1));
+	// the event loop may be late by many seconds
+	EXPECT_EQ(std::vector<uint64_t>({1}), expire(table, now + 5000));
+
+	// a lease which has already expired is reported during the next call
+	table.acquire(3, now + 4000, now * 1000ULL);
+	EXPECT_EQ(std::vector<uint64_t>({3}), expire(table, now + 5001));
+}
+
+TEST(ChunkLeaseTableTests, ShortLeasesDontAccumulate) {
+	ChunkLeaseTable table;
+	uint32_t now = 10000;
+	for (uint32_t tick = 0; tick < 1000; ++tick, ++now) {
+		// writes which lock and unlock chunks between ticks
+		for (uint64_t chunkId = 1; chunkId <= 100; ++chunkId) {
+			table.acquire(chunkId, now + 30, now * 1000ULL);
+			table.release(chunkId, now * 1000ULL + 10);
+		}
+		EXPECT_EQ(std::vector<uint64_t>(), expire(table, now + 1));
+		EXPECT_EQ(0U, table.wheelEntries());
+	}
+
+	// with a lease kept all the time, stale entries are dropped when their slots are visited
+	table.acquire(1000, now + 5000, now * 1000ULL);
+	for (uint32_t tick = 0; tick < 1000; ++tick, ++now) {
+		for (uint64_t chunkId = 1; chunkId <= 100; ++chunkId) {
+			table.acquire(chunkId, now + 30, now * 1000ULL);
+			table.release(chunkId, now * 1000ULL + 10);
+		}
+		EXPECT_EQ(std::vector<uint64_t>(), expire(table, now + 1));
+		EXPECT_LE(table.wheelEntries(), 31U * 100U + 1U);
+	}
+	EXPECT_TRUE(table.contains(1000));
+}
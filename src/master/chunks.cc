@@ -52,6 +52,7 @@
 #include "master/chunkserver_db.h"
 #include "master/checksum.h"
 #include "master/chunk_goal_counters.h"
+#include "master/chunk_lease_table.h"
 #include "master/filesystem.h"
 #include "master/get_servers_for_new_chunk.h"
 #include "master/goal_cache.h"
@@ -626,6 +627,9 @@ static uint32_t chunksinfo_loopstart=0,chunksinfo_loopend=0;
 static uint32_t stats_deletions=0;
 static uint32_t stats_replications=0;
 
+// chunks locked by writers, see ChunkLeaseTable
+static ChunkLeaseTable gChunkLeases;
+
 void chunk_stats(uint32_t *del,uint32_t *repl) {
 	*del = stats_deletions;
 	*repl = stats_replications;
@@ -633,6 +637,25 @@ void chunk_stats(uint32_t *del,uint32_t *repl) {
 	stats_replications = 0;
 }
 
+void chunk_lock_stats(uint32_t *locks, uint32_t *expired, uint32_t *avghold_ms, uint32_t *maxhold_ms) {
+	ChunkLeaseTable::Stats stats = gChunkLeases.takeStats();
+	*locks = stats.acquired;
+	*expired = stats.expired;
+	*avghold_ms = stats.released > 0 ? stats.totalHoldTime_ms / stats.released : 0;
+	*maxhold_ms = stats.maxHoldTime_ms;
+}
+
+static void chunk_lease_acquire(Chunk *c) {
+	gChunkLeases.acquire(c->chunkid, c->lockedto, eventloop_utime() / 1000);
+}
+
+/*! \brief Notices locks which have just expired and wakes up writers waiting for them. */
+static void chunk_expire_leases(void) {
+	gChunkLeases.expire(eventloop_time(), [](uint64_t chunkid) {
+		matoclserv_chunk_unlocked(chunkid);
+	});
+}
+
 #endif // ! METARESTORE
 
 static uint64_t chunk_checksum(const Chunk *c) {
@@ -984,6 +1007,10 @@ int chunk_unlock(uint64_t chunkid) {
 	// Don't remove lockid to safely accept retransmission of FUSE_CHUNK_UNLOCK message
 	c->lockedto = 0;
 	chunk_update_checksum(c);
+#ifndef METARESTORE
+	gChunkLeases.release(chunkid, eventloop_utime() / 1000);
+	matoclserv_chunk_unlocked(chunkid);
+#endif
 	return LIZARDFS_STATUS_OK;
 }
 
@@ -1165,6 +1192,7 @@ uint8_t chunk_multi_modify(uint64_t ochunkid, uint32_t *lockid, uint8_t goal,
 	}
 	c->lockid = *lockid;
 	chunk_update_checksum(c);
+	chunk_lease_acquire(c);
 	return LIZARDFS_STATUS_OK;
 }
 
@@ -1242,6 +1270,7 @@ uint8_t chunk_multi_truncate(uint64_t ochunkid, uint32_t lockid, uint32_t length
 	c->lockedto=(uint32_t)eventloop_time()+LOCKTIMEOUT;
 	c->lockid = lockid;
 	chunk_update_checksum(c);
+	chunk_lease_acquire(c);
 	return LIZARDFS_STATUS_OK;
 }
 #endif // ! METARESTORE
@@ -1275,6 +1304,9 @@ uint8_t chunk_apply_modification(uint32_t ts, uint64_t oldChunkId, uint32_t lock
 	c->lockedto = ts + LOCKTIMEOUT;
 	c->lockid = lockid;
 	chunk_update_checksum(c);
+#ifndef METARESTORE
+	chunk_lease_acquire(c);
+#endif
 	*newChunkId = c->chunkid;
 	return LIZARDFS_STATUS_OK;
 }
@@ -2697,6 +2729,11 @@ int chunk_load(FILE *fd, bool loadLockIds) {
 			if (loadLockIds) {
 				c->lockid = get32bit(&ptr);
 			}
+#ifndef METARESTORE
+			if (c->lockid != 0 && c->isLocked()) {
+				chunk_lease_acquire(c);
+			}
+#endif
 		} else {
 			uint32_t version = get32bit(&ptr);
 			uint32_t lockedto = get32bit(&ptr);
@@ -2763,6 +2800,9 @@ void chunk_store(FILE *fd) {
 void chunk_unload(void) {
 	delete gChunksMetadata;
 	gChunksMetadata = nullptr;
+#ifndef METARESTORE
+	gChunkLeases.clear();
+#endif
 }
 
 void chunk_newfs(void) {
@@ -2947,6 +2987,7 @@ int chunk_strinit(void) {
 	eventloop_reloadregister(chunk_reload);
 	metadataserver::registerFunctionCalledOnPromotion(chunk_become_master);
 	eventloop_eachloopregister(chunk_clean_zombie_servers_a_bit);
+	eventloop_timeregister(TIMEMODE_RUN_LATE, 1, 0, chunk_expire_leases);
 	if (metadataserver::isMaster()) {
 		chunk_become_master();
 	}
@@ -62,6 +62,7 @@ typedef struct _exports {
 	uint32_t rootgid;
 	uint32_t mapalluid;
 	uint32_t mapallgid;
+	uint8_t weight;
 	struct _exports *next;
 } exports;
 
@@ -148,7 +149,7 @@ uint8_t exports_check(uint32_t ip, uint32_t version, uint8_t meta,
 		const uint8_t passcode[16], uint8_t *sesflags,
 		uint32_t *rootuid, uint32_t *rootgid, uint32_t *mapalluid,
 		uint32_t *mapallgid, uint8_t *mingoal, uint8_t *maxgoal,
-		uint32_t *mintrashtime, uint32_t *maxtrashtime) {
+		uint32_t *mintrashtime, uint32_t *maxtrashtime, uint8_t *weight) {
 	const uint8_t *p;
 	uint32_t pleng,i;
 	uint8_t rndstate;
@@ -267,6 +268,7 @@ uint8_t exports_check(uint32_t ip, uint32_t version, uint8_t meta,
 	*maxgoal = f->maxgoal;
 	*mintrashtime = f->mintrashtime;
 	*maxtrashtime = f->maxtrashtime;
+	*weight = f->weight;
 	return LIZARDFS_STATUS_OK;
 }
 
@@ -298,6 +300,7 @@ static void exports_freelist(exports *arec) {
 //  maxgoal=#
 //  mintrashtime=[#w][#d][#h][#m][#[s]]
 //  maxtrashtime=[#w][#d][#h][#m][#[s]]
+//  weight=#
 //
 // ip[/bits] can be '*' (same as 0.0.0.0/0)
 //
@@ -435,6 +438,19 @@ static int exports_parsegoal(char *goalstr,uint8_t *goal) {
 	return 0;
 }
 
+static int exports_parseweight(char *weightstr,uint8_t *weight) {
+	if (*weightstr < '1' || *weightstr > '9') {
+		return -1;
+	}
+	char *end = nullptr;
+	auto value = strtol(weightstr, &end, 10);
+	if (*end != '\0' || value > 100) {
+		return -1;
+	}
+	*weight = value;
+	return 0;
+}
+
 // # | [#w][#d][#h][#m][#s]
 static int exports_parsetime(char *timestr,uint32_t *time) {
 	uint64_t t;
@@ -834,6 +850,15 @@ static int exports_parseoptions(char *opts,uint32_t lineno,exports *arec) {
 				o=1;
 			}
 			break;
+		case 'w':
+			if (strncmp(p,"weight=",7)==0) {
+				o=1;
+				if (exports_parseweight(p+7,&arec->weight)<0) {
+					lzfs_pretty_syslog(LOG_WARNING,"mfsexports: incorrect weight definition (%s) in line: %" PRIu32,p,lineno);
+					return -1;
+				}
+			}
+			break;
 		}
 		if (o==0) {
 			lzfs_pretty_syslog(LOG_WARNING,"mfsexports: unknown option '%s' in line: %" PRIu32 " (ignored)",p,lineno);
@@ -865,6 +890,7 @@ static int exports_parseline(char *line,uint32_t lineno,exports *arec) {
 	arec->rootgid = 999;
 	arec->mapalluid = 999;
 	arec->mapallgid = 999;
+	arec->weight = 1;
 	arec->next = NULL;
 
 	p = line;
@@ -31,5 +31,5 @@ uint8_t exports_check(uint32_t ip, uint32_t version, uint8_t meta,
 		uint32_t *rootuid, uint32_t *rootgid, uint32_t *mapalluid,
 		uint32_t *mapallgid, uint8_t *mingoal, uint8_t *maxgoal,
 		uint32_t *mintrashtime, uint32_t
-		*maxtrashtime);
+		*maxtrashtime, uint8_t *weight);
 int exports_init(void);
@@ -0,0 +1,134 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+
+/*! \brief Queue of requests coming from many flows, served with deficit round robin.
+ *
+ * Every flow (e.g. a client session) has its own FIFO queue. Flows having some requests
+ * queued are visited in turn and each visit lets a flow have up to 'weight' of its requests
+ * popped. A flow with a long backlog can't delay requests of other flows by more than
+ * one round and, while all of them are backlogged, flows get shares proportional to
+ * their weights.
+ */
+template <typename FlowId, typename Request>
+class FairRequestQueue {
+public:
+	FairRequestQueue() : flows_(), active_(), size_(0) {
+	}
+
+	/*! \brief Appends a request to the queue of a flow.
+	 * \param weight number of requests of the flow popped in one round (at least 1)
+	 */
+	void push(FlowId flow, uint32_t weight, Request request) {
+		Flow &entry = flows_[flow];
+		if (entry.requests.empty()) {
+			active_.push_back(flow);
+		}
+		entry.weight = std::max<uint32_t>(weight, 1);
+		entry.requests.push_back(std::move(request));
+		++size_;
+	}
+
+	/*! \brief Removes the next request to be served and returns it.
+	 * The queue must not be empty.
+	 */
+	Request pop() {
+		assert(!active_.empty());
+		FlowId flow = active_.front();
+		auto it = flows_.find(flow);
+		assert(it != flows_.end());
+		Flow &entry = it->second;
+		if (entry.credit == 0) {
+			entry.credit = entry.weight;
+		}
+		Request request = std::move(entry.requests.front());
+		entry.requests.pop_front();
+		--entry.credit;
+		--size_;
+		if (entry.requests.empty()) {
+			active_.pop_front();
+			flows_.erase(it);
+		} else if (entry.credit == 0) {
+			active_.pop_front();
+			active_.push_back(flow);
+		}
+		return request;
+	}
+
+	/*! \brief Removes queued requests of a flow for which pred returns true. */
+	template <typename UnaryPredicate>
+	void remove_if(FlowId flow, UnaryPredicate pred) {
+		auto it = flows_.find(flow);
+		if (it == flows_.end()) {
+			return;
+		}
+		auto &requests = it->second.requests;
+		auto removed = std::remove_if(requests.begin(), requests.end(), pred);
+		size_ -= std::distance(removed, requests.end());
+		requests.erase(removed, requests.end());
+		if (requests.empty()) {
+			flows_.erase(it);
+			active_.erase(std::find(active_.begin(), active_.end(), flow));
+		}
+	}
+
+	void clear() {
+		flows_.clear();
+		active_.clear();
+		size_ = 0;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	/// Number of all queued requests.
+	size_t size() const {
+		return size_;
+	}
+
+	/// Number of queued requests of a flow.
+	size_t size(FlowId flow) const {
+		auto it = flows_.find(flow);
+		return it != flows_.end() ? it->second.requests.size() : 0;
+	}
+
+private:
+	struct Flow {
+		Flow() : requests(), weight(1), credit(0) {
+		}
+
+		std::deque<Request> requests;
+		uint32_t weight;
+		uint32_t credit; // requests which may still be popped in the current round
+	};
+
+	std::unordered_map<FlowId, Flow> flows_; // only flows with queued requests
+	std::deque<FlowId> active_;              // round robin order of flows
+	size_t size_;
+};
@@ -0,0 +1,79 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/fair_request_queue.h"
+
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+static std::string popAll(FairRequestQueue<int, std::string> &queue) {
+	std::string result;
+	while (!queue.empty()) {
+		result += queue.pop();
+	}
+	return result;
+}
+
+TEST(FairRequestQueueTests, Interleave) {
+	FairRequestQueue<int, std::string> queue;
+	for (int i = 0; i < 5; ++i) {
+		queue.push(1, 1, "a");
+	}
+	queue.push(2, 1, "b");
+	queue.push(2, 1, "b");
+	queue.push(3, 1, "c");
+	EXPECT_EQ(8U, queue.size());
+	EXPECT_EQ(5U, queue.size(1));
+	EXPECT_EQ("abcabaaa", popAll(queue));
+	EXPECT_EQ(0U, queue.size(1));
+}
+
+TEST(FairRequestQueueTests, Weights) {
+	FairRequestQueue<int, std::string> queue;
+	for (int i = 0; i < 6; ++i) {
+		queue.push(1, 3, "a");
+		queue.push(2, 1, "b");
+	}
+	EXPECT_EQ("aaabaaabbbbb", popAll(queue));
+}
+
+TEST(FairRequestQueueTests, NewFlowWaitsOneRound) {
+	FairRequestQueue<int, std::string> queue;
+	for (int i = 0; i < 4; ++i) {
+		queue.push(1, 2, "a");
+	}
+	EXPECT_EQ("a", queue.pop());
+	queue.push(2, 1, "b");
+	// flow 1 uses the rest of its credit first
+	EXPECT_EQ("aba", popAll(queue).substr(0, 3));
+}
+
+TEST(FairRequestQueueTests, RemoveIf) {
+	FairRequestQueue<int, std::string> queue;
+	queue.push(1, 1, "a1");
+	queue.push(1, 1, "a2");
+	queue.push(2, 1, "b1");
+	queue.push(1, 1, "a1");
+	queue.remove_if(1, [](const std::string &request) { return request == "a1"; });
+	EXPECT_EQ(2U, queue.size());
+	queue.remove_if(2, [](const std::string &) { return true; });
+	EXPECT_EQ(1U, queue.size());
+	EXPECT_EQ("a2", popAll(queue));
+}
@@ -211,6 +211,8 @@ void fs_getdirpath_data(uint32_t inode,uint8_t *buff,uint32_t size);
 uint8_t fs_getrootinode(uint32_t *rootinode,const uint8_t *path);
 uint8_t fs_end_setlength(uint64_t chunkid);
 uint8_t fs_readchunk(uint32_t inode,uint32_t indx,uint64_t *chunkid,uint64_t *length);
+uint8_t fs_readchunks(uint32_t inode, uint32_t first_index, uint32_t count,
+		std::vector<uint64_t> &chunkids, uint64_t *length);
 uint8_t fs_writeend(uint32_t inode,uint64_t length,uint64_t chunkid, uint32_t lockid);
 void fs_gettrashtime_store(TrashtimeMap &fileTrashtimes, TrashtimeMap &dirTrashtimes,uint8_t *buff);
 void fs_listxattr_data(void *xanode,uint8_t *xabuff);
@@ -257,6 +259,7 @@ const Goal& fs_get_goal_definition(uint8_t goalId);
 
 /// Return info about currently executed tasks
 std::vector<JobInfo> fs_get_current_tasks_info();
+std::vector<JobProgressInfo> fs_get_current_tasks_progress_info();
 // Disable saving metadata on exit
 void fs_disable_metadata_dump_on_exit();
 
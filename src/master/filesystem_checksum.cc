@@ -28,6 +28,9 @@
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_metadata.h"
 #include "master/filesystem_xattr.h"
+#ifndef METARESTORE
+#include "master/matoclserv.h"
+#endif
 
 static uint64_t fsnodes_checksum(FSNode *node, bool full_update = false) {
 	if (!node) {
@@ -100,6 +103,10 @@ void fsnodes_update_checksum(FSNode *node) {
 	if (gChecksumBackgroundUpdater.isNodeIncluded(node)) {
 		addToChecksum(gChecksumBackgroundUpdater.fsNodesChecksum, node->checksum);
 	}
+#ifndef METARESTORE
+	// every change of node's metadata goes through this function
+	matoclserv_notify_node_changed(node->id);
+#endif
 }
 
 static void fsnodes_recalculate_checksum() {
@@ -37,6 +37,9 @@
 #include "master/filesystem_periodic.h"
 #include "master/filesystem_quota.h"
 #include "master/fs_context.h"
+#ifndef METARESTORE
+#include "master/matoclserv.h"
+#endif
 
 #ifndef NDEBUG
   #include "master/personality.h"
@@ -494,6 +497,9 @@ void fsnodes_remove_edge(uint32_t ts, FSNodeDirectory *parent, const HString &na
 		parent->nlink--;
 	}
 
+#ifndef METARESTORE
+	matoclserv_notify_entry_changed(parent->id, name);
+#endif
 	fsnodes_update_checksum(parent);
 
 	auto it = std::find(node->parent.begin(), node->parent.end(), parent->id);
@@ -521,6 +527,9 @@ void fsnodes_link(uint32_t ts, FSNodeDirectory *parent, FSNode *child, const HSt
 	fsnodes_add_stats(parent, &sr);
 	if (ts > 0) {
 		parent->mtime = parent->ctime = ts;
+#ifndef METARESTORE
+		matoclserv_notify_entry_changed(parent->id, name);
+#endif
 		fsnodes_update_checksum(parent);
 		assert(child->type != FSNode::kTrash);
 		child->ctime = ts;
@@ -1898,6 +1898,48 @@ uint8_t fs_readchunk(uint32_t inode, uint32_t indx, uint64_t *chunkid, uint64_t
 	++gFsStatsArray[FsStats::Read];
 	return LIZARDFS_STATUS_OK;
 }
+
+/*! \brief Returns ids of chunks first_index, first_index + 1, ... of a file.
+ *
+ * At most \p count ids are returned and the list ends at the last chunk of the file,
+ * but it always contains at least one element (0 for chunks which don't exist).
+ */
+uint8_t fs_readchunks(uint32_t inode, uint32_t first_index, uint32_t count,
+		std::vector<uint64_t> &chunkids, uint64_t *length) {
+	uint32_t ts = eventloop_time();
+	ChecksumUpdater cu(ts);
+	FSNodeFile *p;
+
+	chunkids.clear();
+	*length = 0;
+	p = fsnodes_id_to_node<FSNodeFile>(inode);
+	if (!p) {
+		return LIZARDFS_ERROR_ENOENT;
+	}
+	if (p->type != FSNode::kFile && p->type != FSNode::kTrash && p->type != FSNode::kReserved) {
+		return LIZARDFS_ERROR_EPERM;
+	}
+	if (first_index > MAX_INDEX) {
+		return LIZARDFS_ERROR_INDEXTOOBIG;
+	}
+	count = std::max<uint32_t>(count, 1);
+	count = std::min<uint32_t>(count, MAX_INDEX - first_index + 1);
+#ifndef METARESTORE
+	if (gMagicAutoFileRepair) {
+		for (uint32_t i = 0; i < count && first_index + i < p->chunks.size(); ++i) {
+			fs_auto_repair_if_needed(p, first_index + i);
+		}
+	}
+#endif
+	chunkids.push_back(first_index < p->chunks.size() ? p->chunks[first_index] : 0);
+	for (uint32_t i = 1; i < count && first_index + i < p->chunks.size(); ++i) {
+		chunkids.push_back(p->chunks[first_index + i]);
+	}
+	*length = p->length;
+	fs_update_atime(p, ts);
+	++gFsStatsArray[FsStats::Read];
+	return LIZARDFS_STATUS_OK;
+}
 #endif
 
 uint8_t fs_writechunk(const FsContext &context, uint32_t inode, uint32_t indx, bool usedummylockid,
@@ -1965,6 +2007,9 @@ uint8_t fs_writechunk(const FsContext &context, uint32_t inode, uint32_t indx, b
 		                                  increaseVersion, &nchunkid);
 	}
 	if (status != LIZARDFS_STATUS_OK) {
+		if (status == LIZARDFS_ERROR_LOCKED) {
+			*chunkid = ochunkid; // let the caller wait until the chunk is unlocked
+		}
 		fsnodes_update_checksum(p);
 		return status;
 	}
@@ -2942,6 +2987,10 @@ std::vector<JobInfo> fs_get_current_tasks_info() {
 	return gMetadata->task_manager.getCurrentJobsInfo();
 }
 
+std::vector<JobProgressInfo> fs_get_current_tasks_progress_info() {
+	return gMetadata->task_manager.getCurrentJobsProgressInfo(eventloop_time());
+}
+
 uint8_t fs_cancel_job(uint32_t job_id) {
 	if (gMetadata->task_manager.cancelJob(job_id)) {
 		return LIZARDFS_STATUS_OK;
@@ -31,6 +31,7 @@
 #  include "common/flat_map.h"
 #endif
 #include "common/loop_watchdog.h"
+#include "master/changelog.h"
 #include "master/filesystem_checksum.h"
 #include "master/filesystem_checksum_updater.h"
 #include "master/filesystem_metadata.h"
@@ -59,8 +60,6 @@ static uint32_t fsinfo_unavailfiles = 0;
 static uint32_t fsinfo_unavailtrashfiles = 0;
 static uint32_t fsinfo_unavailreservedfiles = 0;
 
-static int gTasksBatchSize = 1000;
-
 static int gFileTestLoopTime = 300;
 static int gFileTestLoopIndex = 0;
 static unsigned gFileTestLoopBucketLimit = 0;
@@ -81,16 +80,24 @@ enum NodeErrorFlag {
 static const size_t kMaxNodeEntries = 1000000;
 static DefectiveNodesMap gDefectiveNodes;
 
+#ifndef METARESTORE
+static uint32_t gTasksLoopTime_us = 5000;
+
 void fs_background_task_manager_work() {
 	if (gMetadata->task_manager.workAvailable()) {
 		uint32_t ts = eventloop_time();
 		ChecksumUpdater cu(ts);
-		gMetadata->task_manager.processJobs(ts, gTasksBatchSize);
+		// changes made by tasks are written to the changelog file in one batch
+		changelog_disable_flush();
+		gMetadata->task_manager.processJobs(ts,
+				std::chrono::microseconds(gTasksLoopTime_us));
+		changelog_enable_flush();
 		if (gMetadata->task_manager.workAvailable()) {
 			eventloop_make_next_poll_nonblocking();
 		}
 	}
 }
+#endif
 
 static std::string get_node_info(FSNode *node) {
 	std::string name;
@@ -592,6 +599,7 @@ uint8_t fs_apply_emptyreserved_deprecated(uint32_t /*ts*/,uint32_t /*freeinodes*
 #ifndef METARESTORE
 void fs_read_periodic_config_file() {
 	gFileTestLoopTime = cfg_get_minmaxvalue<uint32_t>("FILE_TEST_LOOP_MIN_TIME", 3600, FILETESTSMINLOOPTIME, FILETESTSMAXLOOPTIME);
+	gTasksLoopTime_us = cfg_get_minmaxvalue<uint32_t>("TASKS_LOOP_TIME_US", 5000, 100, 100000);
 }
 
 void fs_periodic_master_init() {
@@ -20,7 +20,9 @@
 #include "master/locks.h"
 
 #include <algorithm>
-#include <functional>
+#include <iterator>
+#include <limits>
+#include <vector>
 
 #include "common/slogger.h"
 
@@ -33,140 +35,119 @@ const LockRange *LockRanges::findCollision(const LockRange &range) const {
 		return nullptr;
 	}
 
-	auto start = ::std::lower_bound(data_.begin(), data_.end(), range.start,
-			[](const LockRange &other, uint64_t offset) {return other.start < offset;});
-	auto end = ::std::upper_bound(data_.begin(), data_.end(), range.end,
-			[](uint64_t offset, const LockRange &other) {return offset < other.start;});
+	// Range overlaps, is not shared and owner is not the same
+	auto it = data_.find_overlapping(range.start, range.end, [&range](const LockRange &other) {
+		return (!range.shared() || !other.shared()) && other.owners != range.owners;
+	});
 
-	if (start != data_.begin()) {
-		start--;
-	}
-
-	for (auto it = start; it != end; ++it) {
-		const LockRange &other = *it;
-		if (range.overlaps(other)) {
-			// Range overlaps, is not shared and owner is not the same
-			if ((!range.shared() || !other.shared()) && other.owners != range.owners) {
-				return std::addressof(other);
-			}
-		}
-	}
-
-	return nullptr;
+	return it != data_.end() ? std::addressof(*it) : nullptr;
 }
 
-void LockRanges::insert(LockRange &range) {
-	auto start = ::std::lower_bound(data_.begin(), data_.end(), range.start,
-			[](const LockRange &other, uint64_t offset) {return other.start < offset;});
-	auto end = ::std::upper_bound(data_.begin(), data_.end(), range.end,
-			[](uint64_t offset, const LockRange &other) {return offset < other.start;});
-
-	if (start != data_.begin()) {
-		start--;
+void LockRanges::insert(const LockRange &range) {
+	if (range.end <= range.start) {
+		return;
 	}
 
-	auto it = start;
-	for (; it != end && range.end > range.start; ++it) {
-		LockRange &other = *it;
-
-		bool same_owners = range.owners == other.owners;
-
-		// Ranges are adjacent, so they can be merged
-		if (range.sticks(other) && same_owners && range.type == other.type) {
-			range.start = std::min(range.start, other.start);
-			range.end = std::max(range.end, other.end);
-			other.markUnlocking();
-			continue;
+	// Take out all ranges which may be affected: the overlapping ones and the ones
+	// adjacent to the inserted range, which may need to be merged with it.
+	std::vector<LockRange> affected;
+	LockRange following;
+	if (range.start > 0) {
+		auto it = data_.find_overlapping(range.start - 1, range.start,
+				[&range](const LockRange &other) { return other.end == range.start; });
+		if (it != data_.end()) {
+			affected.push_back(std::move(*it));
+			data_.erase(it);
 		}
-
-		// There are no more ranges that can overlap - break
-		if (range.end <= other.start) {
-			break;
+	}
+	data_.extract_overlapping(range.start, range.end, std::back_inserter(affected));
+	if (range.end < std::numeric_limits<uint64_t>::max()) {
+		auto it = data_.find_overlapping(range.end, range.end + 1,
+				[&range](const LockRange &other) { return other.start == range.end; });
+		if (it != data_.end()) {
+			following = std::move(*it);
+			data_.erase(it);
 		}
+	}
 
-		// Ranges do not overlap, no need for collision check
-		if (!range.overlaps(other)) {
+	// Split affected ranges on the inserted range's bounds and apply it to the common parts.
+	// Parts of the inserted range not covered by any existing range are added as they are.
+	std::vector<LockRange> result;
+	uint64_t offset = range.start;
+	for (LockRange &other : affected) {
+		if (other.end <= range.start) {
+			result.push_back(std::move(other));
 			continue;
 		}
 
+		bool same_owners = range.owners == other.owners;
+
 		// If owners are different, the only valid situation is that
 		// both ranges are shared or one of them is removing
 		assert(same_owners ||
 		 (range.shared() && other.shared()) || range.unlocking());
 
-		if (range.start < other.start) {
+		if (other.start < range.start) {
+			LockRange tmp = other;
+			tmp.end = range.start;
+			result.push_back(std::move(tmp));
+		}
+		if (offset < other.start) {
 			LockRange tmp = range;
+			tmp.start = offset;
 			tmp.end = other.start;
-			range.start = other.start;
-			it = insert(it, std::move(tmp), start, end);
-		} else if (range.start == other.start) {
-			if (range.end < other.end) {
-				LockRange tmp = other;
-				tmp.end = range.end;
-				other.start = range.end;
-				range.start = other.end;
-				if (same_owners) {
-					tmp.type = range.type;
-				} else {
-					if (range.unlocking()) {
-						tmp.eraseOwner(range.owner());
-					} else {
-						tmp.addOwners(range.owners);
-					}
-				}
-				it = insert(it, std::move(tmp), start, end);
-			} else { // range.end >= other.end
-				if (same_owners) {
-					other.type = range.type;
-				} else {
-					if (range.unlocking()) {
-						other.eraseOwner(range.owner());
-					} else {
-						other.addOwners(range.owners);
-					}
-				}
-				range.start = other.end;
+			result.push_back(std::move(tmp));
+		}
+
+		LockRange common = other;
+		common.start = std::max(other.start, range.start);
+		common.end = std::min(other.end, range.end);
+		if (same_owners) {
+			common.type = range.type;
+		} else {
+			if (range.unlocking()) {
+				common.eraseOwner(range.owner());
+			} else {
+				common.addOwners(range.owners);
 			}
-		} else { // range.start > other.start
-			LockRange tmp = other;
-			tmp.end = range.start;
-			other.start = range.start;
-			it = insert(it, std::move(tmp), start, end);
 		}
-	}
+		offset = common.end;
+		result.push_back(std::move(common));
 
-	// If anything from the range is left, insert it
-	if (range.end > range.start) {
-		it = insert(it, range, start, end);
+		if (other.end > range.end) {
+			other.start = range.end;
+			result.push_back(std::move(other));
+		}
+	}
+	if (offset < range.end) {
+		LockRange tmp = range;
+		tmp.start = offset;
+		result.push_back(std::move(tmp));
+	}
+	if (following.valid()) {
+		result.push_back(std::move(following));
 	}
 
-	// Remove all leftover ranges
-	data_.erase(std::remove_if(
-			start,
-			end,
-			std::bind(&LockRange::unlocking, std::placeholders::_1)),
-			end
-		);
-}
-
-LockRanges::Container::iterator LockRanges::insert(const Container::iterator &it, const LockRange &range,
-		Container::iterator &begin, Container::iterator &end) {
-	int dist_begin = std::distance(begin, it);
-	int dist_end = std::distance(it, end);
-	auto ret = data_.insert(it, range);
-	begin = ret - dist_begin;
-	end = ret + dist_end + 1;
-	return ret;
-}
-
-LockRanges::Container::iterator LockRanges::insert(const Container::iterator &it, LockRange &&range,
-		Container::iterator &begin, Container::iterator &end) {
-	int dist_begin = std::distance(begin, it);
-	int dist_end = std::distance(it, end);
-	auto ret = data_.insert(it, std::move(range));
-	begin = ret - dist_begin;
-	end = ret + dist_end + 1;
-	return ret;
+	// Put the result back, merging adjacent ranges with the same owners and type
+	// and dropping removed ones
+	LockRange merged;
+	for (LockRange &part : result) {
+		if (part.unlocking()) {
+			continue;
+		}
+		if (merged.valid() && merged.end == part.start && merged.type == part.type
+				&& merged.owners == part.owners) {
+			merged.end = part.end;
+			continue;
+		}
+		if (merged.valid()) {
+			data_.insert(std::move(merged));
+		}
+		merged = std::move(part);
+	}
+	if (merged.valid()) {
+		data_.insert(std::move(merged));
+	}
 }
 
 void LockRanges::clear() {
@@ -224,9 +205,7 @@ bool FileLocks::apply(uint32_t inode, Lock lock, bool nonblocking) {
 }
 
 void FileLocks::enqueue(uint32_t inode, Lock lock) {
-	LockQueue &queue = pending_locks_[inode];
-
-	queue.insert(std::lower_bound(queue.begin(), queue.end(), lock), lock);
+	pending_locks_[inode].insert(std::move(lock));
 }
 
 void FileLocks::gatherCandidates(uint32_t inode, uint64_t start, uint64_t end, LockQueue &result) {
@@ -234,19 +213,13 @@ void FileLocks::gatherCandidates(uint32_t inode, uint64_t start, uint64_t end, L
 	if (it == pending_locks_.end()) {
 		return;
 	}
-	LockQueue &queue = it->second;
+	PendingLocks &queue = it->second;
 
-	auto first = ::std::lower_bound(queue.begin(), queue.end(), start,
-			[](const Lock &lock, uint64_t offset) {return lock.start < offset;});
-	auto last = ::std::upper_bound(queue.begin(), queue.end(), end,
-			[](uint64_t offset, const Lock &lock) {return offset < lock.start;});
-
-	if (first != queue.begin()) {
-		first--;
+	// Only locks waiting for a part of the released range can be woken up
+	queue.extract_overlapping(start, end, std::back_inserter(result));
+	if (queue.empty()) {
+		pending_locks_.erase(it);
 	}
-
-	std::move(first, last, std::back_inserter(result));
-	queue.erase(first, last);
 }
 
 void FileLocks::clear() {
@@ -427,7 +400,7 @@ void store(FILE *file, const Container &data) {
 
 void FileLocks::load(FILE *file) {
 	::load(file, [this](uint32_t inode, Lock &lock) { active_locks_[inode].insert(lock); });
-	::load(file, [this](uint32_t inode, Lock &lock) { pending_locks_[inode].push_back(lock); });
+	::load(file, [this](uint32_t inode, Lock &lock) { pending_locks_[inode].insert(lock); });
 }
 
 void FileLocks::store(FILE *file) {
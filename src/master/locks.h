@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include "common/compact_vector.h"
+#include "common/interval_tree.h"
 #include "protocol/lock_info.h"
 
 #include <unordered_map>
@@ -147,10 +148,15 @@ struct LockRange {
 };
 
 
-/*! \brief Set of ranges, allows to insert, delete and overwrite existing ranges */
+/*! \brief Set of ranges, allows to insert, delete and overwrite existing ranges
+ *
+ * Stored ranges never overlap. They are kept in an interval tree, so looking for
+ * collisions and inserting a range cost O(log n + k), where k is the number of ranges
+ * touched by the operation.
+ */
 class LockRanges {
 public:
-	typedef compact_vector<LockRange> Container;
+	typedef interval_tree<LockRange> Container;
 	typedef Container::iterator iterator;
 	typedef Container::const_iterator const_iterator;
 
@@ -164,10 +170,10 @@ public:
 	/*! \brief Inserts range into the structure
 	 *  Assumes that range is suitable for insertion (fits() function returned true)
 	 */
-	void insert(LockRange &range);
+	void insert(const LockRange &range);
 
-	iterator erase(const_iterator start, const_iterator end) {
-		return data_.erase(start, end);
+	iterator erase(const_iterator it) {
+		return data_.erase(it);
 	}
 
 	size_t size() const {
@@ -193,14 +199,6 @@ public:
 	void clear();
 
 private:
-
-	/*! \brief Inserts range into data structure, preserving begin/end iterators */
-	Container::iterator insert(const Container::iterator &it, const LockRange &range,
-			Container::iterator &begin, Container::iterator &end);
-
-	Container::iterator insert(const Container::iterator &it, LockRange &&range,
-			Container::iterator &begin, Container::iterator &end);
-
 	Container data_;
 };
 
@@ -218,8 +216,10 @@ public:
 	typedef LockRange Lock;
 	/*! \brief Set of all applied locks */
 	typedef LockRanges Locks;
-	/*! \brief Queue of all pending locks */
+	/*! \brief List of pending locks gathered as candidates for insertion */
 	typedef compact_vector<Lock> LockQueue;
+	/*! \brief Queue of all pending locks, indexed by their ranges */
+	typedef interval_tree<Lock> PendingLocks;
 
 	FileLocks() : active_locks_(), pending_locks_() {
 	}
@@ -347,7 +347,7 @@ private:
 	void enqueue(uint32_t inode, Lock lock);
 
 	std::unordered_map<uint32_t, Locks> active_locks_;
-	std::unordered_map<uint32_t, LockQueue> pending_locks_;
+	std::unordered_map<uint32_t, PendingLocks> pending_locks_;
 };
 
 template<typename UnaryPredicate>
@@ -356,12 +356,15 @@ void FileLocks::removePending(uint32_t inode, UnaryPredicate pred) {
 	if (it == pending_locks_.end()) {
 		return;
 	}
-	LockQueue &queue = it->second;
+	PendingLocks &queue = it->second;
 
-	queue.erase(
-		std::remove_if(queue.begin(), queue.end(), pred),
-		queue.end()
-	);
+	for (auto lock_it = queue.begin(); lock_it != queue.end();) {
+		if (pred(*lock_it)) {
+			lock_it = queue.erase(lock_it);
+		} else {
+			++lock_it;
+		}
+	}
 
 	// If last lock was unqueued, inode info can be removed from structure
 	if (queue.empty()) {
@@ -379,22 +382,24 @@ std::pair<uint64_t, uint64_t> FileLocks::unlock(uint32_t inode, UnaryPredicate p
 	}
 	auto &locks = it->second;
 
-	auto erase_it = std::remove_if(locks.begin(), locks.end(),
-			[pred, &start, &end] (LockRange &lock) {
-				auto erased_owners_it = std::remove_if(lock.owners.begin(),
-						lock.owners.end(), pred);
-				// If owner was erased, lock's range might become a candidate for overwrite
-				if (erased_owners_it != lock.owners.end()) {
-					start = std::min(start, lock.start);
-					end = std::max(end, lock.end);
-				}
-				if (erased_owners_it != lock.owners.begin()) {
-					lock.owners.erase(erased_owners_it, lock.owners.end());
-					return false;
-				}
-
-				return true;
-			});
-	locks.erase(erase_it, locks.end());
+	for (auto lock_it = locks.begin(); lock_it != locks.end();) {
+		LockRange &lock = *lock_it;
+		auto erased_owners_it = std::remove_if(lock.owners.begin(), lock.owners.end(), pred);
+		// If owner was erased, lock's range might become a candidate for overwrite
+		if (erased_owners_it != lock.owners.end()) {
+			start = std::min(start, lock.start);
+			end = std::max(end, lock.end);
+		}
+		if (erased_owners_it != lock.owners.begin()) {
+			lock.owners.erase(erased_owners_it, lock.owners.end());
+			++lock_it;
+		} else {
+			lock_it = locks.erase(lock_it);
+		}
+	}
+	// If last lock was unlocked, inode info can be removed from structure
+	if (locks.size() == 0) {
+		active_locks_.erase(it);
+	}
 	return {start, end};
 }
@@ -20,8 +20,11 @@
 
 #include "master/locks.h"
 
+#include <iostream>
 #include <gtest/gtest.h>
 
+#include "common/time_utils.h"
+
 inline bool add(LockRanges &ranges, LockRange &range) {
 	bool ok;
 
@@ -321,3 +324,79 @@ TEST(LocksTest, Unqueue) {
 
 	locks.clear();
 }
+
+TEST(LocksTest, MergeAdjacent) {
+	LockRanges ranges;
+
+	EXPECT_TRUE(lock_exclusive(ranges, 0, 10, 1));
+	EXPECT_TRUE(lock_exclusive(ranges, 20, 30, 1));
+	EXPECT_TRUE(lock_exclusive(ranges, 5, 25, 1));
+	ASSERT_EQ(1U, ranges.size());
+	EXPECT_EQ(0U, ranges.begin()->start);
+	EXPECT_EQ(30U, ranges.begin()->end);
+
+	EXPECT_TRUE(unlock(ranges, 10, 20, 1));
+	EXPECT_EQ(2U, ranges.size());
+	EXPECT_TRUE(lock_exclusive(ranges, 10, 20, 2));
+	EXPECT_EQ(3U, ranges.size());
+}
+
+TEST(LocksTest, WakeUpOverlappingOnly) {
+	FileLocks locks;
+	FileLocks::LockQueue queue;
+
+	EXPECT_TRUE(locks.exclusiveLock(0, 40, 60, owners[0]));
+	EXPECT_TRUE(locks.exclusiveLock(0, 100, 110, owners[0]));
+	// A long pending lock starting way before the released range...
+	EXPECT_FALSE(locks.exclusiveLock(0, 0, 100, owners[1]));
+	// ...and one which doesn't overlap with it
+	EXPECT_FALSE(locks.exclusiveLock(0, 105, 106, owners[2]));
+
+	EXPECT_TRUE(locks.unlock(0, 40, 60, owners[0]));
+	locks.gatherCandidates(0, 40, 60, queue);
+	ASSERT_EQ(1U, queue.size());
+	EXPECT_EQ(0U, queue[0].start);
+	EXPECT_TRUE(locks.apply(0, queue[0]));
+	queue.clear();
+
+	EXPECT_TRUE(locks.unlock(0, 100, 110, owners[0]));
+	locks.gatherCandidates(0, 100, 110, queue);
+	ASSERT_EQ(1U, queue.size());
+	EXPECT_EQ(owners[2], queue[0].owner());
+}
+
+TEST(LocksTest, ManyRanges) {
+	static const uint64_t kRanges = 10000;
+	static const int kRepeats = 10;
+	FileLocks locks;
+	FileLocks::LockQueue queue;
+
+	Timer timer;
+	uint64_t operations = 0;
+	for (int repeat = 0; repeat < kRepeats; ++repeat) {
+		// Every other record is locked by owner 0, owner 1 waits for all of them
+		for (uint64_t i = 0; i < kRanges; ++i) {
+			ASSERT_TRUE(locks.exclusiveLock(0, 2 * i * 100, (2 * i + 1) * 100, owners[0]));
+		}
+		for (uint64_t i = 0; i < kRanges; ++i) {
+			ASSERT_FALSE(locks.sharedLock(0, 2 * i * 100 + 50, (2 * i + 1) * 100 + 50,
+					owners[1]));
+		}
+		for (uint64_t i = 0; i < kRanges; ++i) {
+			ASSERT_TRUE(locks.unlock(0, 2 * i * 100, (2 * i + 1) * 100, owners[0]));
+			locks.gatherCandidates(0, 2 * i * 100, (2 * i + 1) * 100, queue);
+			ASSERT_EQ(1U, queue.size());
+			ASSERT_TRUE(locks.apply(0, queue[0]));
+			queue.clear();
+		}
+		ASSERT_TRUE(locks.unlock(0, 0, std::numeric_limits<uint64_t>::max(), owners[1]));
+		operations += 4 * kRanges;
+	}
+	std::vector<lzfs_locks::Info> active;
+	locks.copyActiveToVector(0, 0, 1, active);
+	EXPECT_TRUE(active.empty());
+
+	std::cout << "Locks with " << kRanges << " ranges per inode: "
+	          << operations * 1000000 / std::max<int64_t>(timer.elapsed_us(), 1)
+	          << " operations/s\n";
+}
@@ -35,6 +35,8 @@
 #include <unistd.h>
 #include <fstream>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "common/cfg.h"
 #include "common/charts.h"
@@ -56,17 +58,21 @@
 #include "common/metadata.h"
 #include "common/moosefs_vector.h"
 #include "common/network_address.h"
+#include "common/output_buffer_chain.h"
 #include "common/random.h"
 #include "common/serialized_goal.h"
 #include "common/slogger.h"
 #include "common/sockets.h"
+#include "common/time_utils.h"
 #include "common/user_groups.h"
 #include "master/changelog.h"
 #include "master/chartsdata.h"
 #include "master/chunks.h"
+#include "master/cache_invalidation_tracker.h"
 #include "master/chunkserver_db.h"
 #include "master/datacachemgr.h"
 #include "master/exports.h"
+#include "master/fair_request_queue.h"
 #include "master/filesystem.h"
 #include "master/filesystem_operations.h"
 #include "master/filesystem_periodic.h"
@@ -74,6 +80,7 @@
 #include "master/masterconn.h"
 #include "master/matocsserv.h"
 #include "master/matomlserv.h"
+#include "master/network_worker_pool.h"
 #include "master/personality.h"
 #include "master/settrashtime_task.h"
 #include "protocol/cltoma.h"
@@ -115,12 +122,6 @@ typedef struct chunklist {
 	struct chunklist *next;
 } chunklist;
 
-// opened files
-typedef struct filelist {
-	uint32_t inode;
-	struct filelist *next;
-} filelist;
-
 struct session {
 	typedef GenericLruCache<uint32_t, FsContext::GroupsContainer, 1024> GroupCache;
 
@@ -140,10 +141,15 @@ struct session {
 	uint32_t rootinode;
 	uint32_t disconnected;  // 0 = connected ; other = disconnection timestamp
 	uint32_t nsocks;        // >0 - connected (number of active connections) ; 0 - not connected
+	bool cacheInvalidation; // one of connections subscribed to LIZ_MATOCL_CACHE_INVALIDATE
+	uint8_t weight;         // number of requests served in one round of the fair scheduler
+	uint32_t requestlatency;    // moving average of time (in us) from receiving to serving a request
+	uint32_t maxrequestlatency; // max time (in us) from receiving to serving a request in this hour
+	uint64_t handledrequests;
 	std::array<uint32_t,SESSION_STATS> currentopstats;
 	std::array<uint32_t,SESSION_STATS> lasthouropstats;
 	GroupCache group_cache;
-	filelist *openedfiles;
+	std::unordered_set<uint32_t> openedfiles;
 	struct session *next;
 
 	session()
@@ -163,6 +169,11 @@ struct session {
 	      rootinode(SPECIAL_INODE_ROOT),
 	      disconnected(),
 	      nsocks(),
+	      cacheInvalidation(),
+	      weight(1),
+	      requestlatency(),
+	      maxrequestlatency(),
+	      handledrequests(),
 	      currentopstats(),
 	      lasthouropstats(),
 	      group_cache(),
@@ -210,6 +221,7 @@ struct matoclserventry {
 	ClientState registered;
 	uint8_t mode;                           //0 - not active, 1 - read header, 2 - read packet
 	bool iolimits;
+	bool cacheInvalidation;                 // LIZ_MATOCL_CACHE_INVALIDATE is sent to this connection
 	int sock;                               //socket number
 	int32_t pdescpos;
 	uint32_t lastread,lastwrite;            //time of last activity
@@ -217,7 +229,8 @@ struct matoclserventry {
 	uint32_t peerip;
 	uint8_t hdrbuff[8];
 	packetstruct inputpacket;
-	packetstruct *outputhead,**outputtail;
+	OutputBufferChain outputBuffer;
+	NetworkWorkerPool::ConnectionPtr connection;  // set if served by gNetworkWorkers
 
 	uint8_t passwordrnd[32];
 	session *sesdata;
@@ -228,12 +241,47 @@ struct matoclserventry {
 	struct matoclserventry *next;
 };
 
+/// Request from a registered client waiting for the fair scheduler.
+struct QueuedRequest {
+	matoclserventry *eptr;
+	uint32_t type;
+	MessageBuffer data;
+	SteadyTimePoint received;
+};
+
+// Maximum number of queued requests of one session; reading from its sockets is
+// suspended when it is reached
+static constexpr uint32_t kMaxQueuedRequestsPerSession = 256;
+
+/// FUSE_WRITE_CHUNK request waiting until the chunk it wants to write gets unlocked.
+struct WaitingChunkWrite {
+	matoclserventry *eptr;
+	PacketHeader header;
+	MessageBuffer data;
+	uint32_t deadline;  // when the request is answered with LIZARDFS_ERROR_LOCKED
+};
+
+// Maximum time (in seconds) a writer waits for a chunk locked by a different writer
+static constexpr uint32_t kMaxChunkLockWait = 10;
+
 static session *sessionshead=NULL;
+// sessions from the list above indexed by their ids (except for sessions with id 0)
+static std::unordered_map<uint32_t, session*> gSessionsById;
 static matoclserventry *matoclservhead=NULL;
 static int lsock;
 static int32_t lsockpdescpos;
 static int exiting,starting;
 
+// network I/O threads (if MATOCL_IO_THREADS > 0)
+static std::unique_ptr<NetworkWorkerPool> gNetworkWorkers;
+
+// requests of registered clients, interleaved between sessions
+static FairRequestQueue<session*, QueuedRequest> gRequestQueue;
+
+// writes waiting for locked chunks (indexed by chunk id) and those which can be retried now
+static std::unordered_multimap<uint64_t, WaitingChunkWrite> gWritesWaitingForUnlock;
+static std::vector<WaitingChunkWrite> gWritesToRetry;
+
 // from config
 static char *ListenHost;
 static char *ListenPort;
@@ -246,6 +294,9 @@ static uint32_t gIoLimitsConfigId;
 static std::string gIoLimitsSubsystem;
 static IoLimitsDatabase gIoLimitsDatabase;
 
+static uint32_t gCacheInvalidationMaxEntries;
+static CacheInvalidationTracker gCacheInvalidationTracker;
+
 static uint32_t stats_prcvd = 0;
 static uint32_t stats_psent = 0;
 static uint64_t stats_brcvd = 0;
@@ -521,6 +572,11 @@ const PacketSerializer* PacketSerializer::getSerializer(PacketHeader::Type type,
 }
 
 void matoclserv_stats(uint64_t stats[5]) {
+	if (gNetworkWorkers) {
+		stats_brcvd += gNetworkWorkers->takeBytesReceived();
+		stats_bsent += gNetworkWorkers->takeBytesSent();
+		stats_psent += gNetworkWorkers->takePacketsSent();
+	}
 	stats[0] = stats_prcvd;
 	stats[1] = stats_psent;
 	stats[2] = stats_brcvd;
@@ -541,6 +597,32 @@ matoclserventry *matoclserv_find_connection(uint32_t id) {
 	return nullptr;
 }
 
+/*! \brief Adds a session to the list of sessions and to the index.
+ *
+ * Session ids are unique (new ones come from fs_newsessionid), so a session
+ * can simply replace the index entry.
+ */
+static void matoclserv_session_link(session *asesdata) {
+	asesdata->next = sessionshead;
+	sessionshead = asesdata;
+	if (asesdata->sessionid != 0) {
+		gSessionsById[asesdata->sessionid] = asesdata;
+	}
+}
+
+/// Removes a session (already unlinked from the list) from the index.
+static void matoclserv_session_unindex(session *asesdata) {
+	auto it = gSessionsById.find(asesdata->sessionid);
+	if (it != gSessionsById.end() && it->second == asesdata) {
+		gSessionsById.erase(it);
+	}
+}
+
+static session *matoclserv_session_lookup(uint32_t sessionid) {
+	auto it = gSessionsById.find(sessionid);
+	return it != gSessionsById.end() ? it->second : nullptr;
+}
+
 /* new registration procedure */
 session* matoclserv_new_session(uint8_t newsession,uint8_t nonewid) {
 	session *asesdata = new session();
@@ -553,8 +635,7 @@ session* matoclserv_new_session(uint8_t newsession,uint8_t nonewid) {
 
 	asesdata->newsession = newsession;
 	asesdata->nsocks = 1;
-	asesdata->next = sessionshead;
-	sessionshead = asesdata;
+	matoclserv_session_link(asesdata);
 	return asesdata;
 }
 
@@ -563,19 +644,17 @@ session* matoclserv_find_session(uint32_t sessionid) {
 	if (sessionid==0) {
 		return NULL;
 	}
-	for (asesdata = sessionshead ; asesdata ; asesdata=asesdata->next) {
-		if (asesdata->sessionid==sessionid) {
-//                      syslog(LOG_NOTICE,"found: %u ; before ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
-			if (asesdata->newsession>=2) {
-				asesdata->newsession-=2;
-			}
-			asesdata->nsocks++;
-//                      syslog(LOG_NOTICE,"found: %u ; after ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
-			asesdata->disconnected = 0;
-			return asesdata;
+	asesdata = matoclserv_session_lookup(sessionid);
+	if (asesdata) {
+//              syslog(LOG_NOTICE,"found: %u ; before ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
+		if (asesdata->newsession>=2) {
+			asesdata->newsession-=2;
 		}
+		asesdata->nsocks++;
+//              syslog(LOG_NOTICE,"found: %u ; after ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
+		asesdata->disconnected = 0;
 	}
-	return NULL;
+	return asesdata;
 }
 
 void matoclserv_close_session(uint32_t sessionid) {
@@ -583,14 +662,15 @@ void matoclserv_close_session(uint32_t sessionid) {
 	if (sessionid==0) {
 		return;
 	}
-	for (asesdata = sessionshead ; asesdata ; asesdata=asesdata->next) {
-		if (asesdata->sessionid==sessionid) {
-//                      syslog(LOG_NOTICE,"close: %u ; before ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
-			if (asesdata->nsocks==1 && asesdata->newsession<2) {
-				asesdata->newsession+=2;
-			}
-//                      syslog(LOG_NOTICE,"close: %u ; after ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
+	asesdata = matoclserv_session_lookup(sessionid);
+	if (asesdata) {
+//              syslog(LOG_NOTICE,"close: %u ; before ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
+		// Mounts may use many connections in one session, the session is removed when the last
+		// of them is closed (a reconnection clears the mark)
+		if (asesdata->newsession<2) {
+			asesdata->newsession+=2;
 		}
+//              syslog(LOG_NOTICE,"close: %u ; after ; nsocks: %u ; state: %u",sessionid,asesdata->nsocks,asesdata->newsession);
 	}
 	return;
 }
@@ -598,7 +678,7 @@ void matoclserv_close_session(uint32_t sessionid) {
 void matoclserv_store_sessions() {
 	session *asesdata;
 	uint32_t ileng;
-	uint8_t fsesrecord[43+SESSION_STATS*8]; // 4+4+4+4+1+1+1+4+4+4+4+4+4+SESSION_STATS*4+SESSION_STATS*4
+	uint8_t fsesrecord[44+SESSION_STATS*8]; // 4+4+4+4+1+1+1+4+4+4+4+4+4+1+SESSION_STATS*4+SESSION_STATS*4
 	uint8_t *ptr;
 	int i;
 	FILE *fd;
@@ -608,7 +688,7 @@ void matoclserv_store_sessions() {
 		lzfs_silent_errlog(LOG_WARNING,"can't store sessions, open error");
 		return;
 	}
-	memcpy(fsesrecord,MFSSIGNATURE "S \001\006\004",8);
+	memcpy(fsesrecord,MFSSIGNATURE "S \001\006\005",8);
 	ptr = fsesrecord+8;
 	put16bit(&ptr,SESSION_STATS);
 	if (fwrite(fsesrecord,10,1,fd)!=1) {
@@ -637,13 +717,14 @@ void matoclserv_store_sessions() {
 			put32bit(&ptr,asesdata->rootgid);
 			put32bit(&ptr,asesdata->mapalluid);
 			put32bit(&ptr,asesdata->mapallgid);
+			put8bit(&ptr,asesdata->weight);
 			for (i=0 ; i<SESSION_STATS ; i++) {
 				put32bit(&ptr,asesdata->currentopstats[i]);
 			}
 			for (i=0 ; i<SESSION_STATS ; i++) {
 				put32bit(&ptr,asesdata->lasthouropstats[i]);
 			}
-			if (fwrite(fsesrecord,(43+SESSION_STATS*8),1,fd)!=1) {
+			if (fwrite(fsesrecord,(44+SESSION_STATS*8),1,fd)!=1) {
 				lzfs_pretty_syslog(LOG_WARNING,"can't store sessions, fwrite error");
 				fclose(fd);
 				return;
@@ -674,7 +755,8 @@ int matoclserv_load_sessions() {
 	const uint8_t *ptr;
 	uint8_t mapalldata;
 	uint8_t goaltrashdata;
-	uint32_t i,statsinfile;
+	uint8_t weightdata;
+	uint32_t i,statsinfile,recordsize;
 	int r;
 	FILE *fd;
 
@@ -692,6 +774,7 @@ int matoclserv_load_sessions() {
 		fclose(fd);
 		return -1;
 	}
+	weightdata = 0;
 	if (memcmp(hdr,MFSSIGNATURE "S 1.5",8)==0) {
 		mapalldata = 0;
 		goaltrashdata = 0;
@@ -724,6 +807,17 @@ int matoclserv_load_sessions() {
 		}
 		ptr = hdr;
 		statsinfile = get16bit(&ptr);
+	} else if (memcmp(hdr,MFSSIGNATURE "S \001\006\005",8)==0) {
+		mapalldata = 1;
+		goaltrashdata = 1;
+		weightdata = 1;
+		if (fread(hdr,2,1,fd)!=1) {
+			lzfs_pretty_syslog(LOG_WARNING,"can't load sessions, fread error");
+			fclose(fd);
+			return -1;
+		}
+		ptr = hdr;
+		statsinfile = get16bit(&ptr);
 	} else {
 		lzfs_pretty_syslog(LOG_WARNING,"can't load sessions, bad header");
 		fclose(fd);
@@ -731,22 +825,19 @@ int matoclserv_load_sessions() {
 	}
 
 	if (mapalldata==0) {
-		fsesrecord = (uint8_t*) malloc(25+statsinfile*8);
+		recordsize = 25+statsinfile*8;
 	} else if (goaltrashdata==0) {
-		fsesrecord = (uint8_t*) malloc(33+statsinfile*8);
+		recordsize = 33+statsinfile*8;
+	} else if (weightdata==0) {
+		recordsize = 43+statsinfile*8;
 	} else {
-		fsesrecord = (uint8_t*) malloc(43+statsinfile*8);
+		recordsize = 44+statsinfile*8;
 	}
+	fsesrecord = (uint8_t*) malloc(recordsize);
 	passert(fsesrecord);
 
 	while (!feof(fd)) {
-		if (mapalldata==0) {
-			r = fread(fsesrecord,25+statsinfile*8,1,fd);
-		} else if (goaltrashdata==0) {
-			r = fread(fsesrecord,33+statsinfile*8,1,fd);
-		} else {
-			r = fread(fsesrecord,43+statsinfile*8,1,fd);
-		}
+		r = fread(fsesrecord,recordsize,1,fd);
 		if (r==1) {
 			ptr = fsesrecord;
 			asesdata = new session();
@@ -768,6 +859,9 @@ int matoclserv_load_sessions() {
 				asesdata->mapalluid = get32bit(&ptr);
 				asesdata->mapallgid = get32bit(&ptr);
 			}
+			if (weightdata) {
+				asesdata->weight = get8bit(&ptr);
+			}
 			asesdata->newsession = 1;
 			asesdata->disconnected = eventloop_time();
 			for (i=0 ; i<SESSION_STATS ; i++) {
@@ -792,8 +886,7 @@ int matoclserv_load_sessions() {
 				}
 				asesdata->info[ileng]=0;
 			}
-			asesdata->next = sessionshead;
-			sessionshead = asesdata;
+			matoclserv_session_link(asesdata);
 		}
 		if (ferror(fd)) {
 			free(fsesrecord);
@@ -809,82 +902,44 @@ int matoclserv_load_sessions() {
 }
 
 int matoclserv_insert_openfile(session* cr,uint32_t inode) {
-	filelist *ofptr,**ofpptr;
 	int status;
 
-	ofpptr = &(cr->openedfiles);
-	while ((ofptr=*ofpptr)) {
-		if (ofptr->inode==inode) {
-			return LIZARDFS_STATUS_OK;       // file already acquired - nothing to do
-		}
-		if (ofptr->inode>inode) {
-			break;
-		}
-		ofpptr = &(ofptr->next);
+	if (cr->openedfiles.count(inode) > 0) {
+		return LIZARDFS_STATUS_OK;       // file already acquired - nothing to do
 	}
 	status = fs_acquire(FsContext::getForMaster(eventloop_time()), inode, cr->sessionid);
 	if (status==LIZARDFS_STATUS_OK) {
-		ofptr = (filelist*)malloc(sizeof(filelist));
-		passert(ofptr);
-		ofptr->inode = inode;
-		ofptr->next = *ofpptr;
-		*ofpptr = ofptr;
+		cr->openedfiles.insert(inode);
 	}
 	return status;
 }
 
 void matoclserv_add_open_file(uint32_t sessionid,uint32_t inode) {
 	session *asesdata;
-	filelist *ofptr,**ofpptr;
 
-	for (asesdata = sessionshead ; asesdata && asesdata->sessionid!=sessionid; asesdata=asesdata->next) ;
+	asesdata = matoclserv_session_lookup(sessionid);
 	if (asesdata==NULL) {
 		asesdata = new session();
 		passert(asesdata);
 		asesdata->sessionid = sessionid;
 /* session created by filesystem - only for old clients (pre 1.5.13) */
 		asesdata->disconnected = eventloop_time();
-		asesdata->next = sessionshead;
-		sessionshead = asesdata;
+		matoclserv_session_link(asesdata);
 	}
 
-	ofpptr = &(asesdata->openedfiles);
-	while ((ofptr=*ofpptr)) {
-		if (ofptr->inode==inode) {
-			return;
-		}
-		if (ofptr->inode>inode) {
-			break;
-		}
-		ofpptr = &(ofptr->next);
-	}
-	ofptr = (filelist*)malloc(sizeof(filelist));
-	passert(ofptr);
-	ofptr->inode = inode;
-	ofptr->next = *ofpptr;
-	*ofpptr = ofptr;
+	asesdata->openedfiles.insert(inode);
 }
 
 void matoclserv_remove_open_file(uint32_t sessionid, uint32_t inode) {
 	session *asesdata;
 
-	for (asesdata = sessionshead; asesdata && asesdata->sessionid != sessionid; asesdata = asesdata->next) {
-	}
+	asesdata = matoclserv_session_lookup(sessionid);
 	if (asesdata == NULL) {
 		lzfs_pretty_syslog(LOG_ERR, "sessions file is corrupted");
 		return;
 	}
 
-	filelist *ofptr = NULL;
-	filelist** ofpptr = &(asesdata->openedfiles);
-	while ((ofptr = *ofpptr)) {
-		if (ofptr->inode == inode) {
-			*ofpptr = ofptr->next;
-			free(ofptr);
-			break;
-		}
-		ofpptr = &(ofptr->next);
-	}
+	asesdata->openedfiles.erase(inode);
 }
 
 void matoclserv_reset_session_timeouts() {
@@ -896,38 +951,15 @@ void matoclserv_reset_session_timeouts() {
 }
 
 uint8_t* matoclserv_createpacket(matoclserventry *eptr,uint32_t type,uint32_t size) {
-	packetstruct *outpacket;
-	uint8_t *ptr;
-	uint32_t psize;
-
-	outpacket=(packetstruct*)malloc(sizeof(packetstruct));
-	passert(outpacket);
-	psize = size+8;
-	outpacket->packet= (uint8_t*) malloc(psize);
-	passert(outpacket->packet);
-	outpacket->bytesleft = psize;
-	ptr = outpacket->packet;
-	put32bit(&ptr,type);
-	put32bit(&ptr,size);
-	outpacket->startptr = (uint8_t*)(outpacket->packet);
-	outpacket->next = NULL;
-	*(eptr->outputtail) = outpacket;
-	eptr->outputtail = &(outpacket->next);
-	return ptr;
+	return eptr->outputBuffer.allocatePacket(type, size);
 }
 
 void matoclserv_createpacket(matoclserventry *eptr, const MessageBuffer& buffer) {
-	packetstruct *outpacket = (packetstruct*)malloc(sizeof(packetstruct));
-	passert(outpacket);
-	outpacket->packet = (uint8_t*) malloc(buffer.size());
-	passert(outpacket->packet);
-	outpacket->bytesleft = buffer.size();
-	// TODO unificate output packets and remove suboptimal memory copying
-	memcpy(outpacket->packet, buffer.data(), buffer.size());
-	outpacket->startptr = outpacket->packet;
-	outpacket->next = NULL;
-	*(eptr->outputtail) = outpacket;
-	eptr->outputtail = &(outpacket->next);
+	eptr->outputBuffer.append(buffer);
+}
+
+void matoclserv_createpacket(matoclserventry *eptr, MessageBuffer&& buffer) {
+	eptr->outputBuffer.append(std::move(buffer));
 }
 
 static inline bool matoclserv_ugid_remap_required(matoclserventry *eptr, uint32_t uid) {
@@ -1528,6 +1560,101 @@ static void matoclserv_broadcast_iolimits_cfg() {
 	}
 }
 
+/*! \brief Remember that the client got metadata of \p inode and may cache it.
+ *
+ * Only sessions subscribed to cache invalidation are tracked, other clients rely on timeouts
+ * of their caches. A client may use many connections, all of them are tracked while
+ * notifications are sent to the one which subscribed.
+ */
+static void matoclserv_cache_access(matoclserventry *eptr, uint32_t inode) {
+	if (eptr->sesdata == nullptr || !eptr->sesdata->cacheInvalidation
+			|| eptr->sesdata->rootinode == 0) {
+		return;
+	}
+	if (inode == SPECIAL_INODE_ROOT) {
+		inode = eptr->sesdata->rootinode;
+	}
+	gCacheInvalidationTracker.access(inode, eptr->sesdata->sessionid);
+}
+
+void matoclserv_notify_node_changed(uint32_t inode) {
+	gCacheInvalidationTracker.nodeChanged(inode);
+}
+
+void matoclserv_notify_entry_changed(uint32_t parent, const std::string &name) {
+	gCacheInvalidationTracker.entryChanged(parent, name);
+}
+
+/*! \brief Send gathered cache invalidation notifications to subscribed clients.
+ *
+ * Called once per event loop iteration, i.e. after replies to all requests which caused
+ * the changes are queued. Notifications for sessions without a subscribed connection
+ * wait in the tracker until the client reconnects or its session expires.
+ */
+static void matoclserv_cache_invalidation_flush() {
+	if (!gCacheInvalidationTracker.hasNotifications()) {
+		return;
+	}
+	const uint32_t maxItems = matocl::cacheInvalidate::kMaxNumberOfItems;
+	for (matoclserventry *eptr = matoclservhead; eptr; eptr = eptr->next) {
+		if (!eptr->cacheInvalidation || eptr->sesdata == nullptr || eptr->mode == KILL) {
+			continue;
+		}
+		auto notification = gCacheInvalidationTracker.collectNotifications(
+				eptr->sesdata->sessionid);
+		uint32_t rootinode = eptr->sesdata->rootinode;
+		for (uint32_t &inode : notification.inodes) {
+			if (inode == rootinode) {
+				inode = SPECIAL_INODE_ROOT;
+			}
+		}
+		for (NamedInodeEntry &entry : notification.entries) {
+			if (entry.inode == rootinode) {
+				entry.inode = SPECIAL_INODE_ROOT;
+			}
+		}
+		for (size_t inodesPos = 0, entriesPos = 0;
+				inodesPos < notification.inodes.size() || entriesPos < notification.entries.size();) {
+			size_t inodesCount = std::min<size_t>(maxItems, notification.inodes.size() - inodesPos);
+			size_t entriesCount = std::min<size_t>(maxItems, notification.entries.size() - entriesPos);
+			std::vector<uint32_t> inodes(notification.inodes.begin() + inodesPos,
+					notification.inodes.begin() + inodesPos + inodesCount);
+			std::vector<NamedInodeEntry> entries(notification.entries.begin() + entriesPos,
+					notification.entries.begin() + entriesPos + entriesCount);
+			matoclserv_createpacket(eptr, matocl::cacheInvalidate::build(0, inodes, entries));
+			inodesPos += inodesCount;
+			entriesPos += entriesCount;
+		}
+	}
+}
+
+void matoclserv_cache_invalidation_subscribe(matoclserventry *eptr, const uint8_t *data,
+		uint32_t length) {
+	uint32_t messageId;
+	cltoma::cacheInvalidationSubscribe::deserialize(data, length, messageId);
+	uint8_t status = LIZARDFS_STATUS_OK;
+	if (gCacheInvalidationMaxEntries == 0 || eptr->sesdata == nullptr
+			|| eptr->sesdata->rootinode == 0) {
+		status = LIZARDFS_ERROR_ENOTSUP;
+	} else {
+		eptr->cacheInvalidation = true;
+		eptr->sesdata->cacheInvalidation = true;
+	}
+	matoclserv_createpacket(eptr, matocl::cacheInvalidationSubscribe::build(messageId, status));
+}
+
+static void matoclserv_cache_invalidation_reload(bool init) {
+	uint32_t maxEntries = cfg_getuint32("CACHE_INVALIDATION_MAX_ENTRIES", 250000);
+	if (!init && (maxEntries == 0) != (gCacheInvalidationMaxEntries == 0)) {
+		// subscribed clients would keep their long cache timeouts without any notifications
+		lzfs_pretty_syslog(LOG_WARNING, "main master server module: enabling or disabling "
+				"CACHE_INVALIDATION_MAX_ENTRIES requires restart, ignoring new value");
+		return;
+	}
+	gCacheInvalidationMaxEntries = maxEntries;
+	gCacheInvalidationTracker.setCapacity(gCacheInvalidationMaxEntries);
+}
+
 void matoclserv_ping(matoclserventry *eptr,const uint8_t *data,uint32_t length) {
 	uint32_t size;
 	deserializeAllMooseFsPacketDataNoHeader(data, length, size);
@@ -1645,6 +1772,7 @@ void matoclserv_fuse_register(matoclserventry *eptr,const uint8_t *data,uint32_t
 		uint32_t mintrashtime,maxtrashtime;
 		uint32_t rootuid,rootgid;
 		uint32_t mapalluid,mapallgid;
+		uint8_t weight;
 		uint32_t ileng,pleng;
 		uint8_t i,rcode;
 		const uint8_t *path;
@@ -1714,9 +1842,9 @@ void matoclserv_fuse_register(matoclserventry *eptr,const uint8_t *data,uint32_t
 				path = (const uint8_t*)"";
 			}
 			if (length==77+16+ileng+pleng) {
-				status = exports_check(eptr->peerip,eptr->version,0,path,eptr->passwordrnd,rptr,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime);
+				status = exports_check(eptr->peerip,eptr->version,0,path,eptr->passwordrnd,rptr,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime,&weight);
 			} else {
-				status = exports_check(eptr->peerip,eptr->version,0,path,NULL,NULL,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime);
+				status = exports_check(eptr->peerip,eptr->version,0,path,NULL,NULL,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime,&weight);
 			}
 			if (status==LIZARDFS_STATUS_OK) {
 				status = fs_getrootinode(&rootinode,path);
@@ -1738,6 +1866,7 @@ void matoclserv_fuse_register(matoclserventry *eptr,const uint8_t *data,uint32_t
 				eptr->sesdata->maxgoal = maxgoal;
 				eptr->sesdata->mintrashtime = mintrashtime;
 				eptr->sesdata->maxtrashtime = maxtrashtime;
+				eptr->sesdata->weight = weight;
 				eptr->sesdata->peerip = eptr->peerip;
 				if (ileng>0) {
 					if (info[ileng-1]==0) {
@@ -1801,9 +1930,9 @@ void matoclserv_fuse_register(matoclserventry *eptr,const uint8_t *data,uint32_t
 			info = (const char*)rptr;
 			rptr+=ileng;
 			if (length==73+16+ileng) {
-				status = exports_check(eptr->peerip,eptr->version,1,NULL,eptr->passwordrnd,rptr,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime);
+				status = exports_check(eptr->peerip,eptr->version,1,NULL,eptr->passwordrnd,rptr,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime,&weight);
 			} else {
-				status = exports_check(eptr->peerip,eptr->version,1,NULL,NULL,NULL,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime);
+				status = exports_check(eptr->peerip,eptr->version,1,NULL,NULL,NULL,&sesflags,&rootuid,&rootgid,&mapalluid,&mapallgid,&mingoal,&maxgoal,&mintrashtime,&maxtrashtime,&weight);
 			}
 			if (status==LIZARDFS_STATUS_OK) {
 				eptr->sesdata = matoclserv_new_session(1,0);
@@ -1822,6 +1951,7 @@ void matoclserv_fuse_register(matoclserventry *eptr,const uint8_t *data,uint32_t
 				eptr->sesdata->maxgoal = maxgoal;
 				eptr->sesdata->mintrashtime = mintrashtime;
 				eptr->sesdata->maxtrashtime = maxtrashtime;
+				eptr->sesdata->weight = weight;
 				eptr->sesdata->peerip = eptr->peerip;
 				if (ileng>0) {
 					if (info[ileng-1]==0) {
@@ -1914,7 +2044,6 @@ void matoclserv_fuse_register(matoclserventry *eptr,const uint8_t *data,uint32_t
 
 void matoclserv_fuse_reserved_inodes(matoclserventry *eptr,const uint8_t *data,uint32_t length) {
 	const uint8_t *ptr;
-	filelist *ofptr,**ofpptr;
 	uint32_t inode;
 
 	if ((length&0x3)!=0) {
@@ -1923,69 +2052,40 @@ void matoclserv_fuse_reserved_inodes(matoclserventry *eptr,const uint8_t *data,u
 		return;
 	}
 
+	// inodes still used by the client (the list ends with the first 0)
+	std::unordered_set<uint32_t> reserved;
 	ptr = data;
-	ofpptr = &(eptr->sesdata->openedfiles);
 	length >>= 2;
-	if (length) {
+	reserved.reserve(length);
+	while (length > 0) {
 		length--;
 		inode = get32bit(&ptr);
-	} else {
-		inode=0;
+		if (inode == 0) {
+			break;
+		}
+		reserved.insert(inode);
+	}
+
+	std::unordered_set<uint32_t> &openedfiles = eptr->sesdata->openedfiles;
+	std::vector<uint32_t> released;
+	for (uint32_t openedinode : openedfiles) {
+		if (reserved.count(openedinode) == 0) {
+			released.push_back(openedinode);
+		}
 	}
 
 	FsContext context = FsContext::getForMaster(eventloop_time());
 	changelog_disable_flush();
-	while ((ofptr=*ofpptr) && inode>0) {
-		if (ofptr->inode<inode) {
-			fs_release(context, ofptr->inode, eptr->sesdata->sessionid);
-			*ofpptr = ofptr->next;
-			free(ofptr);
-		} else if (ofptr->inode>inode) {
-			if (fs_acquire(context, inode, eptr->sesdata->sessionid) == LIZARDFS_STATUS_OK) {
-				ofptr = (filelist*)malloc(sizeof(filelist));
-				passert(ofptr);
-				ofptr->next = *ofpptr;
-				ofptr->inode = inode;
-				*ofpptr = ofptr;
-				ofpptr = &(ofptr->next);
-			}
-			if (length) {
-				length--;
-				inode = get32bit(&ptr);
-			} else {
-				inode=0;
-			}
-		} else {
-			ofpptr = &(ofptr->next);
-			if (length) {
-				length--;
-				inode = get32bit(&ptr);
-			} else {
-				inode=0;
-			}
-		}
+	for (uint32_t releasedinode : released) {
+		openedfiles.erase(releasedinode);
+		fs_release(context, releasedinode, eptr->sesdata->sessionid);
 	}
-	while (inode>0) {
-		if (fs_acquire(context, inode, eptr->sesdata->sessionid) == LIZARDFS_STATUS_OK) {
-			ofptr = (filelist*)malloc(sizeof(filelist));
-			passert(ofptr);
-			ofptr->next = *ofpptr;
-			ofptr->inode = inode;
-			*ofpptr = ofptr;
-			ofpptr = &(ofptr->next);
-		}
-		if (length) {
-			length--;
-			inode = get32bit(&ptr);
-		} else {
-			inode=0;
+	for (uint32_t reservedinode : reserved) {
+		if (openedfiles.count(reservedinode) == 0
+				&& fs_acquire(context, reservedinode, eptr->sesdata->sessionid) == LIZARDFS_STATUS_OK) {
+			openedfiles.insert(reservedinode);
 		}
 	}
-	while ((ofptr=*ofpptr)) {
-		fs_release(context, ofptr->inode, eptr->sesdata->sessionid);
-		*ofpptr = ofptr->next;
-		free(ofptr);
-	}
 	changelog_enable_flush();
 }
 
@@ -2054,6 +2154,9 @@ void matoclserv_liz_whole_path_lookup(matoclserventry *eptr, const uint8_t *data
 		FsContext context = matoclserv_get_context(eptr, uid, gid);
 		status = fs_whole_path_lookup(context, inode, path, &found_inode, attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, found_inode);
+	}
 
 	if (status != LIZARDFS_STATUS_OK) {
 		matoclserv_createpacket(eptr, matocl::wholePathLookup::build(msgid, status));
@@ -2094,6 +2197,13 @@ void matoclserv_fuse_lookup(matoclserventry *eptr,const uint8_t *data,uint32_t l
 		FsContext context = matoclserv_get_context(eptr, uid, gid);
 		status = fs_lookup(context,inode,HString((char*)name, nleng),&newinode,attr);
 	}
+	if (status == LIZARDFS_STATUS_OK || status == LIZARDFS_ERROR_ENOENT) {
+		// negative entries are cached too
+		matoclserv_cache_access(eptr, inode);
+	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, newinode);
+	}
 	ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_LOOKUP,(status!=LIZARDFS_STATUS_OK)?5:43);
 	put32bit(&ptr,msgid);
 	if (status!=LIZARDFS_STATUS_OK) {
@@ -2125,6 +2235,9 @@ void matoclserv_fuse_getattr(matoclserventry *eptr,const uint8_t *data,uint32_t
 		FsContext context = matoclserv_get_context(eptr, uid, gid);
 		status = fs_getattr(context,inode,attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, inode);
+	}
 	ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_GETATTR,(status!=LIZARDFS_STATUS_OK)?5:39);
 	put32bit(&ptr,msgid);
 	if (status!=LIZARDFS_STATUS_OK) {
@@ -2173,6 +2286,9 @@ void matoclserv_fuse_setattr(matoclserventry *eptr,const uint8_t *data,uint32_t
 		status = fs_setattr(context, inode, setmask, attrmode, attruid, attrgid,
 							attratime, attrmtime, sugidclearmode, attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, inode);
+	}
 	ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_SETATTR,(status!=LIZARDFS_STATUS_OK)?5:39);
 	put32bit(&ptr,msgid);
 	if (status!=LIZARDFS_STATUS_OK) {
@@ -2235,6 +2351,9 @@ void matoclserv_fuse_truncate(matoclserventry *eptr, PacketHeader header, const
 		status = fs_try_setlength(context, inode, opened, length,
 								  (type != FUSE_TRUNCATE_END), lockId, attr, &chunkId);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, inode);
+	}
 
 	// In case of LIZARDFS_ERROR_NOTPOSSIBLE we have to tell the client to write the chunk before truncating
 	if (status == LIZARDFS_ERROR_NOTPOSSIBLE && header.type == CLTOMA_FUSE_TRUNCATE) {
@@ -2385,6 +2504,9 @@ void matoclserv_fuse_symlink(matoclserventry *eptr,const uint8_t *data,uint32_t
 		status = fs_symlink(context, inode, HString((char *)name, nleng),
 	                    std::string((char *)path, pleng), &newinode, &attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, newinode);
+	}
 	ptr =
 	    matoclserv_createpacket(eptr, MATOCL_FUSE_SYMLINK, (status != LIZARDFS_STATUS_OK) ? 5 : 43);
 	put32bit(&ptr, msgid);
@@ -2427,6 +2549,9 @@ void matoclserv_fuse_mknod(matoclserventry *eptr, PacketHeader header, const uin
 				inode, HString(std::move(name)),
 				type, mode, umask, rdev, &newinode, attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, newinode);
+	}
 
 	MessageBuffer reply;
 	if (status == LIZARDFS_STATUS_OK && header.type == CLTOMA_FUSE_MKNOD) {
@@ -2477,6 +2602,9 @@ void matoclserv_fuse_mkdir(matoclserventry *eptr, PacketHeader header, const uin
 		status = fs_mkdir(context, inode, HString(std::move(name)), mode, umask,
 						copysgid, &newinode, attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, newinode);
+	}
 
 	MessageBuffer reply;
 	if (status == LIZARDFS_STATUS_OK && header.type == CLTOMA_FUSE_MKDIR) {
@@ -2689,6 +2817,9 @@ void matoclserv_fuse_link(matoclserventry *eptr,const uint8_t *data,uint32_t len
 		auto context = matoclserv_get_context(eptr, uid, gid);
 		status = fs_link(context, inode, inode_dst, HString((char*)name_dst, nleng_dst), &newinode, &attr);
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, newinode);
+	}
 	ptr = matoclserv_createpacket(eptr,MATOCL_FUSE_LINK,(status!=LIZARDFS_STATUS_OK)?5:43);
 	put32bit(&ptr,msgid);
 	if (status!=LIZARDFS_STATUS_OK) {
@@ -2732,6 +2863,10 @@ void matoclserv_fuse_getdir(matoclserventry *eptr,const PacketHeader &header, co
 			if (status != LIZARDFS_STATUS_OK) {
 				matocl::fuseGetDir::serialize(buffer, message_id, status);
 			} else {
+				matoclserv_cache_access(eptr, inode);
+				for (const DirectoryEntry &entry : dir_entries) {
+					matoclserv_cache_access(eptr, entry.inode);
+				}
 				matocl::fuseGetDir::serialize(buffer, message_id, first_entry, dir_entries);
 			}
 		} else if (packet_version == cltoma::fuseGetDirLegacy::kLegacyClient) {
@@ -2827,6 +2962,9 @@ void matoclserv_fuse_open(matoclserventry *eptr,const uint8_t *data,uint32_t len
 			status = fs_opencheck(context,inode,flags,attr);
 		}
 	}
+	if (status == LIZARDFS_STATUS_OK) {
+		matoclserv_cache_access(eptr, inode);
+	}
 	if (eptr->version>=0x010609 && status==LIZARDFS_STATUS_OK) {
 		allowcache = dcm_open(inode,eptr->sesdata->sessionid);
 		if (allowcache==0) {
@@ -2847,6 +2985,90 @@ void matoclserv_fuse_open(matoclserventry *eptr,const uint8_t *data,uint32_t len
 	}
 }
 
+/*! \brief Executes one step of LIZ_CLTOMA_FUSE_COMPOUND.
+ *
+ * Behaves like handlers of the corresponding single requests, so that the client
+ * can't tell the difference (apart from the number of round trips).
+ */
+static uint8_t matoclserv_fuse_compound_op(matoclserventry *eptr, const FsContext &context,
+		const CompoundMetadataOp &op, uint32_t inode, CompoundMetadataOpResult &result) {
+	uint8_t status;
+	result.inode = inode;
+	switch (op.type) {
+	case CompoundMetadataOpType::kLookup:
+		status = fs_lookup(context, inode, HString(op.name), &result.inode, result.attr);
+		eptr->sesdata->currentopstats[3]++;
+		return status;
+	case CompoundMetadataOpType::kGetattr:
+		status = fs_getattr(context, inode, result.attr);
+		eptr->sesdata->currentopstats[1]++;
+		return status;
+	case CompoundMetadataOpType::kMknod:
+		status = fs_mknod(context, inode, HString(op.name), op.node_type, op.mode, op.umask,
+				op.rdev, &result.inode, result.attr);
+		eptr->sesdata->currentopstats[8]++;
+		return status;
+	case CompoundMetadataOpType::kOpen:
+		status = matoclserv_insert_openfile(eptr->sesdata, inode);
+		if (status == LIZARDFS_STATUS_OK) {
+			status = fs_opencheck(context, inode, op.flags, result.attr);
+		}
+		if (status == LIZARDFS_STATUS_OK && dcm_open(inode, eptr->sesdata->sessionid) == 0) {
+			result.attr[1] &= (0xFF ^ (MATTR_ALLOWDATACACHE << 4));
+		}
+		eptr->sesdata->currentopstats[13]++;
+		return status;
+	case CompoundMetadataOpType::kSetattr:
+		status = fs_setattr(context, inode, op.flags, op.mode, op.attr_uid, op.attr_gid,
+				op.attr_atime, op.attr_mtime, static_cast<SugidClearMode>(op.sugid_clear_mode),
+				result.attr);
+		eptr->sesdata->currentopstats[2]++;
+		return status;
+	}
+	return LIZARDFS_ERROR_EINVAL;
+}
+
+void matoclserv_fuse_compound(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
+	uint32_t messageId, uid, gid;
+	std::vector<CompoundMetadataOp> operations;
+
+	cltoma::fuseCompound::deserialize(data, length, messageId, uid, gid, operations);
+
+	uint8_t status = matoclserv_check_group_cache(eptr, gid);
+	if (status == LIZARDFS_STATUS_OK && (operations.empty()
+			|| operations.size() > matocl::fuseCompound::kMaxNumberOfOperations)) {
+		status = LIZARDFS_ERROR_EINVAL;
+	}
+	if (status != LIZARDFS_STATUS_OK) {
+		matoclserv_createpacket(eptr, matocl::fuseCompound::build(messageId, status));
+		return;
+	}
+
+	// All operations are executed by this call, so no other request can interleave with them
+	FsContext context = matoclserv_get_context(eptr, uid, gid);
+	std::vector<CompoundMetadataOpResult> results;
+	results.reserve(operations.size());
+	uint32_t previousInode = 0;
+	for (const CompoundMetadataOp &op : operations) {
+		uint32_t inode = op.inode;
+		if (inode == CompoundMetadataOp::kPreviousInode) {
+			inode = previousInode;
+		}
+		results.emplace_back();
+		CompoundMetadataOpResult &result = results.back();
+		result.status = matoclserv_fuse_compound_op(eptr, context, op, inode, result);
+		if (result.status != LIZARDFS_STATUS_OK) {
+			break;
+		}
+		if (op.type == CompoundMetadataOpType::kLookup || op.type == CompoundMetadataOpType::kMknod) {
+			matoclserv_cache_access(eptr, inode);
+		}
+		matoclserv_cache_access(eptr, result.inode);
+		previousInode = result.inode;
+	}
+	matoclserv_createpacket(eptr, matocl::fuseCompound::build(messageId, results));
+}
+
 void matoclserv_fuse_read_chunk(matoclserventry *eptr, PacketHeader header, const uint8_t *data) {
 	sassert(header.type == CLTOMA_FUSE_READ_CHUNK || header.type == LIZ_CLTOMA_FUSE_READ_CHUNK);
 	uint8_t status;
@@ -2890,6 +3112,48 @@ void matoclserv_fuse_read_chunk(matoclserventry *eptr, PacketHeader header, cons
 	}
 }
 
+void matoclserv_fuse_read_chunks(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
+	uint32_t messageId, inode, firstIndex, count;
+	uint64_t fileLength;
+	std::vector<uint64_t> chunkIds;
+
+	cltoma::fuseReadChunks::deserialize(data, length, messageId, inode, firstIndex, count);
+	count = std::min(count, matocl::fuseReadChunks::kMaxNumberOfChunks);
+
+	uint8_t status = fs_readchunks(inode, firstIndex, count, chunkIds, &fileLength);
+	std::vector<ChunkWithLocations> chunks;
+	if (status == LIZARDFS_STATUS_OK) {
+		chunks.reserve(chunkIds.size());
+		for (uint64_t chunkId : chunkIds) {
+			ChunkWithLocations chunk(chunkId, 0, std::vector<ChunkTypeWithAddress>());
+			if (chunkId > 0) {
+				uint8_t chunkStatus = chunk_getversionandlocations(chunkId, eptr->peerip,
+						chunk.chunk_version, kMaxNumberOfChunkCopies, chunk.locations);
+				if (chunkStatus != LIZARDFS_STATUS_OK) {
+					// the client has to ask for this chunk separately
+					if (chunks.empty()) {
+						status = chunkStatus;
+					}
+					break;
+				}
+			}
+			chunks.push_back(std::move(chunk));
+		}
+	}
+
+	if (status != LIZARDFS_STATUS_OK) {
+		matoclserv_createpacket(eptr, matocl::fuseReadChunks::build(messageId, status));
+		return;
+	}
+
+	dcm_access(inode, eptr->sesdata->sessionid);
+	matoclserv_createpacket(eptr, matocl::fuseReadChunks::build(messageId, fileLength, chunks));
+
+	if (eptr->sesdata) {
+		eptr->sesdata->currentopstats[14]++;
+	}
+}
+
 void matoclserv_chunks_info(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
 	uint32_t message_id{0}, inode, chunk_index, chunk_count, uid, gid;
 	PacketVersion version;
@@ -2935,13 +3199,18 @@ void matoclserv_tape_info(matoclserventry *eptr, const uint8_t *data, uint32_t l
 	}
 }
 
-void matoclserv_fuse_write_chunk(matoclserventry *eptr, PacketHeader header, const uint8_t *data) {
+/*! \brief Handles FUSE_WRITE_CHUNK.
+ * If the chunk is locked by a different writer, the request waits for the lock until
+ * \p waitDeadline.
+ */
+static void matoclserv_fuse_write_chunk(matoclserventry *eptr, PacketHeader header,
+		const uint8_t *data, uint32_t waitDeadline) {
 	sassert(header.type == CLTOMA_FUSE_WRITE_CHUNK || header.type == LIZ_CLTOMA_FUSE_WRITE_CHUNK);
 	uint8_t status;
 	uint32_t inode;
 	uint32_t chunkIndex;
 	uint64_t fileLength;
-	uint64_t chunkId;
+	uint64_t chunkId = 0;
 	uint32_t lockId;
 	uint32_t messageId;
 	uint8_t opflag;
@@ -2960,6 +3229,12 @@ void matoclserv_fuse_write_chunk(matoclserventry *eptr, PacketHeader header, con
 	status = fs_writechunk(matoclserv_get_context(eptr), inode, chunkIndex, useDummyLockId,
 			&lockId, &chunkId, &opflag, &fileLength, min_server_version);
 
+	if (status == LIZARDFS_ERROR_LOCKED && chunkId != 0 && eventloop_time() < waitDeadline) {
+		// reply when the chunk is unlocked or when the wait time is over
+		gWritesWaitingForUnlock.emplace(chunkId, WaitingChunkWrite{eptr, header,
+				std::move(receivedData), waitDeadline});
+		return;
+	}
 	if (status != LIZARDFS_STATUS_OK) {
 		serializer->serializeFuseWriteChunk(outMessage, messageId, status);
 		matoclserv_createpacket(eptr, outMessage);
@@ -2993,6 +3268,45 @@ void matoclserv_fuse_write_chunk(matoclserventry *eptr, PacketHeader header, con
 	}
 }
 
+void matoclserv_fuse_write_chunk(matoclserventry *eptr, PacketHeader header, const uint8_t *data) {
+	matoclserv_fuse_write_chunk(eptr, header, data, eventloop_time() + kMaxChunkLockWait);
+}
+
+void matoclserv_chunk_unlocked(uint64_t chunkid) {
+	auto range = gWritesWaitingForUnlock.equal_range(chunkid);
+	if (range.first == range.second) {
+		return;
+	}
+	for (auto it = range.first; it != range.second; ++it) {
+		gWritesToRetry.push_back(std::move(it->second));
+	}
+	gWritesWaitingForUnlock.erase(range.first, range.second);
+	eventloop_make_next_poll_nonblocking();
+}
+
+/*! \brief Retries writes to chunks which got unlocked and those which waited too long. */
+static void matoclserv_retry_waiting_writes(uint32_t now) {
+	static uint32_t lastDeadlineCheck = 0;
+	if (lastDeadlineCheck != now) {
+		lastDeadlineCheck = now;
+		for (auto it = gWritesWaitingForUnlock.begin(); it != gWritesWaitingForUnlock.end();) {
+			if (it->second.deadline <= now) {
+				gWritesToRetry.push_back(std::move(it->second));
+				it = gWritesWaitingForUnlock.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+	std::vector<WaitingChunkWrite> writes;
+	std::swap(writes, gWritesToRetry);
+	for (WaitingChunkWrite &write : writes) {
+		if (write.eptr->mode != KILL) {
+			matoclserv_fuse_write_chunk(write.eptr, write.header, write.data.data(), write.deadline);
+		}
+	}
+}
+
 void matoclserv_fuse_write_chunk_end(matoclserventry *eptr,
 		PacketHeader header, const uint8_t *data) {
 	sassert(header.type == CLTOMA_FUSE_WRITE_CHUNK_END
@@ -4117,6 +4431,20 @@ void matoclserv_list_defective_files(matoclserventry *eptr, const uint8_t *data,
 	matoclserv_createpacket(eptr, matocl::listDefectiveFiles::build(entry_index, files_info));
 }
 
+void matoclserv_list_session_queues(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
+	cltoma::listSessionQueues::deserialize(data, length);
+	std::vector<SessionQueueInfo> sessions;
+	for (session *sesdata = sessionshead; sesdata; sesdata = sesdata->next) {
+		if (sesdata->nsocks == 0) {
+			continue;
+		}
+		sessions.emplace_back(sesdata->sessionid, sesdata->weight,
+				gRequestQueue.size(sesdata), sesdata->handledrequests,
+				sesdata->requestlatency, sesdata->maxrequestlatency);
+	}
+	matoclserv_createpacket(eptr, matocl::listSessionQueues::build(sessions));
+}
+
 void matoclserv_manage_locks_list(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
 	FsContext context = FsContext::getForMaster(eventloop_time());
 	uint32_t inode;
@@ -4226,9 +4554,15 @@ void matoclserv_manage_locks_unlock(matoclserventry *eptr, const uint8_t *data,
 	matoclserv_createpacket(eptr, std::move(reply));
 }
 
-void matoclserv_list_tasks(matoclserventry *eptr) {
-	std::vector<JobInfo> jobs_info = fs_get_current_tasks_info();
-	matoclserv_createpacket(eptr, matocl::listTasks::build(jobs_info));
+void matoclserv_list_tasks(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
+	PacketVersion version;
+	deserializePacketVersionNoHeader(data, length, version);
+	if (version == cltoma::listTasks::kWithProgress) {
+		matoclserv_createpacket(eptr,
+				matocl::listTasks::build(fs_get_current_tasks_progress_info()));
+	} else {
+		matoclserv_createpacket(eptr, matocl::listTasks::build(fs_get_current_tasks_info()));
+	}
 }
 
 void matoclserv_stop_task(matoclserventry *eptr, const uint8_t *data, uint32_t length) {
@@ -4583,17 +4917,14 @@ void matocl_locks_release(const FsContext &context, uint32_t inode, uint32_t ses
 }
 
 void matocl_session_timedout(session *sesdata) {
-	filelist *fl,*afl;
-	fl=sesdata->openedfiles;
+	gCacheInvalidationTracker.removeSession(sesdata->sessionid);
+	std::unordered_set<uint32_t> openedfiles;
+	std::swap(openedfiles, sesdata->openedfiles);
 	FsContext context = FsContext::getForMaster(eventloop_time());
-	while (fl) {
-		afl = fl;
-		fl=fl->next;
-		fs_release(context, afl->inode, sesdata->sessionid);
-		matocl_locks_release(context, afl->inode, sesdata->sessionid);
-		free(afl);
-	}
-	sesdata->openedfiles=NULL;
+	for (uint32_t inode : openedfiles) {
+		fs_release(context, inode, sesdata->sessionid);
+		matocl_locks_release(context, inode, sesdata->sessionid);
+	}
 	if (sesdata->info) {
 		free(sesdata->info);
 	}
@@ -4611,6 +4942,7 @@ void matocl_session_check(void) {
 //                      syslog(LOG_NOTICE,"remove session: %u",asesdata->sessionid);
 			matocl_session_timedout(asesdata);
 			*sesdata = asesdata->next;
+			matoclserv_session_unindex(asesdata);
 			delete asesdata;
 		} else {
 			sesdata = &(asesdata->next);
@@ -4623,6 +4955,7 @@ void matocl_session_statsmove(void) {
 	for (sesdata = sessionshead ; sesdata ; sesdata=sesdata->next) {
 		sesdata->lasthouropstats = sesdata->currentopstats;
 		sesdata->currentopstats.fill(0);
+		sesdata->maxrequestlatency = 0;
 	}
 	matoclserv_store_sessions();
 }
@@ -4640,7 +4973,20 @@ void matocl_beforedisconnect(matoclserventry *eptr) {
 		free(acl);
 	}
 	eptr->chunkdelayedops=NULL;
+	for (auto it = gWritesWaitingForUnlock.begin(); it != gWritesWaitingForUnlock.end();) {
+		if (it->second.eptr == eptr) {
+			it = gWritesWaitingForUnlock.erase(it);
+		} else {
+			++it;
+		}
+	}
+	gWritesToRetry.erase(std::remove_if(gWritesToRetry.begin(), gWritesToRetry.end(),
+			[eptr](const WaitingChunkWrite &write) { return write.eptr == eptr; }),
+			gWritesToRetry.end());
 	if (eptr->sesdata) {
+		gRequestQueue.remove_if(eptr->sesdata, [eptr](const QueuedRequest &request) {
+			return request.eptr == eptr;
+		});
 		if (eptr->sesdata->nsocks>0) {
 			eptr->sesdata->nsocks--;
 		}
@@ -4779,6 +5125,9 @@ void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *dat
 				case LIZ_CLTOMA_LIST_DEFECTIVE_FILES:
 					matoclserv_list_defective_files(eptr, data, length);
 					break;
+				case LIZ_CLTOMA_LIST_SESSION_QUEUES:
+					matoclserv_list_session_queues(eptr, data, length);
+					break;
 				case LIZ_CLTOMA_MANAGE_LOCKS_LIST:
 					matoclserv_manage_locks_list(eptr,data,length);
 					break;
@@ -4786,7 +5135,7 @@ void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *dat
 					matoclserv_manage_locks_unlock(eptr,data,length);
 					break;
 				case LIZ_CLTOMA_LIST_TASKS:
-					matoclserv_list_tasks(eptr);
+					matoclserv_list_tasks(eptr, data, length);
 					break;
 				case LIZ_CLTOMA_STOP_TASK:
 					matoclserv_stop_task(eptr, data, length);
@@ -4858,10 +5207,19 @@ void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *dat
 				case CLTOMA_FUSE_OPEN:
 					matoclserv_fuse_open(eptr,data,length);
 					break;
+				case LIZ_CLTOMA_FUSE_COMPOUND:
+					matoclserv_fuse_compound(eptr, data, length);
+					break;
+				case LIZ_CLTOMA_CACHE_INVALIDATION_SUBSCRIBE:
+					matoclserv_cache_invalidation_subscribe(eptr, data, length);
+					break;
 				case LIZ_CLTOMA_FUSE_READ_CHUNK:
 				case CLTOMA_FUSE_READ_CHUNK:
 					matoclserv_fuse_read_chunk(eptr, PacketHeader(type, length), data);
 					break;
+				case LIZ_CLTOMA_FUSE_READ_CHUNKS:
+					matoclserv_fuse_read_chunks(eptr, data, length);
+					break;
 				case LIZ_CLTOMA_CHUNKS_INFO:
 					matoclserv_chunks_info(eptr, data, length);
 					break;
@@ -5108,26 +5466,69 @@ void matoclserv_gotpacket(matoclserventry *eptr,uint32_t type,const uint8_t *dat
 	}
 }
 
+/*! \brief Passes a packet to matoclserv_gotpacket or queues it for the fair scheduler.
+ * \return true if the packet was queued
+ */
+static bool matoclserv_handle_packet(matoclserventry *eptr, uint32_t type, const uint8_t *data,
+		uint32_t length) {
+	if (eptr->registered != ClientState::kRegistered || eptr->sesdata == NULL
+			|| type == ANTOAN_NOP) {
+		matoclserv_gotpacket(eptr, type, data, length);
+		return false;
+	}
+	QueuedRequest request{eptr, type, MessageBuffer(data, data + length), SteadyClock::now()};
+	gRequestQueue.push(eptr->sesdata, eptr->sesdata->weight, std::move(request));
+	return true;
+}
+
+/*! \brief Serves queued requests, interleaving sessions according to their weights. */
+static void matoclserv_handle_queued_requests() {
+	ActiveLoopWatchdog watchdog(std::chrono::milliseconds(10));
+	watchdog.start();
+	while (!gRequestQueue.empty()) {
+		QueuedRequest request = gRequestQueue.pop();
+		matoclserventry *eptr = request.eptr;
+		if (eptr->mode == KILL) {
+			continue;
+		}
+		session *sesdata = eptr->sesdata;
+		matoclserv_gotpacket(eptr, request.type,
+				request.data.empty() ? NULL : request.data.data(), request.data.size());
+		uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+				SteadyClock::now() - request.received).count();
+		latency = std::min<uint64_t>(latency, std::numeric_limits<uint32_t>::max());
+		if (sesdata->handledrequests == 0) {
+			sesdata->requestlatency = latency;
+		} else {
+			sesdata->requestlatency = (uint64_t(sesdata->requestlatency) * 15 + latency) / 16;
+		}
+		sesdata->maxrequestlatency = std::max<uint32_t>(sesdata->maxrequestlatency, latency);
+		sesdata->handledrequests++;
+		if (watchdog.expired()) {
+			break;
+		}
+	}
+	if (!gRequestQueue.empty()) {
+		eventloop_make_next_poll_nonblocking();
+	}
+}
+
 void matoclserv_term(void) {
 	matoclserventry *eptr,*eptrn;
-	packetstruct *pptr,*pptrn;
 	chunklist *cl,*cln;
 
 	lzfs_pretty_syslog(LOG_NOTICE,"main master server module: closing %s:%s",ListenHost,ListenPort);
 	tcpclose(lsock);
+	gNetworkWorkers.reset();
+	gRequestQueue.clear();
+	gWritesWaitingForUnlock.clear();
+	gWritesToRetry.clear();
 
 	for (eptr = matoclservhead ; eptr ; eptr = eptrn) {
 		eptrn = eptr->next;
 		if (eptr->inputpacket.packet) {
 			free(eptr->inputpacket.packet);
 		}
-		for (pptr = eptr->outputhead ; pptr ; pptr = pptrn) {
-			pptrn = pptr->next;
-			if (pptr->packet) {
-				free(pptr->packet);
-			}
-			free(pptr);
-		}
 		for (cl = eptr->chunkdelayedops ; cl ; cl = cln) {
 			cln = cl->next;
 			free(cl);
@@ -5204,14 +5605,17 @@ void matoclserv_read(matoclserventry *eptr) {
 			eptr->mode=HEADER;
 			eptr->inputpacket.bytesleft = 8;
 			eptr->inputpacket.startptr = eptr->hdrbuff;
-			matoclserv_gotpacket(eptr,type,eptr->inputpacket.packet,size);
+			bool queued = matoclserv_handle_packet(eptr,type,eptr->inputpacket.packet,size);
 			stats_prcvd++;
 
 			if (eptr->inputpacket.packet) {
 				free(eptr->inputpacket.packet);
 			}
 			eptr->inputpacket.packet=NULL;
-			break;
+			// queued requests are served later, so more of them can be read now
+			if (!queued || gRequestQueue.size(eptr->sesdata) >= kMaxQueuedRequestsPerSession) {
+				break;
+			}
 		}
 
 		if (watchdog.expired()) {
@@ -5222,16 +5626,11 @@ void matoclserv_read(matoclserventry *eptr) {
 
 void matoclserv_write(matoclserventry *eptr) {
 	SignalLoopWatchdog watchdog;
-	packetstruct *pack;
-	int32_t i;
+	ssize_t i;
 
 	watchdog.start();
-	for (;;) {
-		pack = eptr->outputhead;
-		if (pack==NULL) {
-			return;
-		}
-		i=write(eptr->sock,pack->startptr,pack->bytesleft);
+	while (!eptr->outputBuffer.empty()) {
+		i = eptr->outputBuffer.writeTo(eptr->sock);
 		if (i<0) {
 			if (errno!=EAGAIN) {
 				lzfs_silent_errlog(LOG_NOTICE,"main master server module: (ip:%u.%u.%u.%u) write error",(eptr->peerip>>24)&0xFF,(eptr->peerip>>16)&0xFF,(eptr->peerip>>8)&0xFF,eptr->peerip&0xFF);
@@ -5239,19 +5638,8 @@ void matoclserv_write(matoclserventry *eptr) {
 			}
 			return;
 		}
-		pack->startptr+=i;
-		pack->bytesleft-=i;
 		stats_bsent+=i;
-		if (pack->bytesleft>0) {
-			return;
-		}
-		free(pack->packet);
-		stats_psent++;
-		eptr->outputhead = pack->next;
-		if (eptr->outputhead==NULL) {
-			eptr->outputtail = &(eptr->outputhead);
-		}
-		free(pack);
+		stats_psent+=eptr->outputBuffer.takeSentPackets();
 
 		if (watchdog.expired()) {
 			break;
@@ -5267,7 +5655,10 @@ int matoclserv_canexit(void) {
 	matoclserventry *adminTerminator = NULL;
 	static bool terminatorPacketSent = false;
 	for (matoclserventry* eptr = matoclservhead; eptr != nullptr; eptr = eptr->next) {
-		if (eptr->outputhead!=NULL) {
+		if (!eptr->outputBuffer.empty()) {
+			return 0;
+		}
+		if (eptr->connection && gNetworkWorkers->hasPendingOutput(eptr->connection)) {
 			return 0;
 		}
 		if (eptr->chunkdelayedops!=NULL) {
@@ -5307,23 +5698,60 @@ void matoclserv_desc(std::vector<pollfd> &pdesc) {
 	} else {
 		lsockpdescpos = -1;
 	}
+	if (gNetworkWorkers) {
+		pdesc.push_back({gNetworkWorkers->notifyFd(),POLLIN,0});
+	}
 	for (eptr=matoclservhead ; eptr ; eptr=eptr->next) {
+		if (eptr->connection) {
+			// replies produced since the last loop are handed over to the I/O thread
+			eptr->pdescpos = -1;
+			if (!eptr->outputBuffer.empty() && eptr->mode!=KILL) {
+				eptr->lastwrite = eventloop_time();
+				gNetworkWorkers->send(eptr->connection, eptr->outputBuffer);
+			}
+			continue;
+		}
 		pdesc.push_back({eptr->sock,0,0});
 		eptr->pdescpos = pdesc.size() - 1;
-		if (exiting==0) {
+		if (exiting==0 && (eptr->sesdata == NULL
+				|| gRequestQueue.size(eptr->sesdata) < kMaxQueuedRequestsPerSession)) {
 			pdesc.back().events |= POLLIN;
 		}
-		if (eptr->outputhead!=NULL) {
+		if (!eptr->outputBuffer.empty()) {
 			pdesc.back().events |= POLLOUT;
 		}
 	}
 }
 
 
+static void matoclserv_serve_network_workers(uint32_t now) {
+	ActiveLoopWatchdog watchdog(std::chrono::milliseconds(10));
+	watchdog.start();
+	bool done = gNetworkWorkers->handleEvents([now](void *owner, NetworkWorkerPool::Event &event) {
+		matoclserventry *eptr = static_cast<matoclserventry*>(owner);
+		if (eptr->mode == KILL) {
+			return;
+		}
+		if (event.closed) {
+			if (eptr->registered == ClientState::kRegistered) {
+				lzfs_pretty_syslog(LOG_NOTICE,"connection with client(ip:%u.%u.%u.%u) has been closed",(eptr->peerip>>24)&0xFF,(eptr->peerip>>16)&0xFF,(eptr->peerip>>8)&0xFF,eptr->peerip&0xFF);
+			}
+			eptr->mode = KILL;
+			return;
+		}
+		eptr->lastread = now;
+		stats_prcvd++;
+		matoclserv_handle_packet(eptr, event.header.type,
+				event.data.empty() ? NULL : event.data.data(), event.header.length);
+	}, watchdog);
+	if (!done) {
+		eventloop_make_next_poll_nonblocking();
+	}
+}
+
 void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 	uint32_t now=eventloop_time();
 	matoclserventry *eptr,**kptr;
-	packetstruct *pptr,*paptr;
 	int ns;
 
 	if (lsockpdescpos>=0 && (pdesc[lsockpdescpos].revents & POLLIN)) {
@@ -5337,10 +5765,14 @@ void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 			eptr->next = matoclservhead;
 			matoclservhead = eptr;
 			eptr->sock = ns;
+			if (gNetworkWorkers) {
+				eptr->connection = gNetworkWorkers->add(ns, eptr);
+			}
 			eptr->pdescpos = -1;
 			tcpgetpeer(ns,&(eptr->peerip),NULL);
 			eptr->registered = ClientState::kUnregistered;
 			eptr->iolimits = false;
+			eptr->cacheInvalidation = false;
 			eptr->version = 0;
 			eptr->mode = HEADER;
 			eptr->lastread = now;
@@ -5350,8 +5782,6 @@ void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 			eptr->inputpacket.startptr = eptr->hdrbuff;
 			eptr->inputpacket.packet = NULL;
 			eptr->adminTask = AdminTask::kNone;
-			eptr->outputhead = NULL;
-			eptr->outputtail = &(eptr->outputhead);
 
 			eptr->chunkdelayedops = NULL;
 			eptr->sesdata = NULL;
@@ -5360,6 +5790,9 @@ void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 	}
 
 // read
+	if (gNetworkWorkers) {
+		matoclserv_serve_network_workers(now);
+	}
 	for (eptr=matoclservhead ; eptr ; eptr=eptr->next) {
 		if (eptr->pdescpos>=0) {
 			if (pdesc[eptr->pdescpos].revents & (POLLERR|POLLHUP)) {
@@ -5371,16 +5804,18 @@ void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 			}
 		}
 	}
+	matoclserv_retry_waiting_writes(now);
+	matoclserv_handle_queued_requests();
 
 // write
 	for (eptr=matoclservhead ; eptr ; eptr=eptr->next) {
 		if (eptr->lastwrite+2<now && eptr->registered != ClientState::kOldTools
-				&& eptr->outputhead==NULL) {
+				&& eptr->outputBuffer.empty()) {
 			uint8_t *ptr = matoclserv_createpacket(eptr,ANTOAN_NOP,4);      // 4 byte length because of 'msgid'
 			*((uint32_t*)ptr) = 0;
 		}
 		if (eptr->pdescpos>=0) {
-			if ((((pdesc[eptr->pdescpos].events & POLLOUT)==0 && (eptr->outputhead)) || (pdesc[eptr->pdescpos].revents & POLLOUT)) && eptr->mode!=KILL) {
+			if ((((pdesc[eptr->pdescpos].events & POLLOUT)==0 && !eptr->outputBuffer.empty()) || (pdesc[eptr->pdescpos].revents & POLLOUT)) && eptr->mode!=KILL) {
 				eptr->lastwrite = now;
 				matoclserv_write(eptr);
 			}
@@ -5395,19 +5830,14 @@ void matoclserv_serve(const std::vector<pollfd> &pdesc) {
 	while ((eptr=*kptr)) {
 		if (eptr->mode == KILL) {
 			matocl_beforedisconnect(eptr);
-			tcpclose(eptr->sock);
+			if (eptr->connection) {
+				gNetworkWorkers->remove(eptr->connection);
+			} else {
+				tcpclose(eptr->sock);
+			}
 			if (eptr->inputpacket.packet) {
 				free(eptr->inputpacket.packet);
 			}
-			pptr = eptr->outputhead;
-			while (pptr) {
-				if (pptr->packet) {
-					free(pptr->packet);
-				}
-				paptr = pptr;
-				pptr = pptr->next;
-				free(paptr);
-			}
 			*kptr = eptr->next;
 			delete eptr;
 		} else {
@@ -5430,6 +5860,7 @@ void matoclserv_start_cond_check(void) {
 
 int matoclserv_sessionsinit(void) {
 	sessionshead = NULL;
+	gSessionsById.clear();
 
 	switch (matoclserv_load_sessions()) {
 		case 0: // no file
@@ -5525,6 +5956,7 @@ void matoclserv_reload(void) {
 	}
 
 	matoclserv_iolimits_reload();
+	matoclserv_cache_invalidation_reload(false);
 
 	char *oldListenHost = ListenHost;
 	char *oldListenPort = ListenPort;
@@ -5588,6 +6020,15 @@ int matoclserv_networkinit(void) {
 	if (matoclserv_iolimits_reload() != 0) {
 		return -1;
 	}
+	matoclserv_cache_invalidation_reload(true);
+
+	uint32_t ioThreads = cfg_get_maxvalue<uint32_t>("MATOCL_IO_THREADS", 0, 64);
+	if (ioThreads > 0) {
+		gNetworkWorkers.reset(new NetworkWorkerPool("main master server module", ioThreads,
+				MaxPacketSize));
+		lzfs_pretty_syslog(LOG_NOTICE,"main master server module: using %" PRIu32 " network I/O threads",
+				ioThreads);
+	}
 
 	exiting = 0;
 	lsock = tcpsocket();
@@ -5616,6 +6057,7 @@ int matoclserv_networkinit(void) {
 	metadataserver::registerFunctionCalledOnPromotion(matoclserv_become_master);
 	eventloop_destructregister(matoclserv_term);
 	eventloop_pollregister(matoclserv_desc,matoclserv_serve);
+	eventloop_eachloopregister(matoclserv_cache_invalidation_flush);
 	eventloop_wantexitregister(matoclserv_wantexit);
 	eventloop_canexitregister(matoclserv_canexit);
 	return 0;
@@ -5624,14 +6066,12 @@ int matoclserv_networkinit(void) {
 void matoclserv_session_unload(void) {
 	for (session* ss = sessionshead, *ssn = NULL; ss ; ss = ssn) {
 		ssn = ss->next;
-		for (filelist* of = ss->openedfiles, *ofn = NULL; of; of = ofn) {
-			ofn = of->next;
-			free(of);
-		}
 		if (ss->info) {
 			free(ss->info);
 		}
 		delete ss;
 	}
 	sessionshead = nullptr;
+	gSessionsById.clear();
+	gRequestQueue.clear();
 }
@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <string>
 
 void matoclserv_stats(uint64_t stats[5]);
 /*
@@ -31,6 +32,16 @@ void matoclserv_notify_remove(uint32_t dirinode);
 void matoclserv_notify_parent(uint32_t dirinode,uint32_t parent);
 */
 void matoclserv_chunk_status(uint64_t chunkid,uint8_t status);
+
+/// Wake up writers waiting for the lock of \p chunkid (it was released or has expired).
+void matoclserv_chunk_unlocked(uint64_t chunkid);
+
+/// Tell clients caching attributes of \p inode that they changed.
+void matoclserv_notify_node_changed(uint32_t inode);
+
+/// Tell clients caching contents of directory \p parent that entry \p name was added or removed.
+void matoclserv_notify_entry_changed(uint32_t parent, const std::string &name);
+
 void matoclserv_add_open_file(uint32_t sessionid,uint32_t inode);
 void matoclserv_remove_open_file(uint32_t sessionid,uint32_t inode);
 int matoclserv_sessionsinit(void);
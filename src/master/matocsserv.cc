@@ -45,7 +45,7 @@
 #include "common/loop_watchdog.h"
 #include "common/massert.h"
 #include "common/mfserr.h"
-#include "common/output_packet.h"
+#include "common/output_buffer_chain.h"
 #include "common/random.h"
 #include "common/slice_traits.h"
 #include "common/slogger.h"
@@ -55,6 +55,7 @@
 #include "master/chunkserver_db.h"
 #include "master/filesystem.h"
 #include "master/get_servers_for_new_chunk.h"
+#include "master/network_worker_pool.h"
 #include "master/personality.h"
 #include "protocol/cstoma.h"
 #include "protocol/input_packet.h"
@@ -77,7 +78,8 @@ struct matocsserventry {
 	int32_t pdescpos;
 	Timer lastread,lastwrite;
 	InputPacket inputPacket;
-	std::list<OutputPacket> outputPackets;
+	OutputBufferChain outputBuffer;
+	NetworkWorkerPool::ConnectionPtr connection;  // set if served by gNetworkWorkers
 	char *servstrip;                // human readable version of servip
 	uint32_t version;
 	uint32_t servip;                // ip to connect to
@@ -115,6 +117,9 @@ static matocsserventry *matocsservhead=NULL;
 static int lsock;
 static int32_t lsockpdescpos;
 
+// network I/O threads (if MATOCS_IO_THREADS > 0)
+static std::unique_ptr<NetworkWorkerPool> gNetworkWorkers;
+
 // from config
 static char *ListenHost;
 static char *ListenPort;
@@ -589,8 +594,7 @@ char* matocsserv_makestrip(uint32_t ip) {
 }
 
 uint8_t* matocsserv_createpacket(matocsserventry *eptr,uint32_t type,uint32_t size) {
-	eptr->outputPackets.emplace_back(PacketHeader(type, size));
-	return eptr->outputPackets.back().packet.data() + PacketHeader::kSize;
+	return eptr->outputBuffer.allocatePacket(type, size);
 }
 
 /* for future use */
@@ -620,20 +624,21 @@ void matocsserv_got_chunk_checksum(matocsserventry *eptr,const uint8_t *data,uin
 int matocsserv_send_createchunk(matocsserventry *eptr, uint64_t chunkId, ChunkPartType chunkType,
 		uint32_t chunkVersion) {
 	if (eptr->mode != KILL) {
-		eptr->outputPackets.push_back(OutputPacket());
+		MessageBuffer buffer;
 		if (eptr->version < kFirstXorVersion) {
 			// send old packet when chunkserver doesn't support xor chunks
 			sassert(slice_traits::isStandard(chunkType));
-			serializeMooseFsPacket(eptr->outputPackets.back().packet, MATOCS_CREATE, chunkId,
+			serializeMooseFsPacket(buffer, MATOCS_CREATE, chunkId,
 					chunkVersion);
 		} else if (eptr->version < kFirstECVersion) {
 			sassert((int)chunkType.getSliceType() < Goal::Slice::Type::kECFirst);
-			matocs::createChunk::serialize(eptr->outputPackets.back().packet, chunkId, (legacy::ChunkPartType)chunkType,
+			matocs::createChunk::serialize(buffer, chunkId, (legacy::ChunkPartType)chunkType,
 					chunkVersion);
 		} else {
-			matocs::createChunk::serialize(eptr->outputPackets.back().packet, chunkId, chunkType,
+			matocs::createChunk::serialize(buffer, chunkId, chunkType,
 					chunkVersion);
 		}
+		eptr->outputBuffer.append(std::move(buffer));
 	}
 	return 0;
 }
@@ -667,21 +672,22 @@ void matocsserv_got_createchunk_status(matocsserventry *eptr, const std::vector<
 int matocsserv_send_deletechunk(matocsserventry *eptr, uint64_t chunkId, uint32_t chunkVersion,
 		ChunkPartType chunkType) {
 	if (eptr->mode != KILL) {
-		eptr->outputPackets.push_back(OutputPacket());
+		MessageBuffer buffer;
 		if (eptr->version < kFirstXorVersion) {
 			// send old packet when chunkserver doesn't support xor chunks
 			sassert(chunkType == slice_traits::standard::ChunkPartType());
-			serializeMooseFsPacket(eptr->outputPackets.back().packet, MATOCS_DELETE,
+			serializeMooseFsPacket(buffer, MATOCS_DELETE,
 					chunkId, chunkVersion);
 		}
 		else if (eptr->version < kFirstECVersion) {
 			sassert((int)chunkType.getSliceType() < Goal::Slice::Type::kECFirst);
-			matocs::deleteChunk::serialize(eptr->outputPackets.back().packet,
+			matocs::deleteChunk::serialize(buffer,
 					chunkId, (legacy::ChunkPartType)chunkType, chunkVersion);
 		} else {
-			matocs::deleteChunk::serialize(eptr->outputPackets.back().packet,
+			matocs::deleteChunk::serialize(buffer,
 					chunkId, chunkType, chunkVersion);
 		}
+		eptr->outputBuffer.append(std::move(buffer));
 		eptr->delcounter++;
 	}
 	return 0;
@@ -760,9 +766,10 @@ int matocsserv_send_liz_replicatechunk(matocsserventry *eptr, uint64_t chunkid,
 			sources.push_back(legacy::ChunkTypeWithAddress(
 			    NetworkAddress(src->servip, src->servport), (legacy::ChunkPartType)sourceTypes[i]));
 		}
-		eptr->outputPackets.push_back(OutputPacket());
-		matocs::replicateChunk::serialize(eptr->outputPackets.back().packet, chunkid, version,
+		MessageBuffer buffer;
+		matocs::replicateChunk::serialize(buffer, chunkid, version,
 		                                  (legacy::ChunkPartType)type, sources);
+		eptr->outputBuffer.append(std::move(buffer));
 	} else {
 		std::vector<ChunkTypeWithAddress> sources;
 		for (size_t i = 0; i < sourcePointers.size(); ++i) {
@@ -772,9 +779,10 @@ int matocsserv_send_liz_replicatechunk(matocsserventry *eptr, uint64_t chunkid,
 				sourceTypes[i],
 				src->version));
 		}
-		eptr->outputPackets.push_back(OutputPacket());
-		matocs::replicateChunk::serialize(eptr->outputPackets.back().packet, chunkid, version, type,
+		MessageBuffer buffer;
+		matocs::replicateChunk::serialize(buffer, chunkid, version, type,
 		                                  sources);
+		eptr->outputBuffer.append(std::move(buffer));
 	}
 	matocsserv_replication_begin(chunkid, version, type,
 			eptr, sourcePointers.size(), sourcePointers.data());
@@ -814,20 +822,21 @@ void matocsserv_got_replicatechunk_status(matocsserventry *eptr, const std::vect
 int matocsserv_send_setchunkversion(matocsserventry *eptr, uint64_t chunkId, uint32_t newVersion,
 		uint32_t chunkVersion, ChunkPartType chunkType) {
 	if (eptr->mode != KILL) {
-		eptr->outputPackets.push_back(OutputPacket());
+		MessageBuffer buffer;
 		if (eptr->version < kFirstXorVersion) {
 			// send old packet when chunkserver doesn't support xor chunks
 			sassert(chunkType == slice_traits::standard::ChunkPartType());
-			serializeMooseFsPacket(eptr->outputPackets.back().packet, MATOCS_SET_VERSION,
+			serializeMooseFsPacket(buffer, MATOCS_SET_VERSION,
 					chunkId, newVersion, chunkVersion);
 		} else if (eptr->version < kFirstECVersion) {
 			sassert((int)chunkType.getSliceType() < Goal::Slice::Type::kECFirst);
-			matocs::setVersion::serialize(eptr->outputPackets.back().packet, chunkId, (legacy::ChunkPartType)chunkType,
+			matocs::setVersion::serialize(buffer, chunkId, (legacy::ChunkPartType)chunkType,
 					chunkVersion, newVersion);
 		} else {
-			matocs::setVersion::serialize(eptr->outputPackets.back().packet, chunkId, chunkType,
+			matocs::setVersion::serialize(buffer, chunkId, chunkType,
 					chunkVersion, newVersion);
 		}
+		eptr->outputBuffer.append(std::move(buffer));
 	}
 	return 0;
 }
@@ -865,21 +874,21 @@ int matocsserv_send_duplicatechunk(matocsserventry* eptr, uint64_t newChunkId, u
 		return 0;
 	}
 
-	OutputPacket outPacket;
+	MessageBuffer buffer;
 	if (eptr->version < kFirstXorVersion) {
 		sassert(slice_traits::isStandard(chunkType));
 		// Legacy support
-		serializeMooseFsPacket(outPacket.packet, MATOCS_DUPLICATE, newChunkId, newChunkVersion,
+		serializeMooseFsPacket(buffer, MATOCS_DUPLICATE, newChunkId, newChunkVersion,
 				chunkId, chunkVersion);
 	} else if (eptr->version < kFirstECVersion) {
 		sassert((int)chunkType.getSliceType() < Goal::Slice::Type::kECFirst);
-		matocs::duplicateChunk::serialize(outPacket.packet, newChunkId, newChunkVersion,
+		matocs::duplicateChunk::serialize(buffer, newChunkId, newChunkVersion,
 				(legacy::ChunkPartType)chunkType, chunkId, chunkVersion);
 	} else {
-		matocs::duplicateChunk::serialize(outPacket.packet, newChunkId, newChunkVersion,
+		matocs::duplicateChunk::serialize(buffer, newChunkId, newChunkVersion,
 				chunkType, chunkId, chunkVersion);
 	}
-	eptr->outputPackets.push_back(std::move(outPacket));
+	eptr->outputBuffer.append(std::move(buffer));
 	return 0;
 }
 
@@ -926,13 +935,15 @@ void matocsserv_send_truncatechunk(matocsserventry* eptr, uint64_t chunkid, Chun
 		put32bit(&data,oldVersion);
 	} else if (eptr->version < kFirstECVersion) {
 		sassert((int)chunkType.getSliceType() < (int)kFirstECVersion);
-		eptr->outputPackets.push_back(OutputPacket());
-		matocs::truncateChunk::serialize(eptr->outputPackets.back().packet,
+		MessageBuffer buffer;
+		matocs::truncateChunk::serialize(buffer,
 				chunkid, (legacy::ChunkPartType)chunkType, length, newVersion, oldVersion);
+		eptr->outputBuffer.append(std::move(buffer));
 	} else {
-		eptr->outputPackets.push_back(OutputPacket());
-		matocs::truncateChunk::serialize(eptr->outputPackets.back().packet,
+		MessageBuffer buffer;
+		matocs::truncateChunk::serialize(buffer,
 				chunkid, chunkType, length, newVersion, oldVersion);
+		eptr->outputBuffer.append(std::move(buffer));
 	}
 }
 
@@ -985,21 +996,21 @@ int matocsserv_send_duptruncchunk(matocsserventry* eptr, uint64_t newChunkId, ui
 		return 0;
 	}
 
-	OutputPacket outPacket;
+	MessageBuffer buffer;
 	if (eptr->version < kFirstXorVersion) {
 		sassert(slice_traits::isStandard(chunkType));
 		// Legacy support
-		serializeMooseFsPacket(outPacket.packet, MATOCS_DUPTRUNC, newChunkId, newChunkVersion,
+		serializeMooseFsPacket(buffer, MATOCS_DUPTRUNC, newChunkId, newChunkVersion,
 				chunkId, chunkVersion, newChunkLength);
 	} else if (eptr->version < kFirstECVersion) {
 		sassert((int)chunkType.getSliceType() < Goal::Slice::Type::kECFirst);
-		matocs::duptruncChunk::serialize(outPacket.packet, newChunkId,
+		matocs::duptruncChunk::serialize(buffer, newChunkId,
 				newChunkVersion, (legacy::ChunkPartType)chunkType, chunkId, chunkVersion, newChunkLength);
 	} else {
-		matocs::duptruncChunk::serialize(outPacket.packet, newChunkId,
+		matocs::duptruncChunk::serialize(buffer, newChunkId,
 				newChunkVersion, chunkType, chunkId, chunkVersion, newChunkLength);
 	}
-	eptr->outputPackets.push_back(std::move(outPacket));
+	eptr->outputBuffer.append(std::move(buffer));
 	return 0;
 }
 
@@ -1574,6 +1585,7 @@ void matocsserv_term(void) {
 	matocsserventry *eptr,*eaptr;
 	lzfs_pretty_syslog(LOG_INFO,"master <-> chunkservers module: closing %s:%s",ListenHost,ListenPort);
 	tcpclose(lsock);
+	gNetworkWorkers.reset();
 
 	eptr = matocsservhead;
 	while (eptr) {
@@ -1637,10 +1649,8 @@ void matocsserv_write(matocsserventry *eptr) {
 	SignalLoopWatchdog watchdog;
 
 	watchdog.start();
-	while (!eptr->outputPackets.empty()) {
-		OutputPacket& pack = eptr->outputPackets.front();
-		ssize_t i = write(eptr->sock, pack.packet.data() + pack.bytesSent,
-				pack.packet.size() - pack.bytesSent);
+	while (!eptr->outputBuffer.empty()) {
+		ssize_t i = eptr->outputBuffer.writeTo(eptr->sock);
 		if (i<0) {
 			if (errno!=EAGAIN) {
 				lzfs_silent_errlog(LOG_NOTICE,"write to CS(%s) error",eptr->servstrip);
@@ -1648,11 +1658,6 @@ void matocsserv_write(matocsserventry *eptr) {
 			}
 			return;
 		}
-		pack.bytesSent += i;
-		if (pack.packet.size() != pack.bytesSent) {
-			return;
-		}
-		eptr->outputPackets.pop_front();
 
 		if (watchdog.expired()) {
 			break;
@@ -1664,15 +1669,49 @@ void matocsserv_desc(std::vector<pollfd> &pdesc) {
 	matocsserventry *eptr;
 	pdesc.push_back({lsock,POLLIN,0});
 	lsockpdescpos = pdesc.size()-1;
+	if (gNetworkWorkers) {
+		pdesc.push_back({gNetworkWorkers->notifyFd(),POLLIN,0});
+	}
 	for (eptr=matocsservhead ; eptr ; eptr=eptr->next) {
+		if (eptr->connection) {
+			// replies produced since the last loop are handed over to the I/O thread
+			eptr->pdescpos = -1;
+			if (!eptr->outputBuffer.empty() && eptr->mode!=KILL) {
+				eptr->lastwrite.reset();
+				gNetworkWorkers->send(eptr->connection, eptr->outputBuffer);
+			}
+			continue;
+		}
 		pdesc.push_back({eptr->sock,POLLIN,0});
 		eptr->pdescpos = pdesc.size() - 1;
-		if (!eptr->outputPackets.empty()) {
+		if (!eptr->outputBuffer.empty()) {
 			pdesc.back().events |= POLLOUT;
 		}
 	}
 }
 
+static void matocsserv_serve_network_workers() {
+	ActiveLoopWatchdog watchdog(std::chrono::milliseconds(10));
+	watchdog.start();
+	bool done = gNetworkWorkers->handleEvents([](void *owner, NetworkWorkerPool::Event &event) {
+		matocsserventry *eptr = static_cast<matocsserventry*>(owner);
+		if (eptr->mode == KILL) {
+			return;
+		}
+		if (event.closed) {
+			lzfs_pretty_syslog(LOG_NOTICE, "connection with CS(%s) has been closed",
+					eptr->servstrip);
+			eptr->mode = KILL;
+			return;
+		}
+		eptr->lastread.reset();
+		matocsserv_gotpacket(eptr, event.header, event.data);
+	}, watchdog);
+	if (!done) {
+		eventloop_make_next_poll_nonblocking();
+	}
+}
+
 void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 	uint32_t peerip;
 	matocsserventry *eptr,**kptr;
@@ -1690,6 +1729,9 @@ void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 			eptr->next = matocsservhead;
 			matocsservhead = eptr;
 			eptr->sock = ns;
+			if (gNetworkWorkers) {
+				eptr->connection = gNetworkWorkers->add(ns, eptr);
+			}
 			eptr->pdescpos = -1;
 			eptr->mode = CONNECTED;
 			eptr->lastread.reset();
@@ -1719,6 +1761,9 @@ void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 			tcpclose(ns);
 		}
 	}
+	if (gNetworkWorkers) {
+		matocsserv_serve_network_workers();
+	}
 	for (eptr=matocsservhead ; eptr ; eptr=eptr->next) {
 		if (eptr->pdescpos>=0) {
 			if (pdesc[eptr->pdescpos].revents & (POLLERR|POLLHUP)) {
@@ -1736,7 +1781,7 @@ void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 		if (eptr->lastread.elapsed_ms() > eptr->timeout) {
 			eptr->mode = KILL;
 		}
-		if (eptr->lastwrite.elapsed_ms() > (eptr->timeout/3) && eptr->outputPackets.empty()) {
+		if (eptr->lastwrite.elapsed_ms() > (eptr->timeout/3) && eptr->outputBuffer.empty()) {
 			matocsserv_createpacket(eptr,ANTOAN_NOP,0);
 		}
 	}
@@ -1756,7 +1801,11 @@ void matocsserv_serve(const std::vector<pollfd> &pdesc) {
 			if (eptr->csdb) {
 				csdb_lost_connection(eptr->servip,eptr->servport);
 			}
-			tcpclose(eptr->sock);
+			if (eptr->connection) {
+				gNetworkWorkers->remove(eptr->connection);
+			} else {
+				tcpclose(eptr->sock);
+			}
 
 			if (eptr->servstrip) {
 				free(eptr->servstrip);
@@ -1842,6 +1891,14 @@ int matocsserv_init(void) {
 	}
 	lzfs_pretty_syslog(LOG_NOTICE,"master <-> chunkservers module: listen on %s:%s",ListenHost,ListenPort);
 
+	uint32_t ioThreads = cfg_get_maxvalue<uint32_t>("MATOCS_IO_THREADS", 0, 64);
+	if (ioThreads > 0) {
+		gNetworkWorkers.reset(new NetworkWorkerPool("master <-> chunkservers module", ioThreads,
+				MaxPacketSize));
+		lzfs_pretty_syslog(LOG_NOTICE,"master <-> chunkservers module: using %" PRIu32 " network I/O threads",
+				ioThreads);
+	}
+
 	matocsserv_replication_init();
 	matocsservhead = NULL;
 	eventloop_reloadregister(matocsserv_reload);
@@ -42,9 +42,11 @@
 #include "common/loop_watchdog.h"
 #include "common/massert.h"
 #include "common/metadata.h"
+#include "common/output_buffer_chain.h"
 #include "common/slogger.h"
 #include "common/sockets.h"
 #include "master/filesystem.h"
+#include "master/network_worker_pool.h"
 #include "master/personality.h"
 #include "protocol/matoml.h"
 #include "protocol/MFSCommunication.h"
@@ -70,7 +72,8 @@ typedef struct matomlserventry {
 	uint32_t lastread,lastwrite;
 	uint8_t hdrbuff[8];
 	packetstruct inputpacket;
-	packetstruct *outputhead,**outputtail;
+	OutputBufferChain outputBuffer;
+	NetworkWorkerPool::ConnectionPtr connection;  // set if served by gNetworkWorkers
 
 	uint16_t timeout;
 
@@ -90,6 +93,9 @@ static int lsock;
 static int32_t lsockpdescpos;
 static bool gExiting = false;
 
+// network I/O threads (if MATOML_IO_THREADS > 0)
+static std::unique_ptr<NetworkWorkerPool> gNetworkWorkers;
+
 /// Miminal period (in seconds) between two metadata save processes requested by shadow masters
 static uint32_t gMinMetadataSaveRequestPeriod_s;
 
@@ -293,37 +299,11 @@ char* matomlserv_makestrip(uint32_t ip) {
 }
 
 uint8_t* matomlserv_createpacket(matomlserventry *eptr,uint32_t type,uint32_t size) {
-	packetstruct *outpacket;
-	uint8_t *ptr;
-	uint32_t psize;
-
-	outpacket=(packetstruct*)malloc(sizeof(packetstruct));
-	passert(outpacket);
-	psize = size+8;
-	outpacket->packet= (uint8_t*) malloc(psize);
-	passert(outpacket->packet);
-	outpacket->bytesleft = psize;
-	ptr = outpacket->packet;
-	put32bit(&ptr,type);
-	put32bit(&ptr,size);
-	outpacket->startptr = (uint8_t*)(outpacket->packet);
-	outpacket->next = NULL;
-	*(eptr->outputtail) = outpacket;
-	eptr->outputtail = &(outpacket->next);
-	return ptr;
+	return eptr->outputBuffer.allocatePacket(type, size);
 }
 
 void matomlserv_createpacket(matomlserventry *eptr, std::vector<uint8_t> data) {
-	packetstruct *outpacket = (packetstruct*) malloc(sizeof(packetstruct));
-	passert(outpacket);
-	outpacket->packet = (uint8_t*) malloc(data.size());
-	passert(outpacket->packet);
-	memcpy(outpacket->packet, data.data(), data.size());
-	outpacket->bytesleft = data.size();
-	outpacket->startptr = outpacket->packet;
-	outpacket->next = nullptr;
-	*(eptr->outputtail) = outpacket;
-	eptr->outputtail = &(outpacket->next);
+	eptr->outputBuffer.append(std::move(data));
 }
 
 void matomlserv_send_old_changes(matomlserventry *eptr,uint64_t version) {
@@ -682,9 +662,9 @@ void matomlserv_gotpacket(matomlserventry *eptr,uint32_t type,const uint8_t *dat
 
 void matomlserv_term(void) {
 	matomlserventry *eptr,*eaptr;
-	packetstruct *pptr,*paptr;
 	lzfs_pretty_syslog(LOG_INFO,"master <-> metaloggers module: closing %s:%s",ListenHost,ListenPort);
 	tcpclose(lsock);
+	gNetworkWorkers.reset();
 
 	eptr = matomlservhead;
 	while (eptr) {
@@ -694,19 +674,10 @@ void matomlserv_term(void) {
 		if (eptr->servstrip) {
 			free(eptr->servstrip);
 		}
-		pptr = eptr->outputhead;
-		while (pptr) {
-			if (pptr->packet) {
-				free(pptr->packet);
-			}
-			paptr = pptr;
-			pptr = pptr->next;
-			free(paptr);
-		}
 		eaptr = eptr;
 		eptr = eptr->next;
 		gShadowQueue.removeRequest(eaptr);
-		free(eaptr);
+		delete eaptr;
 	}
 	matomlservhead=NULL;
 
@@ -788,16 +759,11 @@ void matomlserv_read(matomlserventry *eptr) {
 
 void matomlserv_write(matomlserventry *eptr) {
 	SignalLoopWatchdog watchdog;
-	packetstruct *pack;
-	int32_t i;
+	ssize_t i;
 
 	watchdog.start();
-	for (;;) {
-		pack = eptr->outputhead;
-		if (pack==NULL) {
-			return;
-		}
-		i=write(eptr->sock,pack->startptr,pack->bytesleft);
+	while (!eptr->outputBuffer.empty()) {
+		i = eptr->outputBuffer.writeTo(eptr->sock);
 		if (i<0) {
 			if (errno!=EAGAIN) {
 				lzfs_silent_errlog(LOG_NOTICE,"write to ML(%s) error",eptr->servstrip);
@@ -805,17 +771,6 @@ void matomlserv_write(matomlserventry *eptr) {
 			}
 			return;
 		}
-		pack->startptr+=i;
-		pack->bytesleft-=i;
-		if (pack->bytesleft>0) {
-			return;
-		}
-		free(pack->packet);
-		eptr->outputhead = pack->next;
-		if (eptr->outputhead==NULL) {
-			eptr->outputtail = &(eptr->outputhead);
-		}
-		free(pack);
 
 		if (watchdog.expired()) {
 			break;
@@ -831,19 +786,52 @@ void matomlserv_desc(std::vector<pollfd> &pdesc) {
 	} else {
 		lsockpdescpos = -1;
 	}
+	if (gNetworkWorkers) {
+		pdesc.push_back({gNetworkWorkers->notifyFd(),POLLIN,0});
+	}
 	for (eptr=matomlservhead ; eptr ; eptr=eptr->next) {
+		if (eptr->connection) {
+			// replies produced since the last loop are handed over to the I/O thread
+			eptr->pdescpos = -1;
+			if (!eptr->outputBuffer.empty() && eptr->mode!=KILL) {
+				eptr->lastwrite = eventloop_time();
+				gNetworkWorkers->send(eptr->connection, eptr->outputBuffer);
+			}
+			continue;
+		}
 		pdesc.push_back({eptr->sock,POLLIN,0});
 		eptr->pdescpos = pdesc.size() - 1;
-		if (eptr->outputhead!=NULL) {
+		if (!eptr->outputBuffer.empty()) {
 			pdesc.back().events |= POLLOUT;
 		}
 	}
 }
 
+static void matomlserv_serve_network_workers(uint32_t now) {
+	ActiveLoopWatchdog watchdog(std::chrono::milliseconds(10));
+	watchdog.start();
+	bool done = gNetworkWorkers->handleEvents([now](void *owner, NetworkWorkerPool::Event &event) {
+		matomlserventry *eptr = static_cast<matomlserventry*>(owner);
+		if (eptr->mode == KILL) {
+			return;
+		}
+		if (event.closed) {
+			lzfs_pretty_syslog(LOG_NOTICE,"connection with ML(%s) has been closed",eptr->servstrip);
+			eptr->mode = KILL;
+			return;
+		}
+		eptr->lastread = now;
+		matomlserv_gotpacket(eptr, event.header.type,
+				event.data.empty() ? NULL : event.data.data(), event.header.length);
+	}, watchdog);
+	if (!done) {
+		eventloop_make_next_poll_nonblocking();
+	}
+}
+
 void matomlserv_serve(const std::vector<pollfd> &pdesc) {
 	uint32_t now=eventloop_time();
 	matomlserventry *eptr,**kptr;
-	packetstruct *pptr,*paptr;
 	int ns;
 
 	if (lsockpdescpos>=0 && (pdesc[lsockpdescpos].revents & POLLIN)) {
@@ -853,11 +841,13 @@ void matomlserv_serve(const std::vector<pollfd> &pdesc) {
 		} else if (metadataserver::isMaster()) {
 			tcpnonblock(ns);
 			tcpnodelay(ns);
-			eptr = (matomlserventry*) malloc(sizeof(matomlserventry));
-			passert(eptr);
+			eptr = new matomlserventry;
 			eptr->next = matomlservhead;
 			matomlservhead = eptr;
 			eptr->sock = ns;
+			if (gNetworkWorkers) {
+				eptr->connection = gNetworkWorkers->add(ns, eptr);
+			}
 			eptr->pdescpos = -1;
 			eptr->mode = HEADER;
 			eptr->lastread = now;
@@ -866,8 +856,6 @@ void matomlserv_serve(const std::vector<pollfd> &pdesc) {
 			eptr->inputpacket.bytesleft = 8;
 			eptr->inputpacket.startptr = eptr->hdrbuff;
 			eptr->inputpacket.packet = NULL;
-			eptr->outputhead = NULL;
-			eptr->outputtail = &(eptr->outputhead);
 			eptr->timeout = 10;
 			eptr->servport = 0;// For shadow masters this will be changed to their MATOCL_SERV_PORT
 			eptr->shadow = false;
@@ -882,6 +870,9 @@ void matomlserv_serve(const std::vector<pollfd> &pdesc) {
 			tcpclose(ns);
 		}
 	}
+	if (gNetworkWorkers) {
+		matomlserv_serve_network_workers(now);
+	}
 	for (eptr=matomlservhead ; eptr ; eptr=eptr->next) {
 		if (eptr->pdescpos>=0) {
 			if (pdesc[eptr->pdescpos].revents & (POLLERR|POLLHUP)) {
@@ -900,7 +891,7 @@ void matomlserv_serve(const std::vector<pollfd> &pdesc) {
 			eptr->mode = KILL;
 		}
 		if ((uint32_t)(eptr->lastwrite+(eptr->timeout/3))<(uint32_t)now
-				&& eptr->outputhead==NULL
+				&& eptr->outputBuffer.empty()
 				&& !gExiting) {
 			matomlserv_createpacket(eptr,ANTOAN_NOP,0);
 		}
@@ -909,24 +900,19 @@ void matomlserv_serve(const std::vector<pollfd> &pdesc) {
 	while ((eptr=*kptr)) {
 		if (eptr->mode == KILL) {
 			matomlserv_beforeclose(eptr);
-			tcpclose(eptr->sock);
+			if (eptr->connection) {
+				gNetworkWorkers->remove(eptr->connection);
+			} else {
+				tcpclose(eptr->sock);
+			}
 			if (eptr->inputpacket.packet) {
 				free(eptr->inputpacket.packet);
 			}
-			pptr = eptr->outputhead;
-			while (pptr) {
-				if (pptr->packet) {
-					free(pptr->packet);
-				}
-				paptr = pptr;
-				pptr = pptr->next;
-				free(paptr);
-			}
 			if (eptr->servstrip) {
 				free(eptr->servstrip);
 			}
 			*kptr = eptr->next;
-			free(eptr);
+			delete eptr;
 		} else {
 			kptr = &(eptr->next);
 		}
@@ -1035,6 +1021,14 @@ int matomlserv_init(void) {
 	}
 	lzfs_pretty_syslog(LOG_NOTICE,"master <-> metaloggers module: listen on %s:%s",ListenHost,ListenPort);
 
+	uint32_t ioThreads = cfg_get_maxvalue<uint32_t>("MATOML_IO_THREADS", 0, 64);
+	if (ioThreads > 0) {
+		gNetworkWorkers.reset(new NetworkWorkerPool("master <-> metaloggers module", ioThreads,
+				MaxPacketSize));
+		lzfs_pretty_syslog(LOG_NOTICE,"master <-> metaloggers module: using %" PRIu32 " network I/O threads",
+				ioThreads);
+	}
+
 	matomlservhead = NULL;
 	ChangelogSecondsToRemember = cfg_getuint16("MATOML_LOG_PRESERVE_SECONDS",600);
 	if (ChangelogSecondsToRemember>3600) {
@@ -0,0 +1,314 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/platform.h"
+#include "master/network_worker_pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "common/massert.h"
+#include "common/slogger.h"
+#include "common/sockets.h"
+
+constexpr uint32_t NetworkWorkerPool::kMaxQueuedPackets;
+
+static void create_nonblocking_pipe(int fds[2]) {
+	eassert(pipe(fds) == 0);
+	eassert(fcntl(fds[0], F_SETFL, O_NONBLOCK) == 0);
+	eassert(fcntl(fds[1], F_SETFL, O_NONBLOCK) == 0);
+}
+
+static void drain_pipe(int fd) {
+	uint8_t buffer[256];
+	while (read(fd, buffer, sizeof(buffer)) > 0) {
+	}
+}
+
+static void notify_pipe(int fd) {
+	uint8_t byte = 0;
+	// EAGAIN means that the pipe is full, so the reader will be woken up anyway
+	if (write(fd, &byte, 1) < 0 && errno != EAGAIN) {
+		lzfs_silent_errlog(LOG_WARNING, "network worker pool: can't write to pipe");
+	}
+}
+
+NetworkWorkerPool::Connection::Connection(int sock, void *owner, uint32_t maxPacketSize,
+		unsigned worker)
+		: sock_(sock),
+		  owner_(owner),
+		  worker_(worker),
+		  outputBytes_(0),
+		  queuedPackets_(0),
+		  removed_(false),
+		  input_(maxPacketSize),
+		  failed_(false) {
+}
+
+NetworkWorkerPool::NetworkWorkerPool(const std::string &name, unsigned threads,
+		uint32_t maxPacketSize)
+		: name_(name),
+		  maxPacketSize_(maxPacketSize),
+		  nextWorker_(0),
+		  pendingEventsPos_(0),
+		  bytesReceived_(0),
+		  bytesSent_(0),
+		  packetsSent_(0) {
+	sassert(threads > 0);
+	create_nonblocking_pipe(notifyPipe_);
+	for (unsigned i = 0; i < threads; ++i) {
+		workers_.emplace_back(new Worker);
+		Worker &worker = *workers_.back();
+		create_nonblocking_pipe(worker.wakeupPipe);
+		worker.thread = std::thread([this, &worker]() { workerLoop(worker); });
+	}
+}
+
+NetworkWorkerPool::~NetworkWorkerPool() {
+	for (auto &worker : workers_) {
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			worker->terminate = true;
+		}
+		notify_pipe(worker->wakeupPipe[1]);
+		worker->thread.join();
+		close(worker->wakeupPipe[0]);
+		close(worker->wakeupPipe[1]);
+	}
+	close(notifyPipe_[0]);
+	close(notifyPipe_[1]);
+}
+
+NetworkWorkerPool::ConnectionPtr NetworkWorkerPool::add(int sock, void *owner) {
+	unsigned workerId = nextWorker_;
+	nextWorker_ = (nextWorker_ + 1) % workers_.size();
+	auto connection = std::make_shared<Connection>(sock, owner, maxPacketSize_, workerId);
+	Worker &worker = *workers_[workerId];
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.added.push_back(connection);
+	}
+	notify_pipe(worker.wakeupPipe[1]);
+	return connection;
+}
+
+void NetworkWorkerPool::send(const ConnectionPtr &connection, OutputBufferChain &output) {
+	if (output.empty()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(connection->outputMutex_);
+		connection->output_.splice(output);
+		connection->outputBytes_ = connection->output_.bytesPending();
+	}
+	wakeup(*connection);
+}
+
+void NetworkWorkerPool::remove(const ConnectionPtr &connection) {
+	connection->owner_ = nullptr;
+	connection->removed_ = true;
+	wakeup(*connection);
+}
+
+void NetworkWorkerPool::collectEvents(std::vector<Event> &events) {
+	drain_pipe(notifyPipe_[0]);
+	std::lock_guard<std::mutex> lock(eventsMutex_);
+	if (events.empty()) {
+		events.swap(events_);
+	} else {
+		std::move(events_.begin(), events_.end(), std::back_inserter(events));
+		events_.clear();
+	}
+}
+
+void NetworkWorkerPool::packetProcessed(const ConnectionPtr &connection) {
+	if (connection->queuedPackets_.fetch_sub(1) == kMaxQueuedPackets) {
+		// the worker has stopped reading from this connection, let it resume
+		wakeup(*connection);
+	}
+}
+
+bool NetworkWorkerPool::hasPendingOutput(const ConnectionPtr &connection) const {
+	return connection->outputBytes_ > 0;
+}
+
+void NetworkWorkerPool::wakeup(const Connection &connection) {
+	Worker &worker = *workers_[connection.worker_];
+	// One byte in the pipe is enough until the worker handles it
+	if (!worker.wakeupPending.exchange(true)) {
+		notify_pipe(worker.wakeupPipe[1]);
+	}
+}
+
+void NetworkWorkerPool::deliver(std::vector<Event> &events) {
+	if (events.empty()) {
+		return;
+	}
+	bool wasEmpty;
+	{
+		std::lock_guard<std::mutex> lock(eventsMutex_);
+		wasEmpty = events_.empty();
+		std::move(events.begin(), events.end(), std::back_inserter(events_));
+	}
+	events.clear();
+	if (wasEmpty) {
+		notify_pipe(notifyPipe_[1]);
+	}
+}
+
+bool NetworkWorkerPool::readFrom(Connection &connection, std::vector<Event> &events) {
+	for (;;) {
+		uint32_t bytesToRead = connection.input_.bytesToBeRead();
+		ssize_t ret = read(connection.sock_, connection.input_.pointerToBeReadInto(), bytesToRead);
+		if (ret == 0) {
+			return false;
+		} else if (ret < 0) {
+			if (errno == EAGAIN || errno == EINTR) {
+				return true;
+			}
+			lzfs_silent_errlog(LOG_NOTICE, "%s: read error", name_.c_str());
+			return false;
+		}
+		bytesReceived_ += ret;
+		try {
+			connection.input_.increaseBytesRead(ret);
+		} catch (InputPacketTooLongException &ex) {
+			lzfs_pretty_syslog(LOG_WARNING, "%s: %s", name_.c_str(), ex.what());
+			return false;
+		}
+		if (!connection.input_.hasData()) {
+			if ((uint32_t)ret == bytesToRead) {
+				// there might be more data to read in socket's buffer
+				continue;
+			}
+			return true;
+		}
+		events.push_back(Event{nullptr, connection.input_.getHeader(),
+				connection.input_.releaseData(), false});
+		if (++connection.queuedPackets_ >= kMaxQueuedPackets) {
+			return true;
+		}
+	}
+}
+
+bool NetworkWorkerPool::writeTo(Connection &connection) {
+	std::lock_guard<std::mutex> lock(connection.outputMutex_);
+	bool ok = true;
+	while (!connection.output_.empty()) {
+		ssize_t ret = connection.output_.writeTo(connection.sock_);
+		if (ret < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				lzfs_silent_errlog(LOG_NOTICE, "%s: write error", name_.c_str());
+				ok = false;
+			}
+			break;
+		}
+		bytesSent_ += ret;
+	}
+	packetsSent_ += connection.output_.takeSentPackets();
+	connection.outputBytes_ = connection.output_.bytesPending();
+	return ok;
+}
+
+void NetworkWorkerPool::workerLoop(Worker &worker) {
+	std::vector<ConnectionPtr> connections;
+	std::vector<pollfd> pdesc;
+	std::vector<Event> events;
+
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			if (worker.terminate) {
+				break;
+			}
+			connections.insert(connections.end(), worker.added.begin(), worker.added.end());
+			worker.added.clear();
+		}
+		connections.erase(std::remove_if(connections.begin(), connections.end(),
+				[](const ConnectionPtr &connection) {
+					if (connection->removed_) {
+						tcpclose(connection->sock_);
+						return true;
+					}
+					return false;
+				}), connections.end());
+
+		pdesc.clear();
+		pdesc.push_back({worker.wakeupPipe[0], POLLIN, 0});
+		for (const auto &connection : connections) {
+			pollfd pfd = {-1, 0, 0};
+			if (!connection->failed_) {
+				pfd.fd = connection->sock_;
+				if (connection->queuedPackets_ < kMaxQueuedPackets) {
+					pfd.events |= POLLIN;
+				}
+				if (connection->outputBytes_ > 0) {
+					pfd.events |= POLLOUT;
+				}
+			}
+			pdesc.push_back(pfd);
+		}
+
+		if (poll(pdesc.data(), pdesc.size(), 1000) < 0) {
+			if (errno != EINTR) {
+				lzfs_silent_errlog(LOG_WARNING, "%s: poll error", name_.c_str());
+			}
+			continue;
+		}
+		if (pdesc[0].revents & POLLIN) {
+			worker.wakeupPending = false;
+			drain_pipe(worker.wakeupPipe[0]);
+		}
+
+		for (size_t i = 0; i < connections.size(); ++i) {
+			Connection &connection = *connections[i];
+			short revents = pdesc[i + 1].revents;
+			if (connection.failed_ || revents == 0) {
+				continue;
+			}
+			size_t firstEvent = events.size();
+			bool ok = (revents & (POLLERR | POLLHUP | POLLNVAL)) == 0;
+			if (ok && (revents & POLLIN)) {
+				ok = readFrom(connection, events);
+			}
+			if (ok && (revents & POLLOUT)) {
+				ok = writeTo(connection);
+			}
+			if (!ok) {
+				connection.failed_ = true;
+				events.push_back(Event{nullptr, PacketHeader(), MessageBuffer(), true});
+			}
+			for (size_t j = firstEvent; j < events.size(); ++j) {
+				events[j].connection = connections[i];
+			}
+		}
+		deliver(events);
+	}
+
+	for (const auto &connection : connections) {
+		tcpclose(connection->sock_);
+	}
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	for (const auto &connection : worker.added) {
+		tcpclose(connection->sock_);
+	}
+	worker.added.clear();
+}
@@ -0,0 +1,200 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/loop_watchdog.h"
+#include "common/output_buffer_chain.h"
+#include "protocol/input_packet.h"
+#include "protocol/packet.h"
+
+/*! \brief Pool of threads doing network I/O for one of the master's server modules.
+ *
+ * Every connection added to the pool is served by one worker thread, which reads
+ * and frames incoming packets and writes outgoing data. Complete packets are passed
+ * to the main (metadata) thread, which handles them with handleEvents() whenever
+ * notifyFd() becomes readable. Replies produced by the main thread are handed over
+ * to the worker with send(). Packets of one connection are always delivered in order.
+ *
+ * All public functions are meant to be called by the main thread.
+ */
+class NetworkWorkerPool {
+public:
+	class Connection;
+	typedef std::shared_ptr<Connection> ConnectionPtr;
+
+	/// Maximal number of packets of one connection waiting for the main thread.
+	/// When it is reached, the worker stops reading from the connection.
+	static constexpr uint32_t kMaxQueuedPackets = 256;
+
+	struct Event {
+		ConnectionPtr connection;
+		PacketHeader header;
+		MessageBuffer data;
+		bool closed; ///< connection has been closed by peer or failed, no packet is attached
+	};
+
+	/*! \brief Starts worker threads.
+	 * \param name name used in log messages
+	 * \param threads number of worker threads
+	 * \param maxPacketSize maximal accepted length of an incoming packet
+	 */
+	NetworkWorkerPool(const std::string &name, unsigned threads, uint32_t maxPacketSize);
+	~NetworkWorkerPool();
+
+	NetworkWorkerPool(const NetworkWorkerPool&) = delete;
+	NetworkWorkerPool& operator=(const NetworkWorkerPool&) = delete;
+
+	/*! \brief Starts serving a connection.
+	 * \param sock nonblocking socket; from now on it's owned by the pool
+	 * \param owner pointer returned by owner() of events of this connection
+	 */
+	ConnectionPtr add(int sock, void *owner);
+
+	/// Moves all data from \p output to the send queue of the connection.
+	void send(const ConnectionPtr &connection, OutputBufferChain &output);
+
+	/// Stops serving the connection and closes its socket.
+	/// Events of this connection which have not been processed yet will have nullptr owner.
+	void remove(const ConnectionPtr &connection);
+
+	/// Descriptor which becomes readable when there are events to be collected.
+	int notifyFd() const {
+		return notifyPipe_[0];
+	}
+
+	/*! \brief Calls \p handler for events produced by worker threads.
+	 *
+	 * Events of removed connections are skipped. Events which haven't been handled
+	 * before \p watchdog expired are kept for the next call.
+	 * \param handler function called as handler(owner, event)
+	 * \return true if all events have been handled
+	 */
+	template <typename Handler>
+	bool handleEvents(Handler handler, const ActiveLoopWatchdog &watchdog) {
+		if (pendingEventsPos_ == pendingEvents_.size()) {
+			pendingEvents_.clear();
+			pendingEventsPos_ = 0;
+			collectEvents(pendingEvents_);
+		}
+		while (pendingEventsPos_ < pendingEvents_.size()) {
+			Event &event = pendingEvents_[pendingEventsPos_++];
+			if (!event.closed) {
+				packetProcessed(event.connection);
+			}
+			void *owner = event.connection->owner();
+			if (owner != nullptr) {
+				handler(owner, event);
+			}
+			event.connection.reset();
+			MessageBuffer().swap(event.data);
+			if (watchdog.expired()) {
+				break;
+			}
+		}
+		return pendingEventsPos_ == pendingEvents_.size();
+	}
+
+	/// Checks if there is still some data to be sent to the connection.
+	bool hasPendingOutput(const ConnectionPtr &connection) const;
+
+	/// Returns number of bytes received since the last call.
+	uint64_t takeBytesReceived() {
+		return bytesReceived_.exchange(0);
+	}
+
+	/// Returns number of bytes sent since the last call.
+	uint64_t takeBytesSent() {
+		return bytesSent_.exchange(0);
+	}
+
+	/// Returns number of packets completely sent since the last call.
+	uint64_t takePacketsSent() {
+		return packetsSent_.exchange(0);
+	}
+
+	class Connection {
+	public:
+		Connection(int sock, void *owner, uint32_t maxPacketSize, unsigned worker);
+
+		void *owner() const {
+			return owner_;
+		}
+
+	private:
+		friend class NetworkWorkerPool;
+
+		const int sock_;
+		void *owner_;
+		const unsigned worker_;
+
+		std::mutex outputMutex_;
+		OutputBufferChain output_;          ///< guarded by outputMutex_
+		std::atomic<uint64_t> outputBytes_;
+		std::atomic<uint32_t> queuedPackets_;
+		std::atomic<bool> removed_;
+
+		// used only by the worker thread
+		InputPacket input_;
+		bool failed_;
+	};
+
+private:
+	struct Worker {
+		Worker() : wakeupPipe{-1, -1}, wakeupPending(false), terminate(false) {}
+
+		std::thread thread;
+		int wakeupPipe[2];
+		std::atomic<bool> wakeupPending;
+		std::mutex mutex;
+		std::vector<ConnectionPtr> added;   ///< guarded by mutex
+		bool terminate;                     ///< guarded by mutex
+	};
+
+	void collectEvents(std::vector<Event> &events);
+	void packetProcessed(const ConnectionPtr &connection);
+	void workerLoop(Worker &worker);
+	bool readFrom(Connection &connection, std::vector<Event> &events);
+	bool writeTo(Connection &connection);
+	void wakeup(const Connection &connection);
+	void deliver(std::vector<Event> &events);
+
+	const std::string name_;
+	const uint32_t maxPacketSize_;
+	std::vector<std::unique_ptr<Worker>> workers_;
+	unsigned nextWorker_;
+
+	int notifyPipe_[2];
+	std::mutex eventsMutex_;
+	std::vector<Event> events_;         ///< guarded by eventsMutex_
+	std::vector<Event> pendingEvents_;  ///< collected, but not handled yet
+	size_t pendingEventsPos_;
+
+	std::atomic<uint64_t> bytesReceived_;
+	std::atomic<uint64_t> bytesSent_;
+	std::atomic<uint64_t> packetsSent_;
+};
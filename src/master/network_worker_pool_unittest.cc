@@ -0,0 +1,132 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "master/network_worker_pool.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "common/datapack.h"
+#include "common/sockets.h"
+
+/// Waits until \p fd becomes readable.
+static void waitForInput(int fd) {
+	struct pollfd pfd = {fd, POLLIN, 0};
+	ASSERT_EQ(poll(&pfd, 1, 5000), 1);
+}
+
+/// Collects at least \p count events of the pool.
+static std::vector<NetworkWorkerPool::Event> collect(NetworkWorkerPool &pool, size_t count) {
+	std::vector<NetworkWorkerPool::Event> result;
+	ActiveLoopWatchdog watchdog(std::chrono::seconds(5));
+	while (result.size() < count) {
+		waitForInput(pool.notifyFd());
+		watchdog.start();
+		pool.handleEvents([&result](void *, NetworkWorkerPool::Event &event) {
+			result.push_back(NetworkWorkerPool::Event{nullptr, event.header, event.data,
+					event.closed});
+		}, watchdog);
+	}
+	return result;
+}
+
+static std::vector<uint8_t> buildPacket(uint32_t type, uint32_t value) {
+	std::vector<uint8_t> packet(PacketHeader::kSize + 4);
+	uint8_t *ptr = packet.data();
+	put32bit(&ptr, type);
+	put32bit(&ptr, 4);
+	put32bit(&ptr, value);
+	return packet;
+}
+
+class NetworkWorkerPoolTests : public ::testing::Test {
+protected:
+	void SetUp() override {
+		ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+		ASSERT_EQ(tcpnonblock(fds_[0]), 0);
+	}
+
+	void TearDown() override {
+		close(fds_[1]);
+	}
+
+	int fds_[2];
+	int owner_;
+};
+
+TEST_F(NetworkWorkerPoolTests, ReceiveAndSend) {
+	NetworkWorkerPool pool("test", 2, 1000);
+	auto connection = pool.add(fds_[0], &owner_);
+
+	std::vector<uint8_t> input;
+	for (uint32_t i = 0; i < 100; ++i) {
+		auto packet = buildPacket(1000 + i, i);
+		input.insert(input.end(), packet.begin(), packet.end());
+	}
+	ASSERT_EQ(write(fds_[1], input.data(), input.size()), (ssize_t)input.size());
+
+	auto events = collect(pool, 100);
+	ASSERT_EQ(100U, events.size());
+	for (uint32_t i = 0; i < 100; ++i) {
+		ASSERT_FALSE(events[i].closed);
+		EXPECT_EQ(1000 + i, events[i].header.type);
+		ASSERT_EQ(4U, events[i].header.length);
+		const uint8_t *ptr = events[i].data.data();
+		EXPECT_EQ(i, get32bit(&ptr));
+	}
+
+	OutputBufferChain output;
+	uint8_t *ptr = output.allocatePacket(2000, 4);
+	put32bit(&ptr, 12345);
+	pool.send(connection, output);
+	EXPECT_TRUE(output.empty());
+
+	auto expected = buildPacket(2000, 12345);
+	std::vector<uint8_t> reply(expected.size());
+	waitForInput(fds_[1]);
+	ASSERT_EQ(read(fds_[1], reply.data(), reply.size()), (ssize_t)reply.size());
+	EXPECT_EQ(expected, reply);
+
+	pool.remove(connection);
+}
+
+TEST_F(NetworkWorkerPoolTests, ClosedByPeer) {
+	NetworkWorkerPool pool("test", 1, 1000);
+	auto connection = pool.add(fds_[0], &owner_);
+	ASSERT_EQ(shutdown(fds_[1], SHUT_WR), 0);
+
+	auto events = collect(pool, 1);
+	ASSERT_EQ(1U, events.size());
+	EXPECT_TRUE(events[0].closed);
+	pool.remove(connection);
+}
+
+TEST_F(NetworkWorkerPoolTests, PacketTooLong) {
+	NetworkWorkerPool pool("test", 1, 2);
+	auto connection = pool.add(fds_[0], &owner_);
+	auto packet = buildPacket(1000, 0);
+	ASSERT_EQ(write(fds_[1], packet.data(), packet.size()), (ssize_t)packet.size());
+
+	auto events = collect(pool, 1);
+	ASSERT_EQ(1U, events.size());
+	EXPECT_TRUE(events[0].closed);
+	pool.remove(connection);
+}
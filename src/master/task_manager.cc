@@ -44,6 +44,7 @@ void TaskManager::Job::processTask(uint32_t ts) {
 	if (!tasks_.empty()) {
 		auto i_front = tasks_.begin();
 		int status = i_front->execute(ts, tasks_);
+		++processed_nodes_;
 		finalizeTask(i_front, status);
 	}
 }
@@ -52,9 +53,13 @@ JobInfo TaskManager::Job::getInfo() const {
 	return { id_, description_ };
 }
 
+JobProgressInfo TaskManager::Job::getProgressInfo(uint32_t ts) const {
+	return { id_, description_, processed_nodes_, ts > start_ts_ ? ts - start_ts_ : 0 };
+}
+
 int TaskManager::submitTask(uint32_t taskid, uint32_t ts, int initial_batch_size, Task *task,
 	                    const std::string &description, const std::function<void(int)> &callback) {
-	Job new_job(taskid, description);
+	Job new_job(taskid, description, ts);
 
 	int done = 0;
 	int status = LIZARDFS_STATUS_OK;
@@ -88,14 +93,11 @@ int TaskManager::submitTask(uint32_t ts, int initial_batch_size, Task *task,
 	return submitTask(reserveJobId(), ts, initial_batch_size, task, description, callback);
 }
 
-void TaskManager::processJobs(uint32_t ts, int number_of_tasks) {
-	SignalLoopWatchdog watchdog;
+void TaskManager::processJobs(uint32_t ts, std::chrono::microseconds max_duration) {
+	SignalLoopWatchdog watchdog(max_duration);
 	JobIterator it = job_list_.begin();
 	watchdog.start();
-	for (int i = 0; i < number_of_tasks; ++i) {
-		if (it == job_list_.end() || watchdog.expired()) {
-			break;
-		}
+	while (it != job_list_.end() && !watchdog.expired()) {
 		if (it->isFinished()) {
 			it = job_list_.erase(it);
 		} else {
@@ -117,6 +119,15 @@ TaskManager::JobsInfoContainer TaskManager::getCurrentJobsInfo() const {
 	return info;
 }
 
+TaskManager::JobsProgressInfoContainer TaskManager::getCurrentJobsProgressInfo(uint32_t ts) const {
+	JobsProgressInfoContainer info;
+	info.reserve(job_list_.size());
+	for (const Job &j : job_list_) {
+		info.push_back(j.getProgressInfo(ts));
+	}
+	return info;
+}
+
 bool TaskManager::cancelJob(uint32_t job_id) {
 	for (auto it = job_list_.begin(); it != job_list_.end(); ++it) {
 		if (it->getId() == job_id) {
@@ -20,6 +20,7 @@
 
 #include "common/platform.h"
 
+#include <chrono>
 #include <functional>
 #include <list>
 #include <memory>
@@ -55,13 +56,15 @@ public:
 	/*! \brief Class representing the original task and all subtasks it created during execution*/
 	class Job {
 	public:
-		Job(uint32_t id, const std::string &description) :
-		    id_(id), description_(description),
+		Job(uint32_t id, const std::string &description, uint32_t start_ts = 0) :
+		    id_(id), description_(description), start_ts_(start_ts), processed_nodes_(0),
 		    finish_callback_(), tasks_() {
 		}
 
 		Job(Job &&other) : id_(std::move(other.id_)),
 				   description_(std::move(other.description_)),
+				   start_ts_(other.start_ts_),
+				   processed_nodes_(other.processed_nodes_),
 				   finish_callback_(std::move(other.finish_callback_)),
 				   tasks_(std::move(other.tasks_)) {
 		}
@@ -105,9 +108,17 @@ public:
 
 		JobInfo getInfo() const;
 
+		/*! \brief Returns information about the Job together with its progress.
+		 * \param ts current time stamp.
+		 */
+		JobProgressInfo getProgressInfo(uint32_t ts) const;
+
 	private:
 		uint32_t id_;
 		std::string description_;
+		uint32_t start_ts_;         /*!< Time stamp of submission of the Job. */
+		uint64_t processed_nodes_;  /*!< Number of tasks executed so far. Every task
+		                                 handles a single node in one execution. */
 		std::function<void(int)> finish_callback_; /*!< Callback function called when all tasks
 		                                                that belong to this Job are done. */
 
@@ -117,6 +128,7 @@ public:
 	typedef typename std::list<Job> JobContainer;
 	typedef typename JobContainer::iterator JobIterator;
 	typedef typename std::vector<JobInfo> JobsInfoContainer;
+	typedef typename std::vector<JobProgressInfo> JobsProgressInfoContainer;
 
 public:
 	TaskManager() : job_list_(), next_job_id_(0) {
@@ -153,15 +165,21 @@ public:
 	/*! \brief Iterate over Jobs and execute tasks.
 	 *
 	 * This function goes through the list of Jobs over and over again,
-	 * executing one task each time it processes a Job.
+	 * executing one task each time it processes a Job, until there is no work
+	 * left or the time limit is exceeded.
 	 * \param ts current time stamp.
-	 * \param number_of_tasks maximum number of tasks to be processed.
+	 * \param max_duration maximum time spent on processing tasks.
 	 */
-	void processJobs(uint32_t ts, int number_of_tasks);
+	void processJobs(uint32_t ts, std::chrono::microseconds max_duration);
 
 	/*! \brief Get information about all currently executed Job. */
 	JobsInfoContainer getCurrentJobsInfo() const;
 
+	/*! \brief Get information about all currently executed Job including their progress.
+	 * \param ts current time stamp.
+	 */
+	JobsProgressInfoContainer getCurrentJobsProgressInfo(uint32_t ts) const;
+
 	/*! \brief Stop execution of a Job specified by given id. */
 	bool cancelJob(uint32_t job_id);
 
@@ -0,0 +1,165 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/cache_invalidator.h"
+
+#include <cassert>
+#include <chrono>
+
+#include "common/slogger.h"
+#include "protocol/matocl.h"
+
+constexpr size_t CacheInvalidator::kMaxTrackedKernelCacheEntries;
+
+CacheInvalidator::CacheInvalidator(InodeCallback inodeCallback, EntryCallback entryCallback,
+		ActivationCallback activationCallback)
+		: inodeCallback_(std::move(inodeCallback)),
+		  entryCallback_(std::move(entryCallback)),
+		  activationCallback_(std::move(activationCallback)),
+		  handler_(*this),
+		  tracker_(kMaxTrackedKernelCacheEntries),
+		  active_(false),
+		  connectionId_(0),
+		  unsupported_(false),
+		  terminate_(false) {
+	auto res = fs_register_packet_type_handler(LIZ_MATOCL_CACHE_INVALIDATE, &handler_);
+	(void)res;
+	assert(res);
+	thread_ = std::thread(&CacheInvalidator::run, this);
+}
+
+CacheInvalidator::~CacheInvalidator() {
+	auto res = fs_unregister_packet_type_handler(LIZ_MATOCL_CACHE_INVALIDATE, &handler_);
+	(void)res;
+	assert(res);
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		terminate_ = true;
+	}
+	cond_.notify_one();
+	thread_.join();
+}
+
+void CacheInvalidator::disconnected() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	active_ = false;
+	connectionId_++;
+	tracker_.reset(inodes_, entries_);
+	cond_.notify_one();
+}
+
+bool CacheInvalidator::CacheInvalidateHandler::handle(MessageBuffer buffer) {
+	try {
+		uint32_t messageId;
+		std::vector<uint32_t> inodes;
+		std::vector<NamedInodeEntry> entries;
+		matocl::cacheInvalidate::deserialize(buffer, messageId, inodes, entries);
+		// replies to requests sent before are not cached for long from now on
+		for (const NamedInodeEntry &entry : entries) {
+			parent_.tracker_.entryInvalidated(entry.inode, entry.name);
+		}
+		for (uint32_t inode : inodes) {
+			parent_.tracker_.inodeInvalidated(inode);
+		}
+		std::unique_lock<std::mutex> lock(parent_.mutex_);
+		parent_.inodes_.insert(parent_.inodes_.end(), inodes.begin(), inodes.end());
+		parent_.entries_.insert(parent_.entries_.end(), entries.begin(), entries.end());
+		parent_.cond_.notify_one();
+		return true;
+	} catch (IncorrectDeserializationException &ex) {
+		lzfs_pretty_syslog(LOG_ERR, "Malformed LIZ_MATOCL_CACHE_INVALIDATE: %s", ex.what());
+		return false;
+	}
+}
+
+void CacheInvalidator::attrReplied(uint32_t inode, uint64_t sequence) {
+	if (!tracker_.changedSince(inode, sequence)) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	inodes_.push_back(inode);
+	cond_.notify_one();
+}
+
+void CacheInvalidator::entryReplied(uint32_t parent, const std::string &name, uint32_t inode,
+		uint64_t sequence) {
+	bool entryChanged = tracker_.changedSince(parent, sequence);
+	// negative entries (inode 0) carry no attributes
+	bool attrChanged = inode != 0 && tracker_.changedSince(inode, sequence);
+	if (!entryChanged && !attrChanged) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (entryChanged) {
+		entries_.emplace_back(name, parent);
+	}
+	if (attrChanged) {
+		inodes_.push_back(inode);
+	}
+	cond_.notify_one();
+}
+
+void CacheInvalidator::run() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!terminate_) {
+		if (!inodes_.empty() || !entries_.empty()) {
+			std::vector<uint32_t> inodes;
+			std::vector<NamedInodeEntry> entries;
+			std::swap(inodes, inodes_);
+			std::swap(entries, entries_);
+			lock.unlock();
+			for (const NamedInodeEntry &entry : entries) {
+				entryCallback_(entry.inode, entry.name);
+			}
+			for (uint32_t inode : inodes) {
+				inodeCallback_(inode);
+			}
+			lock.lock();
+			continue;
+		}
+		if (active_) {
+			cond_.wait(lock);
+			continue;
+		}
+		uint32_t connectionId = connectionId_;
+		lock.unlock();
+		uint8_t status = fs_cache_invalidation_subscribe();
+		lock.lock();
+		if (status == LIZARDFS_STATUS_OK) {
+			unsupported_ = false;
+			// a subscription sent just before disconnection is lost
+			if (connectionId == connectionId_) {
+				active_ = true;
+				lock.unlock();
+				activationCallback_();
+				lock.lock();
+			}
+		} else if (status == LIZARDFS_ERROR_ENOTSUP) {
+			// master may be upgraded or reconfigured, so check it from time to time
+			if (!unsupported_) {
+				lzfs_pretty_syslog(LOG_WARNING, "master doesn't send cache invalidation "
+						"notifications, using default cache timeouts");
+				unsupported_ = true;
+			}
+			cond_.wait_for(lock, std::chrono::seconds(60));
+		} else {
+			cond_.wait_for(lock, std::chrono::seconds(1));
+		}
+	}
+}
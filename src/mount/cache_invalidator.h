@@ -0,0 +1,118 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mount/kernel_cache_tracker.h"
+#include "mount/mastercomm.h"
+#include "protocol/named_inode_entry.h"
+
+/*! \brief Applies cache invalidation notifications sent by the master.
+ *
+ * Notifications are received by the thread reading from the master connection, but callbacks
+ * are called by a separate thread -- invalidating kernel caches may wait for FUSE requests,
+ * which may in turn wait for replies from the master. The same thread subscribes for
+ * notifications after every (re)connection. Until it succeeds, active() returns false and
+ * cached metadata can't rely on notifications.
+ *
+ * A reply with metadata older than a notification may still reach the kernel just after the
+ * notification was applied, so after passing a reply to the kernel, FUSE handlers check if
+ * a notification about it was received in the meantime (see attrReplied(), entryReplied()).
+ * When the connection is lost, all long timeouts granted to the kernel (see tracker())
+ * are invalidated, as notifications about them could have been lost.
+ */
+class CacheInvalidator {
+public:
+	typedef std::function<void(uint32_t inode)> InodeCallback;
+	typedef std::function<void(uint32_t parent, const std::string &name)> EntryCallback;
+	typedef std::function<void()> ActivationCallback;
+
+	CacheInvalidator(InodeCallback inodeCallback, EntryCallback entryCallback,
+			ActivationCallback activationCallback);
+	~CacheInvalidator();
+
+	bool active() const {
+		return active_;
+	}
+
+	/// Timeouts of metadata cached by the kernel.
+	KernelCacheTracker &tracker() {
+		return tracker_;
+	}
+
+	/*! \brief To be called after attributes of an inode were passed to the kernel.
+	 *
+	 * Invalidates them if a notification about the inode was received since \p sequence
+	 * (see KernelCacheTracker::sequence()) was taken.
+	 */
+	void attrReplied(uint32_t inode, uint64_t sequence);
+
+	/*! \brief To be called after an entry and attributes of its inode were passed to the kernel.
+	 *
+	 * Invalidates them if a notification about them was received since \p sequence
+	 * (see KernelCacheTracker::sequence()) was taken.
+	 */
+	void entryReplied(uint32_t parent, const std::string &name, uint32_t inode,
+			uint64_t sequence);
+
+	/// To be called when the connection with the master is lost.
+	void disconnected();
+
+private:
+	class CacheInvalidateHandler : public PacketHandler {
+	public:
+		CacheInvalidateHandler(CacheInvalidator &parent) : parent_(parent) {}
+
+		bool handle(MessageBuffer buffer) override;
+	private:
+		CacheInvalidator &parent_;
+	};
+
+	// Maximal number of long timeouts of the kernel which can be invalidated after
+	// the connection is lost
+	static constexpr size_t kMaxTrackedKernelCacheEntries = 250000;
+
+	void run();
+
+	InodeCallback inodeCallback_;
+	EntryCallback entryCallback_;
+	ActivationCallback activationCallback_;
+	CacheInvalidateHandler handler_;
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::vector<uint32_t> inodes_;
+	std::vector<NamedInodeEntry> entries_;
+	KernelCacheTracker tracker_;
+	std::atomic<bool> active_;
+	uint32_t connectionId_; // incremented on every disconnection
+	bool unsupported_;
+	bool terminate_;
+	std::thread thread_;
+};
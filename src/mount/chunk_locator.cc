@@ -27,21 +27,49 @@
 #include "devtools/request_log.h"
 #include "mount/mastercomm.h"
 
-void ReadChunkLocator::invalidateCache(uint32_t inode, uint32_t index) {
+std::atomic<uint32_t> ReadChunkLocator::chunksToPrefetch(16);
+constexpr uint32_t ReadChunkLocator::kPrefetchedLocationsTimeout_ms;
+
+void ReadChunkLocator::invalidateCache(uint32_t inode, uint32_t /*index*/) {
 	std::unique_lock<std::mutex> lock(mutex_);
-	if (cache_ && inode == inode_ && index == index_) {
-		cache_ = nullptr;
+	if (inode == inode_) {
+		cache_.clear();
 	}
 }
 
 std::shared_ptr<const ChunkLocationInfo> ReadChunkLocator::locateChunk(uint32_t inode, uint32_t index) {
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
-		if (cache_ && inode == inode_ && index == index_) {
-			return cache_;
+		auto it = cache_.find(index);
+		if (inode == inode_ && it != cache_.end()
+				&& cacheAge_.elapsed_ms() < kPrefetchedLocationsTimeout_ms
+				// the file may have grown since, so the last chunk is always located again
+				&& (uint64_t)(index + 1) * MFSCHUNKSIZE <= it->second->fileLength) {
+			return it->second;
 		}
 	}
 	LOG_AVG_TILL_END_OF_SCOPE0("ReadChunkLocator::locateChunk");
+	Cache locations = fetchLocations(inode, index);
+	std::shared_ptr<const ChunkLocationInfo> result = locations.at(index);
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		inode_ = inode;
+		cache_ = std::move(locations);
+		cacheAge_.reset();
+	}
+	return result;
+}
+
+static void throw_read_exception(uint8_t status) {
+	if (status == LIZARDFS_ERROR_ENOENT) {
+		throw UnrecoverableReadException("Chunk locator: error sent by master server", status);
+	} else {
+		throw RecoverableReadException("Chunk locator: error sent by master server", status);
+	}
+}
+
+ReadChunkLocator::Cache ReadChunkLocator::fetchLocations(uint32_t inode, uint32_t index) {
+	Cache result;
 	uint64_t chunkId;
 	uint32_t version;
 	uint64_t fileLength;
@@ -52,15 +80,26 @@ std::shared_ptr<const ChunkLocationInfo> ReadChunkLocator::locateChunk(uint32_t
 	uint8_t status = fs_readchunk(inode, index, &fileLength, &chunkId, &version,
 			&chunkserversData, &chunkserversDataSize);
 #else
+	uint32_t count = chunksToPrefetch;
+	if (count > 1) {
+		std::vector<ChunkWithLocations> chunks;
+		uint8_t status = fs_lizreadchunks(chunks, fileLength, inode, index, count);
+		if (status == LIZARDFS_STATUS_OK) {
+			for (auto &chunk : chunks) {
+				result[index++] = std::make_shared<ChunkLocationInfo>(chunk.chunk_id,
+						chunk.chunk_version, fileLength, std::move(chunk.locations));
+			}
+			return result;
+		} else if (status != LIZARDFS_ERROR_ENOTSUP) {
+			throw_read_exception(status);
+		}
+		// the master doesn't support batched requests, ask for a single chunk
+	}
 	uint8_t status = fs_lizreadchunk(locations, chunkId, version, fileLength, inode, index);
 #endif
 
 	if (status != 0) {
-		if (status == LIZARDFS_ERROR_ENOENT) {
-			throw UnrecoverableReadException("Chunk locator: error sent by master server", status);
-		} else {
-			throw RecoverableReadException("Chunk locator: error sent by master server", status);
-		}
+		throw_read_exception(status);
 	}
 
 #ifdef USE_LEGACY_READ_MESSAGES
@@ -78,13 +117,8 @@ std::shared_ptr<const ChunkLocationInfo> ReadChunkLocator::locateChunk(uint32_t
 		}
 	}
 #endif
-	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		inode_ = inode;
-		index_ = index;
-		cache_ = std::make_shared<ChunkLocationInfo>(chunkId, version, fileLength, locations);
-		return cache_;
-	}
+	result[index] = std::make_shared<ChunkLocationInfo>(chunkId, version, fileLength, locations);
+	return result;
 }
 
 void WriteChunkLocator::locateAndLockChunk(uint32_t inode, uint32_t index) {
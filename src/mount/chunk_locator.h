@@ -20,13 +20,16 @@
 
 #include "common/platform.h"
 
+#include <atomic>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
 
 #include "common/chunk_type_with_address.h"
 #include "common/slogger.h"
+#include "common/time_utils.h"
 
 struct ChunkLocationInfo {
 	typedef std::vector<ChunkTypeWithAddress> ChunkLocations;
@@ -59,21 +62,34 @@ struct ChunkLocationInfo {
 };
 
 // Intended to be instantiated per descriptor.
-// May cache locations of previously queried chunks.
+// Locations of a chunk are fetched from the master together with locations of
+// a few following chunks, which are cached for sequential readers.
 // Thread safe.
 class ReadChunkLocator {
 public:
+	/// Number of chunks located with one request to the master (tweakable).
+	static std::atomic<uint32_t> chunksToPrefetch;
+
+	/// For how long cached locations of prefetched chunks can be used.
+	static constexpr uint32_t kPrefetchedLocationsTimeout_ms = 2000;
+
 	ReadChunkLocator(const ReadChunkLocator&) = delete;
-	ReadChunkLocator() {}
+	ReadChunkLocator() : inode_(0) {}
 
 	std::shared_ptr<const ChunkLocationInfo> locateChunk(uint32_t inode, uint32_t index);
+
+	/// Drops all cached locations, eg. after a chunkserver reported a wrong chunk version.
 	void invalidateCache(uint32_t inode, uint32_t index);
 
 private:
-	uint32_t inode_;
-	uint32_t index_;
+	typedef std::map<uint32_t, std::shared_ptr<const ChunkLocationInfo>> Cache;
+
+	/// Asks the master for locations of chunk \p index and the following ones.
+	Cache fetchLocations(uint32_t inode, uint32_t index);
 
-	std::shared_ptr<const ChunkLocationInfo> cache_;
+	uint32_t inode_;
+	Cache cache_;
+	Timer cacheAge_;
 	std::mutex mutex_;
 };
 
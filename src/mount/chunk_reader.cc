@@ -44,17 +44,22 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 		return;
 	}
 	++preparations;
+	if (force_prepare) {
+		// locations which we have might be outdated
+		locator_.invalidateCache(inode, index);
+	}
 	inode_ = inode;
 	index_ = index;
-	locator_.invalidateCache(inode, index);
 	location_ = locator_.locateChunk(inode, index);
 	chunkAlreadyRead = false;
 	if (location_->isEmptyChunk()) {
 		return;
 	}
 	chunk_type_locations_.clear();
+	hedge_locations_.clear();
 
 	ChunkReadPlanner::ScoreContainer best_scores;
+	ChunkReadPlanner::ScoreContainer hedge_scores;
 
 	available_parts_.clear();
 	for (const ChunkTypeWithAddress& chunk_type_with_address : location_->locations) {
@@ -73,9 +78,14 @@ void ChunkReader::prepareReadingChunk(uint32_t inode, uint32_t index, bool force
 		} else {
 			// we already know other locations
 			if (score > best_scores[type]) {
-				// this location is better, switch to it
+				// this location is better, switch to it and keep the previous one for hedging
+				hedge_locations_[type] = chunk_type_locations_[type];
+				hedge_scores[type] = best_scores[type];
 				chunk_type_locations_[type] = chunk_type_with_address;
 				best_scores[type] = score;
+			} else if (hedge_locations_.count(type) == 0 || score > hedge_scores[type]) {
+				hedge_locations_[type] = chunk_type_with_address;
+				hedge_scores[type] = score;
 			}
 		}
 	}
@@ -130,7 +140,7 @@ uint32_t ChunkReader::readData(std::vector<uint8_t>& buffer, uint32_t offset, ui
 			chunkAlreadyRead = true;
 			executor.executePlan(buffer, chunk_type_locations_, connector_,
 					connectTimeout_ms, wave_timeout_ms,
-					communicationTimeout);
+					communicationTimeout, &hedge_locations_);
 			//TODO(haze): Improve scoring system so it can deal with disconnected chunkservers.
 		} catch (ChunkCrcException &err) {
 			crcErrors_.push_back(ChunkTypeWithAddress(err.server(), err.chunkType(), 0));
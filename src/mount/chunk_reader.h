@@ -70,6 +70,9 @@ public:
 	uint32_t version() const {
 		return location_->version;
 	}
+	uint64_t fileLength() const {
+		return location_->fileLength;
+	}
 
 	/// Counter for the .lizardfds_tweaks file.
 	static std::atomic<uint64_t> preparations;
@@ -83,6 +86,7 @@ private:
 	ChunkReadPlanner planner_;
 	ReadPlan::PartsContainer available_parts_;
 	ReadPlanExecutor::ChunkTypeLocations chunk_type_locations_;
+	ReadPlanExecutor::ChunkTypeLocations hedge_locations_; // second best locations of parts
 	std::vector<ChunkTypeWithAddress> crcErrors_;
 	bool chunkAlreadyRead;
 };
@@ -23,7 +23,6 @@
 #include <bitset>
 #include <cstring>
 
-#include "common/block_xor.h"
 #include "common/chunk_connector.h"
 #include "common/chunk_read_planner.h"
 #include "common/chunk_type_with_address.h"
@@ -37,6 +36,7 @@
 #include "common/time_utils.h"
 #include "devtools/request_log.h"
 #include "mount/mastercomm.h"
+#include "mount/parity_encoder.h"
 #include "mount/readdata.h"
 
 static uint32_t gcd(uint32_t a, uint32_t b) {
@@ -108,9 +108,10 @@ bool ChunkWriter::Operation::isFullStripe(uint32_t stripeSize) const {
 }
 
 ChunkWriter::ChunkWriter(ChunkserverStats& chunkserverStats, ChunkConnector& connector,
-		int dataChainFd)
+		ParityEncoder& parityEncoder, int dataChainFd)
 	: chunkserverStats_(chunkserverStats),
 	  connector_(connector),
+	  parityEncoder_(parityEncoder),
 	  locator_(nullptr),
 	  idCounter_(0),
 	  acceptsNewOperations_(true),
@@ -178,26 +179,52 @@ uint32_t ChunkWriter::getMinimumBlockCountWorthWriting() {
 
 uint32_t ChunkWriter::startNewOperations(bool can_expect_next_block) {
 	LOG_AVG_TILL_END_OF_SCOPE0("ChunkWriter::startNewOperations");
-	uint32_t operationsStarted = 0;
-	// Start all possible operations. Break at the first operation that can't be started, because
-	// we have to preserve the order of operations in order to ensure the files contain proper data
-	for (auto i = newOperations_.begin(); i != newOperations_.end(); i = newOperations_.erase(i)) {
-		Operation& operation = *i;
-		// Don't start partial-stripe writes if they can be extended in the future.
-		// Only the last one can be expanded and only if we accept new data.
-		if (i == std::prev(newOperations_.end())
-				&& acceptsNewOperations_
-				&& !operation.isFullStripe(combinedStripeSize_)
-				&& can_expect_next_block) {
-			break;
+	std::vector<OperationId> operations;
+	std::vector<ParityEncoder::Stripe> stripes;
+	try {
+		// Start all possible operations. Break at the first operation that can't be started,
+		// because we have to preserve the order of operations in order to ensure the files
+		// contain proper data
+		for (auto i = newOperations_.begin(); i != newOperations_.end(); i = newOperations_.erase(i)) {
+			Operation& operation = *i;
+			// Don't start partial-stripe writes if they can be extended in the future.
+			// Only the last one can be expanded and only if we accept new data.
+			if (i == std::prev(newOperations_.end())
+					&& acceptsNewOperations_
+					&& !operation.isFullStripe(combinedStripeSize_)
+					&& can_expect_next_block) {
+				break;
+			}
+			if (!canStartOperation(operation)) {
+				break;
+			}
+			operations.push_back(prepareOperation(std::move(operation), stripes));
 		}
-		if (!canStartOperation(operation)) {
-			break;
+	} catch (...) {
+		startPreparedOperations(operations, stripes);
+		throw;
+	}
+	startPreparedOperations(operations, stripes);
+	return operations.size();
+}
+
+/*!
+ * Computes parity of the prepared operations and sends them to chunkservers.
+ * Data parts are passed to executors while parity parts are being computed.
+ */
+void ChunkWriter::startPreparedOperations(const std::vector<OperationId> &operations,
+		const std::vector<ParityEncoder::Stripe> &stripes) {
+	if (operations.empty()) {
+		return;
+	}
+	parityEncoder_.encode(stripes, [this, &operations]() {
+		for (OperationId operationId : operations) {
+			addOperationPackets(operationId, false);
 		}
-		startOperation(std::move(operation));
-		++operationsStarted;
+	});
+	for (OperationId operationId : operations) {
+		addOperationPackets(operationId, true);
 	}
-	return operationsStarted;
 }
 
 void ChunkWriter::processOperations(uint32_t msTimeout) {
@@ -354,52 +381,6 @@ bool ChunkWriter::canStartOperation(const Operation& operation) {
 	return true;
 }
 
-/*!
- * Computes parity block value and writes it to memory pointed by parity_block.
- * \param chunk_type type of the chunk
- * \param parity_block address of output buffer
- * \param data_blocks array of pointers to data blocks
- * \param offset index of first block to be computed
- * \param size size of data to be computed
- */
-void ChunkWriter::computeParityBlock(const ChunkPartType &chunk_type, uint8_t *parity_block,
-		const std::vector<uint8_t *> &data_blocks, int offset, int size) {
-	int data_part_count = slice_traits::getNumberOfDataParts(chunk_type);
-	int parity_part_count = slice_traits::getNumberOfParityParts(chunk_type);
-
-	assert(slice_traits::isParityPart(chunk_type));
-	assert(parity_block);
-
-	if (slice_traits::isXor(chunk_type)) {
-		assert(data_blocks[offset]);
-		std::memcpy(parity_block, data_blocks[offset], size);
-		for (int i = 1; i < data_part_count; ++i) {
-			if(data_blocks[offset + i]) {
-				blockXor(parity_block, data_blocks[offset + i], size);
-			}
-		}
-		return;
-	}
-
-	assert(slice_traits::isEC(chunk_type));
-
-	typedef ReedSolomon<slice_traits::ec::kMaxDataCount, slice_traits::ec::kMaxParityCount> RS;
-	RS rs(data_part_count, parity_part_count);
-	RS::ErasedMap erased;
-	RS::ConstFragmentMap data_parts{{0}};
-	RS::FragmentMap result_parts{{0}};
-
-	for (int i = 0; i < parity_part_count; ++i) {
-		erased.set(data_part_count + i);
-	}
-	for (int i = 0; i < data_part_count; ++i) {
-		data_parts[i] = data_blocks[offset + i];
-	}
-	result_parts[chunk_type.getSlicePart()] = parity_block;
-
-	rs.recover(data_parts, erased, result_parts, size);
-}
-
 /*!
  * Fills given operation with a range of blocks required to be read.
  * \param operation operation to be filled
@@ -466,14 +447,18 @@ void ChunkWriter::fillStripe(Operation &operation, int first_block, std::vector<
 }
 
 /*!
- * Starts the write operation.
+ * Prepares the write operation and makes it pending.
  * Firstly, function checks if any blocks need to be read (which may be the case with xor/ec goal).
  * If so, they are fetched from chunkservers and used for computing parity blocks.
- * Afterwards, data is sent to selected chunkservers.
+ * Afterwards, buffers for parity blocks are allocated and stripes to be encoded are appended
+ * to stripes. Packets are passed to executors by addOperationPackets.
  * \param operation operation to be started
+ * \param stripes stripes which have to be encoded before the operation is sent
+ * \return id of the operation
  */
-void ChunkWriter::startOperation(Operation operation) {
-	LOG_AVG_TILL_END_OF_SCOPE0("ChunkWriter::startOperation");
+ChunkWriter::OperationId ChunkWriter::prepareOperation(Operation operation,
+		std::vector<ParityEncoder::Stripe> &stripes) {
+	LOG_AVG_TILL_END_OF_SCOPE0("ChunkWriter::prepareOperation");
 	// If the operation is a partial-stripe write, read all the missing blocks first
 	int first_block = combinedStripeSize_ * (operation.journalPositions.front()->blockIndex / combinedStripeSize_);
 	int block_size = operation.journalPositions.front()->size();
@@ -486,19 +471,71 @@ void ChunkWriter::startOperation(Operation operation) {
 	// Now operation.journalElements is a complete stripe.
 	assert(operation.isFullStripe(combinedStripeSize_));
 
-	// Send all the data
-	std::vector<WriteCacheBlock *> blocks_to_write;
-	std::vector<WriteCacheBlock *> parity_blocks;
+	// Allocate all parity blocks of each slice type which has any parity part written
+	for (auto &fdAndExecutor : executors_) {
+		ChunkPartType chunk_type = fdAndExecutor.second->chunkType();
+		if (!slice_traits::isParityPart(chunk_type) || operation.parityBlocks.count(chunk_type) > 0) {
+			continue;
+		}
+		Goal::Slice::Type slice_type = chunk_type.getSliceType();
+		int data_part_count = slice_traits::getNumberOfDataParts(slice_type);
+		int parity_part_count = slice_traits::getNumberOfParityParts(slice_type);
+		int first_parity_part = slice_traits::isXor(slice_type) ? 0 : data_part_count;
+		// How many stripes of that type fit to combined stripe size
+		int stripe_count = combinedStripeSize_ / data_part_count;
+
+		for (int i = 0; i < stripe_count; ++i) {
+			// Check if any data for computing this parity is available
+			if (!stripe_element[i * data_part_count]) {
+				continue;
+			}
+
+			ParityEncoder::Stripe stripe;
+			stripe.type = slice_type;
+			stripe.size = block_size;
+			for (int j = 0; j < data_part_count; ++j) {
+				stripe.data[j] = stripe_element[i * data_part_count + j];
+			}
+			for (int j = 0; j < parity_part_count; ++j) {
+				operation.parityBuffers.push_back(
+					WriteCacheBlock(locator_->chunkIndex(), 0, WriteCacheBlock::kParityBlock));
+				WriteCacheBlock &block = operation.parityBuffers.back();
+				block.blockIndex = first_block + i * data_part_count;
+				block.from = block_from;
+				block.to = block_to;
+				stripe.parity[j] = block.data();
+				operation.parityBlocks[ChunkPartType(slice_type, first_parity_part + j)].push_back(&block);
+			}
+			stripes.push_back(stripe);
+		}
+	}
 
 	OperationId operationId = allocateId();
+	pendingOperations_[operationId] = std::move(operation);
+	return operationId;
+}
+
+/*!
+ * Passes blocks of a prepared operation to executors of data parts or parity parts.
+ * \param operationId id of the operation
+ * \param parity if true, only parity parts are sent, data parts otherwise
+ */
+void ChunkWriter::addOperationPackets(OperationId operationId, bool parity) {
+	LOG_AVG_TILL_END_OF_SCOPE0("ChunkWriter::addOperationPackets");
+	Operation &operation = pendingOperations_.at(operationId);
+	std::vector<WriteCacheBlock *> blocks_to_write;
+
 	for (auto &fdAndExecutor : executors_) {
 		WriteExecutor &executor = *fdAndExecutor.second;
 		ChunkPartType chunk_type = executor.chunkType();
 		int data_part_count = slice_traits::getNumberOfDataParts(chunk_type);
 
+		if (slice_traits::isParityPart(chunk_type) != parity) {
+			continue;
+		}
 		blocks_to_write.clear();
 
-		if (slice_traits::isDataPart(chunk_type)) {
+		if (!parity) {
 			unsigned part_index = slice_traits::getDataPartIndex(chunk_type);
 
 			for (const JournalPosition &position : operation.journalPositions) {
@@ -508,34 +545,13 @@ void ChunkWriter::startOperation(Operation operation) {
 				}
 			}
 		} else {
-			// How many stripes of that type fit to combined stripe size
-			int stripe_count = combinedStripeSize_ / data_part_count;
-
-			parity_blocks.clear();
-			for (int i = 0; i < stripe_count; ++i) {
-				// Check if any data for computing this parity is available
-				if (!stripe_element[i * data_part_count]) {
-					continue;
-				}
-
-				operation.parityBuffers.push_back(
-					WriteCacheBlock(locator_->chunkIndex(), 0, WriteCacheBlock::kParityBlock));
-				WriteCacheBlock &block = operation.parityBuffers.back();
-				parity_blocks.push_back(&block);
-				blocks_to_write.push_back(&block);
-				block.blockIndex = first_block + i * data_part_count;
-				block.from = block_from;
-				block.to = block_to;
-			}
-
-			for (int i = 0; i < (int)parity_blocks.size(); ++i) {
-				computeParityBlock(chunk_type, parity_blocks[i]->data(), stripe_element,
-				                   i * data_part_count, block_size);
+			auto it = operation.parityBlocks.find(chunk_type);
+			if (it != operation.parityBlocks.end()) {
+				blocks_to_write = it->second;
 			}
 		}
 
 		for (const WriteCacheBlock *block : blocks_to_write) {
-			LOG_AVG_TILL_END_OF_SCOPE0("ChunkWriter::startOperation::addDataPackets");
 			WriteId writeId = allocateId();
 			writeIdToOperationId_[writeId] = operationId;
 			executor.addDataPacket(writeId, block->blockIndex / data_part_count, block->from,
@@ -543,7 +559,6 @@ void ChunkWriter::startOperation(Operation operation) {
 			++operation.unfinishedWrites;
 		}
 	}
-	pendingOperations_[operationId] = std::move(operation);
 }
 
 /*!
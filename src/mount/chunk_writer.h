@@ -29,6 +29,7 @@
 #include "common/chunk_type_with_address.h"
 #include "common/write_executor.h"
 #include "mount/chunk_locator.h"
+#include "mount/parity_encoder.h"
 #include "mount/write_cache_block.h"
 
 class ChunkserverStats;
@@ -42,10 +43,12 @@ public:
 	 * \param stats - database which will be updated by the object when accessing servers
 	 * \param connector - object that will be used to create connection with chunkservers
 	 *        to write to them and read from them
+	 * \param parityEncoder - object that will be used to compute parity parts of xor/ec chunks
 	 * \param dataChainFd - end of pipe; if anything is written to it, ChunkWriter will break its
 	 *        poll call and look for some new data in write cache for the currently written chunk
 	 */
-	ChunkWriter(ChunkserverStats& stats, ChunkConnector& connector, int dataChainFd);
+	ChunkWriter(ChunkserverStats& stats, ChunkConnector& connector, ParityEncoder& parityEncoder,
+			int dataChainFd);
 	ChunkWriter(const ChunkWriter&) = delete;
 	~ChunkWriter();
 	ChunkWriter& operator=(const ChunkWriter&) = delete;
@@ -135,6 +138,8 @@ private:
 	public:
 		std::vector<JournalPosition> journalPositions;  // stripe in the written journal
 		std::list<WriteCacheBlock> parityBuffers;       // memory for parity blocks
+		// parity blocks (stored in parityBuffers) to be written to each parity part
+		std::map<ChunkPartType, std::vector<WriteCacheBlock *>> parityBlocks;
 		uint32_t unfinishedWrites;                      // number of write request sent
 		uint64_t offsetOfEnd;                           // offset in the file
 
@@ -169,6 +174,7 @@ private:
 
 	ChunkserverStats& chunkserverStats_;
 	ChunkConnector& connector_;
+	ParityEncoder& parityEncoder_;
 	WriteChunkLocator* locator_;
 	uint32_t idCounter_;
 	bool acceptsNewOperations_;
@@ -182,14 +188,15 @@ private:
 	std::map<OperationId, Operation> pendingOperations_;
 
 	bool canStartOperation(const Operation& operation);
-	void startOperation(Operation operation);
+	OperationId prepareOperation(Operation operation, std::vector<ParityEncoder::Stripe> &stripes);
+	void addOperationPackets(OperationId operationId, bool parity);
+	void startPreparedOperations(const std::vector<OperationId> &operations,
+			const std::vector<ParityEncoder::Stripe> &stripes);
 	void fillOperation(Operation &operation, int first_block, int first_index, int size,
 			std::vector<uint8_t *> &stripe_element);
 	void fillStripe(Operation &operation, int first_block, std::vector<uint8_t *> &stripe_element);
 	void readBlocks(int block_index, int size, int block_from, int block_to,
 			std::vector<WriteCacheBlock> &blocks);
-	void computeParityBlock(const ChunkPartType &chunk_type, uint8_t *parity_block,
-			const std::vector<uint8_t *> &data_blocks, int offset, int size);
 
 	void processStatus(const WriteExecutor& executor, const WriteExecutor::Status& status);
 	uint32_t allocateId() {
@@ -29,6 +29,7 @@ enum {
 	OP_LOOKUP,
 	OP_LOOKUP_INTERNAL,
 	OP_DIRCACHE_LOOKUP,
+	OP_DIRCACHE_NEGATIVE_LOOKUP,
 	OP_GETATTR,
 	OP_DIRCACHE_GETATTR,
 	OP_SETATTR,
@@ -60,6 +61,7 @@ enum {
 	OP_REMOVEXATTR,
 	OP_GETDIR_FULL,
 	OP_GETDIR_SMALL,
+	OP_GETDIR_PREFETCH,
 	OP_GETLK,
 	OP_SETLK,
 	OP_FLOCK,
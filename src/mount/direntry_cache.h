@@ -19,6 +19,7 @@
 #include "common/platform.h"
 
 #include <atomic>
+#include <map>
 
 #include "common/attributes.h"
 #include "common/shared_mutex.h"
@@ -36,6 +37,11 @@
  *   - fast lookup by parent inode + entry index
  *   - fast lookup by inode
  *   - fast removal of oldest entries
+ *   - negative entries for names known not to exist in a directory
+ *
+ * Negative entries have inode 0 and an index with kNegativeEntryIndexFlag set, so they never
+ * take part in readdir sequences. A name is also known not to exist if its directory has a
+ * complete listing in cache (see markComplete).
  *
  * \warning Only explicitly specified methods are thread safe.
  */
@@ -266,6 +272,30 @@ public:
 		return true;
 	}
 
+	/*! \brief Check if directory entry is known not to exist.
+	 *
+	 * \warning This function takes read (shared) lock.
+	 *
+	 * \param ctx Process credentials.
+	 * \param parent_inode Parent node index (inode).
+	 * \param name Name of directory entry to find.
+	 *
+	 * \return True if there is a valid negative entry for the name or a valid complete listing
+	 *         of the directory without it, false otherwise.
+	 */
+	bool lookupNegative(const LizardClient::Context &ctx, uint32_t parent_inode,
+	                    const std::string &name) {
+		shared_lock<SharedMutex> guard(rwlock_);
+		updateTime();
+		auto it = find(ctx, parent_inode, name);
+		if (it != lookup_set_.end()) {
+			return !expired(*it, current_time_) && isNegative(*it);
+		}
+		auto listing_it = complete_listings_.find(std::make_tuple(parent_inode, ctx.uid, ctx.gid));
+		return listing_it != complete_listings_.end() &&
+		       listing_it->second + timeout_ > current_time_;
+	}
+
 	/*! \brief Get attributes of directory entry.
 	 *
 	 * \warning This function takes read (shared) lock.
@@ -321,6 +351,78 @@ public:
 		addEntry(ctx, parent_inode, inode, index, next_index, name, attr, timestamp);
 	}
 
+	/*! \brief Add information that directory entry does not exist to cache.
+	 *
+	 * \param ctx Process credentials.
+	 * \param parent_inode Parent node index (inode).
+	 * \param name Name of nonexistent directory entry.
+	 * \param timestamp Time when data has been obtained (used for entry timeout).
+	 */
+	void insertNegative(const LizardClient::Context &ctx, uint32_t parent_inode,
+	                    const std::string &name, uint64_t timestamp) {
+		// Avoid inserting stale data and data older than the last change of a directory
+		if (timestamp + timeout_ <= current_time_ || timestamp <= last_invalidation_time_) {
+			return;
+		}
+		removeExpired(1, timestamp);
+		auto lookup_it = find(ctx, parent_inode, name);
+		if (lookup_it != lookup_set_.end()) {
+			erase(std::addressof(*lookup_it));
+		}
+		uint64_t index = kNegativeEntryIndexFlag | next_negative_index_++;
+		addEntry(ctx, parent_inode, 0, index, index, name, Attributes{{}}, timestamp);
+	}
+
+	/*! \brief Mark that cache contains all entries of a directory.
+	 *
+	 * Names missing in a complete listing are reported by lookupNegative. The mark is removed
+	 * together with any entry of the listing.
+	 *
+	 * \param ctx Process credentials.
+	 * \param parent_inode Parent node index (inode).
+	 * \param timestamp Time when the listing has been obtained.
+	 */
+	void markComplete(const LizardClient::Context &ctx, uint32_t parent_inode,
+	                  uint64_t timestamp) {
+		if (timestamp + timeout_ <= current_time_ || timestamp <= last_invalidation_time_) {
+			return;
+		}
+		complete_listings_[std::make_tuple(parent_inode, ctx.uid, ctx.gid)] = timestamp;
+	}
+
+	/*! \brief Count lookups in a directory which were not answered from cache.
+	 *
+	 * \warning This function takes write (unique) lock.
+	 *
+	 * \param ctx Process credentials.
+	 * \param parent_inode Parent node index (inode).
+	 *
+	 * \return Number of such lookups (including this one) since the first one that happened
+	 *         less than cache timeout ago.
+	 */
+	uint32_t recordLookupMiss(const LizardClient::Context &ctx, uint32_t parent_inode) {
+		std::unique_lock<SharedMutex> guard(rwlock_);
+		updateTime();
+		if (lookup_misses_.size() >= kMaxLookupMissRecords) {
+			for (auto it = lookup_misses_.begin(); it != lookup_misses_.end();) {
+				if (it->second.first + timeout_ <= current_time_) {
+					it = lookup_misses_.erase(it);
+				} else {
+					++it;
+				}
+			}
+			if (lookup_misses_.size() >= kMaxLookupMissRecords) {
+				lookup_misses_.clear();
+			}
+		}
+		auto &misses = lookup_misses_[std::make_tuple(parent_inode, ctx.uid, ctx.gid)];
+		if (misses.second == 0 || misses.first + timeout_ <= current_time_) {
+			misses.first = current_time_;
+			misses.second = 0;
+		}
+		return ++misses.second;
+	}
+
 	/*! \brief Add data to cache from container.
 	 *
 	 * \param ctx Process credentials.
@@ -406,6 +508,7 @@ public:
 	 */
 	void lockAndInvalidateParent(uint32_t parent_inode) {
 		std::unique_lock<SharedMutex> guard(rwlock_);
+		last_invalidation_time_ = updateTime();
 		auto it = index_set_.lower_bound(std::make_tuple(parent_inode, 0, 0, 0),
 		                                 IndexCompare());
 		while (it != index_set_.end() && it->parent_inode == parent_inode) {
@@ -416,6 +519,9 @@ public:
 	}
 
 	/*! \brief Remove data from cache matching specified criteria.
+	 *
+	 * Negative entries and complete listings of the parent are removed for all credentials,
+	 * as a new entry could have been created.
 	 *
 	 * \warning This function takes write (unique) lock.
 	 *
@@ -424,16 +530,20 @@ public:
 	 */
 	void lockAndInvalidateParent(const LizardClient::Context &ctx, uint32_t parent_inode) {
 		std::unique_lock<SharedMutex> guard(rwlock_);
+		last_invalidation_time_ = updateTime();
 
-		auto it = index_set_.lower_bound(std::make_tuple(parent_inode, ctx.uid, ctx.gid, 0),
+		auto it = index_set_.lower_bound(std::make_tuple(parent_inode, 0, 0, 0),
 		                                 IndexCompare());
-		while (it != index_set_.end() &&
-		       std::make_tuple(parent_inode, ctx.uid, ctx.gid) ==
-		               std::make_tuple(it->parent_inode, it->uid, it->gid)) {
+		while (it != index_set_.end() && it->parent_inode == parent_inode) {
 			DirEntry *entry = std::addressof(*it);
 			++it;
-			erase(entry);
+			if (isNegative(*entry) || (entry->uid == ctx.uid && entry->gid == ctx.gid)) {
+				erase(entry);
+			}
 		}
+		complete_listings_.erase(
+		        complete_listings_.lower_bound(std::make_tuple(parent_inode, 0, 0)),
+		        complete_listings_.upper_bound(std::make_tuple(parent_inode, UINT32_MAX, UINT32_MAX)));
 	}
 
 	IndexSet::const_iterator index_end() const {
@@ -495,6 +605,8 @@ public:
 	 */
 	void clear() {
 		std::unique_lock<SharedMutex> guard(rwlock_);
+		complete_listings_.clear();
+		lookup_misses_.clear();
 		auto it = fifo_list_.begin();
 		while (it != fifo_list_.end()) {
 			auto next_it = std::next(it);
@@ -518,9 +630,16 @@ protected:
 		index_set_.erase(index_set_.iterator_to(*entry));
 		inode_multiset_.erase(inode_multiset_.iterator_to(*entry));
 		fifo_list_.erase(fifo_list_.iterator_to(*entry));
+		if (!isNegative(*entry) && !complete_listings_.empty()) {
+			complete_listings_.erase(std::make_tuple(entry->parent_inode, entry->uid, entry->gid));
+		}
 		delete entry;
 	}
 
+	static bool isNegative(const DirEntry &entry) {
+		return entry.index & kNegativeEntryIndexFlag;
+	}
+
 	bool expired(const DirEntry &entry, uint64_t timestamp) const {
 		return entry.timestamp + timeout_ <= timestamp;
 	}
@@ -567,6 +686,15 @@ protected:
 	InodeMultiset inode_multiset_;
 	FifoList fifo_list_;
 	SharedMutex rwlock_;
+	/*! Time of listing for directories with all entries in cache, by (parent, uid, gid) */
+	std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint64_t> complete_listings_;
+	/*! First time and number of lookup misses, by (parent, uid, gid) */
+	std::map<std::tuple<uint32_t, uint32_t, uint32_t>, std::pair<uint64_t, uint32_t>> lookup_misses_;
+	uint64_t next_negative_index_ = 0;
+	uint64_t last_invalidation_time_ = 0;
 
 	static const int kDefaultTimeout_us = 500000;
+	/*! Indices of directory entries returned by master never have the highest bit set */
+	static constexpr uint64_t kNegativeEntryIndexFlag = UINT64_C(1) << 63;
+	static constexpr size_t kMaxLookupMissRecords = 4096;
 };
@@ -19,8 +19,10 @@
 #include "common/platform.h"
 #include "mount/direntry_cache.h"
 
+#include <chrono>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <thread>
 
 class DirEntryCacheIntrospect : public DirEntryCache {
 public:
@@ -216,3 +218,106 @@ TEST(DirEntryCache, RandomOrder) {
 	}
 	ASSERT_TRUE(lookup_output_it == lookup_output.end());
 }
+
+TEST(DirEntryCache, NegativeEntries) {
+	DirEntryCacheIntrospect cache(5000000);
+	LizardClient::Context ctx(0, 0, 0, 0), other_ctx(1, 1, 0, 0);
+	uint32_t inode;
+	Attributes attr;
+	Attributes dummy_attributes;
+	dummy_attributes.fill(0);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	auto current_time = cache.updateTime();
+	cache.insertSequence(ctx, 9, std::vector<DirectoryEntry>{
+		{0, 1, 7, "a1", dummy_attributes},
+		{1, 2, 8, "a2", dummy_attributes}
+	}, current_time);
+	cache.insertNegative(ctx, 9, "b1", current_time);
+	cache.insertNegative(ctx, 9, "b2", current_time);
+	cache.insertNegative(other_ctx, 9, "b1", current_time);
+	EXPECT_EQ(5U, cache.size());
+	EXPECT_TRUE(cache.lookupNegative(ctx, 9, "b1"));
+	EXPECT_FALSE(cache.lookup(ctx, 9, "b1", inode, attr));
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "a1"));
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b3"));
+	EXPECT_FALSE(cache.lookupNegative(ctx, 10, "b1"));
+
+	// negative entries are not a part of directory listing
+	auto it = cache.find(ctx, 9, 0);
+	ASSERT_TRUE(cache.isValid(it));
+	EXPECT_EQ(1U, it->next_index);
+	++it;
+	ASSERT_TRUE(cache.isValid(it));
+	EXPECT_EQ("a2", it->name);
+	++it;
+	ASSERT_TRUE(cache.isValid(it));
+	EXPECT_EQ(0U, it->inode);
+	EXPECT_NE(it->index, 2U);
+
+	// a newer listing replaces negative entries
+	cache.insertSequence(ctx, 9, std::vector<DirectoryEntry>{{2, 3, 9, "b2", dummy_attributes}},
+			current_time);
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b2"));
+	EXPECT_TRUE(cache.lookup(ctx, 9, "b2", inode, attr));
+	EXPECT_EQ(9U, inode);
+
+	// creating an entry drops negative entries of all users
+	cache.lockAndInvalidateParent(ctx, 9);
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b1"));
+	EXPECT_FALSE(cache.lookupNegative(other_ctx, 9, "b1"));
+	EXPECT_EQ(0U, cache.size());
+
+	// lookups which started before the change are not cached
+	cache.insertNegative(ctx, 9, "b1", current_time);
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b1"));
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	cache.insertNegative(ctx, 9, "b1", cache.updateTime());
+	EXPECT_TRUE(cache.lookupNegative(ctx, 9, "b1"));
+}
+
+TEST(DirEntryCache, CompleteListing) {
+	DirEntryCacheIntrospect cache(5000000);
+	LizardClient::Context ctx(0, 0, 0, 0), other_ctx(1, 1, 0, 0);
+	Attributes dummy_attributes;
+	dummy_attributes.fill(0);
+
+	EXPECT_EQ(1U, cache.recordLookupMiss(ctx, 9));
+	EXPECT_EQ(2U, cache.recordLookupMiss(ctx, 9));
+	EXPECT_EQ(1U, cache.recordLookupMiss(other_ctx, 9));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	auto current_time = cache.updateTime();
+	cache.insertSequence(ctx, 9, std::vector<DirectoryEntry>{
+		{0, 1, 7, "a1", dummy_attributes},
+		{1, 2, 8, "a2", dummy_attributes}
+	}, current_time);
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b1"));
+	cache.markComplete(ctx, 9, current_time);
+	EXPECT_TRUE(cache.lookupNegative(ctx, 9, "b1"));
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "a1"));
+	EXPECT_FALSE(cache.lookupNegative(other_ctx, 9, "b1"));
+
+	// the listing is no longer complete when any of its entries is removed
+	cache.removeOldest(1);
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b1"));
+
+	cache.markComplete(ctx, 9, current_time);
+	EXPECT_TRUE(cache.lookupNegative(ctx, 9, "b1"));
+	cache.lockAndInvalidateParent(other_ctx, 9);
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b1"));
+}
+
+TEST(DirEntryCache, NegativeEntriesExpire) {
+	DirEntryCacheIntrospect cache(1000);
+	LizardClient::Context ctx(0, 0, 0, 0);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	cache.insertNegative(ctx, 9, "b1", cache.updateTime());
+	EXPECT_TRUE(cache.lookupNegative(ctx, 9, "b1"));
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	EXPECT_FALSE(cache.lookupNegative(ctx, 9, "b1"));
+	EXPECT_EQ(1U, cache.recordLookupMiss(ctx, 9));
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	EXPECT_EQ(1U, cache.recordLookupMiss(ctx, 9));
+}
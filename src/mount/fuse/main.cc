@@ -48,6 +48,11 @@
 
 static void mfs_fsinit(void *userdata, struct fuse_conn_info *conn);
 
+#if FUSE_VERSION >= 30
+// Size of write requests sent by the kernel when writeback cache is enabled
+static constexpr unsigned kWritebackCacheMaxWrite = 1024 * 1024;
+#endif
+
 static struct fuse_lowlevel_ops mfs_meta_oper;
 
 static struct fuse_lowlevel_ops mfs_oper;
@@ -109,6 +114,24 @@ static void init_fuse_lowlevel_ops() {
 #endif
 }
 
+#if FUSE_VERSION >= 28
+/// Lets the client drop metadata cached by the kernel when the master notifies about changes.
+#if FUSE_VERSION >= 30
+static void set_kernel_cache_invalidators(struct fuse_session *target) {
+#else
+static void set_kernel_cache_invalidators(struct fuse_chan *target) {
+#endif
+	LizardClient::setKernelCacheInvalidators(
+		[target](LizardClient::Inode inode) {
+			// negative offset drops attributes only
+			fuse_lowlevel_notify_inval_inode(target, inode, -1, 0);
+		},
+		[target](LizardClient::Inode parent, const std::string &name) {
+			fuse_lowlevel_notify_inval_entry(target, parent, name.c_str(), name.size());
+		});
+}
+#endif
+
 static void mfs_fsinit(void *userdata, struct fuse_conn_info *conn) {
 	(void)userdata;
 	(void)conn;
@@ -122,6 +145,23 @@ static void mfs_fsinit(void *userdata, struct fuse_conn_info *conn) {
 	fuse_apply_conn_info_opts(conn_opts, conn);
 	conn->want |= FUSE_CAP_POSIX_ACL;
 	conn->want &= ~FUSE_CAP_ATOMIC_O_TRUNC;
+
+	if (gMountOptions.writebackcache && !gMountOptions.meta) {
+		// The kernel keeps size and mtime of files while caching writes and sends mtime
+		// in setattr after writing the data back. Setattr flushes our write cache before
+		// changing mtime on master, so the master ends up with the kernel's mtime. Cached
+		// data is sent in requests up to max_write bytes (libfuse negotiates max_pages
+		// for requests larger than 128KiB).
+		if (conn->capable & FUSE_CAP_WRITEBACK_CACHE) {
+			conn->want |= FUSE_CAP_WRITEBACK_CACHE;
+		} else {
+			lzfs_pretty_syslog(LOG_WARNING, "kernel doesn't support writeback cache");
+		}
+		if (conn->capable & FUSE_CAP_ASYNC_DIO) {
+			conn->want |= FUSE_CAP_ASYNC_DIO;
+		}
+		conn->max_write = kWritebackCacheMaxWrite;
+	}
 #endif
 
 	daemonize_return_status(0);
@@ -237,7 +277,10 @@ static int mainloop(struct fuse_args *args, const char *mountpoint, bool multith
 	params.delayed_init = gMountOptions.delayedinit;
 	params.report_reserved_period = gMountOptions.reportreservedperiod;
 	params.io_retries = gMountOptions.ioretries;
+	params.master_connections = gMountOptions.masterconnections;
 	params.io_limits_config_file = gMountOptions.iolimits ? gMountOptions.iolimits : "";
+	params.local_chunkserver_socket_dir = gMountOptions.localchunkserversocketdir
+			? gMountOptions.localchunkserversocketdir : "";
 	params.bandwidth_overuse = gMountOptions.bandwidthoveruse;
 	params.chunkserver_round_time_ms = gMountOptions.chunkserverrtt;
 	params.chunkserver_connect_timeout_ms = gMountOptions.chunkserverconnectreadto;
@@ -245,18 +288,28 @@ static int mainloop(struct fuse_args *args, const char *mountpoint, bool multith
 	params.total_read_timeout_ms = gMountOptions.chunkservertotalreadto;
 	params.cache_expiration_time_ms = gMountOptions.cacheexpirationtime;
 	params.readahead_max_window_size_kB = gMountOptions.readaheadmaxwindowsize;
+	params.readahead_workers = gMountOptions.readaheadworkers;
+	params.read_cache_size_MB = gMountOptions.readcachesize;
+	params.parallel_chunk_reads = gMountOptions.parallelchunkreads;
 	params.prefetch_xor_stripes = gMountOptions.prefetchxorstripes;
 	params.bandwidth_overuse = gMountOptions.bandwidthoveruse;
 	params.write_cache_size = gMountOptions.writecachesize;
 	params.write_workers = gMountOptions.writeworkers;
+	params.parity_workers = gMountOptions.parityworkers;
 	params.write_window_size = gMountOptions.writewindowsize;
+	params.write_coalesce_delay_ms = gMountOptions.writecoalescedelay;
 	params.chunkserver_write_timeout_ms = gMountOptions.chunkserverwriteto;
 	params.cache_per_inode_percentage = gMountOptions.cachePerInodePercentage;
 	params.keep_cache = gMountOptions.keepcache;
+#if FUSE_VERSION >= 30
+	params.writeback_cache = gMountOptions.writebackcache;
+#endif
 	params.direntry_cache_timeout = gMountOptions.direntrycacheto;
 	params.direntry_cache_size = gMountOptions.direntrycachesize;
+	params.direntry_cache_prefetch = gMountOptions.direntrycacheprefetch;
 	params.entry_cache_timeout = gMountOptions.entrycacheto;
 	params.attr_cache_timeout = gMountOptions.attrcacheto;
+	params.cache_invalidation = gMountOptions.cacheinvalidation;
 	params.mkdir_copy_sgid = gMountOptions.mkdircopysgid;
 	params.sugid_clear_mode = gMountOptions.sugidclearmode;
 	params.use_rw_lock = gMountOptions.rwlock;
@@ -361,6 +414,16 @@ static int mainloop(struct fuse_args *args, const char *mountpoint, bool multith
 	fuse_session_add_chan(se, ch);
 #endif
 
+#if FUSE_VERSION >= 30
+	if (!gMountOptions.meta && gMountOptions.cacheinvalidation) {
+		set_kernel_cache_invalidators(se);
+	}
+#elif FUSE_VERSION >= 28
+	if (!gMountOptions.meta && gMountOptions.cacheinvalidation) {
+		set_kernel_cache_invalidators(ch);
+	}
+#endif
+
 	if (!gMountOptions.debug && !foreground) {
 		setsid();
 		setpgid(0, getpid());
@@ -384,6 +447,9 @@ static int mainloop(struct fuse_args *args, const char *mountpoint, bool multith
 	} else {
 		err = fuse_session_loop(se);
 	}
+	if (!gMountOptions.meta) {
+		LizardClient::setKernelCacheInvalidators(nullptr, nullptr);
+	}
 	fuse_remove_signal_handlers(se);
 #if FUSE_VERSION >= 30
 	fuse_session_unmount(se);
@@ -790,6 +856,8 @@ int main(int argc, char *argv[]) try {
 	free(gMountOptions.subfolder);
 	if (gMountOptions.iolimits)
 		free(gMountOptions.iolimits);
+	if (gMountOptions.localchunkserversocketdir)
+		free(gMountOptions.localchunkserversocketdir);
 #if FUSE_VERSION >= 30
 	if (gDefaultMountpoint && gDefaultMountpoint != fuse_opts.mountpoint)
 		free(gDefaultMountpoint);
@@ -277,9 +277,11 @@ void mfs_access(fuse_req_t req, fuse_ino_t ino, int mask) {
 void mfs_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
 	try {
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto fuseEntryParam = make_fuse_entry_param(
 				LizardClient::lookup(ctx, parent, name));
 		fuse_reply_entry(req, &fuseEntryParam);
+		LizardClient::entry_replied(parent, name, fuseEntryParam.ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -289,8 +291,10 @@ void mfs_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *) {
 	try {
 		// FileInfo not needed, not conducive to optimization
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto a = LizardClient::getattr(ctx, ino);
 		fuse_reply_attr(req, &a.attr, a.attrTimeout);
+		LizardClient::attr_replied(ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -310,8 +314,10 @@ void mfs_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *stbuf, int to_set,
 		static_assert(LIZARDFS_SET_ATTR_MTIME_NOW == FUSE_SET_ATTR_MTIME_NOW, "incompatible");
 #endif
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto a = LizardClient::setattr(ctx, ino, stbuf, to_set);
 		fuse_reply_attr(req, &a.attr, a.attrTimeout);
+		LizardClient::attr_replied(ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -320,9 +326,11 @@ void mfs_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *stbuf, int to_set,
 void mfs_mknod(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, dev_t rdev) {
 	try {
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto fuseEntryParam = make_fuse_entry_param(
 				LizardClient::mknod(ctx, parent, name, mode, rdev));
 		fuse_reply_entry(req, &fuseEntryParam);
+		LizardClient::entry_replied(parent, name, fuseEntryParam.ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -341,9 +349,11 @@ void mfs_unlink(fuse_req_t req, fuse_ino_t parent, const char *name) {
 void mfs_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode) {
 	try {
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto fuseEntryParam = make_fuse_entry_param(
 				LizardClient::mkdir(ctx, parent, name, mode));
 		fuse_reply_entry(req, &fuseEntryParam);
+		LizardClient::entry_replied(parent, name, fuseEntryParam.ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -362,9 +372,11 @@ void mfs_rmdir(fuse_req_t req, fuse_ino_t parent, const char *name) {
 void mfs_symlink(fuse_req_t req, const char *path, fuse_ino_t parent, const char *name) {
 	try {
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto fuseEntryParam = make_fuse_entry_param(
 				LizardClient::symlink(ctx, path, parent, name));
 		fuse_reply_entry(req, &fuseEntryParam);
+		LizardClient::entry_replied(parent, name, fuseEntryParam.ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -400,9 +412,11 @@ void mfs_rename(fuse_req_t req, fuse_ino_t parent, const char *name, fuse_ino_t
 void mfs_link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, const char *newname) {
 	try {
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto fuseEntryParam = make_fuse_entry_param(
 				LizardClient::link(ctx, ino, newparent, newname));
 		fuse_reply_entry(req, &fuseEntryParam);
+		LizardClient::entry_replied(newparent, newname, fuseEntryParam.ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -485,11 +499,13 @@ void mfs_create(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode
 		struct fuse_file_info *fi) {
 	try {
 		auto ctx = get_context(req);
+		uint64_t cacheSequence = LizardClient::cache_invalidation_sequence();
 		auto e = make_fuse_entry_param(LizardClient::create(
 				ctx, parent, name, mode, fuse_file_info_wrapper(fi)));
 		if (fuse_reply_create(req, &e, fi) == -ENOENT) {
 			LizardClient::remove_file_info(fuse_file_info_wrapper(fi));
 		}
+		LizardClient::entry_replied(parent, name, e.ino, cacheSequence);
 	} catch (LizardClient::RequestException& e) {
 		fuse_reply_err(req, e.system_error_code);
 	}
@@ -42,6 +42,7 @@ struct fuse_opt gMfsOptsStage2[] = {
 	MFS_OPT("mfsmaster=%s", masterhost, 0),
 	MFS_OPT("mfsport=%s", masterport, 0),
 	MFS_OPT("mfsbind=%s", bindhost, 0),
+	MFS_OPT("mfsmasterconnections=%u", masterconnections, 0),
 	MFS_OPT("mfssubfolder=%s", subfolder, 0),
 	MFS_OPT("mfspassword=%s", password, 0),
 	MFS_OPT("askpassword", passwordask, 1),
@@ -55,8 +56,10 @@ struct fuse_opt gMfsOptsStage2[] = {
 	MFS_OPT("mfsaclcachesize=%u", aclcachesize, 0),
 	MFS_OPT("mfscacheperinodepercentage=%u", cachePerInodePercentage, 0),
 	MFS_OPT("mfswriteworkers=%u", writeworkers, 0),
+	MFS_OPT("mfsparityworkers=%u", parityworkers, 0),
 	MFS_OPT("mfsioretries=%u", ioretries, 0),
 	MFS_OPT("mfswritewindowsize=%u", writewindowsize, 0),
+	MFS_OPT("mfswritecoalescedelay=%u", writecoalescedelay, 0),
 	MFS_OPT("mfsdebug", debug, 1),
 	MFS_OPT("mfsmeta", meta, 1),
 	MFS_OPT("mfsdelayedinit", delayedinit, 1),
@@ -70,20 +73,26 @@ struct fuse_opt gMfsOptsStage2[] = {
 	MFS_OPT("mfsattrcacheto=%lf", attrcacheto, 0),
 	MFS_OPT("mfsentrycacheto=%lf", entrycacheto, 0),
 	MFS_OPT("mfsdirentrycacheto=%lf", direntrycacheto, 0),
+	MFS_OPT("mfscacheinvalidation", cacheinvalidation, 1),
 	MFS_OPT("mfsaclcacheto=%lf", aclcacheto, 0),
 	MFS_OPT("mfsreportreservedperiod=%u", reportreservedperiod, 0),
 	MFS_OPT("mfsiolimits=%s", iolimits, 0),
+	MFS_OPT("mfslocalchunkserversocketdir=%s", localchunkserversocketdir, 0),
 	MFS_OPT("mfschunkserverrtt=%d", chunkserverrtt, 0),
 	MFS_OPT("mfschunkserverconnectreadto=%d", chunkserverconnectreadto, 0),
 	MFS_OPT("mfschunkserverwavereadto=%d", chunkserverwavereadto, 0),
 	MFS_OPT("mfschunkservertotalreadto=%d", chunkservertotalreadto, 0),
 	MFS_OPT("cacheexpirationtime=%d", cacheexpirationtime, 0),
 	MFS_OPT("readaheadmaxwindowsize=%d", readaheadmaxwindowsize, 4096),
+	MFS_OPT("mfsreadaheadworkers=%u", readaheadworkers, 0),
+	MFS_OPT("mfsreadcachesize=%u", readcachesize, 0),
+	MFS_OPT("mfsparallelchunkreads=%u", parallelchunkreads, 0),
 	MFS_OPT("mfsprefetchxorstripes", prefetchxorstripes, 1),
 	MFS_OPT("mfschunkserverwriteto=%d", chunkserverwriteto, 0),
 	MFS_OPT("symlinkcachetimeout=%d", symlinkcachetimeout, 3600),
 	MFS_OPT("bandwidthoveruse=%lf", bandwidthoveruse, 1),
 	MFS_OPT("mfsdirentrycachesize=%u", direntrycachesize, 0),
+	MFS_OPT("mfsdirentrycacheprefetch=%u", direntrycacheprefetch, 0),
 	MFS_OPT("nostdmountoptions", nostdmountoptions, 1),
 
 #if FUSE_VERSION >= 26
@@ -91,6 +100,7 @@ struct fuse_opt gMfsOptsStage2[] = {
 #endif
 #if FUSE_VERSION >= 30
 	MFS_OPT("nonempty", nonemptymount, 1),
+	MFS_OPT("mfswritebackcache", writebackcache, 1),
 #endif
 
 	FUSE_OPT_KEY("-m",             KEY_META),
@@ -171,6 +181,12 @@ printf(
 				"(default: %.2f)\n"
 "    -o mfsdirentrycachesize=N   define directory entry cache size in number "
 				"of entries (default: %u)\n"
+"    -o mfsdirentrycacheprefetch=N  read whole directory into directory entry "
+				"cache after N lookups in it missed the cache, 0 disables "
+				"(default: %u)\n"
+"    -o mfscacheinvalidation     get notifications about changes of cached "
+				"metadata from master, which allows using long "
+				"cache timeouts\n"
 "    -o mfsaclcacheto=SEC        set ACL cache timeout in seconds (default: %.2f)\n"
 "    -o mfsreportreservedperiod=SEC  set reporting reserved inodes interval in "
 				"seconds (default: %u)\n"
@@ -190,6 +206,12 @@ printf(
 				"cache) (default: %u)\n"
 "    -o readaheadmaxwindowsize=KB  set max value of readahead window per single "
 				"descriptor in kibibytes (default: %u)\n"
+"    -o mfsreadaheadworkers=N    define number of threads reading ahead in "
+				"background, 0 makes readahead synchronous (default: %u)\n"
+"    -o mfsreadcachesize=N       define size of read cache shared by all "
+				"descriptors in mebibytes, 0 disables it (default: %u)\n"
+"    -o mfsparallelchunkreads=N  define number of threads reading chunks of "
+				"large requests in parallel (default: %u)\n"
 "    -o mfsprefetchxorstripes    prefetch full xor stripe on every first read "
 				"of a xor chunk\n"
 "    -o mfschunkserverwriteto=MSEC  set chunkserver response timeout during "
@@ -206,15 +228,21 @@ printf(
 				"occupied by other inodes can a single inode "
 				"occupy (in %%, default: %u)\n"
 "    -o mfswriteworkers=N        define number of write workers (default: %u)\n"
+"    -o mfsparityworkers=N       define number of threads computing parity of "
+				"xor/ec chunks (default: %u)\n"
 "    -o mfsioretries=N           define number of retries before I/O error is "
 				"returned (default: %u)\n"
 "    -o mfswritewindowsize=N     define write window size (in blocks) for "
 				"each chunk (default: %u)\n"
+"    -o mfswritecoalescedelay=MSEC maximum time for which incomplete blocks and "
+				"stripes wait for more data (default: %u)\n"
 "    -o mfsmaster=HOST           define mfsmaster location (default: mfsmaster)\n"
 "    -o mfsport=PORT             define mfsmaster port number (default: 9421)\n"
 "    -o mfsbind=IP               define source ip address for connections "
 				"(default: NOT DEFINED - chosen automatically "
 				"by OS)\n"
+"    -o mfsmasterconnections=N   define number of connections to mfsmaster "
+				"(default: %u)\n"
 "    -o mfssubfolder=PATH        define subfolder to mount as root (default: %s)\n"
 "    -o mfspassword=PASSWORD     authenticate to mfsmaster with password\n"
 "    -o mfsmd5pass=MD5           authenticate to mfsmaster using directly "
@@ -224,6 +252,9 @@ printf(
 				"secure, but when session is lost then new "
 				"session is created without password\n"
 "    -o mfsiolimits=FILE         define I/O limits configuration file\n"
+"    -o mfslocalchunkserversocketdir=DIR  connect chunkservers running on "
+				"this host with UNIX sockets from DIR (their "
+				"CSSERV_LOCAL_SOCKET_DIR) instead of TCP\n"
 "    -o symlinkcachetimeout=N    define timeout of symlink cache in seconds "
 				"(default: %u)\n"
 "    -o bandwidthoveruse=N       define ratio of allowed bandwidth overuse "
@@ -234,6 +265,9 @@ printf(
 #endif
 #if FUSE_VERSION >= 30
 "    -o nonempty                 allow mounts over non-empty file/dir\n"
+"    -o mfswritebackcache        let the kernel cache writes and send them in "
+				"large requests, and send direct I/O "
+				"asynchronously\n"
 #endif
 "\n",
 		LizardClient::FsInitParams::kDefaultUseRwLock,
@@ -243,6 +277,7 @@ printf(
 		LizardClient::FsInitParams::kDefaultEntryCacheTimeout,
 		LizardClient::FsInitParams::kDefaultDirentryCacheTimeout,
 		LizardClient::FsInitParams::kDefaultDirentryCacheSize,
+		LizardClient::FsInitParams::kDefaultDirentryCachePrefetch,
 		LizardClient::FsInitParams::kDefaultAclCacheTimeout,
 		LizardClient::FsInitParams::kDefaultReportReservedPeriod,
 		LizardClient::FsInitParams::kDefaultRoundTime,
@@ -251,13 +286,19 @@ printf(
 		LizardClient::FsInitParams::kDefaultChunkserverTotalReadTo,
 		LizardClient::FsInitParams::kDefaultCacheExpirationTime,
 		LizardClient::FsInitParams::kDefaultReadaheadMaxWindowSize,
+		LizardClient::FsInitParams::kDefaultReadaheadWorkers,
+		LizardClient::FsInitParams::kDefaultReadCacheSize,
+		LizardClient::FsInitParams::kDefaultParallelChunkReads,
 		LizardClient::FsInitParams::kDefaultChunkserverWriteTo,
 		LizardClient::FsInitParams::kDefaultWriteCacheSize,
 		LizardClient::FsInitParams::kDefaultAclCacheSize,
 		LizardClient::FsInitParams::kDefaultCachePerInodePercentage,
 		LizardClient::FsInitParams::kDefaultWriteWorkers,
+		LizardClient::FsInitParams::kDefaultParityWorkers,
 		LizardClient::FsInitParams::kDefaultIoRetries,
 		LizardClient::FsInitParams::kDefaultWriteWindowSize,
+		LizardClient::FsInitParams::kDefaultWriteCoalesceDelay,
+		LizardClient::FsInitParams::kDefaultMasterConnections,
 		LizardClient::FsInitParams::kDefaultSubfolder,
 		LizardClient::FsInitParams::kDefaultSymlinkCacheTimeout,
 		LizardClient::FsInitParams::kDefaultBandwidthOveruse
@@ -94,14 +94,20 @@ struct mfsopts_ {
 	unsigned writecachesize;
 	unsigned cachePerInodePercentage;
 	unsigned writeworkers;
+	unsigned parityworkers;
 	unsigned ioretries;
+	unsigned masterconnections;
 	unsigned writewindowsize;
+	unsigned writecoalescedelay;
 	double attrcacheto;
 	double entrycacheto;
 	double direntrycacheto;
 	unsigned direntrycachesize;
+	unsigned direntrycacheprefetch;
+	int cacheinvalidation;
 	unsigned reportreservedperiod;
 	char *iolimits;
+	char *localchunkserversocketdir;
 	int chunkserverrtt;
 	int chunkserverconnectreadto;
 	int chunkserverwavereadto;
@@ -109,11 +115,15 @@ struct mfsopts_ {
 	int chunkserverwriteto;
 	int cacheexpirationtime;
 	int readaheadmaxwindowsize;
+	unsigned readaheadworkers;
+	unsigned readcachesize;
+	unsigned parallelchunkreads;
 	int prefetchxorstripes;
 	unsigned symlinkcachetimeout;
 	double bandwidthoveruse;
 #if FUSE_VERSION >= 30
 	int nonemptymount;
+	int writebackcache;
 #endif
 
 	mfsopts_()
@@ -150,14 +160,20 @@ struct mfsopts_ {
 		writecachesize(LizardClient::FsInitParams::kDefaultWriteCacheSize),
 		cachePerInodePercentage(LizardClient::FsInitParams::kDefaultCachePerInodePercentage),
 		writeworkers(LizardClient::FsInitParams::kDefaultWriteWorkers),
+		parityworkers(LizardClient::FsInitParams::kDefaultParityWorkers),
 		ioretries(LizardClient::FsInitParams::kDefaultIoRetries),
+		masterconnections(LizardClient::FsInitParams::kDefaultMasterConnections),
 		writewindowsize(LizardClient::FsInitParams::kDefaultWriteWindowSize),
+		writecoalescedelay(LizardClient::FsInitParams::kDefaultWriteCoalesceDelay),
 		attrcacheto(LizardClient::FsInitParams::kDefaultAttrCacheTimeout),
 		entrycacheto(LizardClient::FsInitParams::kDefaultEntryCacheTimeout),
 		direntrycacheto(LizardClient::FsInitParams::kDefaultDirentryCacheTimeout),
 		direntrycachesize(LizardClient::FsInitParams::kDefaultDirentryCacheSize),
+		direntrycacheprefetch(LizardClient::FsInitParams::kDefaultDirentryCachePrefetch),
+		cacheinvalidation(LizardClient::FsInitParams::kDefaultCacheInvalidation),
 		reportreservedperiod(LizardClient::FsInitParams::kDefaultReportReservedPeriod),
 		iolimits(NULL),
+		localchunkserversocketdir(NULL),
 		chunkserverrtt(LizardClient::FsInitParams::kDefaultRoundTime),
 		chunkserverconnectreadto(LizardClient::FsInitParams::kDefaultChunkserverConnectTo),
 		chunkserverwavereadto(LizardClient::FsInitParams::kDefaultChunkserverWaveReadTo),
@@ -165,11 +181,15 @@ struct mfsopts_ {
 		chunkserverwriteto(LizardClient::FsInitParams::kDefaultChunkserverWriteTo),
 		cacheexpirationtime(LizardClient::FsInitParams::kDefaultCacheExpirationTime),
 		readaheadmaxwindowsize(LizardClient::FsInitParams::kDefaultReadaheadMaxWindowSize),
+		readaheadworkers(LizardClient::FsInitParams::kDefaultReadaheadWorkers),
+		readcachesize(LizardClient::FsInitParams::kDefaultReadCacheSize),
+		parallelchunkreads(LizardClient::FsInitParams::kDefaultParallelChunkReads),
 		prefetchxorstripes(LizardClient::FsInitParams::kDefaultPrefetchXorStripes),
 		symlinkcachetimeout(LizardClient::FsInitParams::kDefaultSymlinkCacheTimeout),
 		bandwidthoveruse(LizardClient::FsInitParams::kDefaultBandwidthOveruse)
 #if FUSE_VERSION >= 30
 		, nonemptymount(LizardClient::FsInitParams::kDefaultNonEmptyMounts)
+		, writebackcache(LizardClient::FsInitParams::kDefaultWritebackCache)
 #endif
 	{ }
 };
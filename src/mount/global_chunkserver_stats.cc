@@ -19,4 +19,36 @@
 #include "common/platform.h"
 #include "mount/global_chunkserver_stats.h"
 
+#include <algorithm>
+#include <cstdio>
+
 ChunkserverStats globalChunkserverStats;
+
+std::string global_chunkserver_stats_show() {
+	auto entries = globalChunkserverStats.getAllStatistics();
+	std::sort(entries.begin(), entries.end(),
+			[](const std::pair<NetworkAddress, ChunkserverStats::ChunkserverEntry>& a,
+			   const std::pair<NetworkAddress, ChunkserverStats::ChunkserverEntry>& b) {
+				return a.first < b.first;
+			});
+	std::string result;
+	for (const auto& entry : entries) {
+		std::string prefix = "chunkservers." + entry.first.toString() + ".";
+		const ChunkserverStats::ChunkserverEntry& stats = entry.second;
+		char score[32];
+		snprintf(score, sizeof(score), "%.3f", stats.score());
+		result += prefix + "pending_reads: " + std::to_string(stats.pendingReads()) + "\n";
+		result += prefix + "pending_writes: " + std::to_string(stats.pendingWrites()) + "\n";
+		result += prefix + "defects: " + std::to_string(stats.defects()) + "\n";
+		result += prefix + "read_block_time_us: "
+				+ std::to_string((uint64_t)stats.readBlockTime_us()) + "\n";
+		result += prefix + "write_block_time_us: "
+				+ std::to_string((uint64_t)stats.writeBlockTime_us()) + "\n";
+		result += prefix + "read_throughput: "
+				+ std::to_string((uint64_t)stats.readThroughput()) + "\n";
+		result += prefix + "write_throughput: "
+				+ std::to_string((uint64_t)stats.writeThroughput()) + "\n";
+		result += prefix + "score: " + score + "\n";
+	}
+	return result;
+}
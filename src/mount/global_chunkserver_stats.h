@@ -20,7 +20,12 @@
 
 #include "common/platform.h"
 
+#include <string>
+
 #include "common/chunkserver_stats.h"
 
 // global chunkserver statistics for this mount instance
 extern ChunkserverStats globalChunkserverStats;
+
+// statistics of all known chunkservers in the format of the .stats file
+std::string global_chunkserver_stats_show();
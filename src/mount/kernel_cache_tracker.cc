@@ -0,0 +1,139 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/kernel_cache_tracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+constexpr uint32_t KernelCacheTracker::kSequenceSlots;
+
+KernelCacheTracker::KernelCacheTracker(size_t capacity)
+		: mutex_(),
+		  sequence_(0),
+		  resetSequence_(0),
+		  sequences_(),
+		  inodes_(),
+		  entries_(),
+		  capacity_(capacity),
+		  lastCleanup_(SteadyClock::now()) {
+}
+
+uint64_t KernelCacheTracker::sequence() const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return sequence_;
+}
+
+double KernelCacheTracker::attrTimeout(uint32_t inode, uint64_t sequence, double timeout,
+		double default_timeout) {
+	if (timeout <= default_timeout) {
+		return timeout;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	SteadyTimePoint now = SteadyClock::now();
+	if (invalidatedSince(inode, sequence) || !makeRoom(now)) {
+		return default_timeout;
+	}
+	SteadyTimePoint end = now + std::chrono::duration_cast<SteadyDuration>(
+			std::chrono::duration<double>(timeout));
+	SteadyTimePoint &current = inodes_[inode];
+	current = std::max(current, end);
+	return timeout;
+}
+
+double KernelCacheTracker::entryTimeout(uint32_t parent, const std::string &name,
+		uint64_t sequence, double timeout, double default_timeout) {
+	if (timeout <= default_timeout) {
+		return timeout;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	SteadyTimePoint now = SteadyClock::now();
+	if (invalidatedSince(parent, sequence) || !makeRoom(now)) {
+		return default_timeout;
+	}
+	SteadyTimePoint end = now + std::chrono::duration_cast<SteadyDuration>(
+			std::chrono::duration<double>(timeout));
+	SteadyTimePoint &current = entries_[EntryKey(parent, name)];
+	current = std::max(current, end);
+	return timeout;
+}
+
+bool KernelCacheTracker::changedSince(uint32_t inode, uint64_t sequence) const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return invalidatedSince(inode, sequence);
+}
+
+void KernelCacheTracker::inodeInvalidated(uint32_t inode) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	sequences_[inode % kSequenceSlots] = ++sequence_;
+	inodes_.erase(inode);
+}
+
+void KernelCacheTracker::entryInvalidated(uint32_t parent, const std::string &name) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	sequences_[parent % kSequenceSlots] = ++sequence_;
+	entries_.erase(EntryKey(parent, name));
+}
+
+void KernelCacheTracker::reset(std::vector<uint32_t> &inodes,
+		std::vector<NamedInodeEntry> &entries) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	resetSequence_ = ++sequence_;
+	SteadyTimePoint now = SteadyClock::now();
+	for (const auto &inode : inodes_) {
+		if (inode.second > now) {
+			inodes.push_back(inode.first);
+		}
+	}
+	for (const auto &entry : entries_) {
+		if (entry.second > now) {
+			entries.emplace_back(entry.first.second, entry.first.first);
+		}
+	}
+	inodes_.clear();
+	entries_.clear();
+}
+
+size_t KernelCacheTracker::size() const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return inodes_.size() + entries_.size();
+}
+
+bool KernelCacheTracker::invalidatedSince(uint32_t inode, uint64_t sequence) const {
+	return resetSequence_ > sequence || sequences_[inode % kSequenceSlots] > sequence;
+}
+
+bool KernelCacheTracker::makeRoom(SteadyTimePoint now) {
+	if (inodes_.size() + entries_.size() < capacity_) {
+		return true;
+	}
+	// Look for passed timeouts at most once per second, so that a full tracker doesn't
+	// slow down every operation
+	if (now - lastCleanup_ < std::chrono::seconds(1)) {
+		return false;
+	}
+	lastCleanup_ = now;
+	for (auto it = inodes_.begin(); it != inodes_.end();) {
+		it = (it->second <= now) ? inodes_.erase(it) : std::next(it);
+	}
+	for (auto it = entries_.begin(); it != entries_.end();) {
+		it = (it->second <= now) ? entries_.erase(it) : std::next(it);
+	}
+	return inodes_.size() + entries_.size() < capacity_;
+}
@@ -0,0 +1,111 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/time_utils.h"
+#include "protocol/named_inode_entry.h"
+
+/*! \brief Decides how long the kernel may cache metadata of a mount getting invalidations.
+ *
+ * A reply may carry metadata fetched before a change, while the notification about the change
+ * is received (possibly with another connection) and applied before the reply reaches the
+ * kernel. Operations take sequence() before fetching metadata; if a notification about the
+ * inode (or about an entry of the parent directory) was received later, their reply gets
+ * the default timeout.
+ *
+ * Long timeouts are remembered until they pass, so that all of them can be invalidated when
+ * notifications may have been lost (see reset()). Their number is bounded by the capacity;
+ * when it is reached, default timeouts are used. All methods are thread safe.
+ */
+class KernelCacheTracker {
+public:
+	explicit KernelCacheTracker(size_t capacity);
+
+	/// Sequence number of the last received notification.
+	uint64_t sequence() const;
+
+	/*! \brief Returns timeout of attributes of an inode fetched after the given sequence.
+	 * \param timeout timeout to be used if no notification was received in the meantime
+	 * \param default_timeout timeout used when notifications can't be relied on
+	 */
+	double attrTimeout(uint32_t inode, uint64_t sequence, double timeout,
+			double default_timeout);
+
+	/*! \brief Returns timeout of an entry of a directory fetched after the given sequence.
+	 * \param timeout timeout to be used if no notification was received in the meantime
+	 * \param default_timeout timeout used when notifications can't be relied on
+	 */
+	double entryTimeout(uint32_t parent, const std::string &name, uint64_t sequence,
+			double timeout, double default_timeout);
+
+	/*! \brief Checks if metadata of an inode fetched after the given sequence may be stale.
+	 *
+	 * True if a notification about the inode (or about an entry of the inode, if it is
+	 * a directory) was received since then, or if notifications could have been lost.
+	 */
+	bool changedSince(uint32_t inode, uint64_t sequence) const;
+
+	/// To be called when a notification about a change of an inode is received.
+	void inodeInvalidated(uint32_t inode);
+
+	/// To be called when a notification about a change of an entry is received.
+	void entryInvalidated(uint32_t parent, const std::string &name);
+
+	/*! \brief Forgets all long timeouts granted so far.
+	 *
+	 * To be called when notifications may have been lost. Replies to operations which
+	 * took their sequence before get default timeouts.
+	 * \param inodes inodes with long timeouts of attributes which haven't passed yet
+	 * \param entries entries (inode is the parent) with long timeouts which haven't passed yet
+	 */
+	void reset(std::vector<uint32_t> &inodes, std::vector<NamedInodeEntry> &entries);
+
+	/// Number of remembered long timeouts.
+	size_t size() const;
+
+private:
+	typedef std::pair<uint32_t, std::string> EntryKey; // parent, name
+
+	// Sequences of notifications are kept for groups of inodes, so that memory they use
+	// is bounded
+	static constexpr uint32_t kSequenceSlots = 4096;
+
+	bool invalidatedSince(uint32_t inode, uint64_t sequence) const;
+	bool makeRoom(SteadyTimePoint now);
+
+	mutable std::mutex mutex_;
+	uint64_t sequence_;
+	uint64_t resetSequence_;
+	std::array<uint64_t, kSequenceSlots> sequences_;
+	std::unordered_map<uint32_t, SteadyTimePoint> inodes_; // inode -> end of timeout
+	std::map<EntryKey, SteadyTimePoint> entries_;          // entry -> end of timeout
+	size_t capacity_;
+	SteadyTimePoint lastCleanup_;
+};
@@ -0,0 +1,89 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/kernel_cache_tracker.h"
+
+#include <gtest/gtest.h>
+
+TEST(KernelCacheTrackerTests, NotificationReceivedDuringRequest) {
+	KernelCacheTracker tracker(100);
+	uint64_t sequence = tracker.sequence();
+	EXPECT_EQ(60.0, tracker.attrTimeout(1, sequence, 60.0, 1.0));
+	EXPECT_EQ(60.0, tracker.entryTimeout(1, "a", sequence, 60.0, 0.0));
+
+	// attributes of inode 2 were fetched before a notification about its change arrived
+	tracker.inodeInvalidated(2);
+	EXPECT_EQ(1.0, tracker.attrTimeout(2, sequence, 60.0, 1.0));
+	EXPECT_EQ(60.0, tracker.attrTimeout(3, sequence, 60.0, 1.0));
+	EXPECT_EQ(60.0, tracker.attrTimeout(2, tracker.sequence(), 60.0, 1.0));
+
+	// a reply computed before the notification, but passed to the kernel after it
+	EXPECT_TRUE(tracker.changedSince(2, sequence));
+	EXPECT_FALSE(tracker.changedSince(3, sequence));
+	EXPECT_FALSE(tracker.changedSince(2, tracker.sequence()));
+
+	tracker.entryInvalidated(1, "b");
+	EXPECT_TRUE(tracker.changedSince(1, sequence));
+	EXPECT_EQ(0.0, tracker.entryTimeout(1, "c", sequence, 60.0, 0.0));
+	EXPECT_EQ(60.0, tracker.entryTimeout(1, "c", tracker.sequence(), 60.0, 0.0));
+
+	// short timeouts are not limited nor remembered
+	size_t size = tracker.size();
+	EXPECT_EQ(0.5, tracker.attrTimeout(2, sequence, 0.5, 1.0));
+	EXPECT_EQ(size, tracker.size());
+}
+
+TEST(KernelCacheTrackerTests, Reset) {
+	KernelCacheTracker tracker(100);
+	uint64_t sequence = tracker.sequence();
+	tracker.attrTimeout(1, sequence, 60.0, 1.0);
+	tracker.attrTimeout(2, sequence, 60.0, 1.0);
+	tracker.entryTimeout(1, "a", sequence, 60.0, 0.0);
+	tracker.entryTimeout(1, "b", sequence, 60.0, 0.0);
+	tracker.inodeInvalidated(2);
+	tracker.entryInvalidated(1, "b");
+	EXPECT_EQ(2U, tracker.size());
+
+	std::vector<uint32_t> inodes;
+	std::vector<NamedInodeEntry> entries;
+	tracker.reset(inodes, entries);
+	EXPECT_EQ(std::vector<uint32_t>{1}, inodes);
+	ASSERT_EQ(1U, entries.size());
+	EXPECT_EQ(1U, entries[0].inode);
+	EXPECT_EQ("a", entries[0].name);
+	EXPECT_EQ(0U, tracker.size());
+	EXPECT_TRUE(tracker.changedSince(3, sequence));
+
+	// replies to requests sent before the reset get default timeouts
+	EXPECT_EQ(1.0, tracker.attrTimeout(3, sequence, 60.0, 1.0));
+	EXPECT_EQ(0.0, tracker.entryTimeout(3, "a", sequence, 60.0, 0.0));
+	EXPECT_EQ(60.0, tracker.attrTimeout(3, tracker.sequence(), 60.0, 1.0));
+}
+
+TEST(KernelCacheTrackerTests, Capacity) {
+	KernelCacheTracker tracker(2);
+	uint64_t sequence = tracker.sequence();
+	EXPECT_EQ(60.0, tracker.attrTimeout(1, sequence, 60.0, 1.0));
+	EXPECT_EQ(60.0, tracker.entryTimeout(1, "a", sequence, 60.0, 0.0));
+	// long timeouts which couldn't be invalidated are not granted
+	EXPECT_EQ(1.0, tracker.attrTimeout(2, sequence, 60.0, 1.0));
+	EXPECT_EQ(0.0, tracker.entryTimeout(1, "b", sequence, 60.0, 0.0));
+	tracker.inodeInvalidated(1);
+	EXPECT_EQ(60.0, tracker.attrTimeout(2, tracker.sequence(), 60.0, 1.0));
+}
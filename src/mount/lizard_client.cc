@@ -55,10 +55,12 @@
 #include "common/user_groups.h"
 #include "devtools/request_log.h"
 #include "mount/acl_cache.h"
+#include "mount/cache_invalidator.h"
 #include "mount/chunk_locator.h"
 #include "mount/client_common.h"
 #include "mount/direntry_cache.h"
 #include "mount/g_io_limiters.h"
+#include "mount/global_chunkserver_stats.h"
 #include "mount/io_limit_group.h"
 #include "mount/mastercomm.h"
 #include "mount/masterproxy.h"
@@ -207,10 +209,12 @@ typedef struct _finfo {
 
 static DirEntryCache gDirEntryCache;
 static unsigned gDirEntryCacheMaxSize = 100000;
+static unsigned gDirEntryCachePrefetch = 0;
 
 static int debug_mode = 0;
 static int usedircache = 1;
 static int keep_cache = 0;
+static bool writeback_cache = false;
 static double direntry_cache_timeout = 0.1;
 static double entry_cache_timeout = 0.0;
 static double attr_cache_timeout = 0.1;
@@ -226,6 +230,77 @@ static std::mutex lock_request_mutex;
 
 static std::unique_ptr<AclCache> acl_cache;
 
+// set if the master is asked to notify about changes of cached metadata
+static std::unique_ptr<CacheInvalidator> gCacheInvalidator;
+static std::mutex gKernelInvalidatorsMutex;
+static KernelInodeInvalidator gKernelInodeInvalidator;
+static KernelEntryInvalidator gKernelEntryInvalidator;
+
+/// Long cache timeouts are safe only if the master notifies about changes.
+static double limit_cache_timeout(double timeout, double default_timeout) {
+	if (gCacheInvalidator && !gCacheInvalidator->active()) {
+		return std::min(timeout, default_timeout);
+	}
+	return timeout;
+}
+
+static double current_attr_cache_timeout() {
+	return limit_cache_timeout(attr_cache_timeout, FsInitParams::kDefaultAttrCacheTimeout);
+}
+
+static double current_entry_cache_timeout() {
+	return limit_cache_timeout(entry_cache_timeout, FsInitParams::kDefaultEntryCacheTimeout);
+}
+
+static double current_direntry_cache_timeout() {
+	return limit_cache_timeout(direntry_cache_timeout,
+			FsInitParams::kDefaultDirentryCacheTimeout);
+}
+
+uint64_t cache_invalidation_sequence() {
+	return gCacheInvalidator ? gCacheInvalidator->tracker().sequence() : 0;
+}
+
+void attr_replied(Inode ino, uint64_t sequence) {
+	if (gCacheInvalidator) {
+		gCacheInvalidator->attrReplied(ino, sequence);
+	}
+}
+
+void entry_replied(Inode parent, const char *name, Inode ino, uint64_t sequence) {
+	if (gCacheInvalidator) {
+		gCacheInvalidator->entryReplied(parent, name, ino, sequence);
+	}
+}
+
+/// Timeout of attributes of an inode fetched after the given sequence of notifications.
+static double attr_cache_timeout_for(Inode inode, uint64_t sequence) {
+	double timeout = current_attr_cache_timeout();
+	if (gCacheInvalidator) {
+		timeout = gCacheInvalidator->tracker().attrTimeout(inode, sequence, timeout,
+				FsInitParams::kDefaultAttrCacheTimeout);
+	}
+	return timeout;
+}
+
+/// Timeout of an entry fetched after the given sequence of notifications.
+static double entry_cache_timeout_for(Inode parent, const std::string &name, bool directory,
+		uint64_t sequence) {
+	double timeout = directory ? current_direntry_cache_timeout() : current_entry_cache_timeout();
+	if (gCacheInvalidator) {
+		double default_timeout = directory ? FsInitParams::kDefaultDirentryCacheTimeout
+		                                   : FsInitParams::kDefaultEntryCacheTimeout;
+		timeout = gCacheInvalidator->tracker().entryTimeout(parent, name, sequence, timeout,
+				default_timeout);
+	}
+	return timeout;
+}
+
+static void update_direntry_cache_timeout() {
+	std::unique_lock<shared_mutex> write_guard(gDirEntryCache.rwlock());
+	gDirEntryCache.setTimeout((uint64_t)(current_direntry_cache_timeout() * 1000000));
+}
+
 void update_readdir_session(uint64_t sessId, uint64_t entryIno) {
 	std::lock_guard<std::mutex> sessions_lock(gReaddirMutex);
 	gReaddirSessions[sessId].lastReadIno = entryIno;
@@ -273,6 +348,10 @@ static void updateNextReaddirEntryIndexIfMasterRestarted(ReaddirSession& readdir
 void masterDisconnectedCallback() {
 	gGroupCache.reset();
 	gDirEntryCache.clear();
+	if (gCacheInvalidator) {
+		gCacheInvalidator->disconnected();
+		update_direntry_cache_timeout();
+	}
 	std::lock_guard<std::mutex> sessions_lock(gReaddirMutex);
 	for (auto& rs : gReaddirSessions) {
 		rs.second.restarted = true;
@@ -285,6 +364,31 @@ inline void eraseAclCache(Inode inode) {
 			inode + 1, 0, 0);
 }
 
+void setKernelCacheInvalidators(KernelInodeInvalidator inodeInvalidator,
+		KernelEntryInvalidator entryInvalidator) {
+	std::lock_guard<std::mutex> guard(gKernelInvalidatorsMutex);
+	gKernelInodeInvalidator = std::move(inodeInvalidator);
+	gKernelEntryInvalidator = std::move(entryInvalidator);
+}
+
+static void invalidate_inode_cache(Inode inode) {
+	gDirEntryCache.lockAndInvalidateInode(inode);
+	eraseAclCache(inode);
+	read_inode_ops(inode);
+	std::lock_guard<std::mutex> guard(gKernelInvalidatorsMutex);
+	if (gKernelInodeInvalidator) {
+		gKernelInodeInvalidator(inode);
+	}
+}
+
+static void invalidate_entry_cache(Inode parent, const std::string &name) {
+	gDirEntryCache.lockAndInvalidateParent(parent);
+	std::lock_guard<std::mutex> guard(gKernelInvalidatorsMutex);
+	if (gKernelEntryInvalidator) {
+		gKernelEntryInvalidator(parent, name);
+	}
+}
+
 // TODO consider making oplog_printf asynchronous
 
 /**
@@ -324,54 +428,62 @@ private:
 };
 
 static uint64_t *statsptr[STATNODES];
+static unsigned latencyseries[STATNODES];
+
+static void op_stats_init(statsnode *s, uint8_t id, const char *name) {
+	statsptr[id] = stats_get_counterptr(stats_get_subnode(s,name,0));
+	latencyseries[id] = gOperationLatencies.series(std::string("fuse_ops.") + name);
+}
 
 void statsptr_init(void) {
 	statsnode *s;
 	s = stats_get_subnode(NULL,"fuse_ops",0);
-	statsptr[OP_SETXATTR] = stats_get_counterptr(stats_get_subnode(s,"setxattr",0));
-	statsptr[OP_GETXATTR] = stats_get_counterptr(stats_get_subnode(s,"getxattr",0));
-	statsptr[OP_LISTXATTR] = stats_get_counterptr(stats_get_subnode(s,"listxattr",0));
-	statsptr[OP_REMOVEXATTR] = stats_get_counterptr(stats_get_subnode(s,"removexattr",0));
-	statsptr[OP_FSYNC] = stats_get_counterptr(stats_get_subnode(s,"fsync",0));
-	statsptr[OP_FLUSH] = stats_get_counterptr(stats_get_subnode(s,"flush",0));
-	statsptr[OP_WRITE] = stats_get_counterptr(stats_get_subnode(s,"write",0));
-	statsptr[OP_READ] = stats_get_counterptr(stats_get_subnode(s,"read",0));
-	statsptr[OP_RELEASE] = stats_get_counterptr(stats_get_subnode(s,"release",0));
-	statsptr[OP_OPEN] = stats_get_counterptr(stats_get_subnode(s,"open",0));
-	statsptr[OP_CREATE] = stats_get_counterptr(stats_get_subnode(s,"create",0));
-	statsptr[OP_RELEASEDIR] = stats_get_counterptr(stats_get_subnode(s,"releasedir",0));
-	statsptr[OP_READDIR] = stats_get_counterptr(stats_get_subnode(s,"readdir",0));
-	statsptr[OP_READRESERVED] = stats_get_counterptr(stats_get_subnode(s,"readreserved",0));
-	statsptr[OP_READTRASH] = stats_get_counterptr(stats_get_subnode(s,"readtrash",0));
-	statsptr[OP_OPENDIR] = stats_get_counterptr(stats_get_subnode(s,"opendir",0));
-	statsptr[OP_LINK] = stats_get_counterptr(stats_get_subnode(s,"link",0));
-	statsptr[OP_RENAME] = stats_get_counterptr(stats_get_subnode(s,"rename",0));
-	statsptr[OP_READLINK] = stats_get_counterptr(stats_get_subnode(s,"readlink",0));
-	statsptr[OP_READLINK_CACHED] = stats_get_counterptr(stats_get_subnode(s,"readlink-cached",0));
-	statsptr[OP_SYMLINK] = stats_get_counterptr(stats_get_subnode(s,"symlink",0));
-	statsptr[OP_RMDIR] = stats_get_counterptr(stats_get_subnode(s,"rmdir",0));
-	statsptr[OP_MKDIR] = stats_get_counterptr(stats_get_subnode(s,"mkdir",0));
-	statsptr[OP_UNLINK] = stats_get_counterptr(stats_get_subnode(s,"unlink",0));
-	statsptr[OP_UNDEL] = stats_get_counterptr(stats_get_subnode(s,"undel",0));
-	statsptr[OP_MKNOD] = stats_get_counterptr(stats_get_subnode(s,"mknod",0));
-	statsptr[OP_SETATTR] = stats_get_counterptr(stats_get_subnode(s,"setattr",0));
-	statsptr[OP_GETATTR] = stats_get_counterptr(stats_get_subnode(s,"getattr",0));
-	statsptr[OP_DIRCACHE_GETATTR] = stats_get_counterptr(stats_get_subnode(s,"getattr-cached",0));
-	statsptr[OP_LOOKUP] = stats_get_counterptr(stats_get_subnode(s,"lookup",0));
-	statsptr[OP_LOOKUP_INTERNAL] = stats_get_counterptr(stats_get_subnode(s,"lookup-internal",0));
+	op_stats_init(s,OP_SETXATTR,"setxattr");
+	op_stats_init(s,OP_GETXATTR,"getxattr");
+	op_stats_init(s,OP_LISTXATTR,"listxattr");
+	op_stats_init(s,OP_REMOVEXATTR,"removexattr");
+	op_stats_init(s,OP_FSYNC,"fsync");
+	op_stats_init(s,OP_FLUSH,"flush");
+	op_stats_init(s,OP_WRITE,"write");
+	op_stats_init(s,OP_READ,"read");
+	op_stats_init(s,OP_RELEASE,"release");
+	op_stats_init(s,OP_OPEN,"open");
+	op_stats_init(s,OP_CREATE,"create");
+	op_stats_init(s,OP_RELEASEDIR,"releasedir");
+	op_stats_init(s,OP_READDIR,"readdir");
+	op_stats_init(s,OP_READRESERVED,"readreserved");
+	op_stats_init(s,OP_READTRASH,"readtrash");
+	op_stats_init(s,OP_OPENDIR,"opendir");
+	op_stats_init(s,OP_LINK,"link");
+	op_stats_init(s,OP_RENAME,"rename");
+	op_stats_init(s,OP_READLINK,"readlink");
+	op_stats_init(s,OP_READLINK_CACHED,"readlink-cached");
+	op_stats_init(s,OP_SYMLINK,"symlink");
+	op_stats_init(s,OP_RMDIR,"rmdir");
+	op_stats_init(s,OP_MKDIR,"mkdir");
+	op_stats_init(s,OP_UNLINK,"unlink");
+	op_stats_init(s,OP_UNDEL,"undel");
+	op_stats_init(s,OP_MKNOD,"mknod");
+	op_stats_init(s,OP_SETATTR,"setattr");
+	op_stats_init(s,OP_GETATTR,"getattr");
+	op_stats_init(s,OP_DIRCACHE_GETATTR,"getattr-cached");
+	op_stats_init(s,OP_LOOKUP,"lookup");
+	op_stats_init(s,OP_LOOKUP_INTERNAL,"lookup-internal");
 	if (usedircache) {
-		statsptr[OP_DIRCACHE_LOOKUP] = stats_get_counterptr(stats_get_subnode(s,"lookup-cached",0));
+		op_stats_init(s,OP_DIRCACHE_LOOKUP,"lookup-cached");
+		op_stats_init(s,OP_DIRCACHE_NEGATIVE_LOOKUP,"lookup-negative-cached");
 	}
-	statsptr[OP_ACCESS] = stats_get_counterptr(stats_get_subnode(s,"access",0));
-	statsptr[OP_STATFS] = stats_get_counterptr(stats_get_subnode(s,"statfs",0));
+	op_stats_init(s,OP_ACCESS,"access");
+	op_stats_init(s,OP_STATFS,"statfs");
 	if (usedircache) {
-		statsptr[OP_GETDIR_FULL] = stats_get_counterptr(stats_get_subnode(s,"getdir-full",0));
+		op_stats_init(s,OP_GETDIR_FULL,"getdir-full");
+		op_stats_init(s,OP_GETDIR_PREFETCH,"getdir-prefetch");
 	} else {
-		statsptr[OP_GETDIR_SMALL] = stats_get_counterptr(stats_get_subnode(s,"getdir-small",0));
+		op_stats_init(s,OP_GETDIR_SMALL,"getdir-small");
 	}
-	statsptr[OP_GETLK] = stats_get_counterptr(stats_get_subnode(s,"getlk",0));
-	statsptr[OP_SETLK] = stats_get_counterptr(stats_get_subnode(s,"setlk",0));
-	statsptr[OP_FLOCK] = stats_get_counterptr(stats_get_subnode(s,"flock",0));
+	op_stats_init(s,OP_GETLK,"getlk");
+	op_stats_init(s,OP_SETLK,"setlk");
+	op_stats_init(s,OP_FLOCK,"flock");
 }
 
 void stats_inc(uint8_t id) {
@@ -382,6 +494,21 @@ void stats_inc(uint8_t id) {
 	}
 }
 
+/// Records latency of an operation, from construction until the end of the scope.
+class OperationLatencyTimer {
+public:
+	explicit OperationLatencyTimer(uint8_t id) : id_(id) {
+	}
+
+	~OperationLatencyTimer() {
+		gOperationLatencies.add(latencyseries[id_], timer_.elapsed_us());
+	}
+
+private:
+	uint8_t id_;
+	Timer timer_;
+};
+
 void type_to_stat(uint32_t inode,uint8_t type, struct stat *stbuf) {
 	memset(stbuf,0,sizeof(struct stat));
 	stbuf->st_ino = inode;
@@ -559,6 +686,11 @@ void makemodestr(char modestr[11],uint16_t mode) {
 
 void makeattrstr(char *buff,uint32_t size,struct stat *stbuf) {
 	char modestr[11];
+	if (!oplog_enabled()) {
+		// the string is used only in the oplog
+		buff[0] = 0;
+		return;
+	}
 	makemodestr(modestr,stbuf->st_mode);
 #ifdef LIZARDFS_HAVE_STRUCT_STAT_ST_RDEV
 	if (modestr[0]=='b' || modestr[0]=='c') {
@@ -589,6 +721,7 @@ struct statvfs statfs(Context &ctx, Inode ino) {
 	memset(&stfsbuf,0,sizeof(stfsbuf));
 
 	stats_inc(OP_STATFS);
+	OperationLatencyTimer latency_timer(OP_STATFS);
 	if (debug_mode) {
 		oplog_printf(ctx, "statfs (%lu)", (unsigned long int)ino);
 	}
@@ -652,6 +785,7 @@ void access(Context &ctx, Inode ino, int mask) {
 			(unsigned long int)ino,
 			mask);
 	stats_inc(OP_ACCESS);
+	OperationLatencyTimer latency_timer(OP_ACCESS);
 #if (R_OK==MODE_MASK_R) && (W_OK==MODE_MASK_W) && (X_OK==MODE_MASK_X)
 	mmode = mask & (MODE_MASK_R | MODE_MASK_W | MODE_MASK_X);
 #else
@@ -679,6 +813,57 @@ void access(Context &ctx, Inode ino, int mask) {
 	}
 }
 
+/// Looks up a directory entry in gDirEntryCache, both positive and negative entries are used.
+static bool lookup_direntry_cache(const Context &ctx, Inode parent, const std::string &name,
+		uint32_t &inode, Attributes &attr, int &status) {
+	if (gDirEntryCache.lookup(ctx, parent, name, inode, attr)) {
+		stats_inc(OP_DIRCACHE_LOOKUP);
+		status = LIZARDFS_STATUS_OK;
+		return true;
+	}
+	if (gDirEntryCache.lookupNegative(ctx, parent, name)) {
+		stats_inc(OP_DIRCACHE_NEGATIVE_LOOKUP);
+		status = LIZARDFS_ERROR_ENOENT;
+		return true;
+	}
+	return false;
+}
+
+/// Fills gDirEntryCache with all entries of a directory in which many lookups missed the cache.
+/// Returns true if the directory has been read.
+static bool prefetch_direntry_cache(Context &ctx, Inode parent) {
+	uint64_t request_size = matocl::fuseGetDir::kMaxNumberOfDirectoryEntries;
+	std::vector<DirectoryEntry> dir_entries;
+	uint8_t status;
+
+	if (gDirEntryCachePrefetch == 0
+			|| gDirEntryCache.recordLookupMiss(ctx, parent) != gDirEntryCachePrefetch) {
+		return false;
+	}
+	stats_inc(OP_GETDIR_PREFETCH);
+	auto data_acquire_time = gDirEntryCache.updateTime();
+	RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
+		fs_getdir(parent, ctx.uid, ctx.gid, 0, request_size, dir_entries));
+	if (status != LIZARDFS_STATUS_OK) {
+		return false;
+	}
+
+	std::unique_lock<shared_mutex> write_guard(gDirEntryCache.rwlock());
+	gDirEntryCache.updateTime();
+	gDirEntryCache.insertSequence(ctx, parent, dir_entries, data_acquire_time);
+	if (dir_entries.size() < request_size) {
+		// the whole directory has been read, insert 'no more entries' marker as readdir does
+		uint64_t marker_index = dir_entries.empty() ? 0 : dir_entries.back().next_index;
+		gDirEntryCache.invalidate(ctx, parent, marker_index);
+		gDirEntryCache.insert(ctx, parent, 0, marker_index, marker_index, "", Attributes{{}}, data_acquire_time);
+		gDirEntryCache.markComplete(ctx, parent, data_acquire_time);
+	}
+	if (gDirEntryCache.size() > gDirEntryCacheMaxSize) {
+		gDirEntryCache.removeOldest(gDirEntryCache.size() - gDirEntryCacheMaxSize);
+	}
+	return true;
+}
+
 EntryParam lookup(Context &ctx, Inode parent, const char *name) {
 	EntryParam e;
 	uint64_t maxfleng;
@@ -689,6 +874,8 @@ EntryParam lookup(Context &ctx, Inode parent, const char *name) {
 	uint8_t mattr;
 	uint8_t icacheflag;
 	int status;
+	OperationLatencyTimer latency_timer(OP_LOOKUP);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 
 	if (debug_mode) {
 		oplog_printf(ctx, "lookup (%lu,%s) ...", (unsigned long int)parent, name);
@@ -721,18 +908,25 @@ EntryParam lookup(Context &ctx, Inode parent, const char *name) {
 		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
 			fs_getattr(inode, ctx.uid, ctx.gid, attr));
 		icacheflag = 0;
-	} else if (usedircache && gDirEntryCache.lookup(ctx,parent,std::string(name,nleng),inode,attr)) {
+	} else if (usedircache && lookup_direntry_cache(ctx, parent, std::string(name, nleng), inode, attr, status)) {
 		if (debug_mode) {
 			lzfs::log_debug("lookup: sending data from dircache");
 		}
-		stats_inc(OP_DIRCACHE_LOOKUP);
-		status = 0;
 		icacheflag = 1;
 //              oplog_printf(ctx, "lookup (%lu,%s) (using open dir cache): OK (%lu)",(unsigned long int)parent,name,(unsigned long int)inode);
+	} else if (usedircache && prefetch_direntry_cache(ctx, parent)
+			&& lookup_direntry_cache(ctx, parent, std::string(name, nleng), inode, attr, status)) {
+		icacheflag = 1;
 	} else {
 		stats_inc(OP_LOOKUP);
+		auto data_acquire_time = gDirEntryCache.updateTime();
 		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
 		fs_lookup(parent, std::string(name, nleng), ctx.uid, ctx.gid, &inode, attr));
+		if (usedircache && status == LIZARDFS_ERROR_ENOENT) {
+			std::unique_lock<shared_mutex> write_guard(gDirEntryCache.rwlock());
+			gDirEntryCache.updateTime();
+			gDirEntryCache.insertNegative(ctx, parent, std::string(name, nleng), data_acquire_time);
+		}
 		icacheflag = 0;
 	}
 	if (status != LIZARDFS_STATUS_OK) {
@@ -749,8 +943,9 @@ EntryParam lookup(Context &ctx, Inode parent, const char *name) {
 	}
 	e.ino = inode;
 	mattr = attr_get_mattr(attr);
-	e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout;
-	e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:((attr[0]==TYPE_DIRECTORY)?direntry_cache_timeout:entry_cache_timeout);
+	e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(inode, cache_sequence);
+	e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout_for(parent,
+			std::string(name, nleng), attr[0]==TYPE_DIRECTORY, cache_sequence);
 	attr_to_stat(inode,attr,&e.attr);
 	if (maxfleng>(uint64_t)(e.attr.st_size)) {
 		e.attr.st_size=maxfleng;
@@ -774,6 +969,8 @@ AttrReply getattr(Context &ctx, Inode ino) {
 	Attributes attr;
 	char attrstr[256];
 	int status;
+	OperationLatencyTimer latency_timer(OP_GETATTR);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 
 	if (debug_mode) {
 		oplog_printf(ctx, "getattr (%lu) ...", (unsigned long int)ino);
@@ -806,7 +1003,7 @@ AttrReply getattr(Context &ctx, Inode ino) {
 	if (attr[0]==TYPE_FILE && maxfleng>(uint64_t)(o_stbuf.st_size)) {
 		o_stbuf.st_size=maxfleng;
 	}
-	attr_timeout = (attr_get_mattr(attr)&MATTR_NOACACHE)?0.0:attr_cache_timeout;
+	attr_timeout = (attr_get_mattr(attr)&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(ino, cache_sequence);
 	makeattrstr(attrstr,256,&o_stbuf);
 	oplog_printf(ctx, "getattr (%lu): OK (%.1f,%s)",
 			(unsigned long int)ino,
@@ -826,6 +1023,8 @@ AttrReply setattr(Context &ctx, Inode ino, struct stat *stbuf, int to_set) {
 
 	makemodestr(modestr,stbuf->st_mode);
 	stats_inc(OP_SETATTR);
+	OperationLatencyTimer latency_timer(OP_SETATTR);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 	if (debug_mode) {
 		oplog_printf(ctx, "setattr (%lu,0x%X,[%s:0%04o,%ld,%ld,%lu,%lu,%" PRIu64 "]) ...",
 			(unsigned long int)ino,
@@ -995,7 +1194,7 @@ AttrReply setattr(Context &ctx, Inode ino, struct stat *stbuf, int to_set) {
 	if (attr[0]==TYPE_FILE && maxfleng>(uint64_t)(o_stbuf.st_size)) {
 		o_stbuf.st_size=maxfleng;
 	}
-	attr_timeout = (attr_get_mattr(attr)&MATTR_NOACACHE)?0.0:attr_cache_timeout;
+	attr_timeout = (attr_get_mattr(attr)&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(ino, cache_sequence);
 	makeattrstr(attrstr,256,&o_stbuf);
 	oplog_printf(ctx, "setattr (%lu,0x%X,[%s:0%04o,%ld,%ld,%lu,%lu,%" PRIu64 "]): OK (%.1f,%s)",
 			(unsigned long int)ino,
@@ -1025,6 +1224,8 @@ EntryParam mknod(Context &ctx, Inode parent, const char *name, mode_t mode, dev_
 
 	makemodestr(modestr,mode);
 	stats_inc(OP_MKNOD);
+	OperationLatencyTimer latency_timer(OP_MKNOD);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 	if (debug_mode) {
 		oplog_printf(ctx, "mknod (%lu,%s,%s:0%04o,0x%08lX) ...",
 				(unsigned long int)parent,
@@ -1092,8 +1293,8 @@ EntryParam mknod(Context &ctx, Inode parent, const char *name, mode_t mode, dev_
 		gDirEntryCache.lockAndInvalidateParent(ctx, parent);
 		e.ino = inode;
 		mattr = attr_get_mattr(attr);
-		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout;
-		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout;
+		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(inode, cache_sequence);
+		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout_for(parent, name, false, cache_sequence);
 		attr_to_stat(inode,attr,&e.attr);
 		makeattrstr(attrstr,256,&e.attr);
 		oplog_printf(ctx, "mknod (%lu,%s,%s:0%04o,0x%08lX): OK (%.1f,%lu,%.1f,%s)",
@@ -1115,6 +1316,7 @@ void unlink(Context &ctx, Inode parent, const char *name) {
 	int status;
 
 	stats_inc(OP_UNLINK);
+	OperationLatencyTimer latency_timer(OP_UNLINK);
 	if (debug_mode) {
 		oplog_printf(ctx, "unlink (%lu,%s) ...", (unsigned long int)parent, name);
 	}
@@ -1156,6 +1358,7 @@ void unlink(Context &ctx, Inode parent, const char *name) {
 
 void undel(Context &ctx, Inode ino) {
 	stats_inc(OP_UNDEL);
+	OperationLatencyTimer latency_timer(OP_UNDEL);
 	if (debug_mode) {
 		oplog_printf(ctx, "undel (%lu) ...", (unsigned long)ino);
 	}
@@ -1179,6 +1382,8 @@ EntryParam mkdir(Context &ctx, Inode parent, const char *name, mode_t mode) {
 
 	makemodestr(modestr,mode);
 	stats_inc(OP_MKDIR);
+	OperationLatencyTimer latency_timer(OP_MKDIR);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 	if (debug_mode) {
 		oplog_printf(ctx, "mkdir (%lu,%s,d%s:0%04o) ...",
 				(unsigned long int)parent,
@@ -1222,8 +1427,8 @@ EntryParam mkdir(Context &ctx, Inode parent, const char *name, mode_t mode) {
 		gDirEntryCache.lockAndInvalidateParent(parent);
 		e.ino = inode;
 		mattr = attr_get_mattr(attr);
-		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout;
-		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:direntry_cache_timeout;
+		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(inode, cache_sequence);
+		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout_for(parent, name, true, cache_sequence);
 		attr_to_stat(inode,attr,&e.attr);
 		makeattrstr(attrstr,256,&e.attr);
 		oplog_printf(ctx, "mkdir (%lu,%s,d%s:0%04o): OK (%.1f,%lu,%.1f,%s)",
@@ -1244,6 +1449,7 @@ void rmdir(Context &ctx, Inode parent, const char *name) {
 	int status;
 
 	stats_inc(OP_RMDIR);
+	OperationLatencyTimer latency_timer(OP_RMDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "rmdir (%lu,%s) ...", (unsigned long int)parent, name);
 	}
@@ -1293,6 +1499,8 @@ EntryParam symlink(Context &ctx, const char *path, Inode parent,
 	int status;
 
 	stats_inc(OP_SYMLINK);
+	OperationLatencyTimer latency_timer(OP_SYMLINK);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 	if (debug_mode) {
 		oplog_printf(ctx, "symlink (%s,%lu,%s) ...",
 				path,
@@ -1332,8 +1540,8 @@ EntryParam symlink(Context &ctx, const char *path, Inode parent,
 		gDirEntryCache.lockAndInvalidateParent(parent);
 		e.ino = inode;
 		mattr = attr_get_mattr(attr);
-		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout;
-		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout;
+		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(inode, cache_sequence);
+		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout_for(parent, name, false, cache_sequence);
 		attr_to_stat(inode,attr,&e.attr);
 		makeattrstr(attrstr,256,&e.attr);
 		symlink_cache_insert(inode, (const uint8_t *)path);
@@ -1352,6 +1560,7 @@ EntryParam symlink(Context &ctx, const char *path, Inode parent,
 std::string readlink(Context &ctx, Inode ino) {
 	int status;
 	const uint8_t *path;
+	OperationLatencyTimer latency_timer(OP_READLINK);
 
 	if (debug_mode) {
 		oplog_printf(ctx, "readlink (%lu) ...",
@@ -1388,6 +1597,7 @@ void rename(Context &ctx, Inode parent, const char *name,
 	Attributes attr;
 
 	stats_inc(OP_RENAME);
+	OperationLatencyTimer latency_timer(OP_RENAME);
 	if (debug_mode) {
 		oplog_printf(ctx, "rename (%lu,%s,%lu,%s) ...",
 				(unsigned long int)parent,
@@ -1471,6 +1681,8 @@ EntryParam link(Context &ctx, Inode ino, Inode newparent, const char *newname) {
 
 
 	stats_inc(OP_LINK);
+	OperationLatencyTimer latency_timer(OP_LINK);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 	if (debug_mode) {
 		oplog_printf(ctx, "link (%lu,%lu,%s) ...",
 				(unsigned long int)ino,
@@ -1518,8 +1730,8 @@ EntryParam link(Context &ctx, Inode ino, Inode newparent, const char *newname) {
 		gDirEntryCache.lockAndInvalidateParent(newparent);
 		e.ino = inode;
 		mattr = attr_get_mattr(attr);
-		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout;
-		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout;
+		e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(inode, cache_sequence);
+		e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout_for(newparent, newname, false, cache_sequence);
 		attr_to_stat(inode,attr,&e.attr);
 		makeattrstr(attrstr,256,&e.attr);
 		oplog_printf(ctx, "link (%lu,%lu,%s): OK (%.1f,%lu,%.1f,%s)",
@@ -1538,6 +1750,7 @@ void opendir(Context &ctx, Inode ino) {
 	int status;
 
 	stats_inc(OP_OPENDIR);
+	OperationLatencyTimer latency_timer(OP_OPENDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "opendir (%lu) ...", (unsigned long int)ino);
 	}
@@ -1573,6 +1786,7 @@ std::vector<DirEntry> readdir(Context &ctx, uint64_t fh, Inode ino, off_t off, s
 	// as it is 64bit unsigned int on master)
 
 	stats_inc(OP_READDIR);
+	OperationLatencyTimer latency_timer(OP_READDIR);
 	if (debug_mode) {
 		oplog_printf(ctx, "readdir (%lu,%" PRIu64 ",%" PRIu64 ") ...",
 				static_cast<unsigned long int>(ino),
@@ -1718,6 +1932,7 @@ std::vector<DirEntry> readdir(Context &ctx, uint64_t fh, Inode ino, off_t off, s
 
 std::vector<NamedInodeEntry> readreserved(Context &ctx, NamedInodeOffset off, NamedInodeOffset max_entries) {
 	stats_inc(OP_READRESERVED);
+	OperationLatencyTimer latency_timer(OP_READRESERVED);
 	if (debug_mode) {
 		oplog_printf(ctx, "readreserved (%" PRIu64 ",%" PRIu64 ") ...",
 				(uint64_t)max_entries,
@@ -1738,6 +1953,7 @@ std::vector<NamedInodeEntry> readreserved(Context &ctx, NamedInodeOffset off, Na
 
 std::vector<NamedInodeEntry> readtrash(Context &ctx, NamedInodeOffset off, NamedInodeOffset max_entries) {
 	stats_inc(OP_READTRASH);
+	OperationLatencyTimer latency_timer(OP_READTRASH);
 	if (debug_mode) {
 		oplog_printf(ctx, "readtrash (%" PRIu64 ",%" PRIu64 ") ...",
 				(uint64_t)max_entries,
@@ -1760,6 +1976,7 @@ void releasedir(Inode ino) {
 	static constexpr int kBatchSize = 1000;
 
 	stats_inc(OP_RELEASEDIR);
+	OperationLatencyTimer latency_timer(OP_RELEASEDIR);
 	if (debug_mode) {
 		oplog_printf("releasedir (%lu) ...",
 				(unsigned long int)ino);
@@ -1798,10 +2015,12 @@ static finfo* fs_newfileinfo(uint8_t accmode, uint32_t inode) {
 	if (accmode == O_RDONLY) {
 		fileinfo->mode = IO_READONLY;
 		fileinfo->data = read_data_new(inode);
-	} else if (accmode == O_WRONLY) {
+	} else if (accmode == O_WRONLY && !writeback_cache) {
 		fileinfo->mode = IO_WRITEONLY;
 		fileinfo->data = write_data_new(inode);
 	} else {
+		// With writeback cache the kernel reads pages of write-only files, which it is going
+		// to modify partially, so such files are handled like read-write ones.
 		fileinfo->mode = IO_NONE;
 		fileinfo->data = NULL;
 	}
@@ -1842,6 +2061,8 @@ EntryParam create(Context &ctx, Inode parent, const char *name, mode_t mode,
 
 	makemodestr(modestr,mode);
 	stats_inc(OP_CREATE);
+	OperationLatencyTimer latency_timer(OP_CREATE);
+	uint64_t cache_sequence = cache_invalidation_sequence();
 	if (debug_mode) {
 		oplog_printf(ctx, "create (%lu,%s,-%s:0%04o)",
 				(unsigned long int)parent,
@@ -1888,8 +2109,27 @@ EntryParam create(Context &ctx, Inode parent, const char *name, mode_t mode,
 		throw RequestException(LIZARDFS_ERROR_EINVAL);
 	}
 
+	// Create and open the file with one request if the master supports it. This is the only
+	// sequence executed by a single handler: path walks (lookup, getattr, open) and setattr
+	// after create come from the kernel as separate FUSE requests, each answered before the
+	// next one is sent, so there is nothing to batch here.
+	std::vector<CompoundMetadataOp> operations = {
+		CompoundMetadataOp::mknod(parent, std::string(name, nleng), TYPE_FILE, mode & 07777,
+				ctx.umask, 0),
+		CompoundMetadataOp::open(CompoundMetadataOp::kPreviousInode, oflags)
+	};
+	std::vector<CompoundMetadataOpResult> results;
 	RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
-		fs_mknod(parent,nleng,(const uint8_t*)name,TYPE_FILE,mode&07777,ctx.umask,ctx.uid,ctx.gid,0,inode,attr));
+		fs_compound(ctx.uid, ctx.gid, operations, results));
+	if (status == LIZARDFS_STATUS_OK) {
+		status = results[0].status;
+		inode = results[0].inode;
+		attr = results[0].attr;
+	} else if (status == LIZARDFS_ERROR_ENOTSUP) {
+		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
+			fs_mknod(parent,nleng,(const uint8_t*)name,TYPE_FILE,mode&07777,ctx.umask,ctx.uid,ctx.gid,0,inode,attr));
+		results.clear();
+	}
 	if (status != LIZARDFS_STATUS_OK) {
 		oplog_printf(ctx, "create (%lu,%s,-%s:0%04o) (mknod): %s",
 				(unsigned long int)parent,
@@ -1899,9 +2139,13 @@ EntryParam create(Context &ctx, Inode parent, const char *name, mode_t mode,
 				lizardfs_error_string(status));
 		throw RequestException(status);
 	}
-	Attributes tmp_attr;
-	RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
-		fs_opencheck(inode,ctx.uid,ctx.gid,oflags,tmp_attr));
+	if (results.size() == operations.size()) {
+		status = results[1].status;
+	} else {
+		Attributes tmp_attr;
+		RETRY_ON_ERROR_WITH_UPDATED_CREDENTIALS(status, ctx,
+			fs_opencheck(inode,ctx.uid,ctx.gid,oflags,tmp_attr));
+	}
 
 	if (status != LIZARDFS_STATUS_OK) {
 		oplog_printf(ctx, "create (%lu,%s,-%s:0%04o) (open): %s",
@@ -1928,8 +2172,8 @@ EntryParam create(Context &ctx, Inode parent, const char *name, mode_t mode,
 	}
 	gDirEntryCache.lockAndInvalidateParent(ctx, parent);
 	e.ino = inode;
-	e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout;
-	e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout;
+	e.attr_timeout = (mattr&MATTR_NOACACHE)?0.0:attr_cache_timeout_for(inode, cache_sequence);
+	e.entry_timeout = (mattr&MATTR_NOECACHE)?0.0:entry_cache_timeout_for(parent, name, false, cache_sequence);
 	attr_to_stat(inode,attr,&e.attr);
 	makeattrstr(attrstr,256,&e.attr);
 	oplog_printf(ctx, "create (%lu,%s,-%s:0%04o): OK (%.1f,%lu,%.1f,%s,%lu)",
@@ -1954,6 +2198,7 @@ void open(Context &ctx, Inode ino, FileInfo *fi) {
 	finfo *fileinfo;
 
 	stats_inc(OP_OPEN);
+	OperationLatencyTimer latency_timer(OP_OPEN);
 	if (debug_mode) {
 		oplog_printf(ctx, "open (%lu) ...", (unsigned long int)ino);
 	}
@@ -2014,6 +2259,7 @@ void release(Inode ino, FileInfo *fi) {
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 
 	stats_inc(OP_RELEASE);
+	OperationLatencyTimer latency_timer(OP_RELEASE);
 	if (debug_mode) {
 		oplog_printf("release (%lu) ...", (unsigned long int)ino);
 	}
@@ -2043,6 +2289,7 @@ std::vector<uint8_t> read_special_inode(Context &ctx,
 			FileInfo* fi) {
 	LOG_AVG_TILL_END_OF_SCOPE0("read");
 	stats_inc(OP_READ);
+	OperationLatencyTimer latency_timer(OP_READ);
 
 	return special_read(ino, ctx, size, off, fi, debug_mode);
 }
@@ -2054,6 +2301,7 @@ ReadCache::Result read(Context &ctx,
 			FileInfo *fi) {
 	LOG_AVG_TILL_END_OF_SCOPE0("read");
 	stats_inc(OP_READ);
+	OperationLatencyTimer latency_timer(OP_READ);
 
 	finfo *fileinfo = reinterpret_cast<finfo*>(fi->fh);
 	int err;
@@ -2169,6 +2417,7 @@ BytesWritten write(Context &ctx, Inode ino, const char *buf, size_t size, off_t
 	int err;
 
 	stats_inc(OP_WRITE);
+	OperationLatencyTimer latency_timer(OP_WRITE);
 	if (debug_mode) {
 		oplog_printf(ctx, "write (%lu,%" PRIu64 ",%" PRIu64 ") ...",
 				(unsigned long int)ino,
@@ -2256,6 +2505,7 @@ void flush(Context &ctx, Inode ino, FileInfo* fi) {
 	int err;
 
 	stats_inc(OP_FLUSH);
+	OperationLatencyTimer latency_timer(OP_FLUSH);
 	if (debug_mode) {
 		oplog_printf(ctx, "flush (%lu) ...",
 				(unsigned long int)ino);
@@ -2299,6 +2549,7 @@ void fsync(Context &ctx, Inode ino, int datasync, FileInfo* fi) {
 	int err;
 
 	stats_inc(OP_FSYNC);
+	OperationLatencyTimer latency_timer(OP_FSYNC);
 	if (debug_mode) {
 		oplog_printf(ctx, "fsync (%lu,%d) ...",
 				(unsigned long int)ino,
@@ -2700,6 +2951,7 @@ void setxattr(Context &ctx, Inode ino, const char *name, const char *value,
 
 
 	stats_inc(OP_SETXATTR);
+	OperationLatencyTimer latency_timer(OP_SETXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "setxattr (%lu,%s,%" PRIu64 ",%d) ...",
 				(unsigned long int)ino,
@@ -2817,6 +3069,7 @@ XattrReply getxattr(Context &ctx, Inode ino, const char *name, size_t size, uint
 
 
 	stats_inc(OP_GETXATTR);
+	OperationLatencyTimer latency_timer(OP_GETXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "getxattr (%lu,%s,%" PRIu64 ") ...",
 				(unsigned long int)ino,
@@ -2915,6 +3168,7 @@ XattrReply listxattr(Context &ctx, Inode ino, size_t size) {
 	uint8_t mode;
 
 	stats_inc(OP_LISTXATTR);
+	OperationLatencyTimer latency_timer(OP_LISTXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "listxattr (%lu,%" PRIu64 ") ...",
 				(unsigned long int)ino,
@@ -2969,6 +3223,7 @@ void removexattr(Context &ctx, Inode ino, const char *name) {
 	int status;
 
 	stats_inc(OP_REMOVEXATTR);
+	OperationLatencyTimer latency_timer(OP_REMOVEXATTR);
 	if (debug_mode) {
 		oplog_printf(ctx, "removexattr (%lu,%s) ...",
 				(unsigned long int)ino,
@@ -3031,6 +3286,7 @@ void getlk(Context &ctx, Inode ino, FileInfo* fi, struct lzfs_locks::FlockWrappe
 	uint32_t status;
 
 	stats_inc(OP_FLOCK);
+	OperationLatencyTimer latency_timer(OP_GETLK);
 	if (IS_SPECIAL_INODE(ino)) {
 		if (debug_mode) {
 			oplog_printf(ctx, "flock(ctx, %lu, fi): %s", (unsigned long int)ino, lizardfs_error_string(LIZARDFS_ERROR_EINVAL));
@@ -3058,6 +3314,7 @@ uint32_t setlk_send(Context &ctx, Inode ino, FileInfo* fi, struct lzfs_locks::Fl
 	uint32_t status;
 
 	stats_inc(OP_SETLK);
+	OperationLatencyTimer latency_timer(OP_SETLK);
 	if (IS_SPECIAL_INODE(ino)) {
 		if (debug_mode) {
 			oplog_printf(ctx, "flock(ctx, %lu, fi): %s", (unsigned long int)ino, lizardfs_error_string(LIZARDFS_ERROR_EINVAL));
@@ -3107,6 +3364,7 @@ uint32_t flock_send(Context &ctx, Inode ino, FileInfo* fi, int op) {
 	uint32_t status;
 
 	stats_inc(OP_FLOCK);
+	OperationLatencyTimer latency_timer(OP_FLOCK);
 	if (IS_SPECIAL_INODE(ino)) {
 		if (debug_mode) {
 			oplog_printf(ctx, "flock(ctx, %lu, fi): %s", (unsigned long int)ino, lizardfs_error_string(LIZARDFS_ERROR_EINVAL));
@@ -3229,12 +3487,14 @@ std::vector<ChunkserverListEntry> getchunkservers() {
 	return chunkservers;
 }
 
-void init(int debug_mode_, int keep_cache_, double direntry_cache_timeout_, unsigned direntry_cache_size_,
-		double entry_cache_timeout_, double attr_cache_timeout_, int mkdir_copy_sgid_,
+void init(int debug_mode_, int keep_cache_, bool writeback_cache_,
+		double direntry_cache_timeout_, unsigned direntry_cache_size_,
+		unsigned direntry_cache_prefetch_, double entry_cache_timeout_, double attr_cache_timeout_, int mkdir_copy_sgid_,
 		SugidClearMode sugid_clear_mode_, bool use_rwlock_,
 		double acl_cache_timeout_, unsigned acl_cache_size_) {
 	debug_mode = debug_mode_;
 	keep_cache = keep_cache_;
+	writeback_cache = writeback_cache_;
 	direntry_cache_timeout = direntry_cache_timeout_;
 	entry_cache_timeout = entry_cache_timeout_;
 	attr_cache_timeout = attr_cache_timeout_;
@@ -3244,10 +3504,13 @@ void init(int debug_mode_, int keep_cache_, double direntry_cache_timeout_, unsi
 	uint64_t timeout = (uint64_t)(direntry_cache_timeout * 1000000);
 	gDirEntryCache.setTimeout(timeout);
 	gDirEntryCacheMaxSize = direntry_cache_size_;
+	gDirEntryCachePrefetch = direntry_cache_prefetch_;
 	if (debug_mode) {
-		lzfs::log_debug("cache parameters: file_keep_cache={} direntry_cache_timeout={:.2f}"
+		lzfs::log_debug("cache parameters: file_keep_cache={} writeback_cache={}"
+		                " direntry_cache_timeout={:.2f}"
 		                " entry_cache_timeout={:.2f} attr_cache_timeout={:.2f}",
 		                (keep_cache==1)?"always":(keep_cache==2)?"never":"auto",
+		                writeback_cache ? "enabled" : "disabled",
 		                direntry_cache_timeout, entry_cache_timeout, attr_cache_timeout);
 		lzfs::log_debug("mkdir copy sgid={} sugid clear mode={}",
 		                mkdir_copy_sgid_, sugidClearModeString(sugid_clear_mode_));
@@ -3256,6 +3519,7 @@ void init(int debug_mode_, int keep_cache_, double direntry_cache_timeout_, unsi
 		                acl_cache_timeout_, acl_cache_size_);
 	}
 	statsptr_init();
+	globalChunkserverStats.setLatencyHistograms(&gOperationLatencies);
 
 	acl_cache.reset(new AclCache(
 			std::chrono::milliseconds((int)(1000 * acl_cache_timeout_)),
@@ -3306,18 +3570,33 @@ void fs_init(FsInitParams &params) {
 			params.total_read_timeout_ms,
 			params.cache_expiration_time_ms,
 			params.readahead_max_window_size_kB,
+			params.readahead_workers,
+			params.read_cache_size_MB,
+			params.parallel_chunk_reads,
 			params.prefetch_xor_stripes,
-			std::max(params.bandwidth_overuse, 1.));
+			std::max(params.bandwidth_overuse, 1.),
+			params.local_chunkserver_socket_dir);
 	write_data_init(params.write_cache_size, params.io_retries, params.write_workers,
-			params.write_window_size, params.chunkserver_write_timeout_ms, params.cache_per_inode_percentage);
+			params.write_window_size, params.chunkserver_write_timeout_ms, params.cache_per_inode_percentage,
+			params.parity_workers, params.write_coalesce_delay_ms,
+			params.local_chunkserver_socket_dir);
 
-	init(params.debug_mode, params.keep_cache, params.direntry_cache_timeout, params.direntry_cache_size,
+	init(params.debug_mode, params.keep_cache, params.writeback_cache,
+		params.direntry_cache_timeout, params.direntry_cache_size,
+		params.direntry_cache_prefetch,
 		params.entry_cache_timeout, params.attr_cache_timeout, params.mkdir_copy_sgid,
 		params.sugid_clear_mode, params.use_rw_lock,
 		params.acl_cache_timeout, params.acl_cache_size);
+
+	if (params.cache_invalidation) {
+		gCacheInvalidator.reset(new CacheInvalidator(invalidate_inode_cache,
+				invalidate_entry_cache, update_direntry_cache_timeout));
+		update_direntry_cache_timeout();
+	}
 }
 
 void fs_term() {
+	gCacheInvalidator.reset();
 	write_data_term();
 	read_data_term();
 	masterproxy_term();
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <functional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -57,6 +58,7 @@ struct FsInitParams {
 	static constexpr unsigned kDefaultReportReservedPeriod = 30;
 #endif
 	static constexpr unsigned kDefaultIoRetries = 30;
+	static constexpr unsigned kDefaultMasterConnections = 1;
 	static constexpr unsigned kDefaultRoundTime = 200;
 	static constexpr unsigned kDefaultChunkserverConnectTo = 2000;
 	static constexpr unsigned kDefaultChunkserverReadTo = 2000;
@@ -64,6 +66,9 @@ struct FsInitParams {
 	static constexpr unsigned kDefaultChunkserverTotalReadTo = 2000;
 	static constexpr unsigned kDefaultCacheExpirationTime = 0;
 	static constexpr unsigned kDefaultReadaheadMaxWindowSize = 16384;
+	static constexpr unsigned kDefaultReadaheadWorkers = 4;
+	static constexpr unsigned kDefaultReadCacheSize = 0;
+	static constexpr unsigned kDefaultParallelChunkReads = 4;
 	static constexpr bool     kDefaultPrefetchXorStripes = false;
 
 	static constexpr float    kDefaultBandwidthOveruse = 1.0;
@@ -75,7 +80,9 @@ struct FsInitParams {
 #endif
 	static constexpr unsigned kDefaultCachePerInodePercentage = 25;
 	static constexpr unsigned kDefaultWriteWorkers = 10;
+	static constexpr unsigned kDefaultParityWorkers = 2;
 	static constexpr unsigned kDefaultWriteWindowSize = 15;
+	static constexpr unsigned kDefaultWriteCoalesceDelay = 5000;
 	static constexpr unsigned kDefaultSymlinkCacheTimeout = 3600;
 #if FUSE_VERSION >= 30
 	static constexpr int      kDefaultNonEmptyMounts = 0;
@@ -83,10 +90,13 @@ struct FsInitParams {
 
 	static constexpr bool     kDefaultDebugMode = false;
 	static constexpr int      kDefaultKeepCache = 0;
+	static constexpr bool     kDefaultWritebackCache = false;
 	static constexpr double   kDefaultDirentryCacheTimeout = 0.25;
 	static constexpr unsigned kDefaultDirentryCacheSize = 100000;
+	static constexpr unsigned kDefaultDirentryCachePrefetch = 0;
 	static constexpr double   kDefaultEntryCacheTimeout = 0.0;
 	static constexpr double   kDefaultAttrCacheTimeout = 1.0;
+	static constexpr bool     kDefaultCacheInvalidation = false;
 #ifdef __linux__
 	static constexpr bool     kDefaultMkdirCopySgid = true;
 #else
@@ -112,22 +122,31 @@ struct FsInitParams {
 	             do_not_remember_password(kDefaultDoNotRememberPassword), delayed_init(kDefaultDelayedInit),
 	             report_reserved_period(kDefaultReportReservedPeriod),
 	             io_retries(kDefaultIoRetries),
+	             master_connections(kDefaultMasterConnections),
 	             chunkserver_round_time_ms(kDefaultRoundTime),
 	             chunkserver_connect_timeout_ms(kDefaultChunkserverConnectTo),
 	             chunkserver_wave_read_timeout_ms(kDefaultChunkserverWaveReadTo),
 	             total_read_timeout_ms(kDefaultChunkserverTotalReadTo),
 	             cache_expiration_time_ms(kDefaultCacheExpirationTime),
 	             readahead_max_window_size_kB(kDefaultReadaheadMaxWindowSize),
+	             readahead_workers(kDefaultReadaheadWorkers),
+	             read_cache_size_MB(kDefaultReadCacheSize),
+	             parallel_chunk_reads(kDefaultParallelChunkReads),
 	             prefetch_xor_stripes(kDefaultPrefetchXorStripes),
 	             bandwidth_overuse(kDefaultBandwidthOveruse),
 	             write_cache_size(kDefaultWriteCacheSize),
 	             write_workers(kDefaultWriteWorkers), write_window_size(kDefaultWriteWindowSize),
+	             parity_workers(kDefaultParityWorkers),
+	             write_coalesce_delay_ms(kDefaultWriteCoalesceDelay),
 	             chunkserver_write_timeout_ms(kDefaultChunkserverWriteTo),
 	             cache_per_inode_percentage(kDefaultCachePerInodePercentage),
 	             symlink_cache_timeout_s(kDefaultSymlinkCacheTimeout),
 	             debug_mode(kDefaultDebugMode), keep_cache(kDefaultKeepCache),
+	             writeback_cache(kDefaultWritebackCache),
 	             direntry_cache_timeout(kDefaultDirentryCacheTimeout), direntry_cache_size(kDefaultDirentryCacheSize),
+	             direntry_cache_prefetch(kDefaultDirentryCachePrefetch),
 	             entry_cache_timeout(kDefaultEntryCacheTimeout), attr_cache_timeout(kDefaultAttrCacheTimeout),
+	             cache_invalidation(kDefaultCacheInvalidation),
 	             mkdir_copy_sgid(kDefaultMkdirCopySgid), sugid_clear_mode(kDefaultSugidClearMode),
 	             use_rw_lock(kDefaultUseRwLock),
 	             acl_cache_timeout(kDefaultAclCacheTimeout), acl_cache_size(kDefaultAclCacheSize),
@@ -139,22 +158,31 @@ struct FsInitParams {
 	             do_not_remember_password(kDefaultDoNotRememberPassword), delayed_init(kDefaultDelayedInit),
 	             report_reserved_period(kDefaultReportReservedPeriod),
 	             io_retries(kDefaultIoRetries),
+	             master_connections(kDefaultMasterConnections),
 	             chunkserver_round_time_ms(kDefaultRoundTime),
 	             chunkserver_connect_timeout_ms(kDefaultChunkserverConnectTo),
 	             chunkserver_wave_read_timeout_ms(kDefaultChunkserverWaveReadTo),
 	             total_read_timeout_ms(kDefaultChunkserverTotalReadTo),
 	             cache_expiration_time_ms(kDefaultCacheExpirationTime),
 	             readahead_max_window_size_kB(kDefaultReadaheadMaxWindowSize),
+	             readahead_workers(kDefaultReadaheadWorkers),
+	             read_cache_size_MB(kDefaultReadCacheSize),
+	             parallel_chunk_reads(kDefaultParallelChunkReads),
 	             prefetch_xor_stripes(kDefaultPrefetchXorStripes),
 	             bandwidth_overuse(kDefaultBandwidthOveruse),
 	             write_cache_size(kDefaultWriteCacheSize),
 	             write_workers(kDefaultWriteWorkers), write_window_size(kDefaultWriteWindowSize),
+	             parity_workers(kDefaultParityWorkers),
+	             write_coalesce_delay_ms(kDefaultWriteCoalesceDelay),
 	             chunkserver_write_timeout_ms(kDefaultChunkserverWriteTo),
 	             cache_per_inode_percentage(kDefaultCachePerInodePercentage),
 	             symlink_cache_timeout_s(kDefaultSymlinkCacheTimeout),
 	             debug_mode(kDefaultDebugMode), keep_cache(kDefaultKeepCache),
+	             writeback_cache(kDefaultWritebackCache),
 	             direntry_cache_timeout(kDefaultDirentryCacheTimeout), direntry_cache_size(kDefaultDirentryCacheSize),
+	             direntry_cache_prefetch(kDefaultDirentryCachePrefetch),
 	             entry_cache_timeout(kDefaultEntryCacheTimeout), attr_cache_timeout(kDefaultAttrCacheTimeout),
+	             cache_invalidation(kDefaultCacheInvalidation),
 	             mkdir_copy_sgid(kDefaultMkdirCopySgid), sugid_clear_mode(kDefaultSugidClearMode),
 	             use_rw_lock(kDefaultUseRwLock),
 	             acl_cache_timeout(kDefaultAclCacheTimeout), acl_cache_size(kDefaultAclCacheSize),
@@ -173,18 +201,25 @@ struct FsInitParams {
 	unsigned report_reserved_period;
 
 	unsigned io_retries;
+	unsigned master_connections;
 	unsigned chunkserver_round_time_ms;
 	unsigned chunkserver_connect_timeout_ms;
 	unsigned chunkserver_wave_read_timeout_ms;
 	unsigned total_read_timeout_ms;
 	unsigned cache_expiration_time_ms;
 	unsigned readahead_max_window_size_kB;
+	unsigned readahead_workers;
+	unsigned read_cache_size_MB;
+	unsigned parallel_chunk_reads;
 	bool prefetch_xor_stripes;
 	double bandwidth_overuse;
+	std::string local_chunkserver_socket_dir;
 
 	unsigned write_cache_size;
 	unsigned write_workers;
 	unsigned write_window_size;
+	unsigned parity_workers;
+	unsigned write_coalesce_delay_ms;
 	unsigned chunkserver_write_timeout_ms;
 	unsigned cache_per_inode_percentage;
 	unsigned symlink_cache_timeout_s;
@@ -192,10 +227,13 @@ struct FsInitParams {
 	bool debug_mode;
 	// NOTICE(sarna): This variable can hold more values than 0-1, don't change it to bool ever.
 	int keep_cache;
+	bool writeback_cache;
 	double direntry_cache_timeout;
 	unsigned direntry_cache_size;
+	unsigned direntry_cache_prefetch;
 	double entry_cache_timeout;
 	double attr_cache_timeout;
+	bool cache_invalidation;
 	bool mkdir_copy_sgid;
 	SugidClearMode sugid_clear_mode;
 	bool use_rw_lock;
@@ -306,6 +344,26 @@ void updateGroups(Context &ctx);
 
 void masterDisconnectedCallback();
 
+typedef std::function<void(Inode inode)> KernelInodeInvalidator;
+typedef std::function<void(Inode parent, const std::string &name)> KernelEntryInvalidator;
+
+/// Sets functions dropping metadata cached by the kernel when the master notifies about
+/// its changes (see FsInitParams::cache_invalidation); empty functions unset them.
+void setKernelCacheInvalidators(KernelInodeInvalidator inodeInvalidator,
+		KernelEntryInvalidator entryInvalidator);
+
+/// Sequence of cache invalidation notifications, to be taken before a request whose reply
+/// is passed to the kernel.
+uint64_t cache_invalidation_sequence();
+
+/// To be called after attributes of an inode were passed to the kernel. Drops them if the master
+/// notified about their change since the sequence was taken.
+void attr_replied(Inode ino, uint64_t sequence);
+
+/// To be called after an entry was passed to the kernel. Drops it (and attributes of its inode)
+/// if the master notified about their change since the sequence was taken.
+void entry_replied(Inode parent, const char *name, Inode ino, uint64_t sequence);
+
 // TODO what about this one? Will decide when writing non-fuse client
 // void fsinit(void *userdata, struct fuse_conn_info *conn);
 bool isSpecialInode(LizardClient::Inode ino);
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
@@ -47,8 +48,10 @@
 #include "common/lizardfs_version.h"
 #include "common/md5.h"
 #include "common/mfserr.h"
+#include "common/multi_buffer_writer.h"
 #include "common/sockets.h"
 #include "common/slogger.h"
+#include "common/time_utils.h"
 #include "mount/exports.h"
 #include "mount/stats.h"
 #include "protocol/cltoma.h"
@@ -56,8 +59,15 @@
 #include "protocol/MFSCommunication.h"
 #include "protocol/packet.h"
 
+enum class SendStatus : uint8_t {
+	kSent,
+	kError,
+	kSessionLost
+};
+
+struct MasterConnection;
+
 struct threc {
-	pthread_t thid;
 	std::mutex mutex;
 	std::condition_variable condition;
 	MessageBuffer outputBuffer;
@@ -69,8 +79,31 @@ struct threc {
 
 	uint32_t receivedType;
 
-	uint32_t packetId;      // thread number
-	threc *next;
+	uint32_t packetId;      // thread number, index in gThrecs
+
+	// Fields used by fs_threc_flush, guarded by sendQueueMutex and the connection's mutex
+	bool queuedForSending;  // packet waits in the send queue of a connection
+	SendStatus sendStatus;  // result of sending the packet
+	MasterConnection *connection; // connection used to send the last packet
+};
+
+/*! \brief Connection to the master.
+ *
+ * The first connection registers the session of the mount and reports its reserved inodes.
+ * Other connections are registered in the same session, they carry requests in parallel
+ * to avoid waiting for large replies sent to other threads.
+ */
+struct MasterConnection {
+	MasterConnection() : fd(-1), disconnect(false), lastwrite(0), connected(false) {
+	}
+
+	std::mutex mutex;               // guards fd, disconnect, lastwrite and writing to fd
+	int fd;
+	bool disconnect;
+	time_t lastwrite;
+	std::atomic<bool> connected;    // fd is valid, read without the mutex to choose connections
+	std::vector<threc*> sendQueue;  // records with packets to send, guarded by sendQueueMutex
+	pthread_t receiveThread;
 };
 
 typedef struct _acquired_file {
@@ -85,19 +118,43 @@ typedef struct _acquired_file {
 
 #define RECEIVE_TIMEOUT 10
 
-static threc *threchead=NULL;
+/*! \brief Record of the calling thread, valid only if its generation is the current one.
+ *
+ * When the thread exits, the record is returned to gFreeThrecs and reused (together with
+ * its packetId) by the next new thread.
+ */
+struct ThrecHolder {
+	ThrecHolder() : rec(nullptr), generation(0) {
+	}
+	~ThrecHolder();
+
+	threc *rec;
+	uint32_t generation;
+};
+
+// Records of all threads, indexed by packetId (gThrecs[0] is unused)
+static std::vector<threc*> gThrecs;
+// Records of finished threads, guarded by recMutex
+static std::vector<threc*> gFreeThrecs;
+static thread_local ThrecHolder gMyThrec;
+static std::atomic<uint32_t> gThrecGeneration(1);
+
+// Maximum number of packets sent in one writev call
+static const size_t kMaxPacketsSentAtOnce = 64;
+
+static const uint32_t kMaxMasterConnections = 16;
+static MasterConnection gConnections[kMaxMasterConnections];
+static MasterConnection &gMaster = gConnections[0]; // connection which registers the session
+static uint32_t gConnectionCount = 1;
 
 static acquired_file *afhead=NULL;
 
-static int fd;
-static bool disconnect;
-static time_t lastwrite;
 static int sessionlost;
 
 static uint32_t maxretries;
 
-static pthread_t rpthid,npthid;
-static std::mutex fdMutex, recMutex, acquiredFileMutex;
+static pthread_t npthid;
+static std::mutex recMutex, sendQueueMutex, acquiredFileMutex;
 
 static uint32_t sessionid;
 static uint32_t masterversion;
@@ -190,15 +247,27 @@ void master_stats_add(uint8_t id,uint64_t s) {
 	}
 }
 
-static inline void setDisconnect(bool value) {
-	std::unique_lock<std::mutex> fdLock(fdMutex);
-	disconnect = value;
+static void setDisconnect(MasterConnection &conn, bool value) {
+	std::unique_lock<std::mutex> fdLock(conn.mutex);
+	conn.disconnect = value;
 	if(value) {
-		LizardClient::masterDisconnectedCallback();
+		if (&conn == &gMaster) {
+			LizardClient::masterDisconnectedCallback();
+		}
 		lzfs_pretty_syslog(LOG_WARNING,"master: disconnected");
 	}
 }
 
+/*! \brief Drops the connection which delivered the last reply to the calling thread. */
+static inline void setDisconnect(bool value) {
+	threc *rec = gMyThrec.rec;
+	if (rec && gMyThrec.generation == gThrecGeneration && rec->connection) {
+		setDisconnect(*rec->connection, value);
+	} else {
+		setDisconnect(gMaster, value);
+	}
+}
+
 void fs_inc_acnt(uint32_t inode) {
 	acquired_file *afptr,**afpptr;
 	std::unique_lock<std::mutex> acquiredFileLock(acquiredFileMutex);
@@ -238,39 +307,54 @@ void fs_dec_acnt(uint32_t inode) {
 	}
 }
 
+ThrecHolder::~ThrecHolder() {
+	if (rec == nullptr) {
+		return;
+	}
+	std::unique_lock<std::mutex> recLock(recMutex);
+	// records of older generations were deleted by fs_term
+	if (generation == gThrecGeneration) {
+		gFreeThrecs.push_back(rec);
+	}
+}
+
 threc* fs_get_my_threc() {
-	pthread_t mythid = pthread_self();
-	threc *rec;
+	uint32_t generation = gThrecGeneration;
+	if (gMyThrec.rec && gMyThrec.generation == generation) {
+		return gMyThrec.rec;
+	}
 	std::unique_lock<std::mutex> recLock(recMutex);
-	for (rec = threchead ; rec ; rec = rec->next) {
-		if (pthread_equal(rec->thid, mythid)) {
-			return rec;
+	threc *rec;
+	if (!gFreeThrecs.empty()) {
+		rec = gFreeThrecs.back();
+		gFreeThrecs.pop_back();
+	} else {
+		rec = new threc;
+		if (gThrecs.empty()) {
+			gThrecs.push_back(nullptr);
 		}
+		rec->packetId = gThrecs.size();
+		gThrecs.push_back(rec);
 	}
-	rec = new threc;
-	rec->thid = mythid;
+	// the receiving thread may look at the record of a finished thread
+	std::unique_lock<std::mutex> lock(rec->mutex);
 	rec->sent = false;
 	rec->status = 0;
 	rec->received = false;
 	rec->waiting = 0;
 	rec->receivedType = 0;
-	if (threchead==NULL) {
-		rec->packetId = 1;
-	} else {
-		rec->packetId = threchead->packetId + 1;
-	}
-	rec->next = threchead;
-	threchead = rec;
+	rec->queuedForSending = false;
+	rec->sendStatus = SendStatus::kError;
+	rec->connection = nullptr;
+	gMyThrec.rec = rec;
+	gMyThrec.generation = generation;
 	return rec;
 }
 
 threc* fs_get_threc_by_id(uint32_t packetId) {
-	threc *rec;
 	std::unique_lock<std::mutex> recLock(recMutex);
-	for (rec = threchead ; rec ; rec=rec->next) {
-		if (rec->packetId==packetId) {
-			return rec;
-		}
+	if (packetId < gThrecs.size()) {
+		return gThrecs[packetId];
 	}
 	return NULL;
 }
@@ -295,28 +379,141 @@ bool fs_lizcreatepacket(threc *rec, MessageBuffer message) {
 
 LIZARDFS_CREATE_EXCEPTION_CLASS_MSG(LostSessionException, Exception, "session lost");
 
-static bool fs_threc_flush(threc *rec) {
-	std::unique_lock<std::mutex> fdLock(fdMutex);
+/*! \brief Writes all the buffers to the master's socket. fdLock: LOCKED */
+static bool fs_write_to_master(int fd, MultiBufferWriter& writer, int msecto) {
+	pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLOUT;
+	while (writer.hasDataToSend()) {
+		pfd.revents = 0;
+		if (tcppoll(pfd, msecto) < 0) {
+			return false;
+		}
+		if (!(pfd.revents & POLLOUT)) {
+			tcpsetlasterror(TCPETIMEDOUT);
+			return false;
+		}
+		ssize_t ret = writer.writeTo(fd);
+		if (ret == 0 || (ret < 0 && tcpgetlasterror() != TCPEAGAIN)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*! \brief Sends packets of the given records in one writev call. fdLock: LOCKED */
+static void fs_send_packets(MasterConnection &conn, const std::vector<threc*>& batch) {
+	SendStatus status = SendStatus::kSent;
 	if (sessionlost) {
-		throw LostSessionException();
+		status = SendStatus::kSessionLost;
+	} else if (conn.fd == -1) {
+		status = SendStatus::kError;
+	} else {
+		// Owners of the records wait for conn.mutex, so their output buffers don't change.
+		// A reply can't be received before sending the request, so the records are marked
+		// as sent in advance.
+		MultiBufferWriter writer;
+		uint64_t size = 0;
+		for (threc *rec : batch) {
+			std::unique_lock<std::mutex> lock(rec->mutex);
+			rec->received = false;
+			rec->sent = true;
+			rec->connection = &conn;
+			writer.addBufferToSend(rec->outputBuffer.data(), rec->outputBuffer.size());
+			size += rec->outputBuffer.size();
+		}
+		if (fs_write_to_master(conn.fd, writer, 1000)) {
+			master_stats_add(MASTER_BYTESSENT, size);
+			master_stats_add(MASTER_PACKETSSENT, batch.size());
+			conn.lastwrite = time(NULL);
+		} else {
+			lzfs_pretty_syslog(LOG_WARNING, "tcp send error: %s", strerr(tcpgetlasterror()));
+			conn.disconnect = true;
+			status = SendStatus::kError;
+			for (threc *rec : batch) {
+				std::unique_lock<std::mutex> lock(rec->mutex);
+				rec->sent = false;
+			}
+		}
 	}
-	if (fd==-1) {
-		return false;
+	for (threc *rec : batch) {
+		rec->sendStatus = status;
 	}
-	std::unique_lock<std::mutex> lock(rec->mutex);
-	const int32_t size = rec->outputBuffer.size();
-	if (tcptowrite(fd, rec->outputBuffer.data(), size, 1000) != size) {
-		lzfs_pretty_syslog(LOG_WARNING, "tcp send error: %s", strerr(tcpgetlasterror()));
-		disconnect = true;
-		return false;
+}
+
+/*! \brief Chooses a connection for the packet prepared in the record.
+ *
+ * Requests which may get large replies have their own connection, so that they don't delay
+ * replies for other threads. Locks and subscriptions are bound to the connection they were
+ * sent with, so they always use the first one. Other requests are spread by thread.
+ */
+static MasterConnection& fs_choose_connection(threc *rec) {
+	if (gConnectionCount == 1 || rec->outputBuffer.size() < 4) {
+		return gMaster;
+	}
+	const uint8_t *ptr = rec->outputBuffer.data();
+	MasterConnection *conn;
+	switch (get32bit(&ptr)) {
+	case LIZ_CLTOMA_FUSE_FLOCK:
+	case LIZ_CLTOMA_FUSE_GETLK:
+	case LIZ_CLTOMA_FUSE_SETLK:
+	case LIZ_CLTOMA_CACHE_INVALIDATION_SUBSCRIBE:
+	case LIZ_CLTOMA_IOLIMIT:
+		return gMaster;
+	case CLTOMA_FUSE_GETDIR:
+	case LIZ_CLTOMA_FUSE_GETDIR:
+	case CLTOMA_FUSE_GETXATTR:
+	case CLTOMA_FUSE_GETTRASH:
+	case LIZ_CLTOMA_FUSE_GETTRASH:
+	case CLTOMA_FUSE_GETRESERVED:
+	case LIZ_CLTOMA_FUSE_GETRESERVED:
+	case LIZ_CLTOMA_FUSE_READ_CHUNKS:
+	case LIZ_CLTOMA_CHUNKS_INFO:
+	case LIZ_CLTOMA_CSERV_LIST:
+		conn = &gConnections[gConnectionCount - 1];
+		break;
+	default:
+		conn = &gConnections[rec->packetId % (gConnectionCount - 1)];
+	}
+	// Use the first connection while the chosen one is being reestablished
+	return conn->connected ? *conn : gMaster;
+}
+
+/*! \brief Sends the packet prepared in the record.
+ *
+ * Packets of threads which send at the same time are queued. The thread which gets the mutex
+ * of the connection first sends packets of all of them, so that the others don't have to wait
+ * for their turn to write to the socket.
+ */
+static bool fs_threc_flush(threc *rec) {
+	MasterConnection &conn = fs_choose_connection(rec);
+	{
+		std::unique_lock<std::mutex> queueLock(sendQueueMutex);
+		rec->queuedForSending = true;
+		conn.sendQueue.push_back(rec);
 	}
-	rec->received = false;
-	rec->sent = true;
-	lock.unlock();
-	master_stats_add(MASTER_BYTESSENT, size);
-	master_stats_inc(MASTER_PACKETSSENT);
-	lastwrite = time(NULL);
-	return true;
+	std::unique_lock<std::mutex> fdLock(conn.mutex);
+	for (;;) {
+		std::vector<threc*> batch;
+		{
+			std::unique_lock<std::mutex> queueLock(sendQueueMutex);
+			if (!rec->queuedForSending) {
+				// Sent by another thread (or by this one in the previous batch)
+				break;
+			}
+			size_t count = std::min(conn.sendQueue.size(), kMaxPacketsSentAtOnce);
+			batch.assign(conn.sendQueue.begin(), conn.sendQueue.begin() + count);
+			conn.sendQueue.erase(conn.sendQueue.begin(), conn.sendQueue.begin() + count);
+			for (threc *queued : batch) {
+				queued->queuedForSending = false;
+			}
+		}
+		fs_send_packets(conn, batch);
+	}
+	if (rec->sendStatus == SendStatus::kSessionLost) {
+		throw LostSessionException();
+	}
+	return rec->sendStatus == SendStatus::kSent;
 }
 
 static bool fs_threc_wait(threc *rec, std::unique_lock<std::mutex>& lock) {
@@ -336,14 +533,38 @@ static inline uint32_t sleep_time(uint32_t tryNo) {
 	}
 }
 
+// Latency histogram series of requests sent to the master plus one, indexed by packet type
+static std::atomic<uint16_t> gRequestLatencySeries[PacketHeader::kMaxLizPacketType + 1];
+
+/*! \brief Records latency of a request in gOperationLatencies. */
+static void fs_record_request_latency(const threc *rec, int64_t time_us) {
+	// the packet was prepared by this thread, so no lock is needed to read its type
+	if (rec->outputBuffer.size() < PacketHeader::kSize) {
+		return;
+	}
+	const uint8_t *ptr = rec->outputBuffer.data();
+	uint32_t type = get32bit(&ptr);
+	if (type > PacketHeader::kMaxLizPacketType) {
+		return;
+	}
+	unsigned series = gRequestLatencySeries[type].load(std::memory_order_relaxed);
+	if (series == 0) {
+		series = gOperationLatencies.series("master_requests." + std::to_string(type)) + 1;
+		gRequestLatencySeries[type].store(series, std::memory_order_relaxed);
+	}
+	gOperationLatencies.add(series - 1, time_us);
+}
+
 // TODO(jotek): not every request should be retransmitted if recv failed (e.g. snapshot)
 static bool fs_threc_send_receive(threc *rec, bool filter, PacketHeader::Type expected_type) {
+	Timer timer;
 	try {
 		for (uint32_t cnt = 0 ; cnt < maxretries ; cnt++) {
 			if (fs_threc_flush(rec)) {
 				std::unique_lock<std::mutex> lock(rec->mutex);
 				if (fs_threc_wait(rec, lock)) {
 					if (!filter || rec->receivedType == expected_type) {
+						fs_record_request_latency(rec, timer.elapsed_us());
 						return true;
 					} else {
 						lock.unlock();
@@ -493,12 +714,12 @@ int fs_connect(bool verbose) {
 		regbuff = (uint8_t*) malloc(8+64+13+pleng+ileng+16);
 	}
 
-	fd = tcpsocket();
-	if (fd<0) {
+	gMaster.fd = tcpsocket();
+	if (gMaster.fd<0) {
 		free(regbuff);
 		return -1;
 	}
-	if (tcpnodelay(fd)<0) {
+	if (tcpnodelay(gMaster.fd)<0) {
 		if (verbose) {
 			fprintf(stderr,"can't set TCP_NODELAY\n");
 		} else {
@@ -506,26 +727,26 @@ int fs_connect(bool verbose) {
 		}
 	}
 	if (srcip>0) {
-		if (tcpnumbind(fd,srcip,0)<0) {
+		if (tcpnumbind(gMaster.fd,srcip,0)<0) {
 			if (verbose) {
 				fprintf(stderr,"can't bind socket to given ip (\"%s\")\n",srcstrip);
 			} else {
 				lzfs_pretty_syslog(LOG_WARNING,"can't bind socket to given ip (\"%s\")",srcstrip);
 			}
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(gMaster.fd);
+			gMaster.fd=-1;
 			free(regbuff);
 			return -1;
 		}
 	}
-	if (tcpnumconnect(fd,masterip,masterport)<0) {
+	if (tcpnumconnect(gMaster.fd,masterip,masterport)<0) {
 		if (verbose) {
 			fprintf(stderr,"can't connect to mfsmaster (\"%s\":\"%" PRIu16 "\")\n",masterstrip,masterport);
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"can't connect to mfsmaster (\"%s\":\"%" PRIu16 "\")",masterstrip,masterport);
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
@@ -536,25 +757,25 @@ int fs_connect(bool verbose) {
 		memcpy(wptr,FUSE_REGISTER_BLOB_ACL,64);
 		wptr+=64;
 		put8bit(&wptr,REGISTER_GETRANDOM);
-		if (tcptowrite(fd,regbuff,8+65,1000)!=8+65) {
+		if (tcptowrite(gMaster.fd,regbuff,8+65,1000)!=8+65) {
 			if (verbose) {
 				fprintf(stderr,"error sending data to mfsmaster\n");
 			} else {
 				lzfs_pretty_syslog(LOG_WARNING,"error sending data to mfsmaster");
 			}
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(gMaster.fd);
+			gMaster.fd=-1;
 			free(regbuff);
 			return -1;
 		}
-		if (tcptoread(fd,regbuff,8,1000)!=8) {
+		if (tcptoread(gMaster.fd,regbuff,8,1000)!=8) {
 			if (verbose) {
 				fprintf(stderr,"error receiving data from mfsmaster\n");
 			} else {
 				lzfs_pretty_syslog(LOG_WARNING,"error receiving data from mfsmaster");
 			}
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(gMaster.fd);
+			gMaster.fd=-1;
 			free(regbuff);
 			return -1;
 		}
@@ -566,8 +787,8 @@ int fs_connect(bool verbose) {
 			} else {
 				lzfs_pretty_syslog(LOG_WARNING,"got incorrect answer from mfsmaster");
 			}
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(gMaster.fd);
+			gMaster.fd=-1;
 			free(regbuff);
 			return -1;
 		}
@@ -578,19 +799,19 @@ int fs_connect(bool verbose) {
 			} else {
 				lzfs_pretty_syslog(LOG_WARNING,"got incorrect answer from mfsmaster");
 			}
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(gMaster.fd);
+			gMaster.fd=-1;
 			free(regbuff);
 			return -1;
 		}
-		if (tcptoread(fd,regbuff,32,1000)!=32) {
+		if (tcptoread(gMaster.fd,regbuff,32,1000)!=32) {
 			if (verbose) {
 				fprintf(stderr,"error receiving data from mfsmaster\n");
 			} else {
 				lzfs_pretty_syslog(LOG_WARNING,"error receiving data from mfsmaster");
 			}
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(gMaster.fd);
+			gMaster.fd=-1;
 			free(regbuff);
 			return -1;
 		}
@@ -631,25 +852,25 @@ int fs_connect(bool verbose) {
 	if (havepassword) {
 		memcpy(wptr+pleng,digest,16);
 	}
-	if (tcptowrite(fd,regbuff,8+64+(gInitParams.meta?9:13)+ileng+pleng+(havepassword?16:0),1000)!=(int32_t)(8+64+(gInitParams.meta?9:13)+ileng+pleng+(havepassword?16:0))) {
+	if (tcptowrite(gMaster.fd,regbuff,8+64+(gInitParams.meta?9:13)+ileng+pleng+(havepassword?16:0),1000)!=(int32_t)(8+64+(gInitParams.meta?9:13)+ileng+pleng+(havepassword?16:0))) {
 		if (verbose) {
 			fprintf(stderr,"error sending data to mfsmaster: %s\n",strerr(tcpgetlasterror()));
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"error sending data to mfsmaster: %s",strerr(tcpgetlasterror()));
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
-	if (tcptoread(fd,regbuff,8,1000)!=8) {
+	if (tcptoread(gMaster.fd,regbuff,8,1000)!=8) {
 		if (verbose) {
 			fprintf(stderr,"error receiving data from mfsmaster: %s\n",strerr(tcpgetlasterror()));
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"error receiving data from mfsmaster: %s",strerr(tcpgetlasterror()));
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
@@ -661,8 +882,8 @@ int fs_connect(bool verbose) {
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"got incorrect answer from mfsmaster");
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
@@ -673,19 +894,19 @@ int fs_connect(bool verbose) {
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"got incorrect answer from mfsmaster");
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
-	if (tcptoread(fd,regbuff,i,1000)!=(int32_t)i) {
+	if (tcptoread(gMaster.fd,regbuff,i,1000)!=(int32_t)i) {
 		if (verbose) {
 			fprintf(stderr,"error receiving data from mfsmaster: %s\n",strerr(tcpgetlasterror()));
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"error receiving data from mfsmaster: %s",strerr(tcpgetlasterror()));
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
@@ -696,8 +917,8 @@ int fs_connect(bool verbose) {
 		} else {
 			lzfs_pretty_syslog(LOG_WARNING,"mfsmaster register error: %s",lizardfs_error_string(rptr[0]));
 		}
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(gMaster.fd);
+		gMaster.fd=-1;
 		free(regbuff);
 		return -1;
 	}
@@ -736,7 +957,7 @@ int fs_connect(bool verbose) {
 		maxtrashtime = 0;
 	}
 	free(regbuff);
-	lastwrite=time(NULL);
+	gMaster.lastwrite=time(NULL);
 	if (!verbose) {
 		lzfs_pretty_syslog(LOG_NOTICE,"registered to master with new session (id #%" PRIu32 ")", sessionid);
 	}
@@ -865,7 +1086,7 @@ int fs_connect(bool verbose) {
 	return 0;
 }
 
-void fs_reconnect() {
+void fs_reconnect(MasterConnection &conn) {
 	uint32_t i;
 	uint8_t *wptr,regbuff[8+64+9];
 	const uint8_t *rptr;
@@ -875,25 +1096,25 @@ void fs_reconnect() {
 		return;
 	}
 
-	fd = tcpsocket();
-	if (fd<0) {
+	conn.fd = tcpsocket();
+	if (conn.fd<0) {
 		return;
 	}
-	if (tcpnodelay(fd)<0) {
+	if (tcpnodelay(conn.fd)<0) {
 		lzfs_pretty_syslog(LOG_WARNING,"can't set TCP_NODELAY: %s",strerr(tcpgetlasterror()));
 	}
 	if (srcip>0) {
-		if (tcpnumbind(fd,srcip,0)<0) {
+		if (tcpnumbind(conn.fd,srcip,0)<0) {
 			lzfs_pretty_syslog(LOG_WARNING,"can't bind socket to given ip (\"%s\")",srcstrip);
-			tcpclose(fd);
-			fd=-1;
+			tcpclose(conn.fd);
+			conn.fd=-1;
 			return;
 		}
 	}
-	if (tcpnumconnect(fd,masterip,masterport)<0) {
+	if (tcpnumconnect(conn.fd,masterip,masterport)<0) {
 		lzfs_pretty_syslog(LOG_WARNING,"can't connect to master (\"%s\":\"%" PRIu16 "\")",masterstrip,masterport);
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
 	master_stats_inc(MASTER_CONNECTS);
@@ -907,18 +1128,18 @@ void fs_reconnect() {
 	put16bit(&wptr,LIZARDFS_PACKAGE_VERSION_MAJOR);
 	put8bit(&wptr,LIZARDFS_PACKAGE_VERSION_MINOR);
 	put8bit(&wptr,LIZARDFS_PACKAGE_VERSION_MICRO);
-	if (tcptowrite(fd,regbuff,8+64+9,1000)!=8+64+9) {
+	if (tcptowrite(conn.fd,regbuff,8+64+9,1000)!=8+64+9) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: register error (write: %s)",strerr(tcpgetlasterror()));
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
 	master_stats_add(MASTER_BYTESSENT,16+64);
 	master_stats_inc(MASTER_PACKETSSENT);
-	if (tcptoread(fd,regbuff,8,1000)!=8) {
+	if (tcptoread(conn.fd,regbuff,8,1000)!=8) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: register error (read header: %s)",strerr(tcpgetlasterror()));
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
 	master_stats_add(MASTER_BYTESRCVD,8);
@@ -926,34 +1147,36 @@ void fs_reconnect() {
 	i = get32bit(&rptr);
 	if (i!=MATOCL_FUSE_REGISTER) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: register error (bad answer: %" PRIu32 ")",i);
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
 	i = get32bit(&rptr);
 	if (i!=1) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: register error (bad length: %" PRIu32 ")",i);
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
-	if (tcptoread(fd,regbuff,i,1000)!=(int32_t)i) {
+	if (tcptoread(conn.fd,regbuff,i,1000)!=(int32_t)i) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: register error (read data: %s)",strerr(tcpgetlasterror()));
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
 	master_stats_add(MASTER_BYTESRCVD,i);
 	master_stats_inc(MASTER_PACKETSRCVD);
 	rptr = regbuff;
 	if (rptr[0]!=0) {
-		sessionlost=1;
+		if (&conn == &gMaster) {
+			sessionlost=1;
+		}
 		lzfs_pretty_syslog(LOG_WARNING,"master: register status: %s",lizardfs_error_string(rptr[0]));
-		tcpclose(fd);
-		fd=-1;
+		tcpclose(conn.fd);
+		conn.fd=-1;
 		return;
 	}
-	lastwrite=time(NULL);
+	conn.lastwrite=time(NULL);
 	lzfs_pretty_syslog(LOG_NOTICE,"registered to master (session id #%" PRIu32 ")", sessionid);
 }
 
@@ -971,7 +1194,7 @@ void fs_close_session(void) {
 	wptr+=64;
 	put8bit(&wptr,REGISTER_CLOSESESSION);
 	put32bit(&wptr,sessionid);
-	if (tcptowrite(fd,regbuff,8+64+5,1000)!=8+64+5) {
+	if (tcptowrite(gMaster.fd,regbuff,8+64+5,1000)!=8+64+5) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: close session error (write: %s)",strerr(tcpgetlasterror()));
 	}
 }
@@ -982,8 +1205,26 @@ static void usr1_handler(int) {
 }
 #endif
 
+/*! \brief Sends NOP to keep the connection alive if nothing was sent recently. fdLock: LOCKED */
+static void fs_send_nop(MasterConnection &conn, time_t now) {
+	uint8_t *ptr,hdr[12];
+	if (conn.lastwrite+2<now) {
+		ptr = hdr;
+		put32bit(&ptr,ANTOAN_NOP);
+		put32bit(&ptr,4);
+		put32bit(&ptr,0);
+		if (tcptowrite(conn.fd,hdr,12,1000)!=12) {
+			conn.disconnect = true;
+		} else {
+			master_stats_add(MASTER_BYTESSENT,12);
+			master_stats_inc(MASTER_PACKETSSENT);
+		}
+		conn.lastwrite=now;
+	}
+}
+
 void* fs_nop_thread(void *arg) {
-	uint8_t *ptr,hdr[12],*inodespacket;
+	uint8_t *ptr,*inodespacket;
 	int32_t inodesleng;
 	acquired_file *afptr;
 	int now;
@@ -997,9 +1238,16 @@ void* fs_nop_thread(void *arg) {
 #endif
 	for (;;) {
 		now = time(NULL);
-		std::unique_lock<std::mutex> fdLock(fdMutex);
+		for (uint32_t i = 1; i < gConnectionCount; ++i) {
+			MasterConnection &conn = gConnections[i];
+			std::unique_lock<std::mutex> fdLock(conn.mutex);
+			if (conn.disconnect == false && conn.fd >= 0) {
+				fs_send_nop(conn, now);
+			}
+		}
+		std::unique_lock<std::mutex> fdLock(gMaster.mutex);
 		if (fterm) {
-			if (fd>=0) {
+			if (gMaster.fd>=0) {
 				fs_close_session();
 			}
 			return NULL;
@@ -1008,20 +1256,8 @@ void* fs_nop_thread(void *arg) {
 			lzfs_pretty_syslog(LOG_NOTICE, "Received SIGUSR1, killing gently...");
 			exit(LIZARDFS_EXIT_STATUS_GENTLY_KILL);
 		}
-		if (disconnect == false && fd >= 0) {
-			if (lastwrite+2<now) {  // NOP
-				ptr = hdr;
-				put32bit(&ptr,ANTOAN_NOP);
-				put32bit(&ptr,4);
-				put32bit(&ptr,0);
-				if (tcptowrite(fd,hdr,12,1000)!=12) {
-					disconnect = true;
-				} else {
-					master_stats_add(MASTER_BYTESSENT,12);
-					master_stats_inc(MASTER_PACKETSSENT);
-				}
-				lastwrite=now;
-			}
+		if (gMaster.disconnect == false && gMaster.fd >= 0) {
+			fs_send_nop(gMaster, now);
 			if (++inodeswritecnt >= gInitParams.report_reserved_period) {
 				inodeswritecnt = 0;
 				std::unique_lock<std::mutex> asLock(acquiredFileMutex);
@@ -1037,8 +1273,8 @@ void* fs_nop_thread(void *arg) {
 				for (afptr=afhead ; afptr ; afptr=afptr->next) {
 					put32bit(&ptr,afptr->inode);
 				}
-				if (tcptowrite(fd,inodespacket,inodesleng,1000)!=inodesleng) {
-					disconnect = true;
+				if (tcptowrite(gMaster.fd,inodespacket,inodesleng,1000)!=inodesleng) {
+					gMaster.disconnect = true;
 				} else {
 					master_stats_add(MASTER_BYTESSENT,inodesleng);
 					master_stats_inc(MASTER_PACKETSSENT);
@@ -1051,22 +1287,22 @@ void* fs_nop_thread(void *arg) {
 	}
 }
 
-bool fs_append_from_master(MessageBuffer& buffer, uint32_t size) {
+bool fs_append_from_master(MasterConnection &conn, MessageBuffer& buffer, uint32_t size) {
 	if (size == 0) {
 		return true;
 	}
 	const uint32_t oldSize = buffer.size();
 	buffer.resize(oldSize + size);
 	uint8_t *appendPointer = buffer.data() + oldSize;
-	int r = tcptoread(fd, appendPointer, size, RECEIVE_TIMEOUT * 1000);
+	int r = tcptoread(conn.fd, appendPointer, size, RECEIVE_TIMEOUT * 1000);
 	if (r == 0) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: connection lost");
-		setDisconnect(true);
+		setDisconnect(conn, true);
 		return false;
 	}
 	if (r != (int)size) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: tcp recv error: %s",strerr(tcpgetlasterror()));
-		setDisconnect(true);
+		setDisconnect(conn, true);
 		return false;
 	}
 	master_stats_add(MASTER_BYTESRCVD, size);
@@ -1074,45 +1310,73 @@ bool fs_append_from_master(MessageBuffer& buffer, uint32_t size) {
 }
 
 template<class... Args>
-bool fs_deserialize_from_master(uint32_t& remainingBytes, Args&... destination) {
+bool fs_deserialize_from_master(MasterConnection &conn, uint32_t& remainingBytes,
+		Args&... destination) {
 	const uint32_t size = serializedSize(destination...);
 	if (size > remainingBytes) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: packet too short");
-		setDisconnect(true);
+		setDisconnect(conn, true);
 		return false;
 	}
 	MessageBuffer buffer;
-	if (!fs_append_from_master(buffer, size)) {
+	if (!fs_append_from_master(conn, buffer, size)) {
 		return false;
 	}
 	try {
 		deserialize(buffer, destination...);
 	} catch (IncorrectDeserializationException& e) {
 		lzfs_pretty_syslog(LOG_WARNING,"master: deserialization error: %s", e.what());
-		setDisconnect(true);
+		setDisconnect(conn, true);
 		return false;
 	}
 	remainingBytes -= size;
 	return true;
 }
 
-void* fs_receive_thread(void *) {
+/*! \brief Reestablishes the first connection, registering a new session if needed. fdLock: LOCKED */
+static void fs_reconnect_master() {
+	if (gMaster.fd==-1 && sessionid!=0) {
+		fs_reconnect(gMaster);  // try to register using the same session id
+	}
+	if (gMaster.fd==-1) {   // still not connected
+		if (sessionlost) {      // if previous session is lost then try to register as a new session
+			if (fs_connect(false)==0) {
+				sessionlost=0;
+				// other connections are registered in the previous session
+				for (uint32_t i = 1; i < gConnectionCount; ++i) {
+					std::unique_lock<std::mutex> fdLock(gConnections[i].mutex);
+					gConnections[i].disconnect = true;
+				}
+			}
+		} else {        // if other problem occurred then try to resolve hostname and portname then try to reconnect using the same session id
+			if (fs_resolve(false, gInitParams.bind_host, gInitParams.host, gInitParams.port) == 0) {
+				fs_reconnect(gMaster);
+			}
+		}
+	}
+}
+
+void* fs_receive_thread(void *arg) {
+	MasterConnection &conn = *static_cast<MasterConnection*>(arg);
 	uint32_t initialReconnectSleep_ms = 100;
 	uint32_t reconnectSleep_ms = initialReconnectSleep_ms;
 	for (;;) {
-		std::unique_lock<std::mutex>fdLock(fdMutex);
+		std::unique_lock<std::mutex>fdLock(conn.mutex);
 		if (fterm) {
 			return NULL;
 		}
-		if (disconnect) {
-			tcpclose(fd);
-			fd=-1;
-			disconnect = false;
-			// send to any threc status error and unlock them
+		if (conn.disconnect) {
+			tcpclose(conn.fd);
+			conn.fd=-1;
+			conn.disconnect = false;
+			// send to any threc waiting for this connection status error and unlock them
 			std::unique_lock<std::mutex>recLock(recMutex);
-			for (threc *rec=threchead ; rec ; rec=rec->next) {
+			for (threc *rec : gThrecs) {
+				if (rec == nullptr) {
+					continue;
+				}
 				std::unique_lock<std::mutex> lock(rec->mutex);
-				if (rec->sent) {
+				if (rec->sent && rec->connection == &conn) {
 					rec->status = 1;
 					rec->received = true;
 					if (rec->waiting) {
@@ -1121,21 +1385,13 @@ void* fs_receive_thread(void *) {
 				}
 			}
 		}
-		if (fd==-1 && sessionid!=0) {
-			fs_reconnect();         // try to register using the same session id
-		}
-		if (fd==-1) {   // still not connected
-			if (sessionlost) {      // if previous session is lost then try to register as a new session
-				if (fs_connect(false)==0) {
-					sessionlost=0;
-				}
-			} else {        // if other problem occurred then try to resolve hostname and portname then try to reconnect using the same session id
-				if (fs_resolve(false, gInitParams.bind_host, gInitParams.host, gInitParams.port) == 0) {
-					fs_reconnect();
-				}
-			}
+		if (&conn == &gMaster) {
+			fs_reconnect_master();
+		} else if (conn.fd==-1 && sessionid!=0 && !sessionlost) {
+			fs_reconnect(conn);
 		}
-		if (fd==-1) {
+		conn.connected = (conn.fd >= 0);
+		if (conn.fd==-1) {
 			fdLock.unlock();
 			usleep(reconnectSleep_ms * 1000);
 			// slowly increase timeout before each retry
@@ -1157,7 +1413,7 @@ void* fs_receive_thread(void *) {
 		PacketVersion packetVersion;
 		uint32_t messageId = 0;
 		uint32_t remainingBytes = serializedSize(packetHeader);
-		if (!fs_deserialize_from_master(remainingBytes, packetHeader)) {
+		if (!fs_deserialize_from_master(conn, remainingBytes, packetHeader)) {
 			continue;
 		}
 		master_stats_inc(MASTER_PACKETSRCVD);
@@ -1169,7 +1425,7 @@ void* fs_receive_thread(void *) {
 					perTypePacketHandlers.find(packetHeader.type);
 			if (handler != perTypePacketHandlers.end()) {
 				MessageBuffer buffer;
-				if (fs_append_from_master(buffer, remainingBytes)) {
+				if (fs_append_from_master(conn, buffer, remainingBytes)) {
 					handler->second->handle(std::move(buffer));
 				}
 				continue;
@@ -1179,19 +1435,19 @@ void* fs_receive_thread(void *) {
 		if (packetHeader.isLizPacketType()) {
 			if (remainingBytes < serializedSize(packetVersion, messageId)) {
 				lzfs_pretty_syslog(LOG_WARNING,"master: packet too short: no msgid");
-				setDisconnect(true);
+				setDisconnect(conn, true);
 				continue;
 			}
-			if (!fs_deserialize_from_master(remainingBytes, packetVersion, messageId)) {
+			if (!fs_deserialize_from_master(conn, remainingBytes, packetVersion, messageId)) {
 				continue;
 			}
 		} else {
 			if (remainingBytes < serializedSize(messageId)) {
 				lzfs_pretty_syslog(LOG_WARNING,"master: packet too short: no msgid");
-				setDisconnect(true);
+				setDisconnect(conn, true);
 				continue;
 			}
-			if (!fs_deserialize_from_master(remainingBytes, messageId)) {
+			if (!fs_deserialize_from_master(conn, remainingBytes, messageId)) {
 				continue;
 			}
 		}
@@ -1209,7 +1465,7 @@ void* fs_receive_thread(void *) {
 		threc *rec = fs_get_threc_by_id(messageId);
 		if (rec == NULL) {
 			lzfs_pretty_syslog(LOG_WARNING,"master: got unexpected queryid");
-			setDisconnect(true);
+			setDisconnect(conn, true);
 			continue;
 		}
 		std::unique_lock<std::mutex> lock(rec->mutex);
@@ -1219,7 +1475,7 @@ void* fs_receive_thread(void *) {
 		} else {
 			serialize(rec->inputBuffer, messageId);
 		}
-		if (!fs_append_from_master(rec->inputBuffer, remainingBytes)) {
+		if (!fs_append_from_master(conn, rec->inputBuffer, remainingBytes)) {
 			lock.unlock();
 			continue;
 		}
@@ -1240,10 +1496,14 @@ int fs_init_master_connection(LizardClient::FsInitParams &params) {
 	gInitParams = params;
 	std::fill(params.password_digest.begin(), params.password_digest.end(), 0);
 
-	fd = -1;
+	gConnectionCount = std::max<uint32_t>(1, std::min(params.master_connections, kMaxMasterConnections));
+	for (uint32_t i = 0; i < gConnectionCount; ++i) {
+		gConnections[i].fd = -1;
+		gConnections[i].disconnect = false;
+		gConnections[i].connected = false;
+	}
 	sessionlost = params.delayed_init;
 	sessionid = 0;
-	disconnect = false;
 
 	if (params.delayed_init) {
 		return 1;
@@ -1259,27 +1519,31 @@ void fs_init_threads(uint32_t retries) {
 
 	pthread_attr_init(&thattr);
 	pthread_attr_setstacksize(&thattr,0x100000);
-	pthread_create(&rpthid,&thattr,fs_receive_thread,NULL);
+	for (uint32_t i = 0; i < gConnectionCount; ++i) {
+		pthread_create(&gConnections[i].receiveThread, &thattr, fs_receive_thread, &gConnections[i]);
+	}
 	pthread_create(&npthid,&thattr,fs_nop_thread,NULL);
 	pthread_attr_destroy(&thattr);
 }
 
 void fs_term(void) {
-	threc *tr,*trn;
 	acquired_file *af,*afn;
-	std::unique_lock<std::mutex> fd_lock(fdMutex);
-	fterm = 1;
-	fd_lock.unlock();
+	for (uint32_t i = 0; i < gConnectionCount; ++i) {
+		std::unique_lock<std::mutex> fd_lock(gConnections[i].mutex);
+		fterm = 1;
+	}
 	pthread_join(npthid,NULL);
-	pthread_join(rpthid,NULL);
+	for (uint32_t i = 0; i < gConnectionCount; ++i) {
+		pthread_join(gConnections[i].receiveThread, NULL);
+	}
 	std::unique_lock<std::mutex> rec_lock(recMutex);
-	for (tr = threchead ; tr ; tr = trn) {
-		trn = tr->next;
-		tr->outputBuffer.clear();
-		tr->inputBuffer.clear();
+	for (threc *tr : gThrecs) {
 		delete tr;
 	}
-	threchead = nullptr;
+	gThrecs.clear();
+	gFreeThrecs.clear();
+	// Records cached by threads are not valid any more
+	gThrecGeneration++;
 	rec_lock.unlock();
 	std::unique_lock<std::mutex> af_lock(acquiredFileMutex);
 	for (af = afhead ; af ; af = afn) {
@@ -1288,9 +1552,14 @@ void fs_term(void) {
 	}
 	afhead = nullptr;
 	af_lock.unlock();
-	fd_lock.lock();
-	if (fd>=0) {
-		tcpclose(fd);
+	for (uint32_t i = 0; i < gConnectionCount; ++i) {
+		MasterConnection &conn = gConnections[i];
+		std::unique_lock<std::mutex> fd_lock(conn.mutex);
+		if (conn.fd>=0) {
+			tcpclose(conn.fd);
+			conn.fd = -1;
+		}
+		conn.connected = false;
 	}
 }
 
@@ -1977,6 +2246,73 @@ uint8_t fs_opencheck(uint32_t inode, uint32_t uid, uint32_t gid, uint8_t flags,
 	return ret;
 }
 
+uint8_t fs_compound(uint32_t uid, uint32_t gid, const std::vector<CompoundMetadataOp> &operations,
+		std::vector<CompoundMetadataOpResult> &results) {
+	threc *rec = fs_get_my_threc();
+	if (masterversion < kCompoundRequestVersion) {
+		return LIZARDFS_ERROR_ENOTSUP;
+	}
+	auto message = cltoma::fuseCompound::build(rec->packetId, uid, gid, operations);
+	if (!fs_lizcreatepacket(rec, message)) {
+		return LIZARDFS_ERROR_IO;
+	}
+	if (!fs_lizsendandreceive(rec, LIZ_MATOCL_FUSE_COMPOUND, message)) {
+		return LIZARDFS_ERROR_IO;
+	}
+	try {
+		PacketVersion packetVersion;
+		uint32_t dummyMessageId;
+		deserializePacketVersionNoHeader(message, packetVersion);
+		if (packetVersion == matocl::fuseCompound::kStatusPacketVersion) {
+			uint8_t status;
+			matocl::fuseCompound::deserialize(message, dummyMessageId, status);
+			return status;
+		} else if (packetVersion == matocl::fuseCompound::kResponsePacketVersion) {
+			matocl::fuseCompound::deserialize(message, dummyMessageId, results);
+			if (results.empty() || results.size() > operations.size()) {
+				throw IncorrectDeserializationException("wrong number of results");
+			}
+		} else {
+			throw IncorrectDeserializationException(
+					"unknown packet version " + std::to_string(packetVersion));
+		}
+	} catch (Exception &ex) {
+		fs_got_inconsistent("LIZ_MATOCL_FUSE_COMPOUND", message.size(), ex.what());
+		return LIZARDFS_ERROR_IO;
+	}
+	// Keep acquired file counters consistent with what fs_opencheck does
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (results[i].status == LIZARDFS_STATUS_OK
+				&& operations[i].type == CompoundMetadataOpType::kOpen) {
+			fs_inc_acnt(results[i].inode);
+		}
+	}
+	return LIZARDFS_STATUS_OK;
+}
+
+uint8_t fs_cache_invalidation_subscribe() {
+	threc *rec = fs_get_my_threc();
+	if (masterversion < kCacheInvalidationVersion) {
+		return LIZARDFS_ERROR_ENOTSUP;
+	}
+	auto message = cltoma::cacheInvalidationSubscribe::build(rec->packetId);
+	if (!fs_lizcreatepacket(rec, message)) {
+		return LIZARDFS_ERROR_IO;
+	}
+	if (!fs_lizsendandreceive(rec, LIZ_MATOCL_CACHE_INVALIDATION_SUBSCRIBE, message)) {
+		return LIZARDFS_ERROR_IO;
+	}
+	try {
+		uint32_t dummyMessageId;
+		uint8_t status;
+		matocl::cacheInvalidationSubscribe::deserialize(message, dummyMessageId, status);
+		return status;
+	} catch (Exception &ex) {
+		fs_got_inconsistent("LIZ_MATOCL_CACHE_INVALIDATION_SUBSCRIBE", message.size(), ex.what());
+		return LIZARDFS_ERROR_IO;
+	}
+}
+
 uint8_t fs_update_credentials(uint32_t key, const GroupCache::Groups &gids) {
 	threc* rec = fs_get_my_threc();
 	std::vector<uint8_t> message;
@@ -2087,6 +2423,43 @@ uint8_t fs_lizreadchunk(std::vector<ChunkTypeWithAddress> &chunkservers, uint64_
 	return LIZARDFS_STATUS_OK;
 }
 
+uint8_t fs_lizreadchunks(std::vector<ChunkWithLocations> &chunks, uint64_t &fileLength,
+		uint32_t inode, uint32_t firstIndex, uint32_t count) {
+	threc *rec = fs_get_my_threc();
+	if (masterversion < kReadChunksVersion) {
+		return LIZARDFS_ERROR_ENOTSUP;
+	}
+	auto message = cltoma::fuseReadChunks::build(rec->packetId, inode, firstIndex, count);
+	if (!fs_lizcreatepacket(rec, message)) {
+		return LIZARDFS_ERROR_IO;
+	}
+	if (!fs_lizsendandreceive(rec, LIZ_MATOCL_FUSE_READ_CHUNKS, message)) {
+		return LIZARDFS_ERROR_IO;
+	}
+	try {
+		PacketVersion packetVersion;
+		uint32_t dummyMessageId;
+		deserializePacketVersionNoHeader(message, packetVersion);
+		if (packetVersion == matocl::fuseReadChunks::kStatusPacketVersion) {
+			uint8_t status;
+			matocl::fuseReadChunks::deserialize(message, dummyMessageId, status);
+			return status;
+		} else if (packetVersion == matocl::fuseReadChunks::kResponsePacketVersion) {
+			matocl::fuseReadChunks::deserialize(message, dummyMessageId, fileLength, chunks);
+			if (chunks.empty()) {
+				throw IncorrectDeserializationException("empty list of chunks");
+			}
+			return LIZARDFS_STATUS_OK;
+		} else {
+			throw IncorrectDeserializationException(
+					"unknown packet version " + std::to_string(packetVersion));
+		}
+	} catch (Exception &ex) {
+		fs_got_inconsistent("LIZ_MATOCL_FUSE_READ_CHUNKS", message.size(), ex.what());
+		return LIZARDFS_ERROR_IO;
+	}
+}
+
 uint8_t fs_writechunk(uint32_t inode,uint32_t indx,uint64_t *length,uint64_t *chunkid,uint32_t *version,const uint8_t **csdata,uint32_t *csdatasize) {
 	uint8_t *wptr;
 	const uint8_t *rptr;
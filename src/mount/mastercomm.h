@@ -27,8 +27,10 @@
 #include "common/acl_type.h"
 #include "common/attributes.h"
 #include "common/chunk_type_with_address.h"
+#include "common/chunk_with_locations.h"
 #include "mount/group_cache.h"
 #include "mount/lizard_client.h"
+#include "protocol/compound_metadata_op.h"
 #include "protocol/packet.h"
 #include "protocol/lock_info.h"
 #include "protocol/directory_entry.h"
@@ -62,11 +64,19 @@ uint8_t fs_getdir(uint32_t inode, uint32_t uid, uint32_t gid, uint64_t first_ent
 
 uint8_t fs_opencheck(uint32_t inode, uint32_t uid, uint32_t gid, uint8_t flags, Attributes &attr);
 uint8_t fs_update_credentials(uint32_t key, const GroupCache::Groups &gids);
+/// Executes operations in the master in one request; a result is returned for each
+/// operation executed (up to and including the first failed one).
+uint8_t fs_compound(uint32_t uid, uint32_t gid, const std::vector<CompoundMetadataOp> &operations,
+		std::vector<CompoundMetadataOpResult> &results);
+/// Asks the master to send LIZ_MATOCL_CACHE_INVALIDATE packets to this connection.
+uint8_t fs_cache_invalidation_subscribe();
 void fs_release(uint32_t inode);
 
 uint8_t fs_readchunk(uint32_t inode,uint32_t indx,uint64_t *length,uint64_t *chunkid,uint32_t *version,const uint8_t **csdata,uint32_t *csdatasize);
 uint8_t fs_lizreadchunk(std::vector<ChunkTypeWithAddress> &serverList, uint64_t &chunkId,
 		uint32_t &chunkVersion, uint64_t &fileLength, uint32_t inode, uint32_t index);
+uint8_t fs_lizreadchunks(std::vector<ChunkWithLocations> &chunks, uint64_t &fileLength,
+		uint32_t inode, uint32_t firstIndex, uint32_t count);
 uint8_t fs_writechunk(uint32_t inode,uint32_t indx,uint64_t *length,uint64_t *chunkid,uint32_t *version,const uint8_t **csdata,uint32_t *csdatasize);
 uint8_t fs_lizwritechunk(uint32_t inode, uint32_t chunkIndex, uint32_t &lockId,
 		uint64_t &fileLength, uint64_t &chunkId, uint32_t &chunkVersion,
@@ -22,73 +22,366 @@
 #include <errno.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Operations are logged only when some .oplog or .ophistory handle is open, otherwise
+ * oplog_printf returns immediately.
+ *
+ * Each thread writes binary records to its own ring without any locks: time, context,
+ * pointer to the format (which has to be a string literal) and values of arguments
+ * (with copies of strings). Records are formatted by readers, which merge records
+ * of all threads in the order of time.
+ *
+ * A ring is a single-writer seqlock: before overwriting old records the writer moves
+ * 'reserved' forward, and after writing a record it moves 'head' forward. A reader copies
+ * a record and then checks if 'reserved' didn't reach it, otherwise the copy may be torn.
+ * 'tail' is the oldest record which hasn't been overwritten yet. Rings of finished threads
+ * are taken over by new threads, so their records can still be read.
+ */
 
-#define OPBUFFSIZE 0x1000000
 #define LINELENG 1000
-#define MAXHISTORYSIZE 0xF00000
+
+// ring of each thread, in 8-byte words (1 MiB)
+static constexpr uint64_t kRingWords = 128 * 1024;
+// the longest record, in words
+static constexpr uint32_t kMaxRecordWords = 2 * LINELENG / 8;
+// record header: size in words (lower 32 bits) and flags
+static constexpr uint64_t kRecordPadding = uint64_t(1) << 32;
+static constexpr uint64_t kRecordWithContext = uint64_t(1) << 33;
+// words of record header, time, uid/gid, pid and format
+static constexpr uint32_t kRecordHeaderWords = 6;
+// length of a string stored as a null pointer
+static constexpr uint64_t kNullString = std::numeric_limits<uint64_t>::max();
+
+struct OplogRing {
+	OplogRing() : words(new std::atomic<uint64_t>[kRingWords]()), head(0), reserved(0), tail(0),
+			used(true) {
+	}
+
+	std::unique_ptr<std::atomic<uint64_t>[]> words;
+	std::atomic<uint64_t> head;      // end of the last written record
+	std::atomic<uint64_t> reserved;  // end of the record being written
+	std::atomic<uint64_t> tail;      // beginning of the oldest record
+	bool used;                       // guarded by opbufflock
+};
 
 typedef struct _fhentry {
 	unsigned long fh;
-	uint64_t readpos;
 	uint32_t refcount;
+	std::vector<uint64_t> readpos;               // read position in each ring
+	std::vector<std::vector<uint64_t>> pending;  // records read from each ring, not yet formatted
+	std::string output;                          // formatted records not returned yet
+	size_t outputpos;
 	struct _fhentry *next;
 } fhentry;
 
+std::atomic<int> gOplogReaders(0);
+
 static unsigned long nextfh=1;
 static fhentry *fhhead=NULL;
 
-static uint8_t opbuff[OPBUFFSIZE];
-static uint64_t writepos=0;
-static uint8_t waiting=0;
+static std::vector<OplogRing*> rings;
+static std::atomic<uint8_t> waiting(0);
 static pthread_mutex_t opbufflock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t nodata = PTHREAD_COND_INITIALIZER;
 
 static time_t gConvTmHour = std::numeric_limits<time_t>::max(); // enforce update on first read
 static struct tm gConvTm;
-static pthread_mutex_t timelock = PTHREAD_MUTEX_INITIALIZER;
 
-static inline void oplog_put(uint8_t *buff,uint32_t leng) {
-	uint32_t bpos;
-	if (leng>OPBUFFSIZE) {  // just in case
-		buff+=leng-OPBUFFSIZE;
-		leng=OPBUFFSIZE;
+namespace {
+
+enum class ArgumentType {
+	kNone, kInt, kLong, kLongLong, kSize, kIntmax, kPtrdiff, kDouble, kLongDouble, kString,
+	kPointer, kInvalid
+};
+
+// A conversion specification of printf
+struct Conversion {
+	const char *begin;  // '%'
+	const char *end;    // after the conversion character
+	bool width_arg;     // width given as '*'
+	bool precision_arg; // precision given as '.*'
+	ArgumentType type;
+};
+
+/*! \brief Parses a conversion specification starting at format (which points at '%'). */
+Conversion parse_conversion(const char *format) {
+	Conversion conv;
+	const char *p = format + 1;
+	conv.begin = format;
+	conv.width_arg = false;
+	conv.precision_arg = false;
+	while (*p && strchr("-+ #0'", *p)) {
+		p++;
+	}
+	if (*p == '*') {
+		conv.width_arg = true;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9') {
+		p++;
+	}
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			conv.precision_arg = true;
+			p++;
+		}
+		while (*p >= '0' && *p <= '9') {
+			p++;
+		}
+	}
+	const char *length = p;
+	while (*p && strchr("hlLqjzt", *p)) {
+		p++;
+	}
+	size_t length_size = p - length;
+	char conversion = *p;
+	conv.end = conversion ? p + 1 : p;
+	if (conversion && strchr("diouxXc", conversion)) {
+		if (length_size == 0 || length[0] == 'h') {
+			conv.type = ArgumentType::kInt;
+		} else if (length[0] == 'q' || (length_size == 2 && length[0] == 'l')) {
+			conv.type = ArgumentType::kLongLong;
+		} else if (length[0] == 'l') {
+			conv.type = ArgumentType::kLong;
+		} else if (length[0] == 'z') {
+			conv.type = ArgumentType::kSize;
+		} else if (length[0] == 'j') {
+			conv.type = ArgumentType::kIntmax;
+		} else if (length[0] == 't') {
+			conv.type = ArgumentType::kPtrdiff;
+		} else {
+			conv.type = ArgumentType::kInvalid;
+		}
+	} else if (conversion && strchr("fFeEgGaA", conversion)) {
+		conv.type = (length_size > 0 && length[0] == 'L') ? ArgumentType::kLongDouble
+		                                                    : ArgumentType::kDouble;
+	} else if (conversion == 's' && length_size == 0) {
+		conv.type = ArgumentType::kString;
+	} else if (conversion == 'p') {
+		conv.type = ArgumentType::kPointer;
+	} else if (conversion == '%') {
+		conv.type = ArgumentType::kNone;
+	} else {
+		conv.type = ArgumentType::kInvalid;
+	}
+	return conv;
+}
+
+/*! \brief Builds a record of one oplog line in the buffer, returns its size in words. */
+uint32_t oplog_make_record(uint64_t *record, const struct LizardClient::Context *ctx,
+		const char *format, va_list ap) {
+	struct timeval tv;
+	gettimeofday(&tv, nullptr);
+	record[1] = tv.tv_sec;
+	record[2] = tv.tv_usec;
+	record[3] = ctx ? (uint64_t(ctx->uid) | (uint64_t(ctx->gid) << 32)) : 0;
+	record[4] = ctx ? ctx->pid : 0;
+	record[5] = reinterpret_cast<uintptr_t>(format);
+	uint32_t size = kRecordHeaderWords;
+	for (const char *p = strchr(format, '%'); p; p = strchr(p, '%')) {
+		Conversion conv = parse_conversion(p);
+		p = conv.end;
+		if (conv.type == ArgumentType::kInvalid) {
+			// the rest of the format will be printed as it is
+			break;
+		}
+		// each argument takes at most two words, and then its string (if it fits)
+		if (size + 4 > kMaxRecordWords) {
+			break;
+		}
+		if (conv.width_arg) {
+			record[size++] = (int64_t)va_arg(ap, int);
+		}
+		if (conv.precision_arg) {
+			record[size++] = (int64_t)va_arg(ap, int);
+		}
+		switch (conv.type) {
+		case ArgumentType::kInt:
+			record[size++] = (int64_t)va_arg(ap, int);
+			break;
+		case ArgumentType::kLong:
+			record[size++] = (int64_t)va_arg(ap, long);
+			break;
+		case ArgumentType::kLongLong:
+			record[size++] = (int64_t)va_arg(ap, long long);
+			break;
+		case ArgumentType::kSize:
+			record[size++] = va_arg(ap, size_t);
+			break;
+		case ArgumentType::kIntmax:
+			record[size++] = (int64_t)va_arg(ap, intmax_t);
+			break;
+		case ArgumentType::kPtrdiff:
+			record[size++] = (int64_t)va_arg(ap, ptrdiff_t);
+			break;
+		case ArgumentType::kDouble:
+		case ArgumentType::kLongDouble: {
+			double value = conv.type == ArgumentType::kDouble ? va_arg(ap, double)
+			                                                  : (double)va_arg(ap, long double);
+			memcpy(&record[size++], &value, sizeof(value));
+			break;
+		}
+		case ArgumentType::kPointer:
+			record[size++] = reinterpret_cast<uintptr_t>(va_arg(ap, void*));
+			break;
+		case ArgumentType::kString: {
+			const char *str = va_arg(ap, const char*);
+			if (str == nullptr) {
+				record[size++] = kNullString;
+				break;
+			}
+			size_t length = strnlen(str, (kMaxRecordWords - size - 1) * 8);
+			record[size++] = length;
+			memcpy(&record[size], str, length);
+			size += (length + 7) / 8;
+			break;
+		}
+		default:
+			break;
+		}
 	}
+	record[0] = size | (ctx ? kRecordWithContext : 0);
+	return size;
+}
+
+OplogRing *oplog_acquire_ring() {
+	OplogRing *result = nullptr;
 	pthread_mutex_lock(&opbufflock);
-	bpos = writepos%OPBUFFSIZE;
-	writepos+=leng;
-	if (bpos+leng>OPBUFFSIZE) {
-		memcpy(opbuff+bpos,buff,OPBUFFSIZE-bpos);
-		buff+=OPBUFFSIZE-bpos;
-		leng-=OPBUFFSIZE-bpos;
-		bpos = 0;
-	}
-	memcpy(opbuff+bpos,buff,leng);
-	if (waiting) {
-		pthread_cond_broadcast(&nodata);
-		waiting=0;
+	for (OplogRing *ring : rings) {
+		if (!ring->used) {
+			ring->used = true;
+			result = ring;
+			break;
+		}
+	}
+	if (result == nullptr) {
+		result = new OplogRing();
+		rings.push_back(result);
 	}
 	pthread_mutex_unlock(&opbufflock);
+	return result;
 }
 
-static void get_time(timeval &tv, tm &ltime) {
-	gettimeofday(&tv, nullptr);
+// Ring of the current thread, given to another thread when this one finishes
+struct ThreadRing {
+	~ThreadRing() {
+		if (ring) {
+			pthread_mutex_lock(&opbufflock);
+			ring->used = false;
+			pthread_mutex_unlock(&opbufflock);
+		}
+	}
+
+	OplogRing *ring = nullptr;
+};
+
+thread_local ThreadRing tThreadRing;
+
+/*! \brief Writes a record to the ring of the current thread. */
+void oplog_put(const uint64_t *record, uint32_t size) {
+	if (tThreadRing.ring == nullptr) {
+		tThreadRing.ring = oplog_acquire_ring();
+	}
+	OplogRing &ring = *tThreadRing.ring;
+	uint64_t head = ring.head.load(std::memory_order_relaxed);
+	uint64_t offset = head % kRingWords;
+	uint64_t padding = (offset + size > kRingWords) ? kRingWords - offset : 0;
+	uint64_t end = head + padding + size;
+
+	// drop the oldest records which will be overwritten
+	uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+	while (tail + kRingWords < end) {
+		tail += ring.words[tail % kRingWords].load(std::memory_order_relaxed) & 0xFFFFFFFFU;
+	}
+	ring.tail.store(tail, std::memory_order_relaxed);
+	ring.reserved.store(end, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	if (padding > 0) {
+		ring.words[offset].store(kRecordPadding | padding, std::memory_order_relaxed);
+		offset = 0;
+	}
+	for (uint32_t i = 0; i < size; i++) {
+		ring.words[offset + i].store(record[i], std::memory_order_relaxed);
+	}
+	ring.head.store(end, std::memory_order_release);
+
+	if (waiting.load(std::memory_order_relaxed)) {
+		waiting.store(0, std::memory_order_relaxed);
+		pthread_cond_broadcast(&nodata);
+	}
+}
+
+void oplog_vprintf(const struct LizardClient::Context *ctx, const char *format, va_list ap) {
+	uint64_t record[kMaxRecordWords];
+	uint32_t size = oplog_make_record(record, ctx, format, ap);
+	oplog_put(record, size);
+}
+
+/*! \brief Copies the next record from the ring, returns false if there is none. opbufflock: LOCKED */
+bool oplog_read_record(OplogRing &ring, uint64_t &readpos, std::vector<uint64_t> &record) {
+	for (;;) {
+		uint64_t head = ring.head.load(std::memory_order_acquire);
+		if (readpos >= head) {
+			return false;
+		}
+		uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+		if (readpos < tail) {
+			readpos = tail;  // older records were overwritten
+			continue;
+		}
+		uint64_t header = ring.words[readpos % kRingWords].load(std::memory_order_relaxed);
+		uint64_t size = header & 0xFFFFFFFFU;
+		bool valid = size > 0 && readpos + size <= head
+				&& (readpos % kRingWords) + size <= kRingWords
+				&& ((header & kRecordPadding) || size <= kMaxRecordWords);
+		if (valid && !(header & kRecordPadding)) {
+			record.resize(size);
+			for (uint64_t i = 0; i < size; i++) {
+				record[i] = ring.words[(readpos + i) % kRingWords].load(std::memory_order_relaxed);
+			}
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (ring.reserved.load(std::memory_order_relaxed) > readpos + kRingWords) {
+			continue;  // the record could have been overwritten while it was copied
+		}
+		if (!valid) {
+			readpos = head;  // shouldn't happen
+			return false;
+		}
+		readpos += size;
+		if (!(header & kRecordPadding)) {
+			return true;
+		}
+	}
+}
+
+/*! \brief Converts time of a record to local time. opbufflock: LOCKED */
+void get_time(time_t sec, tm &ltime) {
 	static constexpr time_t secs_per_hour = 60 * 60;
-	time_t hour = tv.tv_sec / secs_per_hour;
-	unsigned secs_this_hour = tv.tv_sec % secs_per_hour;
+	time_t hour = sec / secs_per_hour;
+	unsigned secs_this_hour = sec % secs_per_hour;
 
-	pthread_mutex_lock(&timelock);
 	if (hour != gConvTmHour) {
 		gConvTmHour = hour;
 		time_t convts = hour * secs_per_hour;
 		localtime_r(&convts, &gConvTm);
 	}
 	ltime = gConvTm;
-	pthread_mutex_unlock(&timelock);
 
 	assert(ltime.tm_sec == 0);
 	assert(ltime.tm_min == 0);
@@ -97,108 +390,205 @@ static void get_time(timeval &tv, tm &ltime) {
 	ltime.tm_min = secs_this_hour / 60;
 }
 
-void oplog_printf(const struct LizardClient::Context &ctx,const char *format,...) {
-	struct timeval tv;
-	struct tm ltime;
-	va_list ap;
-	int r, leng = 0;
+/*! \brief Formats the value of a conversion stored in a record. */
+int oplog_format_conversion(char *buff, size_t size, const Conversion &conv,
+		const uint64_t *&arg, const uint64_t *end) {
+	// the conversion specification with width and precision taken from the record
+	std::string spec(conv.begin, conv.end);
+	if (conv.width_arg || conv.precision_arg) {
+		if ((end - arg) < (conv.width_arg ? 1 : 0) + (conv.precision_arg ? 1 : 0)) {
+			return -1;
+		}
+		std::string width, precision;
+		if (conv.width_arg) {
+			int value = (int)*arg++;
+			width = (value < 0 ? "-" : "") + std::to_string(std::abs(value));
+			spec.replace(spec.find('*'), 1, width);
+		}
+		if (conv.precision_arg) {
+			int value = (int)*arg++;
+			spec.replace(spec.find(".*"), 2, value < 0 ? "" : "." + std::to_string(value));
+		}
+	}
+	if (conv.type == ArgumentType::kNone) {
+		return snprintf(buff, size, "%%");
+	}
+	if (arg >= end) {
+		return -1;
+	}
+	uint64_t value = *arg++;
+	switch (conv.type) {
+	case ArgumentType::kInt:
+		return snprintf(buff, size, spec.c_str(), (int)value);
+	case ArgumentType::kLong:
+		return snprintf(buff, size, spec.c_str(), (long)value);
+	case ArgumentType::kLongLong:
+		return snprintf(buff, size, spec.c_str(), (long long)value);
+	case ArgumentType::kSize:
+		return snprintf(buff, size, spec.c_str(), (size_t)value);
+	case ArgumentType::kIntmax:
+		return snprintf(buff, size, spec.c_str(), (intmax_t)value);
+	case ArgumentType::kPtrdiff:
+		return snprintf(buff, size, spec.c_str(), (ptrdiff_t)value);
+	case ArgumentType::kDouble:
+	case ArgumentType::kLongDouble: {
+		double d;
+		memcpy(&d, &value, sizeof(d));
+		if (conv.type == ArgumentType::kLongDouble) {
+			return snprintf(buff, size, spec.c_str(), (long double)d);
+		}
+		return snprintf(buff, size, spec.c_str(), d);
+	}
+	case ArgumentType::kPointer:
+		return snprintf(buff, size, spec.c_str(), reinterpret_cast<void*>(value));
+	case ArgumentType::kString: {
+		if (value == kNullString) {
+			return snprintf(buff, size, spec.c_str(), "(null)");
+		}
+		uint64_t words = (value + 7) / 8;
+		if (uint64_t(end - arg) < words) {
+			return -1;
+		}
+		std::string str(reinterpret_cast<const char*>(arg), value);
+		arg += words;
+		return snprintf(buff, size, spec.c_str(), str.c_str());
+	}
+	default:
+		return -1;
+	}
+}
+
+/*! \brief Formats a record as a line of the oplog. opbufflock: LOCKED */
+void oplog_format_record(const std::vector<uint64_t> &record, std::string &output) {
 	char buff[LINELENG];
+	struct tm ltime;
+	int r, leng;
+	time_t sec = record[1];
+	unsigned usec = record[2];
 
-	get_time(tv, ltime);
-	r  = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: uid:%u gid:%u pid:%u cmd:",
-		(unsigned long long)tv.tv_sec, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec, (unsigned)tv.tv_usec,
-		(unsigned)ctx.uid, (unsigned)ctx.gid, (unsigned)ctx.pid);
+	get_time(sec, ltime);
+	if (record[0] & kRecordWithContext) {
+		r = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: uid:%u gid:%u pid:%u cmd:",
+			(unsigned long long)sec, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec, usec,
+			(unsigned)(record[3] & 0xFFFFFFFFU), (unsigned)(record[3] >> 32), (unsigned)record[4]);
+	} else {
+		r = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: cmd:",
+			(unsigned long long)sec, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec, usec);
+	}
 	if (r < 0) {
 		return;
 	}
 	leng = std::min(LINELENG - 1, r);
 
-	va_start(ap, format);
-	r = vsnprintf(buff + leng, LINELENG - leng, format, ap);
-	va_end(ap);
-	if (r < 0) {
-		return;
+	const char *format = reinterpret_cast<const char*>(static_cast<uintptr_t>(record[5]));
+	const uint64_t *arg = record.data() + kRecordHeaderWords;
+	const uint64_t *end = record.data() + record.size();
+	const char *p = format;
+	while (*p && leng < LINELENG - 1) {
+		const char *percent = strchr(p, '%');
+		size_t literal = percent ? (size_t)(percent - p) : strlen(p);
+		literal = std::min<size_t>(literal, LINELENG - 1 - leng);
+		memcpy(buff + leng, p, literal);
+		leng += literal;
+		p += literal;
+		if (*p != '%' || leng >= LINELENG - 1) {
+			continue;
+		}
+		Conversion conv = parse_conversion(p);
+		r = conv.type == ArgumentType::kInvalid ? -1
+				: oplog_format_conversion(buff + leng, LINELENG - leng, conv, arg, end);
+		if (r < 0) {
+			// arguments which didn't fit in the record
+			r = snprintf(buff + leng, LINELENG - leng, "%s", p);
+			p += strlen(p);
+		} else {
+			p = conv.end;
+		}
+		leng = std::min(LINELENG - 1, leng + r);
 	}
-	leng += r;
 
-	leng = std::min(LINELENG - 1, leng);
 	buff[leng++] = '\n';
-	oplog_put((uint8_t*)buff, leng);
+	output.append(buff, leng);
 }
 
-void oplog_printf(const char *format, ...) {
-	struct timeval tv;
-	struct tm ltime;
-	va_list ap;
-	int r, leng = 0;
-	char buff[LINELENG];
+/*! \brief Formats pending records of all threads in the order of time. opbufflock: LOCKED */
+void oplog_format_pending(fhentry *fhptr, uint32_t maxleng) {
+	fhptr->readpos.resize(rings.size(), 0);
+	fhptr->pending.resize(rings.size());
+	while (fhptr->output.size() - fhptr->outputpos < maxleng) {
+		int oldest = -1;
+		for (size_t i = 0; i < rings.size(); i++) {
+			std::vector<uint64_t> &record = fhptr->pending[i];
+			if (record.empty() && !oplog_read_record(*rings[i], fhptr->readpos[i], record)) {
+				continue;
+			}
+			if (oldest < 0 || std::make_pair(record[1], record[2])
+					< std::make_pair(fhptr->pending[oldest][1], fhptr->pending[oldest][2])) {
+				oldest = i;
+			}
+		}
+		if (oldest < 0) {
+			break;
+		}
+		oplog_format_record(fhptr->pending[oldest], fhptr->output);
+		fhptr->pending[oldest].clear();
+	}
+}
 
-	get_time(tv, ltime);
-	r = snprintf(buff, LINELENG, "%llu %02u.%02u %02u:%02u:%02u.%06u: cmd:",
-		(unsigned long long)tv.tv_sec, ltime.tm_mon + 1, ltime.tm_mday, ltime.tm_hour, ltime.tm_min, ltime.tm_sec, (unsigned)tv.tv_usec);
-	if (r < 0) {
+} // anonymous namespace
+
+void oplog_printf(const struct LizardClient::Context &ctx,const char *format,...) {
+	if (!oplog_enabled()) {
 		return;
 	}
-	leng = std::min(LINELENG - 1, r);
-
+	va_list ap;
 	va_start(ap, format);
-	r = vsnprintf(buff + leng, LINELENG - leng, format, ap);
+	oplog_vprintf(&ctx, format, ap);
 	va_end(ap);
-	if (r < 0) {
+}
+
+void oplog_printf(const char *format, ...) {
+	if (!oplog_enabled()) {
 		return;
 	}
-	leng += r;
-
-	leng = std::min(LINELENG - 1, leng);
-	buff[leng++] = '\n';
-	oplog_put((uint8_t*)buff, leng);
+	va_list ap;
+	va_start(ap, format);
+	oplog_vprintf(nullptr, format, ap);
+	va_end(ap);
 }
 
 unsigned long oplog_newhandle(int hflag) {
 	fhentry *fhptr;
-	uint32_t bpos;
 
 	pthread_mutex_lock(&opbufflock);
-	fhptr = (fhentry*) malloc(sizeof(fhentry));
+	fhptr = new fhentry();
 	fhptr->fh = nextfh++;
 	fhptr->refcount = 1;
-	if (hflag) {
-		if (writepos<MAXHISTORYSIZE) {
-			fhptr->readpos = 0;
+	fhptr->outputpos = 0;
+	for (OplogRing *ring : rings) {
+		if (hflag) {
+			fhptr->readpos.push_back(ring->tail.load(std::memory_order_relaxed));
 		} else {
-			fhptr->readpos = writepos - MAXHISTORYSIZE;
-			bpos = fhptr->readpos%OPBUFFSIZE;
-			while (fhptr->readpos < writepos) {
-				if (opbuff[bpos]=='\n') {
-					break;
-				}
-				bpos++;
-				bpos%=OPBUFFSIZE;
-				fhptr->readpos++;
-			}
-			if (fhptr->readpos<writepos) {
-				fhptr->readpos++;
-			}
+			fhptr->readpos.push_back(ring->head.load(std::memory_order_relaxed));
 		}
-	} else {
-		fhptr->readpos = writepos;
 	}
 	fhptr->next = fhhead;
 	fhhead = fhptr;
+	gOplogReaders++;
 	pthread_mutex_unlock(&opbufflock);
 	return fhptr->fh;
 }
 
-void oplog_releasehandle(unsigned long fh) {
+static void oplog_unref(unsigned long fh) {
 	fhentry **fhpptr,*fhptr;
-	pthread_mutex_lock(&opbufflock);
 	fhpptr = &fhhead;
 	while ((fhptr = *fhpptr)) {
 		if (fhptr->fh==fh) {
 			fhptr->refcount--;
 			if (fhptr->refcount==0) {
 				*fhpptr = fhptr->next;
-				free(fhptr);
+				delete fhptr;
+				gOplogReaders--;
 			} else {
 				fhpptr = &(fhptr->next);
 			}
@@ -206,12 +596,16 @@ void oplog_releasehandle(unsigned long fh) {
 			fhpptr = &(fhptr->next);
 		}
 	}
+}
+
+void oplog_releasehandle(unsigned long fh) {
+	pthread_mutex_lock(&opbufflock);
+	oplog_unref(fh);
 	pthread_mutex_unlock(&opbufflock);
 }
 
 void oplog_getdata(unsigned long fh,uint8_t **buff,uint32_t *leng,uint32_t maxleng) {
 	fhentry *fhptr;
-	uint32_t bpos;
 	struct timeval tv;
 	struct timespec ts;
 
@@ -224,44 +618,42 @@ void oplog_getdata(unsigned long fh,uint8_t **buff,uint32_t *leng,uint32_t maxle
 		return;
 	}
 	fhptr->refcount++;
-	while (fhptr->readpos>=writepos) {
+	if (fhptr->outputpos == fhptr->output.size()) {
+		fhptr->output.clear();
+		fhptr->outputpos = 0;
+	}
+	gettimeofday(&tv,NULL);
+	ts.tv_sec = tv.tv_sec+1;
+	ts.tv_nsec = tv.tv_usec*1000;
+	oplog_format_pending(fhptr, maxleng);
+	while (fhptr->output.empty()) {
+		// writers don't take the lock, so a wakeup may be missed: check again after 10ms
+		struct timespec slice;
 		gettimeofday(&tv,NULL);
-		ts.tv_sec = tv.tv_sec+1;
-		ts.tv_nsec = tv.tv_usec*1000;
-		waiting=1;
-		if (pthread_cond_timedwait(&nodata,&opbufflock,&ts)==ETIMEDOUT) {
+		slice.tv_sec = tv.tv_sec;
+		slice.tv_nsec = tv.tv_usec * 1000 + 10 * 1000 * 1000;
+		if (slice.tv_nsec >= 1000 * 1000 * 1000) {
+			slice.tv_sec++;
+			slice.tv_nsec -= 1000 * 1000 * 1000;
+		}
+		if (slice.tv_sec > ts.tv_sec || (slice.tv_sec == ts.tv_sec && slice.tv_nsec > ts.tv_nsec)) {
+			slice = ts;
+		}
+		waiting.store(1, std::memory_order_relaxed);
+		if (pthread_cond_timedwait(&nodata,&opbufflock,&slice)==ETIMEDOUT
+				&& (slice.tv_sec == ts.tv_sec && slice.tv_nsec == ts.tv_nsec)) {
 			*buff = (uint8_t*)"#\n";
 			*leng = 2;
 			return;
 		}
+		oplog_format_pending(fhptr, maxleng);
 	}
-	bpos = fhptr->readpos%OPBUFFSIZE;
-	*leng = (writepos-(fhptr->readpos));
-	*buff = opbuff+bpos;
-	if ((*leng)>(OPBUFFSIZE-bpos)) {
-		(*leng) = (OPBUFFSIZE-bpos);
-	}
-	if ((*leng)>maxleng) {
-		(*leng) = maxleng;
-	}
-	fhptr->readpos+=(*leng);
+	*buff = (uint8_t*)&fhptr->output[fhptr->outputpos];
+	*leng = std::min<size_t>(fhptr->output.size() - fhptr->outputpos, maxleng);
+	fhptr->outputpos += *leng;
 }
 
 void oplog_releasedata(unsigned long fh) {
-	fhentry **fhpptr,*fhptr;
-	fhpptr = &fhhead;
-	while ((fhptr = *fhpptr)) {
-		if (fhptr->fh==fh) {
-			fhptr->refcount--;
-			if (fhptr->refcount==0) {
-				*fhpptr = fhptr->next;
-				free(fhptr);
-			} else {
-				fhpptr = &(fhptr->next);
-			}
-		} else {
-			fhpptr = &(fhptr->next);
-		}
-	}
+	oplog_unref(fh);
 	pthread_mutex_unlock(&opbufflock);
 }
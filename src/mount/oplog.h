@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <atomic>
 #include <mount/lizard_client_context.h>
 
 #ifndef __printflike
@@ -31,6 +32,14 @@
 #endif
 #endif /* __printflike */
 
+// number of open .oplog and .ophistory handles, operations are logged only if there are any
+extern std::atomic<int> gOplogReaders;
+
+inline bool oplog_enabled() {
+	return gOplogReaders.load(std::memory_order_relaxed) > 0;
+}
+
+// format has to be a string literal, it is used when the line is read
 void oplog_printf(
 		const struct LizardClient::Context &ctx,const char *format,...) __printflike(2, 3);
 void oplog_printf(const char *format,...) __printflike(1, 2);
@@ -0,0 +1,180 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/oplog.h"
+
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+// Reads lines from the handle until there is nothing new for a second
+static std::vector<std::string> read_lines(unsigned long fh, uint32_t maxleng = 4096) {
+	std::string data;
+	for (;;) {
+		uint8_t *buff;
+		uint32_t leng;
+		oplog_getdata(fh, &buff, &leng, maxleng);
+		std::string chunk(reinterpret_cast<char*>(buff), leng);
+		oplog_releasedata(fh);
+		if (chunk == "#\n") {
+			break;
+		}
+		data += chunk;
+	}
+	std::vector<std::string> lines;
+	std::istringstream stream(data);
+	for (std::string line; std::getline(stream, line);) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+// Returns text of the line after "cmd:"
+static std::string command(const std::string &line) {
+	size_t pos = line.find("cmd:");
+	return pos == std::string::npos ? "" : line.substr(pos + 4);
+}
+
+TEST(OplogTests, NotRecordedWithoutReaders) {
+	EXPECT_FALSE(oplog_enabled());
+	oplog_printf("not recorded %d", 1);
+	unsigned long fh = oplog_newhandle(1);
+	EXPECT_TRUE(oplog_enabled());
+	oplog_printf("recorded %d", 2);
+	auto lines = read_lines(fh);
+	oplog_releasehandle(fh);
+	EXPECT_FALSE(oplog_enabled());
+	ASSERT_EQ(1U, lines.size());
+	EXPECT_EQ("recorded 2", command(lines[0]));
+}
+
+TEST(OplogTests, FormattedWhenRead) {
+	LizardClient::Context ctx(1, 2, 3, 0);
+	char name[16];
+	strcpy(name, "file");
+	unsigned long fh = oplog_newhandle(0);
+	oplog_printf(ctx, "lookup (%lu,%s): %s %.1f %04o %zu %08lX %5d|%-3s|%.*s %%",
+			(unsigned long)12, name, "OK", 1.25, 0755, (size_t)7,
+			(unsigned long)0xABC, -4, "x", 2, "abc");
+	strcpy(name, "changed");
+	auto lines = read_lines(fh);
+	oplog_releasehandle(fh);
+	ASSERT_EQ(1U, lines.size());
+	EXPECT_NE(std::string::npos, lines[0].find(": uid:1 gid:2 pid:3 cmd:"));
+	EXPECT_EQ("lookup (12,file): OK 1.2 0755 7 00000ABC    -4|x  |ab %", command(lines[0]));
+}
+
+TEST(OplogTests, ThreadsMergedInOrderOfTime) {
+	unsigned long fh = oplog_newhandle(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([t]() {
+			for (int i = 0; i < 1000; ++i) {
+				oplog_printf("thread %d line %d", t, i);
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	auto lines = read_lines(fh, 100);
+	oplog_releasehandle(fh);
+	ASSERT_EQ(4000U, lines.size());
+	std::string previous_time;
+	std::vector<int> next_line(4, 0);
+	for (const auto &line : lines) {
+		// "<seconds> <date> <time>.<microseconds>: cmd:..." - compare seconds and microseconds
+		std::string time = line.substr(0, line.find(' ')) + line.substr(line.find(": ") - 6, 6);
+		EXPECT_LE(previous_time, time);
+		previous_time = time;
+		int t, i;
+		ASSERT_EQ(2, sscanf(command(line).c_str(), "thread %d line %d", &t, &i));
+		EXPECT_EQ(next_line[t]++, i);
+	}
+}
+
+TEST(OplogTests, HistoryKeepsLatestRecords) {
+	unsigned long fh = oplog_newhandle(0);
+	std::string padding(200, 'p');
+	std::thread([&padding]() {
+		for (int i = 0; i < 20000; ++i) {
+			oplog_printf("history %d %s", i, padding.c_str());
+		}
+	}).join();
+	unsigned long history = oplog_newhandle(1);
+	auto lines = read_lines(history);
+	oplog_releasehandle(history);
+	oplog_releasehandle(fh);
+	ASSERT_FALSE(lines.empty());
+	EXPECT_LT(lines.size(), 20000U);
+	int previous = -1;
+	for (const auto &line : lines) {
+		int i;
+		char text[256];
+		if (sscanf(command(line).c_str(), "history %d %255s", &i, text) != 2) {
+			continue;  // records of other tests
+		}
+		EXPECT_EQ(padding, text);
+		if (previous >= 0) {
+			EXPECT_EQ(previous + 1, i);
+		}
+		previous = i;
+	}
+	EXPECT_EQ(19999, previous);
+}
+
+TEST(OplogTests, ReadWhileWritten) {
+	unsigned long fh = oplog_newhandle(0);
+	std::string padding(100, 'q');
+	std::atomic<int> finished(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([t, &padding, &finished]() {
+			for (int i = 0; i < 20000; ++i) {
+				oplog_printf("concurrent %d %d %s", t, i, padding.c_str());
+			}
+			// rings of finished threads are reused, so no thread may exit before all are done
+			finished++;
+			while (finished < 4) {
+				std::this_thread::yield();
+			}
+		});
+	}
+	auto lines = read_lines(fh, 65536);
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	oplog_releasehandle(fh);
+	// records overwritten before they were read are lost, the rest has to be intact
+	ASSERT_FALSE(lines.empty());
+	std::vector<int> previous(4, -1);
+	for (const auto &line : lines) {
+		int t, i;
+		char text[256];
+		ASSERT_EQ(3, sscanf(command(line).c_str(), "concurrent %d %d %255s", &t, &i, text));
+		EXPECT_EQ(padding, text);
+		EXPECT_LT(previous[t], i);
+		previous[t] = i;
+	}
+	EXPECT_EQ(std::vector<int>(4, 19999), previous);
+}
@@ -0,0 +1,135 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/parity_encoder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "common/block_xor.h"
+#include "common/reed_solomon.h"
+
+ParityEncoder::ParityEncoder(unsigned threads) : terminate_(false) {
+	for (unsigned i = 0; i < threads; ++i) {
+		threads_.emplace_back(&ParityEncoder::worker, this);
+	}
+}
+
+ParityEncoder::~ParityEncoder() {
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		terminate_ = true;
+	}
+	work_cond_.notify_all();
+	for (auto &thread : threads_) {
+		thread.join();
+	}
+}
+
+void ParityEncoder::encode(const std::vector<Stripe> &stripes,
+		const std::function<void()> &work_in_progress) {
+	if (threads_.empty() || stripes.size() <= 1) {
+		if (work_in_progress) {
+			work_in_progress();
+		}
+		for (const Stripe &stripe : stripes) {
+			encodeStripe(stripe);
+		}
+		return;
+	}
+
+	Batch batch{&stripes, 0, 0};
+	std::unique_lock<std::mutex> lock(mutex_);
+	batches_.push_back(&batch);
+	lock.unlock();
+	work_cond_.notify_all();
+
+	if (work_in_progress) {
+		work_in_progress();
+	}
+
+	lock.lock();
+	encodeBatch(batch, lock);
+	finished_cond_.wait(lock, [&batch]() { return batch.finished == batch.stripes->size(); });
+}
+
+void ParityEncoder::encodeBatch(Batch &batch, std::unique_lock<std::mutex> &lock) {
+	while (batch.next < batch.stripes->size()) {
+		const Stripe &stripe = (*batch.stripes)[batch.next++];
+		if (batch.next == batch.stripes->size()) {
+			// nothing more to take from this batch
+			batches_.erase(std::find(batches_.begin(), batches_.end(), &batch));
+		}
+		lock.unlock();
+		encodeStripe(stripe);
+		lock.lock();
+		batch.finished++;
+	}
+	finished_cond_.notify_all();
+}
+
+void ParityEncoder::worker() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;) {
+		work_cond_.wait(lock, [this]() { return terminate_ || !batches_.empty(); });
+		if (terminate_) {
+			return;
+		}
+		encodeBatch(*batches_.front(), lock);
+	}
+}
+
+void ParityEncoder::encodeStripe(const Stripe &stripe) {
+	int data_part_count = slice_traits::getNumberOfDataParts(stripe.type);
+	int parity_part_count = slice_traits::getNumberOfParityParts(stripe.type);
+
+	if (slice_traits::isXor(stripe.type)) {
+		assert(stripe.data[0] && stripe.parity[0]);
+		std::memcpy(stripe.parity[0], stripe.data[0], stripe.size);
+		for (int i = 1; i < data_part_count; ++i) {
+			if (stripe.data[i]) {
+				blockXor(stripe.parity[0], stripe.data[i], stripe.size);
+			}
+		}
+		return;
+	}
+
+	assert(slice_traits::isEC(stripe.type));
+	typedef ReedSolomon<slice_traits::ec::kMaxDataCount, slice_traits::ec::kMaxParityCount> RS;
+	// Matrices and tables are kept between calls, they are rebuilt only if the code changes
+	thread_local RS rs;
+	thread_local int rs_k = 0, rs_m = 0;
+	if (rs_k != data_part_count || rs_m != parity_part_count) {
+		rs = RS(data_part_count, parity_part_count);
+		rs_k = data_part_count;
+		rs_m = parity_part_count;
+	}
+
+	RS::ConstFragmentMap data_parts{{0}};
+	RS::FragmentMap parity_parts{{0}};
+	for (int i = 0; i < data_part_count; ++i) {
+		data_parts[i] = stripe.data[i];
+	}
+	for (int i = 0; i < parity_part_count; ++i) {
+		assert(stripe.parity[i]);
+		parity_parts[i] = stripe.parity[i];
+	}
+	rs.encode(data_parts, parity_parts, stripe.size);
+}
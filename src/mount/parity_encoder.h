@@ -0,0 +1,87 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/goal.h"
+#include "common/slice_traits.h"
+
+/*! \brief Computes parity parts of xor and ec stripes written by ChunkWriter.
+ *
+ * Stripes are encoded in batches. A batch is shared between the calling thread and the threads
+ * of the encoder, each stripe is encoded in one pass computing all of its parity parts.
+ * Ec stripes use the Reed-Solomon kernels (ec_encode_data) chosen for the CPU at runtime.
+ */
+class ParityEncoder {
+public:
+	struct Stripe {
+		Stripe() : type(Goal::Slice::Type::kStandard), size(0), data{{nullptr}}, parity{{nullptr}} {
+		}
+
+		Goal::Slice::Type type; /// xor or ec slice type
+		uint32_t size;          /// number of bytes in each part
+		/// Data parts, null pointers stand for zeros (the first one has to be set for xor).
+		std::array<const uint8_t *, slice_traits::ec::kMaxDataCount> data;
+		/// Output buffers for all parity parts (xor has only one).
+		std::array<uint8_t *, slice_traits::ec::kMaxParityCount> parity;
+	};
+
+	/*! \param threads number of encoding threads, 0 makes callers encode all stripes */
+	explicit ParityEncoder(unsigned threads);
+	~ParityEncoder();
+
+	/*! \brief Encodes a batch of stripes.
+	 *
+	 * Work in progress is executed by the calling thread before it joins encoding of the batch,
+	 * so that it overlaps with work of the encoding threads. Returns when all stripes are encoded.
+	 */
+	void encode(const std::vector<Stripe> &stripes,
+			const std::function<void()> &work_in_progress = std::function<void()>());
+
+	/*! \brief Encodes a single stripe in the calling thread. */
+	static void encodeStripe(const Stripe &stripe);
+
+private:
+	struct Batch {
+		const std::vector<Stripe> *stripes;
+		size_t next;     // index of the first stripe not taken by any thread
+		size_t finished; // number of encoded stripes
+	};
+
+	// Encodes stripes of the batch until none is left, lock is released while encoding
+	void encodeBatch(Batch &batch, std::unique_lock<std::mutex> &lock);
+	void worker();
+
+	std::mutex mutex_;
+	std::condition_variable work_cond_;     // a new batch or termination
+	std::condition_variable finished_cond_; // a stripe was encoded
+	std::deque<Batch *> batches_;           // batches with stripes not taken yet
+	std::vector<std::thread> threads_;
+	bool terminate_;
+};
@@ -0,0 +1,128 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/parity_encoder.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "common/reed_solomon.h"
+#include "common/time_utils.h"
+#include "protocol/MFSCommunication.h"
+
+typedef ReedSolomon<slice_traits::ec::kMaxDataCount, slice_traits::ec::kMaxParityCount> RS;
+
+struct TestStripes {
+	TestStripes(Goal::Slice::Type type, int count, uint32_t size) {
+		int k = slice_traits::getNumberOfDataParts(type);
+		int m = slice_traits::getNumberOfParityParts(type);
+		buffers.resize(count * (k + m), std::vector<uint8_t>(size));
+		for (int i = 0; i < count; ++i) {
+			ParityEncoder::Stripe stripe;
+			stripe.type = type;
+			stripe.size = size;
+			for (int j = 0; j < k; ++j) {
+				auto &buffer = buffers[i * (k + m) + j];
+				for (auto &byte : buffer) {
+					byte = rand();
+				}
+				stripe.data[j] = buffer.data();
+			}
+			for (int j = 0; j < m; ++j) {
+				stripe.parity[j] = buffers[i * (k + m) + k + j].data();
+			}
+			stripes.push_back(stripe);
+		}
+	}
+
+	std::vector<std::vector<uint8_t>> buffers;
+	std::vector<ParityEncoder::Stripe> stripes;
+};
+
+TEST(ParityEncoderTests, Xor) {
+	TestStripes test(slice_traits::xors::getSliceType(3), 10, MFSBLOCKSIZE);
+	ParityEncoder encoder(2);
+	encoder.encode(test.stripes);
+	for (const auto &stripe : test.stripes) {
+		for (uint32_t i = 0; i < stripe.size; ++i) {
+			ASSERT_EQ(stripe.data[0][i] ^ stripe.data[1][i] ^ stripe.data[2][i], stripe.parity[0][i]);
+		}
+	}
+}
+
+TEST(ParityEncoderTests, EcMatchesRecovery) {
+	const int k = 5, m = 3;
+	TestStripes test(slice_traits::ec::getSliceType(k, m), 10, MFSBLOCKSIZE);
+	test.stripes[3].data[1] = nullptr; // zeros
+	bool work_done = false;
+	ParityEncoder encoder(3);
+	encoder.encode(test.stripes, [&work_done]() { work_done = true; });
+	EXPECT_TRUE(work_done);
+
+	for (const auto &stripe : test.stripes) {
+		// Recover data parts from parity parts and compare them with the original ones
+		RS rs(k, m);
+		RS::ErasedMap erased;
+		RS::ConstFragmentMap input{{0}};
+		RS::FragmentMap output{{0}};
+		std::vector<std::vector<uint8_t>> recovered(m, std::vector<uint8_t>(stripe.size));
+		std::vector<uint8_t> zeros(stripe.size, 0);
+		for (int i = 0; i < k; ++i) {
+			input[i] = stripe.data[i] ? stripe.data[i] : zeros.data();
+		}
+		for (int i = 0; i < m; ++i) {
+			input[k + i] = stripe.parity[i];
+			erased.set(i);
+			input[i] = nullptr;
+			output[i] = recovered[i].data();
+		}
+		rs.recover(input, erased, output, stripe.size);
+		for (int i = 0; i < m; ++i) {
+			const uint8_t *original = stripe.data[i] ? stripe.data[i] : zeros.data();
+			ASSERT_EQ(std::vector<uint8_t>(original, original + stripe.size), recovered[i]);
+		}
+	}
+}
+
+static void benchmark_encoder(Goal::Slice::Type type, unsigned threads) {
+	const int stripe_count = 64;
+	TestStripes test(type, stripe_count, MFSBLOCKSIZE);
+	ParityEncoder encoder(threads);
+	int repeat_count = 10;
+	Timer time;
+	for (int i = 0; i < repeat_count; ++i) {
+		encoder.encode(test.stripes);
+	}
+	int64_t bytes = (int64_t)slice_traits::getNumberOfDataParts(type) * MFSBLOCKSIZE
+			* stripe_count * repeat_count;
+	std::cout << "Encoding " << to_string(type) << " with " << threads << " threads = "
+			<< bytes / std::max<int64_t>(time.elapsed_us(), 1) << "MB/s\n";
+}
+
+TEST(ParityEncoderTests, EncodeBenchmark) {
+	for (unsigned threads : {0, 4}) {
+		benchmark_encoder(slice_traits::xors::getSliceType(2), threads);
+		benchmark_encoder(slice_traits::xors::getSliceType(7), threads);
+		benchmark_encoder(slice_traits::ec::getSliceType(3, 2), threads);
+		benchmark_encoder(slice_traits::ec::getSliceType(8, 4), threads);
+		benchmark_encoder(slice_traits::ec::getSliceType(16, 8), threads);
+	}
+}
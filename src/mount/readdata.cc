@@ -29,14 +29,19 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <condition_variable>
+#include <limits>
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 
 #include "common/connection_pool.h"
 #include "common/datapack.h"
 #include "common/exceptions.h"
 #include "common/mfserr.h"
+#include "common/pcqueue.h"
 #include "common/read_plan_executor.h"
 #include "common/slogger.h"
 #include "common/sockets.h"
@@ -46,6 +51,8 @@
 #include "mount/mastercomm.h"
 #include "mount/readahead_adviser.h"
 #include "mount/readdata_cache.h"
+#include "mount/shared_read_cache.h"
+#include "mount/stats.h"
 #include "mount/tweaks.h"
 #include "protocol/MFSCommunication.h"
 
@@ -55,6 +62,22 @@
 static std::atomic<uint32_t> gReadaheadMaxWindowSize;
 static std::atomic<uint32_t> gCacheExpirationTime_ms;
 
+// Maximal size of a single background readahead request
+static const uint32_t kPrefetchSegmentSize = 16 * MFSBLOCKSIZE;
+
+/// A part of the readahead window read by a readahead worker.
+struct PrefetchSegment {
+	PrefetchSegment(uint64_t offset, uint32_t size)
+			: offset(offset), size(size), in_progress(false), done(false), data() {
+	}
+
+	uint64_t offset;
+	uint32_t size;
+	bool in_progress;
+	bool done;
+	std::vector<uint8_t> data;
+};
+
 struct readrec {
 	ChunkReader reader;
 	ReadCache cache;
@@ -64,13 +87,43 @@ struct readrec {
 	uint8_t refreshCounter;         // gMutex
 	bool expired;                   // gMutex
 
+	ChunkReader prefetch_reader;    // used only by the worker handling this record
+	uint8_t prefetchRefreshCounter; // gMutex
+	std::mutex prefetch_mutex;
+	std::condition_variable prefetch_cond;
+	std::list<PrefetchSegment> prefetch_segments; // prefetch_mutex
+	uint64_t prefetch_start;        // prefetch_mutex, start of the current sequential stream
+	uint64_t prefetch_end;          // prefetch_mutex, end of the last scheduled segment
+	uint64_t prefetch_eof;          // prefetch_mutex, offset at which a prefetch hit end of file
+	uint32_t prefetch_generation;   // prefetch_mutex, changed when prefetched data gets stale
+	bool prefetch_queued;           // prefetch_mutex, record is in the queue or being handled
+
 	readrec(uint32_t inode, ChunkConnector& connector, double bandwidth_overuse)
 			: reader(connector, bandwidth_overuse),
 			  cache(gCacheExpirationTime_ms),
 			  readahead_adviser(gCacheExpirationTime_ms, gReadaheadMaxWindowSize),
 			  inode(inode),
 			  refreshCounter(0),
-			  expired(false) {
+			  expired(false),
+			  prefetch_reader(connector, bandwidth_overuse),
+			  prefetchRefreshCounter(0),
+			  prefetch_segments(),
+			  prefetch_start(0),
+			  prefetch_end(0),
+			  prefetch_eof(std::numeric_limits<uint64_t>::max()),
+			  prefetch_generation(0),
+			  prefetch_queued(false) {
+	}
+
+	/// Drops prefetched data and scheduled segments; prefetch_mutex has to be locked.
+	void cancelPrefetch() {
+		prefetch_segments.remove_if([](const PrefetchSegment &segment) {
+			return !segment.in_progress;
+		});
+		// data being read at the moment will be dropped too
+		prefetch_generation++;
+		prefetch_start = prefetch_end = 0;
+		prefetch_eof = std::numeric_limits<uint64_t>::max();
 	}
 };
 
@@ -89,6 +142,21 @@ static std::atomic<bool> gPrefetchXorStripes;
 static bool readDataTerminate;
 static std::atomic<uint32_t> maxRetries;
 static double gBandwidthOveruse;
+static void *gPrefetchQueue;
+static std::vector<pthread_t> gPrefetchWorkers;
+static std::atomic<bool> gAsyncReadahead;
+static std::atomic<uint64_t> gPrefetchedBytes;
+static std::atomic<uint64_t> gPrefetchWaits;
+static std::atomic<uint64_t> gPrefetchCancels;
+static std::unique_ptr<SharedReadCache> gSharedReadCache;
+static void *gChunkReadQueue;
+static std::vector<pthread_t> gChunkReadWorkers;
+static std::atomic<uint32_t> gParallelChunkReads;
+static std::atomic<uint32_t> gParallelChunkReadsInFlight;
+static std::atomic<uint64_t> gParallelChunkReadsTotal;
+static uint64_t *gSharedReadCacheHits;
+static uint64_t *gSharedReadCacheMisses;
+static uint64_t *gSharedReadCacheEvictions;
 
 const unsigned ReadaheadAdviser::kInitWindowSize;
 const unsigned ReadaheadAdviser::kDefaultWindowSizeLimit;
@@ -134,12 +202,22 @@ void* read_data_delayed_ops(void *arg) {
 		}
 		ReadRecords::iterator readRecordIt = gActiveReadRecords.begin();
 		while (readRecordIt != gActiveReadRecords.end()) {
-			if (readRecordIt->second->refreshCounter < REFRESHTICKS) {
-				++(readRecordIt->second->refreshCounter);
+			readrec *rrec = readRecordIt->second;
+			if (rrec->refreshCounter < REFRESHTICKS) {
+				++(rrec->refreshCounter);
+			}
+			if (rrec->prefetchRefreshCounter < REFRESHTICKS) {
+				++(rrec->prefetchRefreshCounter);
 			}
 
-			if (readRecordIt->second->expired) {
-				delete readRecordIt->second;
+			bool in_use = false;
+			if (rrec->expired) {
+				// records are deleted only when no readahead worker uses them
+				std::unique_lock<std::mutex> prefetch_lock(rrec->prefetch_mutex);
+				in_use = rrec->prefetch_queued;
+			}
+			if (rrec->expired && !in_use) {
+				delete rrec;
 				readRecordIt = gActiveReadRecords.erase(readRecordIt);
 			} else {
 				++readRecordIt;
@@ -164,8 +242,13 @@ void read_data_end(void* rr) {
 
 	std::unique_lock<std::mutex> lock(gMutex);
 	rrec->expired = true;
+	std::unique_lock<std::mutex> prefetch_lock(rrec->prefetch_mutex);
+	rrec->cancelPrefetch();
 }
 
+static void *read_data_prefetch_worker(void *arg);
+static void *read_data_chunk_worker(void *arg);
+
 void read_data_init(uint32_t retries,
 		uint32_t chunkserverRoundTripTime_ms,
 		uint32_t chunkserverConnectTimeout_ms,
@@ -173,8 +256,12 @@ void read_data_init(uint32_t retries,
 		uint32_t chunkserverTotalReadTimeout_ms,
 		uint32_t cache_expiration_time_ms,
 		uint32_t readahead_max_window_size_kB,
+		uint32_t readahead_workers,
+		uint32_t read_cache_size_MB,
+		uint32_t parallel_chunk_reads,
 		bool prefetchXorStripes,
-		double bandwidth_overuse) {
+		double bandwidth_overuse,
+		const std::string &local_chunkserver_socket_dir) {
 	pthread_attr_t thattr;
 
 	readDataTerminate = false;
@@ -192,10 +279,32 @@ void read_data_init(uint32_t retries,
 	gTweaks.registerVariable("PrefetchXorStripes", gPrefetchXorStripes);
 	gChunkConnector.setRoundTripTime(chunkserverRoundTripTime_ms);
 	gChunkConnector.setSourceIp(fs_getsrcip());
+	gChunkConnector.setLocalSocketDirectory(local_chunkserver_socket_dir);
 	pthread_attr_init(&thattr);
 	pthread_attr_setstacksize(&thattr,0x100000);
 	pthread_create(&delayedOpsThread,&thattr,read_data_delayed_ops,NULL);
+	gPrefetchQueue = queue_new(0);
+	gPrefetchWorkers.resize(readahead_workers);
+	for (auto &th : gPrefetchWorkers) {
+		pthread_create(&th, &thattr, read_data_prefetch_worker, NULL);
+	}
+	gChunkReadQueue = queue_new(0);
+	gChunkReadWorkers.resize(parallel_chunk_reads);
+	for (auto &th : gChunkReadWorkers) {
+		pthread_create(&th, &thattr, read_data_chunk_worker, NULL);
+	}
 	pthread_attr_destroy(&thattr);
+	gAsyncReadahead = readahead_workers > 0;
+	gParallelChunkReads = parallel_chunk_reads;
+
+	if (read_cache_size_MB > 0) {
+		gSharedReadCache.reset(new SharedReadCache(uint64_t(read_cache_size_MB) << 20,
+				cache_expiration_time_ms));
+		statsnode *s = stats_get_subnode(NULL, "read_cache", 0);
+		gSharedReadCacheHits = stats_get_counterptr(stats_get_subnode(s, "hits", 0));
+		gSharedReadCacheMisses = stats_get_counterptr(stats_get_subnode(s, "misses", 0));
+		gSharedReadCacheEvictions = stats_get_counterptr(stats_get_subnode(s, "evictions", 0));
+	}
 
 	gTweaks.registerVariable("ReadMaxRetries", maxRetries);
 	gTweaks.registerVariable("ReadConnectTimeout", gChunkserverConnectTimeout_ms);
@@ -203,10 +312,19 @@ void read_data_init(uint32_t retries,
 	gTweaks.registerVariable("ReadTotalTimeout", gChunkserverTotalReadTimeout_ms);
 	gTweaks.registerVariable("CacheExpirationTime", gCacheExpirationTime_ms);
 	gTweaks.registerVariable("ReadaheadMaxWindowSize", gReadaheadMaxWindowSize);
+	gTweaks.registerVariable("ReadaheadAsync", gAsyncReadahead);
+	gTweaks.registerVariable("ReadaheadPrefetchedBytes", gPrefetchedBytes);
+	gTweaks.registerVariable("ReadaheadWaits", gPrefetchWaits);
+	gTweaks.registerVariable("ReadaheadCancels", gPrefetchCancels);
+	gTweaks.registerVariable("ReadParallelChunks", gParallelChunkReads);
+	gTweaks.registerVariable("ReadParallelChunksTotal", gParallelChunkReadsTotal);
 	gTweaks.registerVariable("ReadChunkPrepare", ChunkReader::preparations);
+	gTweaks.registerVariable("ReadChunkPrefetch", ReadChunkLocator::chunksToPrefetch);
 	gTweaks.registerVariable("ReqExecutedTotal", ReadPlanExecutor::executions_total_);
 	gTweaks.registerVariable("ReqExecutedUsingAll", ReadPlanExecutor::executions_with_additional_operations_);
 	gTweaks.registerVariable("ReqFinishedUsingAll", ReadPlanExecutor::executions_finished_by_additional_operations_);
+	gTweaks.registerVariable("ReqHedgesIssued", ReadPlanExecutor::hedges_issued_);
+	gTweaks.registerVariable("ReqHedgesWon", ReadPlanExecutor::hedges_won_);
 }
 
 void read_data_term(void) {
@@ -217,7 +335,28 @@ void read_data_term(void) {
 
 	pthread_join(delayedOpsThread,NULL);
 
+	for (size_t i = 0; i < gPrefetchWorkers.size(); ++i) {
+		queue_put(gPrefetchQueue, 0, 0, NULL, 0);
+	}
+	for (auto &th : gPrefetchWorkers) {
+		pthread_join(th, NULL);
+	}
+	gPrefetchWorkers.clear();
+	queue_delete(gPrefetchQueue);
+	gPrefetchQueue = nullptr;
+
+	for (size_t i = 0; i < gChunkReadWorkers.size(); ++i) {
+		queue_put(gChunkReadQueue, 0, 0, NULL, 0);
+	}
+	for (auto &th : gChunkReadWorkers) {
+		pthread_join(th, NULL);
+	}
+	gChunkReadWorkers.clear();
+	queue_delete(gChunkReadQueue);
+	gChunkReadQueue = nullptr;
+
 	clear_active_read_records();
+	gSharedReadCache.reset();
 }
 
 void read_inode_ops(uint32_t inode) { // attributes of inode have been changed - force reconnect and clear cache
@@ -226,7 +365,16 @@ void read_inode_ops(uint32_t inode) { // attributes of inode have been changed -
 	ReadRecordRange range = gActiveReadRecords.equal_range(inode);
 
 	for (ReadRecords::iterator it = range.first; it != range.second; ++it) {
-		it->second->refreshCounter = REFRESHTICKS; // force reconnect on forthcoming access
+		readrec *rrec = it->second;
+		rrec->refreshCounter = REFRESHTICKS; // force reconnect on forthcoming access
+		rrec->prefetchRefreshCounter = REFRESHTICKS;
+		std::unique_lock<std::mutex> prefetch_lock(rrec->prefetch_mutex);
+		rrec->cancelPrefetch();
+	}
+	lock.unlock();
+
+	if (gSharedReadCache) {
+		gSharedReadCache->invalidate(inode);
 	}
 }
 
@@ -238,35 +386,104 @@ int read_data_sleep_time_ms(int tryCounter) {
 	}
 }
 
-static void print_error_msg(const readrec *rrec, uint32_t try_counter, const Exception &ex) {
-	if (rrec->reader.isChunkLocated()) {
+static void print_error_msg(const ChunkReader &reader, uint32_t try_counter, const Exception &ex) {
+	if (reader.isChunkLocated()) {
 		lzfs_pretty_syslog(LOG_WARNING,
 		                   "read file error, inode: %u, index: %u, chunk: %" PRIu64 ", version: %u - %s "
-		                   "(try counter: %u)", rrec->reader.inode(), rrec->reader.index(),
-		                   rrec->reader.chunkId(), rrec->reader.version(), ex.what(), try_counter);
+		                   "(try counter: %u)", reader.inode(), reader.index(),
+		                   reader.chunkId(), reader.version(), ex.what(), try_counter);
 	} else {
 		lzfs_pretty_syslog(LOG_WARNING,
 		                   "read file error, inode: %u, index: %u, chunk: failed to locate - %s "
-		                   "(try counter: %u)", rrec->reader.inode(), rrec->reader.index(),
+		                   "(try counter: %u)", reader.inode(), reader.index(),
 		                   ex.what(), try_counter);
 	}
 }
 
-static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes_to_read,
-		std::vector<uint8_t> &read_buffer, uint64_t *bytes_read) {
+static void read_cache_stats_update() {
+	SharedReadCache::Stats cache_stats = gSharedReadCache->takeStats();
+	stats_lock();
+	*gSharedReadCacheHits += cache_stats.hits;
+	*gSharedReadCacheMisses += cache_stats.misses;
+	*gSharedReadCacheEvictions += cache_stats.evictions;
+	stats_unlock();
+}
+
+/*!
+ * \brief Reads data of a chunk, using the shared read cache if it is enabled.
+ *
+ * The range is extended to whole blocks. Leading blocks found in the cache are not read
+ * from chunkservers and blocks which are read are put into the cache. Only full blocks are
+ * cached, so the end of file is always determined by the length of the file known to reader.
+ *
+ * \return number of bytes appended to buffer (less than size only at the end of file)
+ */
+static uint32_t read_chunk_data(ChunkReader &reader, std::vector<uint8_t> &buffer,
+		uint32_t offset, uint32_t size, const Timeout &communication_timeout) {
+	if (!gSharedReadCache || reader.chunkId() == 0) {
+		return reader.readData(buffer, offset, size,
+				gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
+				communication_timeout, gPrefetchXorStripes);
+	}
+
+	uint64_t offset_in_file = static_cast<uint64_t>(reader.index()) * MFSCHUNKSIZE + offset;
+	if (offset_in_file >= reader.fileLength()) {
+		return 0;
+	}
+	size = std::min<uint64_t>(size, reader.fileLength() - offset_in_file);
+
+	uint32_t inode = reader.inode();
+	uint32_t index = reader.index();
+	uint64_t chunk_id = reader.chunkId();
+	uint32_t version = reader.version();
+	uint32_t first_block = offset / MFSBLOCKSIZE;
+	uint32_t end_block = (offset + size + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE;
+	uint64_t generation = gSharedReadCache->generation(inode);
+
+	std::vector<uint8_t> blocks;
+	uint32_t block = first_block;
+	while (block < end_block
+			&& gSharedReadCache->get(inode, index, block, chunk_id, version, blocks)) {
+		++block;
+	}
+	if (block < end_block) {
+		size_t cached_size = blocks.size();
+		uint32_t bytes_read = reader.readData(blocks, block * MFSBLOCKSIZE,
+				(end_block - block) * MFSBLOCKSIZE,
+				gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
+				communication_timeout, gPrefetchXorStripes);
+		for (uint32_t pos = 0; pos + MFSBLOCKSIZE <= bytes_read; pos += MFSBLOCKSIZE, ++block) {
+			gSharedReadCache->put(inode, index, block, chunk_id, version, generation,
+					blocks.data() + cached_size + pos, MFSBLOCKSIZE);
+		}
+	}
+	read_cache_stats_update();
+
+	uint32_t skip = offset - first_block * MFSBLOCKSIZE;
+	if (blocks.size() <= skip) {
+		return 0;
+	}
+	uint32_t bytes = std::min<uint64_t>(size, blocks.size() - skip);
+	buffer.insert(buffer.end(), blocks.begin() + skip, blocks.begin() + skip + bytes);
+	return bytes;
+}
+
+/*!
+ * \brief Reads a part of one chunk, retrying after recoverable failures.
+ *
+ * \param force_prepare if true, location of the chunk is fetched even if it is known to reader
+ * \param refresh_counter refresh counter (guarded by gMutex) belonging to the reader, may be null
+ */
+static int read_chunk_to_buffer(ChunkReader &reader, uint8_t *refresh_counter, uint32_t inode,
+		uint32_t chunk_index, uint32_t offset_in_chunk, uint32_t size, uint32_t max_retries,
+		bool force_prepare, std::vector<uint8_t> &read_buffer, uint32_t *bytes_read) {
 	uint32_t try_counter = 0;
-	uint32_t prepared_inode = 0; // this is always different than any real inode
-	uint32_t prepared_chunk_id = 0;
-	assert(*bytes_read == 0);
+	bool prepared = false;
 
 	// forced sleep between retries caused by recoverable failures
 	uint32_t sleep_time_ms = 0;
 
-	std::unique_lock<std::mutex> lock(gMutex);
-	bool force_prepare = (rrec->refreshCounter == REFRESHTICKS);
-	lock.unlock();
-
-	while (bytes_to_read > 0) {
+	for (;;) {
 		Timeout sleep_timeout = Timeout(std::chrono::milliseconds(sleep_time_ms));
 		// Increase communicationTimeout to sleepTime; longer poll() can't be worse
 		// than short poll() followed by nonproductive usleep().
@@ -274,38 +491,20 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 		Timeout communication_timeout = Timeout(std::chrono::milliseconds(timeout_ms));
 		sleep_time_ms = 0;
 		try {
-			uint32_t chunk_id = current_offset / MFSCHUNKSIZE;
-			if (force_prepare || prepared_inode != rrec->inode || prepared_chunk_id != chunk_id) {
-				rrec->reader.prepareReadingChunk(rrec->inode, chunk_id, force_prepare);
-				prepared_chunk_id = chunk_id;
-				prepared_inode = rrec->inode;
+			if (force_prepare || !prepared) {
+				reader.prepareReadingChunk(inode, chunk_index, force_prepare);
+				prepared = true;
 				force_prepare = false;
-				lock.lock();
-				rrec->refreshCounter = 0;
-				lock.unlock();
-			}
-
-			uint64_t offset_of_chunk = static_cast<uint64_t>(chunk_id) * MFSCHUNKSIZE;
-			uint32_t offset_in_chunk = current_offset - offset_of_chunk;
-			uint32_t size_in_chunk = MFSCHUNKSIZE - offset_in_chunk;
-			if (size_in_chunk > bytes_to_read) {
-				size_in_chunk = bytes_to_read;
-			}
-			uint32_t bytes_read_from_chunk = rrec->reader.readData(
-					read_buffer, offset_in_chunk, size_in_chunk,
-					gChunkserverConnectTimeout_ms, gChunkserverWaveReadTimeout_ms,
-					communication_timeout, gPrefetchXorStripes);
-			// No exceptions thrown. We can increase the counters and go to the next chunk
-			*bytes_read += bytes_read_from_chunk;
-			current_offset += bytes_read_from_chunk;
-			bytes_to_read -= bytes_read_from_chunk;
-			if (bytes_read_from_chunk < size_in_chunk) {
-				// end of file
-				break;
+				if (refresh_counter) {
+					std::unique_lock<std::mutex> lock(gMutex);
+					*refresh_counter = 0;
+				}
 			}
-			try_counter = 0;
+			*bytes_read = read_chunk_data(
+					reader, read_buffer, offset_in_chunk, size, communication_timeout);
+			return LIZARDFS_STATUS_OK;
 		} catch (UnrecoverableReadException &ex) {
-			print_error_msg(rrec, try_counter, ex);
+			print_error_msg(reader, try_counter, ex);
 			if (ex.status() == LIZARDFS_ERROR_ENOENT) {
 				return LIZARDFS_ERROR_EBADF; // stale handle
 			} else {
@@ -313,10 +512,10 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 			}
 		} catch (Exception &ex) {
 			if (try_counter > 0) {
-				print_error_msg(rrec, try_counter, ex);
+				print_error_msg(reader, try_counter, ex);
 			}
 			force_prepare = true;
-			if (try_counter > maxRetries) {
+			if (try_counter > max_retries) {
 				return LIZARDFS_ERROR_IO;
 			} else {
 				usleep(sleep_timeout.remaining_us());
@@ -325,7 +524,304 @@ static int read_to_buffer(readrec *rrec, uint64_t current_offset, uint64_t bytes
 			try_counter++;
 		}
 	}
-	return LIZARDFS_STATUS_OK;
+}
+
+struct ChunkReadBatch;
+
+/*!
+ * \brief Part of a read request handed over to a chunk reading worker.
+ */
+struct ChunkReadJob {
+	uint32_t inode;
+	uint32_t chunk_index;
+	uint32_t offset_in_chunk;
+	uint32_t size;
+	uint32_t max_retries;
+	std::vector<uint8_t> buffer;
+	uint32_t bytes_read;
+	int status;
+	bool done; // guarded by ChunkReadBatch::mutex
+	ChunkReadBatch *batch;
+};
+
+struct ChunkReadBatch {
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::vector<ChunkReadJob> jobs;
+};
+
+/*!
+ * \brief Reserves a place for a chunk read executed by a worker.
+ * \return false if the limit of chunks read in parallel is reached
+ */
+static bool read_parallel_chunk_acquire() {
+	uint32_t in_flight = gParallelChunkReadsInFlight.load();
+	do {
+		if (in_flight >= std::min<uint32_t>(gParallelChunkReads, gChunkReadWorkers.size())) {
+			return false;
+		}
+	} while (!gParallelChunkReadsInFlight.compare_exchange_weak(in_flight, in_flight + 1));
+	return true;
+}
+
+static void *read_data_chunk_worker(void *) {
+	for (;;) {
+		uint32_t z1, z2, z3;
+		uint8_t *data;
+		queue_get(gChunkReadQueue, &z1, &z2, &data, &z3);
+		if (data == NULL) {
+			return NULL;
+		}
+		ChunkReadJob *job = (ChunkReadJob *)data;
+		ChunkReader reader(gChunkConnector, gBandwidthOveruse);
+		job->bytes_read = 0;
+		job->status = read_chunk_to_buffer(reader, nullptr, job->inode, job->chunk_index,
+				job->offset_in_chunk, job->size, job->max_retries, false, job->buffer,
+				&job->bytes_read);
+		gParallelChunkReadsInFlight--;
+		std::unique_lock<std::mutex> lock(job->batch->mutex);
+		job->done = true;
+		// notified under the lock, the batch is destroyed as soon as its owner sees the flag
+		job->batch->cond.notify_all();
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Reads data of a file using the given reader.
+ *
+ * If the data spans many chunks, chunks following the first one are read in parallel by
+ * chunk reading workers (as long as the limit of chunks read in parallel allows it).
+ *
+ * \param reader rrec->reader (foreground reads) or rrec->prefetch_reader (readahead)
+ * \param refresh_counter refresh counter (guarded by gMutex) belonging to the reader
+ * \param max_retries maximal number of retries after recoverable failures
+ */
+static int read_to_buffer(readrec *rrec, ChunkReader &reader, uint8_t &refresh_counter,
+		uint32_t max_retries, uint64_t current_offset, uint64_t bytes_to_read,
+		std::vector<uint8_t> &read_buffer, uint64_t *bytes_read) {
+	assert(*bytes_read == 0);
+	if (bytes_to_read == 0) {
+		return LIZARDFS_STATUS_OK;
+	}
+
+	std::unique_lock<std::mutex> lock(gMutex);
+	bool force_prepare = (refresh_counter == REFRESHTICKS);
+	lock.unlock();
+
+	uint32_t first_chunk = current_offset / MFSCHUNKSIZE;
+	uint32_t end_chunk = (current_offset + bytes_to_read + MFSCHUNKSIZE - 1) / MFSCHUNKSIZE;
+	auto chunk_range = [&](uint32_t chunk_index, uint32_t &offset_in_chunk, uint32_t &size) {
+		uint64_t offset_of_chunk = static_cast<uint64_t>(chunk_index) * MFSCHUNKSIZE;
+		uint64_t begin = std::max(current_offset, offset_of_chunk);
+		uint64_t end = std::min(current_offset + bytes_to_read, offset_of_chunk + MFSCHUNKSIZE);
+		offset_in_chunk = begin - offset_of_chunk;
+		size = end - begin;
+	};
+
+	ChunkReadBatch batch;
+	batch.jobs.reserve(end_chunk - first_chunk - 1);
+	for (uint32_t chunk_index = first_chunk + 1; chunk_index < end_chunk; ++chunk_index) {
+		if (!read_parallel_chunk_acquire()) {
+			break;
+		}
+		ChunkReadJob job;
+		job.inode = rrec->inode;
+		job.chunk_index = chunk_index;
+		chunk_range(chunk_index, job.offset_in_chunk, job.size);
+		job.max_retries = max_retries;
+		job.bytes_read = 0;
+		job.status = LIZARDFS_STATUS_OK;
+		job.done = false;
+		job.batch = &batch;
+		batch.jobs.push_back(std::move(job));
+	}
+	for (ChunkReadJob &job : batch.jobs) {
+		queue_put(gChunkReadQueue, 0, 0, (uint8_t *)&job, 0);
+	}
+	if (!batch.jobs.empty()) {
+		gParallelChunkReadsTotal += batch.jobs.size();
+	}
+
+	int status = LIZARDFS_STATUS_OK;
+	for (uint32_t chunk_index = first_chunk; chunk_index < end_chunk; ++chunk_index) {
+		uint32_t offset_in_chunk, size_in_chunk;
+		chunk_range(chunk_index, offset_in_chunk, size_in_chunk);
+		uint32_t bytes_read_from_chunk = 0;
+		uint32_t job_index = chunk_index - first_chunk - 1;
+		if (chunk_index > first_chunk && job_index < batch.jobs.size()) {
+			ChunkReadJob &job = batch.jobs[job_index];
+			std::unique_lock<std::mutex> batch_lock(batch.mutex);
+			batch.cond.wait(batch_lock, [&job]() { return job.done; });
+			batch_lock.unlock();
+			status = job.status;
+			bytes_read_from_chunk = job.bytes_read;
+			read_buffer.insert(read_buffer.end(), job.buffer.begin(), job.buffer.end());
+		} else {
+			status = read_chunk_to_buffer(reader, &refresh_counter, rrec->inode, chunk_index,
+					offset_in_chunk, size_in_chunk, max_retries, force_prepare, read_buffer,
+					&bytes_read_from_chunk);
+			force_prepare = false;
+		}
+		if (status != LIZARDFS_STATUS_OK) {
+			break;
+		}
+		*bytes_read += bytes_read_from_chunk;
+		if (bytes_read_from_chunk < size_in_chunk) {
+			// end of file
+			break;
+		}
+	}
+
+	// jobs refer to the batch, so all of them have to be finished before returning
+	std::unique_lock<std::mutex> batch_lock(batch.mutex);
+	batch.cond.wait(batch_lock, [&batch]() {
+		return std::all_of(batch.jobs.begin(), batch.jobs.end(),
+				[](const ChunkReadJob &job) { return job.done; });
+	});
+	return status;
+}
+
+/*!
+ * \brief Reads segments scheduled for prefetching one by one.
+ *
+ * Only one worker at a time handles a given record, so prefetch_reader isn't shared.
+ */
+static void read_data_prefetch(readrec *rrec) {
+	std::unique_lock<std::mutex> lock(rrec->prefetch_mutex);
+	for (;;) {
+		auto segment = std::find_if(rrec->prefetch_segments.begin(), rrec->prefetch_segments.end(),
+				[](const PrefetchSegment &segment) { return !segment.done; });
+		if (segment == rrec->prefetch_segments.end()) {
+			rrec->prefetch_queued = false;
+			rrec->prefetch_cond.notify_all();
+			return;
+		}
+		uint64_t offset = segment->offset;
+		uint32_t size = segment->size;
+		uint32_t generation = rrec->prefetch_generation;
+		segment->in_progress = true;
+		lock.unlock();
+
+		std::vector<uint8_t> buffer;
+		uint64_t bytes_read = 0;
+		// Retries are left to the foreground read, which waits for this one
+		int err = read_to_buffer(rrec, rrec->prefetch_reader, rrec->prefetchRefreshCounter, 0,
+				offset, size, buffer, &bytes_read);
+
+		lock.lock();
+		// Segments being read are never removed by other threads
+		segment->in_progress = false;
+		if (generation != rrec->prefetch_generation) {
+			// prefetching was cancelled, following segments belong to a new stream
+			rrec->prefetch_segments.erase(segment);
+		} else if (err) {
+			// foreground reads will deal with the failure, prefetching restarts from here
+			rrec->prefetch_segments.erase(segment, rrec->prefetch_segments.end());
+			rrec->prefetch_end = offset;
+		} else {
+			segment->done = true;
+			segment->data = std::move(buffer);
+			gPrefetchedBytes += bytes_read;
+			if (bytes_read < size) {
+				// end of file, there is nothing more to prefetch
+				rrec->prefetch_eof = rrec->prefetch_end = offset + bytes_read;
+				rrec->prefetch_segments.erase(std::next(segment), rrec->prefetch_segments.end());
+			}
+		}
+		rrec->prefetch_cond.notify_all();
+	}
+}
+
+static void *read_data_prefetch_worker(void *) {
+	for (;;) {
+		uint32_t z1, z2, z3;
+		uint8_t *data;
+		queue_get(gPrefetchQueue, &z1, &z2, &data, &z3);
+		if (data == NULL) {
+			return NULL;
+		}
+		read_data_prefetch((readrec *)data);
+	}
+	return NULL;
+}
+
+/*!
+ * \brief Moves prefetched data to cache before serving a read request.
+ *
+ * Waits only for segments overlapping with the request which are being read at the moment.
+ * Segments overlapping with the request which weren't started yet are dropped, the request
+ * will read this data itself. Access outside of the prefetched stream cancels prefetching.
+ */
+static void read_data_collect_prefetched(readrec *rrec, uint64_t offset, uint32_t size) {
+	std::unique_lock<std::mutex> lock(rrec->prefetch_mutex);
+	auto &segments = rrec->prefetch_segments;
+	if (offset < rrec->prefetch_start || offset > rrec->prefetch_end) {
+		if (!segments.empty()) {
+			gPrefetchCancels++;
+		}
+		rrec->cancelPrefetch();
+	}
+	uint64_t end = offset + size;
+	auto overlaps = [offset, end](const PrefetchSegment &segment) {
+		return segment.offset < end && offset < segment.offset + segment.size;
+	};
+	segments.remove_if([&overlaps](const PrefetchSegment &segment) {
+		return !segment.in_progress && !segment.done && overlaps(segment);
+	});
+	auto being_read = [&segments, &overlaps]() {
+		return std::any_of(segments.begin(), segments.end(),
+				[&overlaps](const PrefetchSegment &segment) {
+					return segment.in_progress && overlaps(segment);
+				});
+	};
+	if (being_read()) {
+		gPrefetchWaits++;
+		rrec->prefetch_cond.wait(lock, [&being_read]() { return !being_read(); });
+	}
+	for (auto it = segments.begin(); it != segments.end();) {
+		if (it->done) {
+			rrec->cache.store(it->offset, std::move(it->data));
+			it = segments.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/*!
+ * \brief Schedules reading of the readahead window following a read request in background.
+ * \param offset end of the read request
+ */
+static void read_data_schedule_prefetch(readrec *rrec, uint64_t offset) {
+	uint64_t window = rrec->readahead_adviser.window();
+	if (window == 0) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(rrec->prefetch_mutex);
+	if (rrec->prefetch_eof < offset) {
+		// the file has grown
+		rrec->prefetch_eof = std::numeric_limits<uint64_t>::max();
+	}
+	if (rrec->prefetch_end < offset) {
+		rrec->prefetch_start = rrec->prefetch_end = offset;
+	}
+	uint64_t target = std::min(offset + window, rrec->prefetch_eof);
+	uint32_t segment_size = std::min<uint64_t>(window, kPrefetchSegmentSize);
+	if (target < rrec->prefetch_end + segment_size) {
+		// wait until there is at least one full segment to read
+		return;
+	}
+	while (rrec->prefetch_end < target) {
+		uint64_t size = std::min<uint64_t>(segment_size, target - rrec->prefetch_end);
+		size = (size + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE * MFSBLOCKSIZE;
+		rrec->prefetch_segments.emplace_back(rrec->prefetch_end, size);
+		rrec->prefetch_end += size;
+	}
+	if (!rrec->prefetch_queued) {
+		rrec->prefetch_queued = true;
+		queue_put(gPrefetchQueue, 0, 0, (uint8_t *)rrec, 0);
+	}
 }
 
 int read_data(void *rr, off_t fuseOffset, size_t fuseSize,
@@ -341,18 +837,30 @@ int read_data(void *rr, off_t fuseOffset, size_t fuseSize,
 	// Feed the adviser with original FUSE offset and size (before alignment)
 	rrec->readahead_adviser.feed(fuseOffset, fuseSize);
 
+	bool async_readahead = gAsyncReadahead && !gPrefetchWorkers.empty();
+	if (async_readahead) {
+		read_data_collect_prefetched(rrec, offset, size);
+	}
+
 	ReadCache::Result result = rrec->cache.query(offset, size);
 
 	if (result.frontOffset() <= offset && offset + size <= result.endOffset()) {
 		ret = std::move(result);
+		if (async_readahead) {
+			read_data_schedule_prefetch(rrec, offset + size);
+		}
 		return LIZARDFS_STATUS_OK;
 	}
 	uint64_t request_offset = result.remainingOffset();
-	uint64_t bytes_to_read_left = std::max<uint64_t>(size, rrec->readahead_adviser.window()) - (request_offset - offset);
+	// With asynchronous readahead only the requested data is read here
+	uint64_t bytes_to_read_left = async_readahead ? size
+			: std::max<uint64_t>(size, rrec->readahead_adviser.window());
+	bytes_to_read_left -= request_offset - offset;
 	bytes_to_read_left = (bytes_to_read_left + MFSBLOCKSIZE - 1) / MFSBLOCKSIZE * MFSBLOCKSIZE;
 
 	uint64_t bytes_read = 0;
-	int err = read_to_buffer(rrec, request_offset, bytes_to_read_left, result.inputBuffer(), &bytes_read);
+	int err = read_to_buffer(rrec, rrec->reader, rrec->refreshCounter, maxRetries,
+			request_offset, bytes_to_read_left, result.inputBuffer(), &bytes_read);
 	if (err) {
 		// paranoia check - discard any leftover bytes from incorrect read
 		result.inputBuffer().clear();
@@ -360,5 +868,8 @@ int read_data(void *rr, off_t fuseOffset, size_t fuseSize,
 	}
 
 	ret = std::move(result);
+	if (async_readahead) {
+		read_data_schedule_prefetch(rrec, offset + size);
+	}
 	return LIZARDFS_STATUS_OK;
 }
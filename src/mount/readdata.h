@@ -21,6 +21,7 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <string>
 
 #include "mount/chunk_locator.h"
 #include "mount/readdata_cache.h"
@@ -43,6 +44,10 @@ void read_data_init(uint32_t retries,
 		uint32_t chunkserverTotalReadTimeout_ms,
 		uint32_t cache_expiration_time_ms,
 		uint32_t readahead_max_window_size_kB,
+		uint32_t readahead_workers,
+		uint32_t read_cache_size_MB,
+		uint32_t parallel_chunk_reads,
 		bool prefetchXorStripes,
-		double bandwidth_overuse);
+		double bandwidth_overuse,
+		const std::string &local_chunkserver_socket_dir);
 void read_data_term(void);
@@ -27,6 +27,7 @@
 #include <cassert>
 #include <cstring>
 #include <deque>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <numeric>
@@ -307,6 +308,23 @@ public:
 		return result;
 	}
 
+	/*!
+	 * \brief Put data which was read in advance into cache.
+	 *
+	 * Cached data overlapping with the new one is dropped.
+	 */
+	void store(Offset offset, std::vector<uint8_t> &&data) {
+		if (data.empty()) {
+			return;
+		}
+		auto it = entries_.upper_bound(offset, Entry::OffsetComp());
+		if (it != entries_.begin() && std::prev(it)->endOffset() > offset) {
+			--it;
+		}
+		auto inserted = insert(it, offset, data.size());
+		inserted->buffer = std::move(data);
+	}
+
 	void clear() {
 		auto it = entries_.begin();
 		while (it != entries_.end()) {
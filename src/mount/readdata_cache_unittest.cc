@@ -0,0 +1,62 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/readdata_cache.h"
+
+#include <gtest/gtest.h>
+
+static std::vector<uint8_t> pattern(uint8_t value, size_t size) {
+	return std::vector<uint8_t>(size, value);
+}
+
+TEST(ReadCacheTests, StoreAndQuery) {
+	ReadCache cache(1000000);
+	cache.store(100, pattern(1, 100));
+	cache.store(200, pattern(2, 100));
+
+	ReadCache::Result result = cache.query(150, 100);
+	ASSERT_EQ(100U, result.requestSize(150, 100));
+	std::vector<uint8_t> buffer(100);
+	EXPECT_EQ(100U, result.copyToBuffer(buffer.data(), 150, 100));
+	EXPECT_EQ(pattern(1, 50), std::vector<uint8_t>(buffer.begin(), buffer.begin() + 50));
+	EXPECT_EQ(pattern(2, 50), std::vector<uint8_t>(buffer.begin() + 50, buffer.end()));
+}
+
+TEST(ReadCacheTests, StoreReplacesOverlappingData) {
+	ReadCache cache(1000000);
+	cache.store(0, pattern(1, 100));
+	{
+		// data used by a reader stays valid after being replaced
+		ReadCache::Result held = cache.query(0, 100);
+		cache.store(50, pattern(2, 100));
+		std::vector<uint8_t> buffer(100);
+		EXPECT_EQ(100U, held.copyToBuffer(buffer.data(), 0, 100));
+		EXPECT_EQ(pattern(1, 100), buffer);
+	}
+
+	ReadCache::Result result = cache.query(50, 100);
+	std::vector<uint8_t> buffer(100);
+	EXPECT_EQ(100U, result.copyToBuffer(buffer.data(), 50, 100));
+	EXPECT_EQ(pattern(2, 100), buffer);
+
+	// data before offset 50 was dropped together with the overlapping entry
+	ReadCache::Result missing = cache.query(0, 50);
+	EXPECT_EQ(0U, missing.remainingOffset());
+	EXPECT_TRUE(missing.inputBuffer().empty());
+}
@@ -0,0 +1,125 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/shared_read_cache.h"
+
+constexpr uint32_t SharedReadCache::kGenerationSlots;
+
+SharedReadCache::SharedReadCache(uint64_t capacity, uint32_t expiration_time_ms)
+		: mutex_(),
+		  blocks_(),
+		  lru_(),
+		  generations_(),
+		  capacity_(capacity),
+		  expiration_time_ms_(expiration_time_ms),
+		  size_(0),
+		  stats_() {
+}
+
+uint64_t SharedReadCache::generation(uint32_t inode) const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return generations_[inode % kGenerationSlots];
+}
+
+bool SharedReadCache::get(uint32_t inode, uint32_t chunk_index, uint32_t block,
+		uint64_t chunk_id, uint32_t chunk_version, std::vector<uint8_t> &output) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	auto it = blocks_.find(Key(inode, chunk_index, block));
+	if (it == blocks_.end()) {
+		stats_.misses++;
+		return false;
+	}
+	BlockList::iterator entry = it->second;
+	if (entry->chunk_id != chunk_id || entry->chunk_version != chunk_version
+			|| entry->timer.elapsed_ms() >= expiration_time_ms_) {
+		// the chunk was modified or replaced, or the block may be outdated
+		erase(it);
+		stats_.misses++;
+		return false;
+	}
+	lru_.splice(lru_.end(), lru_, entry);
+	output.insert(output.end(), entry->data.begin(), entry->data.end());
+	stats_.hits++;
+	return true;
+}
+
+void SharedReadCache::put(uint32_t inode, uint32_t chunk_index, uint32_t block,
+		uint64_t chunk_id, uint32_t chunk_version, uint64_t generation,
+		const uint8_t *data, uint32_t size) {
+	if (size == 0 || size > capacity_) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (generations_[inode % kGenerationSlots] != generation) {
+		// the file was changed while the data was being read
+		return;
+	}
+	Key key(inode, chunk_index, block);
+	auto it = blocks_.find(key);
+	if (it != blocks_.end()) {
+		erase(it);
+	}
+	while (size_ + size > capacity_) {
+		erase(blocks_.find(lru_.front().key));
+		stats_.evictions++;
+	}
+	lru_.push_back(Block{key, chunk_id, chunk_version, std::vector<uint8_t>(data, data + size),
+			Timer()});
+	blocks_.emplace(key, std::prev(lru_.end()));
+	size_ += size;
+}
+
+void SharedReadCache::invalidate(uint32_t inode) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	generations_[inode % kGenerationSlots]++;
+	auto it = blocks_.lower_bound(Key(inode, 0, 0));
+	while (it != blocks_.end() && std::get<0>(it->first) == inode) {
+		auto next = std::next(it);
+		erase(it);
+		it = next;
+	}
+}
+
+void SharedReadCache::clear() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (auto &generation : generations_) {
+		generation++;
+	}
+	blocks_.clear();
+	lru_.clear();
+	size_ = 0;
+}
+
+uint64_t SharedReadCache::size() const {
+	std::unique_lock<std::mutex> lock(mutex_);
+	return size_;
+}
+
+SharedReadCache::Stats SharedReadCache::takeStats() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	Stats result = stats_;
+	stats_ = Stats();
+	return result;
+}
+
+void SharedReadCache::erase(std::map<Key, BlockList::iterator>::iterator it) {
+	size_ -= it->second->data.size();
+	lru_.erase(it->second);
+	blocks_.erase(it);
+}
@@ -0,0 +1,114 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "common/time_utils.h"
+
+/*! \brief Cache of file data shared by all descriptors of the mount.
+ *
+ * Data is kept in blocks (MFSBLOCKSIZE bytes, the last block of a file may be shorter)
+ * identified by inode, chunk index and index of the block in the chunk. Every block
+ * remembers id and version of the chunk it was read from, and a block is valid only
+ * as long as readers locate the same version of the chunk. Changes of a file noticed
+ * by the mount are reported with invalidate(), which drops all blocks of the inode.
+ * Chunks overwritten by other mounts may keep their version, so blocks also expire
+ * after the same time as entries of per-descriptor caches.
+ *
+ * Memory used by blocks is bounded by the capacity, least recently used blocks are
+ * evicted first. All methods are thread safe.
+ */
+class SharedReadCache {
+public:
+	struct Stats {
+		Stats() : hits(0), misses(0), evictions(0) {
+		}
+
+		uint64_t hits;      /// number of blocks found in cache
+		uint64_t misses;    /// number of blocks not found in cache
+		uint64_t evictions; /// number of blocks evicted to make room for new ones
+	};
+
+	SharedReadCache(uint64_t capacity, uint32_t expiration_time_ms);
+
+	/*! \brief Returns generation of an inode.
+	 *
+	 * Generation has to be taken before reading data from chunkservers and passed to put(),
+	 * so that data read while the file was being invalidated is not cached.
+	 */
+	uint64_t generation(uint32_t inode) const;
+
+	/*! \brief Appends data of a block to output.
+	 * \return true if the block was found, it comes from the given version of the chunk
+	 * and it hasn't expired
+	 */
+	bool get(uint32_t inode, uint32_t chunk_index, uint32_t block, uint64_t chunk_id,
+			uint32_t chunk_version, std::vector<uint8_t> &output);
+
+	/*! \brief Inserts a block read from the given version of a chunk. */
+	void put(uint32_t inode, uint32_t chunk_index, uint32_t block, uint64_t chunk_id,
+			uint32_t chunk_version, uint64_t generation, const uint8_t *data, uint32_t size);
+
+	/*! \brief Drops all blocks of an inode. */
+	void invalidate(uint32_t inode);
+
+	void clear();
+
+	/// Number of bytes of data in cache.
+	uint64_t size() const;
+
+	/// Statistics gathered since the previous call.
+	Stats takeStats();
+
+private:
+	typedef std::tuple<uint32_t, uint32_t, uint32_t> Key; // inode, chunk index, block
+
+	struct Block {
+		Key key;
+		uint64_t chunk_id;
+		uint32_t chunk_version;
+		std::vector<uint8_t> data;
+		Timer timer; // time since the block was read
+	};
+
+	typedef std::list<Block> BlockList;
+
+	// Generations are kept for groups of inodes, so that memory they use is bounded
+	static constexpr uint32_t kGenerationSlots = 4096;
+
+	void erase(std::map<Key, BlockList::iterator>::iterator it);
+
+	mutable std::mutex mutex_;
+	std::map<Key, BlockList::iterator> blocks_;
+	BlockList lru_; // least recently used blocks first
+	std::array<uint64_t, kGenerationSlots> generations_;
+	uint64_t capacity_;
+	uint32_t expiration_time_ms_;
+	uint64_t size_;
+	Stats stats_;
+};
@@ -0,0 +1,116 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common/platform.h"
+#include "mount/shared_read_cache.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+static const uint32_t kExpirationTime_ms = 60000;
+
+static void putBlock(SharedReadCache &cache, uint32_t inode, uint32_t block, uint32_t version,
+		uint8_t value, uint32_t size = 100) {
+	std::vector<uint8_t> data(size, value);
+	cache.put(inode, 0, block, 1, version, cache.generation(inode), data.data(), data.size());
+}
+
+TEST(SharedReadCacheTests, GetAndVersions) {
+	SharedReadCache cache(1000, kExpirationTime_ms);
+	std::vector<uint8_t> output;
+	EXPECT_FALSE(cache.get(1, 0, 0, 1, 1, output));
+	putBlock(cache, 1, 0, 1, 'a');
+	putBlock(cache, 1, 1, 1, 'b', 50);
+	EXPECT_EQ(150U, cache.size());
+	EXPECT_TRUE(cache.get(1, 0, 0, 1, 1, output));
+	EXPECT_TRUE(cache.get(1, 0, 1, 1, 1, output));
+	ASSERT_EQ(150U, output.size());
+	EXPECT_EQ('a', output[99]);
+	EXPECT_EQ('b', output[100]);
+
+	// a block read from another version of the chunk is dropped
+	EXPECT_FALSE(cache.get(1, 0, 0, 1, 2, output));
+	EXPECT_FALSE(cache.get(1, 0, 0, 1, 1, output));
+	EXPECT_EQ(50U, cache.size());
+
+	SharedReadCache::Stats stats = cache.takeStats();
+	EXPECT_EQ(2U, stats.hits);
+	EXPECT_EQ(3U, stats.misses);
+	EXPECT_EQ(0U, cache.takeStats().hits);
+}
+
+TEST(SharedReadCacheTests, Eviction) {
+	SharedReadCache cache(300, kExpirationTime_ms);
+	std::vector<uint8_t> output;
+	putBlock(cache, 1, 0, 1, 'a');
+	putBlock(cache, 1, 1, 1, 'b');
+	putBlock(cache, 1, 2, 1, 'c');
+	EXPECT_TRUE(cache.get(1, 0, 0, 1, 1, output));
+	putBlock(cache, 2, 0, 1, 'd');
+	EXPECT_EQ(300U, cache.size());
+	// block 1 was the least recently used one
+	EXPECT_FALSE(cache.get(1, 0, 1, 1, 1, output));
+	EXPECT_TRUE(cache.get(1, 0, 0, 1, 1, output));
+	EXPECT_TRUE(cache.get(1, 0, 2, 1, 1, output));
+	EXPECT_TRUE(cache.get(2, 0, 0, 1, 1, output));
+	EXPECT_EQ(1U, cache.takeStats().evictions);
+}
+
+TEST(SharedReadCacheTests, Invalidate) {
+	SharedReadCache cache(1000, kExpirationTime_ms);
+	std::vector<uint8_t> output;
+	putBlock(cache, 1, 0, 1, 'a');
+	putBlock(cache, 2, 0, 1, 'b');
+	uint64_t generation = cache.generation(1);
+	cache.invalidate(1);
+	EXPECT_FALSE(cache.get(1, 0, 0, 1, 1, output));
+	EXPECT_TRUE(cache.get(2, 0, 0, 1, 1, output));
+
+	// data read before the invalidation is not cached
+	std::vector<uint8_t> data(100, 'c');
+	cache.put(1, 0, 0, 1, 1, generation, data.data(), data.size());
+	EXPECT_FALSE(cache.get(1, 0, 0, 1, 1, output));
+	cache.put(1, 0, 0, 1, 1, cache.generation(1), data.data(), data.size());
+	EXPECT_TRUE(cache.get(1, 0, 0, 1, 1, output));
+
+	cache.clear();
+	EXPECT_EQ(0U, cache.size());
+	EXPECT_FALSE(cache.get(2, 0, 0, 1, 1, output));
+}
+
+TEST(SharedReadCacheTests, OverwrittenByAnotherMount) {
+	SharedReadCache cache(1000, 50);
+	std::vector<uint8_t> output;
+	putBlock(cache, 1, 0, 1, 'a');
+	EXPECT_TRUE(cache.get(1, 0, 0, 1, 1, output));
+
+	// another mount overwrites the chunk in place: its id and version stay the same and this
+	// mount is not notified, so the old data can be served only until the block expires
+	std::this_thread::sleep_for(std::chrono::milliseconds(60));
+	output.clear();
+	EXPECT_FALSE(cache.get(1, 0, 0, 1, 1, output));
+	EXPECT_TRUE(output.empty());
+	EXPECT_EQ(0U, cache.size());
+
+	putBlock(cache, 1, 0, 1, 'b');
+	EXPECT_TRUE(cache.get(1, 0, 0, 1, 1, output));
+	ASSERT_EQ(100U, output.size());
+	EXPECT_EQ('b', output[0]);
+}
@@ -20,8 +20,10 @@
 #include "common/platform.h"
 
 #include <fcntl.h>
+#include <cstring>
 
 #include "mount/client_common.h"
+#include "mount/global_chunkserver_stats.h"
 #include "mount/special_inode.h"
 #include "mount/stats.h"
 
@@ -58,6 +60,15 @@ static void open(const Context &ctx, FileInfo *fi) {
 	}
 	PthreadMutexWrapper lock((statsinfo->lock));         // make helgrind happy
 	stats_show_all(&(statsinfo->buff),&(statsinfo->leng));
+	std::string extra = global_chunkserver_stats_show() + stats_show_latencies();
+	if (statsinfo->buff && !extra.empty()) {
+		char *buff = (char*) realloc(statsinfo->buff, statsinfo->leng + extra.size());
+		if (buff) {
+			memcpy(buff + statsinfo->leng, extra.data(), extra.size());
+			statsinfo->buff = buff;
+			statsinfo->leng += extra.size();
+		}
+	}
 	statsinfo->reset = 0;
 	fi->fh = reinterpret_cast<uintptr_t>(statsinfo);
 	fi->direct_io = 1;
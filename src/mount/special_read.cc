@@ -127,8 +127,9 @@ static std::vector<uint8_t> read(const Context &ctx,
 	uint32_t ssize;
 	uint8_t *buff;
 	oplog_getdata(fi->fh, &buff, &ssize, size);
+	std::vector<uint8_t> ret(buff, buff + ssize);
 	oplog_releasedata(fi->fh);
-	return std::vector<uint8_t>(buff, buff + ssize);
+	return ret;
 }
 } // InodeOplog
 
@@ -141,8 +142,9 @@ static std::vector<uint8_t> read(const Context &ctx,
 	uint32_t ssize;
 	uint8_t *buff;
 	oplog_getdata(fi->fh, &buff, &ssize, size);
+	std::vector<uint8_t> ret(buff, buff + ssize);
 	oplog_releasedata(fi->fh);
-	return std::vector<uint8_t>(buff, buff + ssize);
+	return ret;
 }
 } // InodeOphistory
 
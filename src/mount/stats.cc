@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+PerThreadLatencyHistograms gOperationLatencies;
+
 static statsnode *firstnode = NULL;
 static uint32_t allactiveplengs = 0;
 static uint32_t activenodes = 0;
@@ -121,6 +123,8 @@ void stats_reset_all(void) {
 		stats_reset(a);
 
 	stats_unlock();
+
+	gOperationLatencies.reset();
 }
 
 static inline uint32_t stats_print_values(char *buff, uint32_t maxleng, statsnode *n) {
@@ -153,6 +157,42 @@ void stats_show_all(char **buff, uint32_t *leng) {
 	stats_unlock();
 }
 
+std::string stats_show_latencies(void) {
+	static const double percentiles[] = {50, 90, 99, 99.9};
+	static const char *percentile_names[] = {"p50", "p90", "p99", "p999"};
+	std::string result;
+	char line[256];
+
+	for (const auto &series : gOperationLatencies.collect()) {
+		const char *name = series.first.c_str();
+		const LatencyHistogram &histogram = series.second;
+		uint64_t count = histogram.count();
+
+		snprintf(line, sizeof(line), "latency.%s.count: %" PRIu64 "\n", name, count);
+		result += line;
+		snprintf(line, sizeof(line), "latency.%s.avg_us: %" PRIu64 "\n", name,
+		         histogram.sum_us() / count);
+		result += line;
+		for (int i = 0; i < 4; i++) {
+			snprintf(line, sizeof(line), "latency.%s.%s_us: %" PRIu64 "\n", name,
+			         percentile_names[i], histogram.percentile_us(percentiles[i]));
+			result += line;
+		}
+		// non-empty buckets as pairs of upper bound (in microseconds) and number of operations
+		snprintf(line, sizeof(line), "latency.%s.buckets:", name);
+		result += line;
+		for (int b = 0; b < LatencyHistogram::kBuckets; b++) {
+			if (histogram.bucketCount(b) > 0) {
+				snprintf(line, sizeof(line), " %" PRIu64 ":%" PRIu64,
+				         LatencyHistogram::bucketLimit_us(b), histogram.bucketCount(b));
+				result += line;
+			}
+		}
+		result += "\n";
+	}
+	return result;
+}
+
 void stats_free(statsnode *n) {
 	statsnode *a, *an;
 	free(n->name);
@@ -22,6 +22,9 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <string>
+
+#include "common/latency_histogram.h"
 
 struct statsnode {
 	uint64_t counter;
@@ -42,3 +45,9 @@ void stats_show_all(char **buff, uint32_t *leng);
 void stats_lock(void);
 void stats_unlock(void);
 void stats_term(void);
+
+// latency histograms of operations of this mount, reset together with the counters
+extern PerThreadLatencyHistograms gOperationLatencies;
+
+// returns merged latency histograms in the format of the .stats file
+std::string stats_show_latencies(void);
@@ -53,6 +53,7 @@
 #include "mount/chunk_writer.h"
 #include "mount/global_chunkserver_stats.h"
 #include "mount/mastercomm.h"
+#include "mount/parity_encoder.h"
 #include "mount/readdata.h"
 #include "mount/tweaks.h"
 #include "mount/write_cache_block.h"
@@ -63,10 +64,21 @@
 #define IDHASHSIZE 256
 #define IDHASH(inode) (((inode)*0xB239FB71)%IDHASHSIZE)
 
+// Maximum time for which partial blocks and stripes wait in the data chain for more data
+static std::atomic<uint32_t> gWriteCoalesceDelay_ms;
+
 namespace {
 
+/*!
+ * \brief Write cache of one inode.
+ *
+ * All fields except inode, lcnt and next are guarded by mutex. lcnt and next are guarded by
+ * gMutex, which protects the hash table of inodes. The lock order is gMutex, inodedata::mutex,
+ * gDelayedQueueMutex.
+ */
 struct inodedata {
 	uint32_t inode;
+	std::mutex mutex;
 	uint64_t maxfleng;
 	int status;
 	uint16_t flushwaiting;
@@ -119,7 +131,7 @@ struct inodedata {
 		}
 	}
 
-	/* glock: LOCKED */
+	/* ilock: LOCKED */
 	void wakeUpWorkerIfNecessary() {
 		/*
 		 * Write worker always looks for the first block in chain and we modify or add always the
@@ -134,7 +146,7 @@ struct inodedata {
 		}
 	}
 
-	/* glock: UNUSED */
+	/* ilock: UNUSED */
 	bool isDataChainPipeValid() const {
 		return newDataInChainPipe[0] >= 0;
 	}
@@ -145,11 +157,11 @@ struct inodedata {
 	 * or write_data_flush_inode or the data in data chain is too old to keep it longer in
 	 * our buffers. If this function returns false, we write only full stripes from data
 	 * chain to chunkservers.
-	 * glock: LOCKED
+	 * ilock: LOCKED
 	 */
 	bool requiresFlushing() const {
 		return (flushwaiting > 0
-				|| lastWriteToDataChain.elapsed_ms() >= kMaximumTimeInDataChainSinceLastWrite_ms
+				|| lastWriteToDataChain.elapsed_ms() >= gWriteCoalesceDelay_ms
 				|| lastWriteToChunkservers.elapsed_ms() >= kMaximumTimeInDataChainSinceLastFlush_ms);
 	}
 
@@ -182,13 +194,6 @@ private:
 	 * Maximum time for data to be kept in data chain waiting for collecting a full stripe.
 	 */
 	static const uint32_t kMaximumTimeInDataChainSinceLastFlush_ms = 15000;
-
-	/*! Limit for \p lastWriteToDataChain after which we force a flush.
-	 *
-	 * Maximum time for data to be kept in data chain waiting for collecting a full stripe
-	 * if no new data is written into the data chain
-	 */
-	static const uint32_t kMaximumTimeInDataChainSinceLastWrite_ms = 5000;
 };
 
 struct DelayedQueueEntry {
@@ -205,12 +210,15 @@ struct DelayedQueueEntry {
 } // anonymous namespace
 
 static std::atomic<uint32_t> maxretries;
-static std::mutex gMutex;
+static std::mutex gMutex; // guards idhash and inodedata::lcnt
 typedef std::unique_lock<std::mutex> Glock;
+typedef std::unique_lock<std::mutex> Ilock; // lock of inodedata::mutex
 
+// Free cache blocks are counted without any lock, fcbmutex is used only to wait for them
+static std::mutex fcbmutex;
 static std::condition_variable fcbcond;
-static uint32_t fcbwaiting = 0;
-static int64_t freecacheblocks;
+static std::atomic<uint32_t> fcbwaiting;
+static std::atomic<int64_t> freecacheblocks;
 static inodedata **idhash;
 
 static uint32_t gWriteWindowSize;
@@ -223,34 +231,50 @@ static pthread_t delayed_queue_worker_th;
 static std::vector<pthread_t> write_worker_th;
 
 static void* jqueue;
+static std::mutex gDelayedQueueMutex;
 static std::list<DelayedQueueEntry> delayedQueue;
 
 static ConnectionPool gChunkserverConnectionPool;
 static ChunkConnectorUsingPool gChunkConnector(gChunkserverConnectionPool);
+static std::unique_ptr<ParityEncoder> gParityEncoder;
 
-void write_cb_release_blocks(uint32_t count, Glock&) {
+void write_cb_release_blocks(uint32_t count) {
 	freecacheblocks += count;
-	if (fcbwaiting > 0 && freecacheblocks > 0) {
+	if (fcbwaiting > 0) {
+		// a waiter checks freecacheblocks under fcbmutex, so taking it avoids lost wakeups
+		std::unique_lock<std::mutex> fcblock(fcbmutex);
 		fcbcond.notify_all();
 	}
 }
 
-void write_cb_acquire_blocks(uint32_t count, Glock&) {
+void write_cb_acquire_blocks(uint32_t count) {
 	freecacheblocks -= count;
 }
 
-void write_cb_wait_for_block(inodedata* id, Glock& glock) {
-	LOG_AVG_TILL_END_OF_SCOPE0("write_cb_wait_for_block");
-	fcbwaiting++;
+static bool write_cb_can_acquire_block(uint64_t dataChainSize) {
+	int64_t freeBlocks = freecacheblocks;
+	// dataChainSize / (dataChainSize + freeBlocks) > gCachePerInodePercentage / 100
+	// really means "0 > 0"
+	return freeBlocks > 0
+			&& dataChainSize * 100 <= (dataChainSize + freeBlocks) * gCachePerInodePercentage;
+}
+
+/* ilock: LOCKED (released while waiting) */
+void write_cb_wait_for_block(inodedata* id, Ilock& ilock) {
 	uint64_t dataChainSize = id->dataChain.size();
-	while (freecacheblocks <= 0
-			// dataChainSize / (dataChainSize + freecacheblocks) > gCachePerInodePercentage / 100
-			// really means "0 > 0"
-			|| dataChainSize * 100 > (dataChainSize + freecacheblocks) * gCachePerInodePercentage)
-	{
-		fcbcond.wait(glock);
+	if (write_cb_can_acquire_block(dataChainSize)) {
+		return;
 	}
+	LOG_AVG_TILL_END_OF_SCOPE0("write_cb_wait_for_block");
+	ilock.unlock();
+	std::unique_lock<std::mutex> fcblock(fcbmutex);
+	fcbwaiting++;
+	fcbcond.wait(fcblock, [dataChainSize]() {
+		return write_cb_can_acquire_block(dataChainSize);
+	});
 	fcbwaiting--;
+	fcblock.unlock();
+	ilock.lock();
 }
 
 /* inode */
@@ -295,11 +319,13 @@ void write_free_inodedata(inodedata* fid, Glock&) {
 
 /* delayed queue */
 
-static void delayed_queue_put(inodedata* id, uint32_t seconds, Glock&) {
+static void delayed_queue_put(inodedata* id, uint32_t seconds) {
+	std::unique_lock<std::mutex> lock(gDelayedQueueMutex);
 	delayedQueue.push_back(DelayedQueueEntry(id, seconds * DelayedQueueEntry::kTicksPerSecond));
 }
 
-static bool delayed_queue_remove(inodedata* id, Glock&) {
+static bool delayed_queue_remove(inodedata* id) {
+	std::unique_lock<std::mutex> lock(gDelayedQueueMutex);
 	for (auto it = delayedQueue.begin(); it != delayedQueue.end(); ++it) {
 		if (it->inodeData == id) {
 			delayedQueue.erase(it);
@@ -312,7 +338,7 @@ static bool delayed_queue_remove(inodedata* id, Glock&) {
 void* delayed_queue_worker(void*) {
 	for (;;) {
 		Timeout timeout(std::chrono::microseconds(1000000 / DelayedQueueEntry::kTicksPerSecond));
-		Glock lock(gMutex);
+		std::unique_lock<std::mutex> lock(gDelayedQueueMutex);
 		auto it = delayedQueue.begin();
 		while (it != delayedQueue.end()) {
 			if (it->inodeData == NULL) {
@@ -333,19 +359,19 @@ void* delayed_queue_worker(void*) {
 
 /* queues */
 
-void write_delayed_enqueue(inodedata* id, uint32_t seconds, Glock& lock) {
+void write_delayed_enqueue(inodedata* id, uint32_t seconds, Ilock&) {
 	if (seconds > 0) {
-		delayed_queue_put(id, seconds, lock);
+		delayed_queue_put(id, seconds);
 	} else {
 		queue_put(jqueue, 0, 0, (uint8_t*) id, 0);
 	}
 }
 
-void write_enqueue(inodedata* id, Glock&) {
+void write_enqueue(inodedata* id, Ilock&) {
 	queue_put(jqueue, 0, 0, (uint8_t*) id, 0);
 }
 
-void write_job_delayed_end(inodedata* id, int status, int seconds, Glock &lock) {
+void write_job_delayed_end(inodedata* id, int status, int seconds, Ilock &lock) {
 	LOG_AVG_TILL_END_OF_SCOPE0("write_job_delayed_end");
 	LOG_AVG_TILL_END_OF_SCOPE1("write_job_delayed_end#sec", seconds);
 	id->locator.reset();
@@ -363,7 +389,7 @@ void write_job_delayed_end(inodedata* id, int status, int seconds, Glock &lock)
 		write_delayed_enqueue(id, seconds, lock);
 	} else {        // no more work or error occurred
 		// if this is an error then release all data blocks
-		write_cb_release_blocks(id->dataChain.size(), lock);
+		write_cb_release_blocks(id->dataChain.size());
 		id->dataChain.clear();
 		id->inqueue = false;
 		id->maxfleng = 0; // proper file length is now on the master server, remove our length cache
@@ -373,7 +399,7 @@ void write_job_delayed_end(inodedata* id, int status, int seconds, Glock &lock)
 	}
 }
 
-void write_job_end(inodedata *id, int status, Glock &lock) {
+void write_job_end(inodedata *id, int status, Ilock &lock) {
 	write_job_delayed_end(id, status, 0, lock);
 }
 
@@ -384,9 +410,10 @@ public:
 
 private:
 	void processDataChain(ChunkWriter& writer);
-	void returnJournalToDataChain(std::list<WriteCacheBlock>&& journal, Glock&);
-	bool haveAnyBlockInCurrentChunk(Glock&);
-	bool haveBlockWorthWriting(uint32_t unfinishedOperationCount, Glock&);
+	void returnJournalToDataChain(std::list<WriteCacheBlock>&& journal, Ilock&);
+	bool haveAnyBlockInCurrentChunk(Ilock&);
+	bool haveBlockWorthWriting(uint32_t unfinishedOperationCount, uint32_t stripeSize, Ilock&);
+	bool haveStripeWorthWriting(uint32_t stripeSize, Ilock&);
 	inodedata* inodeData_;
 	uint32_t chunkIndex_;
 	Timer wholeOperationTimer;
@@ -403,7 +430,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 	inodeData_ = inodeData;
 
 	// First, choose index of some chunk to write
-	Glock lock(gMutex);
+	Ilock lock(inodeData_->mutex);
 	int status = inodeData_->status;
 	bool haveDataToWrite;
 	if (inodeData_->locator) {
@@ -428,7 +455,8 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 	lock.unlock();
 
 	/*  Process the job */
-	ChunkWriter writer(globalChunkserverStats, gChunkConnector, inodeData_->newDataInChainPipe[0]);
+	ChunkWriter writer(globalChunkserverStats, gChunkConnector, *gParityEncoder,
+			inodeData_->newDataInChainPipe[0]);
 	wholeOperationTimer.reset();
 	std::unique_ptr<WriteChunkLocator> locator = std::move(inodeData_->locator);
 	if (!locator) {
@@ -446,13 +474,13 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 				processDataChain(writer);
 				writer.finish(kTimeToFinishOperations * 1000);
 
-				Glock lock(gMutex);
+				Ilock lock(inodeData_->mutex);
 				returnJournalToDataChain(writer.releaseJournal(), lock);
 			}
 			locator->unlockChunk();
 			read_inode_ops(inodeData_->inode);
 
-			Glock lock(gMutex);
+			Ilock lock(inodeData_->mutex);
 			inodeData_->minimumBlocksToWrite = writer.getMinimumBlockCountWorthWriting();
 			bool canWait = !inodeData_->requiresFlushing();
 			if (!haveAnyBlockInCurrentChunk(lock)) {
@@ -468,7 +496,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 			write_job_delayed_end(inodeData_, LIZARDFS_STATUS_OK, (canWait ? 1 : 0), lock);
 		} catch (Exception& e) {
 			std::string errorString = e.what();
-			Glock lock(gMutex);
+			Ilock lock(inodeData_->mutex);
 			if (e.status() != LIZARDFS_ERROR_LOCKED) {
 				inodeData_->trycnt++;
 				errorString += " (try counter: " + std::to_string(inodeData->trycnt) + ")";
@@ -495,7 +523,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 			}
 		}
 	} catch (UnrecoverableWriteException& e) {
-		Glock lock(gMutex);
+		Ilock lock(inodeData_->mutex);
 		if (e.status() == LIZARDFS_ERROR_ENOENT) {
 			write_job_end(inodeData_, LIZARDFS_ERROR_EBADF, lock);
 		} else if (e.status() == LIZARDFS_ERROR_QUOTA) {
@@ -506,7 +534,7 @@ void InodeChunkWriter::processJob(inodedata* inodeData) {
 			write_job_end(inodeData_, LIZARDFS_ERROR_IO, lock);
 		}
 	} catch (Exception& e) {
-		Glock lock(gMutex);
+		Ilock lock(inodeData_->mutex);
 		int waitTime = 1;
 		if (inodeData_->trycnt > 10) {
 			waitTime = std::min<int>(10, inodeData_->trycnt - 9);
@@ -539,13 +567,14 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 		bool can_expect_next_block = true;
 		if (wholeOperationTimer.elapsed_s() + kTimeToFinishOperations < maximumTime
 				&& writer.acceptsNewOperations()) {
-			Glock lock(gMutex);
+			Ilock lock(inodeData_->mutex);
 			// While there is any block worth sending, we add new write operation
-			while (haveBlockWorthWriting(writer.getUnfinishedOperationsCount(), lock)) {
+			while (haveBlockWorthWriting(writer.getUnfinishedOperationsCount(),
+					writer.getMinimumBlockCountWorthWriting(), lock)) {
 				// Remove block from cache and pass it to the writer
 				writer.addOperation(std::move(inodeData_->dataChain.front()));
 				inodeData_->popFromChain();
-				write_cb_release_blocks(1, lock);
+				write_cb_release_blocks(1);
 			}
 			if (inodeData_->requiresFlushing() && !haveAnyBlockInCurrentChunk(lock)) {
 				// No more data and some flushing is needed or required, so flush everything
@@ -557,7 +586,7 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 			can_expect_next_block = haveAnyBlockInCurrentChunk(lock);
 		} else if (writer.acceptsNewOperations()) {
 			// We are running out of time...
-			Glock lock(gMutex);
+			Ilock lock(inodeData_->mutex);
 			if (!inodeData_->requiresFlushing()) {
 				// Nobody is waiting for the data to be flushed and the data in write chain
 				// isn't too old. Let's postpone any operations
@@ -571,7 +600,7 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 		}
 
 		if (writer.startNewOperations(can_expect_next_block) > 0) {
-			Glock lock(gMutex);
+			Ilock lock(inodeData_->mutex);
 			inodeData_->lastWriteToChunkservers.reset();
 		}
 		if (writer.getPendingOperationsCount() == 0) {
@@ -587,9 +616,9 @@ void InodeChunkWriter::processDataChain(ChunkWriter& writer) {
 	}
 }
 
-void InodeChunkWriter::returnJournalToDataChain(std::list<WriteCacheBlock> &&journal, Glock &lock) {
+void InodeChunkWriter::returnJournalToDataChain(std::list<WriteCacheBlock> &&journal, Ilock &) {
 	if (!journal.empty()) {
-		write_cb_acquire_blocks(journal.size(), lock);
+		write_cb_acquire_blocks(journal.size());
 		uint64_t prev_id = journal.front().chunkIndex;
 		int alterations = (!inodeData_->dataChain.empty()
 				&& journal.back().chunkIndex != inodeData_->dataChain.front().chunkIndex) ? 1 : 0;
@@ -607,7 +636,7 @@ void InodeChunkWriter::returnJournalToDataChain(std::list<WriteCacheBlock> &&jou
 /*
  * Check if there is any data in the same chunk waiting to be written.
  */
-bool InodeChunkWriter::haveAnyBlockInCurrentChunk(Glock&) {
+bool InodeChunkWriter::haveAnyBlockInCurrentChunk(Ilock&) {
 	if (inodeData_->dataChain.empty()) {
 		return false;
 	} else {
@@ -617,11 +646,12 @@ bool InodeChunkWriter::haveAnyBlockInCurrentChunk(Glock&) {
 
 /*
  * Check if there is any data worth sending to the chunkserver.
- * We will avoid sending blocks of size different than MFSBLOCKSIZE.
- * These can be taken only if we are close to run out of tasks to do.
- * glock: LOCKED
+ * We will avoid sending blocks of size different than MFSBLOCKSIZE and stripes which are
+ * not complete yet. These can be taken only if we have to flush the data.
+ * ilock: LOCKED
  */
-bool InodeChunkWriter::haveBlockWorthWriting(uint32_t unfinishedOperationCount, Glock& lock) {
+bool InodeChunkWriter::haveBlockWorthWriting(uint32_t unfinishedOperationCount,
+		uint32_t stripeSize, Ilock& lock) {
 	if (!haveAnyBlockInCurrentChunk(lock)) {
 		return false;
 	}
@@ -633,14 +663,42 @@ bool InodeChunkWriter::haveBlockWorthWriting(uint32_t unfinishedOperationCount,
 		// Don't start new operations if there is already a lot of pending writes
 		return false;
 	} else {
-		// Always start full blocks; start partial blocks only if we have to flush the data
-		// or the block won't be expanded (only the last one can be) to a full block
-		return (block.size() == MFSBLOCKSIZE
-				|| inodeData_->requiresFlushing()
-				|| inodeData_->dataChain.size() > 1);
+		return inodeData_->requiresFlushing() || haveStripeWorthWriting(stripeSize, lock);
 	}
 }
 
+/*
+ * Check if the stripe starting with the first block of the data chain can be written
+ * without waiting for more data. It can if it is complete or if it won't be completed by
+ * sequential writes: only the last block of the chain can be expanded and new blocks are
+ * appended after it, so writing ahead of the following blocks doesn't fill any gaps.
+ * Waiting for complete stripes saves writing partial blocks and recomputing parity of
+ * partial stripes of xor and ec chunks.
+ * ilock: LOCKED
+ */
+bool InodeChunkWriter::haveStripeWorthWriting(uint32_t stripeSize, Ilock&) {
+	const auto& front = inodeData_->dataChain.front();
+	stripeSize = std::max<uint32_t>(stripeSize, 1);
+	uint32_t stripeEnd = std::min<uint32_t>((front.blockIndex / stripeSize + 1) * stripeSize,
+			MFSBLOCKSINCHUNK);
+	uint32_t nextBlockIndex = front.blockIndex;
+	for (const auto& block : inodeData_->dataChain) {
+		if (block.chunkIndex != chunkIndex_ || block.blockIndex != nextBlockIndex
+				|| block.type != WriteCacheBlock::kWritableBlock) {
+			// The stripe isn't written sequentially, waiting won't complete it
+			return true;
+		}
+		if (block.size() != MFSBLOCKSIZE) {
+			// A partial block can still be expanded only if it is the last one
+			return &block != &inodeData_->dataChain.back();
+		}
+		if (++nextBlockIndex == stripeEnd) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /* main working thread | glock:UNLOCKED */
 void* write_worker(void*) {
 	InodeChunkWriter inodeDataWriter;
@@ -665,15 +723,19 @@ void* write_worker(void*) {
 
 /* API | glock: INITIALIZED,UNLOCKED */
 void write_data_init(uint32_t cachesize, uint32_t retries, uint32_t workers,
-		uint32_t writewindowsize, uint32_t chunkserverTimeout_ms, uint32_t cachePerInodePercentage) {
+		uint32_t writewindowsize, uint32_t chunkserverTimeout_ms, uint32_t cachePerInodePercentage,
+		uint32_t parityWorkers, uint32_t writeCoalesceDelay_ms,
+		const std::string &localChunkserverSocketDir) {
 	uint64_t cachebytecount = uint64_t(cachesize) * 1024 * 1024;
 	uint64_t cacheblockcount = (cachebytecount / MFSBLOCKSIZE);
 	uint32_t i;
 	pthread_attr_t thattr;
 
 	gChunkConnector.setSourceIp(fs_getsrcip());
+	gChunkConnector.setLocalSocketDirectory(localChunkserverSocketDir);
 	gWriteWindowSize = writewindowsize;
 	gChunkserverTimeout_ms = chunkserverTimeout_ms;
+	gWriteCoalesceDelay_ms = writeCoalesceDelay_ms;
 	maxretries = retries;
 	if (cacheblockcount < 10) {
 		cacheblockcount = 10;
@@ -688,6 +750,7 @@ void write_data_init(uint32_t cachesize, uint32_t retries, uint32_t workers,
 	}
 
 	jqueue = queue_new(0);
+	gParityEncoder.reset(new ParityEncoder(parityWorkers));
 
 	pthread_attr_init(&thattr);
 	pthread_attr_setstacksize(&thattr, 0x100000);
@@ -699,16 +762,14 @@ void write_data_init(uint32_t cachesize, uint32_t retries, uint32_t workers,
 	pthread_attr_destroy(&thattr);
 
 	gTweaks.registerVariable("WriteMaxRetries", maxretries);
+	gTweaks.registerVariable("WriteCoalesceDelay", gWriteCoalesceDelay_ms);
 }
 
 void write_data_term(void) {
 	uint32_t i;
 	inodedata *id, *idn;
 
-	{
-		Glock lock(gMutex);
-		delayed_queue_put(nullptr, 0, lock);
-	}
+	delayed_queue_put(nullptr, 0);
 	for (i = 0; i < write_worker_th.size(); i++) {
 		queue_put(jqueue, 0, 0, NULL, 0);
 	}
@@ -717,6 +778,7 @@ void write_data_term(void) {
 	}
 	pthread_join(delayed_queue_worker_th, NULL);
 	queue_delete(jqueue, queue_deleter_delete<inodedata>);
+	gParityEncoder.reset();
 	for (i = 0; i < IDHASHSIZE; i++) {
 		for (id = idhash[i]; id; id = idn) {
 			idn = id->next;
@@ -726,9 +788,9 @@ void write_data_term(void) {
 	free(idhash);
 }
 
-/* glock: UNLOCKED */
+/* ilock: UNLOCKED */
 int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uint32_t to, const uint8_t *data) {
-	Glock lock(gMutex);
+	Ilock lock(id->mutex);
 	id->lastWriteToDataChain.reset();
 
 	// Try to expand the last block
@@ -745,7 +807,7 @@ int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uin
 
 	// Didn't manage to expand an existing block, so allocate a new one
 	write_cb_wait_for_block(id, lock);
-	write_cb_acquire_blocks(1, lock);
+	write_cb_acquire_blocks(1);
 	id->pushToChain(WriteCacheBlock(chindx, pos, WriteCacheBlock::kWritableBlock));
 	sassert(id->dataChain.back().expand(from, to, data));
 	if (id->inqueue) {
@@ -754,7 +816,7 @@ int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uin
 		// - there are at least two chunks in the write chain
 		if (id->trycnt == 0 && (id->dataChain.size() > id->minimumBlocksToWrite
 			|| id->dataChain.front().chunkIndex != id->dataChain.back().chunkIndex)) {
-			if (delayed_queue_remove(id, lock)) {
+			if (delayed_queue_remove(id)) {
 				write_enqueue(id, lock);
 			}
 		}
@@ -766,7 +828,7 @@ int write_block(inodedata *id, uint32_t chindx, uint16_t pos, uint32_t from, uin
 	return 0;
 }
 
-/* glock: UNLOCKED */
+/* ilock: UNLOCKED */
 int write_blocks(inodedata *id, uint64_t offset, uint32_t size, const uint8_t* data) {
 	LOG_AVG_TILL_END_OF_SCOPE0("write_blocks");
 	uint32_t chindx = offset >> MFSCHUNKBITS;
@@ -803,7 +865,7 @@ int write_data(void *vid, uint64_t offset, uint32_t size, const uint8_t* data) {
 		return LIZARDFS_ERROR_IO;
 	}
 
-	Glock lock(gMutex);
+	Ilock lock(id->mutex);
 	status = id->status;
 	if (status == LIZARDFS_STATUS_OK) {
 		if (offset + size > id->maxfleng) {     // move fleng
@@ -824,40 +886,50 @@ int write_data(void *vid, uint64_t offset, uint32_t size, const uint8_t* data) {
 	return write_blocks(id, offset, size, data);
 }
 
-static void write_data_flushwaiting_increase(inodedata *id, Glock&) {
+static void write_data_flushwaiting_increase(inodedata *id, Ilock&) {
 	id->flushwaiting++;
 }
 
-static void write_data_flushwaiting_decrease(inodedata *id, Glock&) {
+static void write_data_flushwaiting_decrease(inodedata *id, Ilock&) {
 	id->flushwaiting--;
 	if (id->flushwaiting == 0 && id->writewaiting > 0) {
 		id->writecond.notify_all();
 	}
 }
 
-static void write_data_lcnt_increase(inodedata *id, Glock&) {
-	id->lcnt++;
+/*! \brief Finds (or creates) write cache of an inode and prevents it from being freed.
+ * glock: UNLOCKED
+ */
+static inodedata* write_data_acquire(uint32_t inode, bool create) {
+	Glock lock(gMutex);
+	inodedata* id = create ? write_get_inodedata(inode, lock) : write_find_inodedata(inode, lock);
+	if (id) {
+		id->lcnt++;
+	}
+	return id;
 }
 
-static void write_data_lcnt_decrease(inodedata *id, Glock& lock) {
+/*! \brief Releases write cache acquired with write_data_acquire, frees it if it is unused.
+ * glock: UNLOCKED, ilock: UNLOCKED
+ */
+static void write_data_release(inodedata *id) {
+	Glock lock(gMutex);
 	id->lcnt--;
-	if (id->lcnt == 0 && !id->inqueue && id->flushwaiting == 0 && id->writewaiting == 0) {
-		write_free_inodedata(id, lock);
+	if (id->lcnt == 0) {
+		Ilock ilock(id->mutex);
+		bool unused = !id->inqueue && id->flushwaiting == 0 && id->writewaiting == 0;
+		ilock.unlock();
+		if (unused) {
+			write_free_inodedata(id, lock);
+		}
 	}
 }
 
 void* write_data_new(uint32_t inode) {
-	inodedata* id;
-	Glock lock(gMutex);
-	id = write_get_inodedata(inode, lock);
-	if (id == NULL) {
-		return NULL;
-	}
-	write_data_lcnt_increase(id, lock);
-	return id;
+	return write_data_acquire(inode, true);
 }
 
-static int write_data_flush(void* vid, Glock& lock) {
+static int write_data_flush(void* vid, Ilock& lock) {
 	inodedata* id = (inodedata*) vid;
 	if (id == NULL) {
 		return LIZARDFS_ERROR_IO;
@@ -865,7 +937,7 @@ static int write_data_flush(void* vid, Glock& lock) {
 
 	write_data_flushwaiting_increase(id, lock);
 	// If there are no errors (trycnt==0) and inode is waiting in the delayed queue, speed it up
-	if (id->trycnt == 0 && delayed_queue_remove(id, lock)) {
+	if (id->trycnt == 0 && delayed_queue_remove(id)) {
 		write_enqueue(id, lock);
 	}
 	// Wait for the data to be flushed
@@ -877,48 +949,51 @@ static int write_data_flush(void* vid, Glock& lock) {
 }
 
 int write_data_flush(void* vid) {
-	Glock lock(gMutex);
-	return write_data_flush(vid, lock);
+	inodedata* id = (inodedata*) vid;
+	if (id == NULL) {
+		return LIZARDFS_ERROR_IO;
+	}
+	Ilock lock(id->mutex);
+	return write_data_flush(id, lock);
 }
 
 uint64_t write_data_getmaxfleng(uint32_t inode) {
-	uint64_t maxfleng;
-	inodedata* id;
 	Glock lock(gMutex);
-	id = write_find_inodedata(inode, lock);
-	if (id) {
-		maxfleng = id->maxfleng;
-	} else {
-		maxfleng = 0;
+	inodedata* id = write_find_inodedata(inode, lock);
+	if (id == NULL) {
+		return 0;
 	}
-	return maxfleng;
+	Ilock ilock(id->mutex);
+	return id->maxfleng;
 }
 
 int write_data_flush_inode(uint32_t inode) {
-	Glock lock(gMutex);
-	inodedata* id = write_find_inodedata(inode, lock);
+	inodedata* id = write_data_acquire(inode, false);
 	if (id == NULL) {
 		return 0;
 	}
-	return write_data_flush(id, lock);
+	Ilock lock(id->mutex);
+	int status = write_data_flush(id, lock);
+	lock.unlock();
+	write_data_release(id);
+	return status;
 }
 
 int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid, uint64_t length,
 		Attributes& attr) {
-	Glock lock(gMutex);
-
 	// 1. Flush writes but don't finish it completely - it'll be done at the end of truncate
-	inodedata* id = write_get_inodedata(inode, lock);
+	inodedata* id = write_data_acquire(inode, true);
 	if (id == NULL) {
 		return LIZARDFS_ERROR_IO;
 	}
-	write_data_lcnt_increase(id, lock);
+	Ilock lock(id->mutex);
 	write_data_flushwaiting_increase(id, lock); // this will block any writing to this inode
 
 	int err = write_data_flush(id, lock);
 	if (err != 0) {
 		write_data_flushwaiting_decrease(id, lock);
-		write_data_lcnt_decrease(id, lock);
+		lock.unlock();
+		write_data_release(id);
 		return err;
 	}
 
@@ -951,7 +1026,8 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 	if (status != 0 || !writeNeeded) {
 		// Something failed or we have nothing to do more (master server managed to do the truncate)
 		write_data_flushwaiting_decrease(id, lock);
-		write_data_lcnt_decrease(id, lock);
+		lock.unlock();
+		write_data_release(id);
 		if (status == LIZARDFS_STATUS_OK) {
 			return 0;
 		} else {
@@ -980,7 +1056,8 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 		lock.lock();
 		if (err != 0) {
 			write_data_flushwaiting_decrease(id, lock);
-			write_data_lcnt_decrease(id, lock);
+			lock.unlock();
+			write_data_release(id);
 			return err;
 		}
 
@@ -990,7 +1067,8 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 		if (err != 0) {
 			// unlock the chunk here?
 			write_data_flushwaiting_decrease(id, lock);
-			write_data_lcnt_decrease(id, lock);
+			lock.unlock();
+			write_data_release(id);
 			return err;
 		}
 	}
@@ -998,8 +1076,10 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 	// Now we can tell the master server to finish the truncate operation and then unblock the inode
 	lock.unlock();
 	status = fs_truncateend(inode, uid, gid, length, lockId, attr);
+	lock.lock();
 	write_data_flushwaiting_decrease(id, lock);
-	write_data_lcnt_decrease(id, lock);
+	lock.unlock();
+	write_data_release(id);
 
 	if (status != LIZARDFS_STATUS_OK) {
 		// status is now MFS status, so we cannot return any errno
@@ -1009,12 +1089,13 @@ int write_data_truncate(uint32_t inode, bool opened, uint32_t uid, uint32_t gid,
 }
 
 int write_data_end(void* vid) {
-	Glock lock(gMutex);
 	inodedata* id = (inodedata*) vid;
 	if (id == NULL) {
 		return LIZARDFS_ERROR_IO;
 	}
+	Ilock lock(id->mutex);
 	int status = write_data_flush(id, lock);
-	write_data_lcnt_decrease(id, lock);
+	lock.unlock();
+	write_data_release(id);
 	return status;
 }
@@ -21,12 +21,14 @@
 #include "common/platform.h"
 
 #include <inttypes.h>
+#include <string>
 
 #include "common/attributes.h"
 
 void write_data_init(uint32_t cachesize, uint32_t retries, uint32_t workers,
 		uint32_t writewindowsize, uint32_t chunkserverTimeout_ms,
-		uint32_t cachePerInodePercentage);
+		uint32_t cachePerInodePercentage, uint32_t parityWorkers,
+		uint32_t writeCoalesceDelay_ms, const std::string &localChunkserverSocketDir);
 void write_data_term(void);
 void* write_data_new(uint32_t inode);
 int write_data_end(void *vid);
@@ -1751,6 +1751,52 @@ enum class SugidClearMode {
 #define LIZ_MATOCL_FUSE_GETTRASH (1000U + 602U)
 /// msgid:32 entries:(vector<NamedInodeEntry>)
 
+// 0x643
+#define LIZ_CLTOMA_FUSE_READ_CHUNKS (1000U + 603U)
+/// msgid:32 inode:32 chunkindex:32 chunkcount:32
+
+// 0x644
+#define LIZ_MATOCL_FUSE_READ_CHUNKS (1000U + 604U)
+/// version==0 msgid:32 status:8
+/// version==1 msgid:32 filelength:64 chunks:(vector<ChunkWithLocations>)
+/// chunks describe consecutive indices starting from chunkindex; there may be fewer of them
+/// than requested (never less than one)
+
+// 0x645
+#define LIZ_CLTOMA_FUSE_COMPOUND (1000U + 605U)
+/// msgid:32 uid:32 gid:32 operations:(vector<CompoundMetadataOp>)
+
+// 0x646
+#define LIZ_MATOCL_FUSE_COMPOUND (1000U + 606U)
+/// version==0 msgid:32 status:8
+/// version==1 msgid:32 results:(vector<CompoundMetadataOpResult>)
+/// operations are executed in order until the first one which fails; results are sent for
+/// all executed operations, so the last result may carry an error status
+
+// 0x647
+#define LIZ_CLTOMA_CACHE_INVALIDATION_SUBSCRIBE (1000U + 607U)
+/// msgid:32
+
+// 0x648
+#define LIZ_MATOCL_CACHE_INVALIDATION_SUBSCRIBE (1000U + 608U)
+/// msgid:32 status:8
+
+// 0x649
+#define LIZ_MATOCL_CACHE_INVALIDATE (1000U + 609U)
+/// msgid:32 inodes:(vector<uint32_t>) entries:(vector<NamedInodeEntry>)
+/// sent by the master (with msgid==0) to subscribed sessions; inodes have changed attributes,
+/// entries were added to or removed from directories (inode of an entry is its parent)
+
+// 0x64A
+#define LIZ_CLTOMA_LIST_SESSION_QUEUES (1000U + 610U)
+/// -
+
+// 0x64B
+#define LIZ_MATOCL_LIST_SESSION_QUEUES (1000U + 611U)
+/// sessions:(vector<SessionQueueInfo>)
+/// request scheduling statistics of connected sessions (latency in microseconds, the maximum
+/// is taken over the current hour)
+
 // CHUNKSERVER STATS
 
 // 0x0258
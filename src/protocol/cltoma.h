@@ -29,6 +29,7 @@
 #include "common/richacl.h"
 #include "common/serialization_macros.h"
 #include "common/small_vector.h"
+#include "protocol/compound_metadata_op.h"
 #include "protocol/lock_info.h"
 #include "protocol/MFSCommunication.h"
 #include "protocol/packet.h"
@@ -212,6 +213,18 @@ LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		uint32_t, chunk_index,
 		uint32_t, chunk_count)
 
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cltoma, fuseCompound, LIZ_CLTOMA_FUSE_COMPOUND, 0,
+		uint32_t, message_id,
+		uint32_t, uid,
+		uint32_t, gid,
+		std::vector<CompoundMetadataOp>, operations)
+
+// LIZ_CLTOMA_CACHE_INVALIDATION_SUBSCRIBE
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cltoma, cacheInvalidationSubscribe, LIZ_CLTOMA_CACHE_INVALIDATION_SUBSCRIBE, 0,
+		uint32_t, message_id)
+
 // LIZ_CLTOMA_HOSTNAME
 LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		cltoma, hostname, LIZ_CLTOMA_HOSTNAME, 0)
@@ -390,9 +403,13 @@ LIZARDFS_DEFINE_PACKET_SERIALIZATION(cltoma, fuseGetTrash, LIZ_CLTOMA_FUSE_GETTR
 		uint32_t, off,
 		uint32_t, max_entries)
 
+LIZARDFS_DEFINE_PACKET_VERSION(cltoma, listTasks, kStandard, 0)
+LIZARDFS_DEFINE_PACKET_VERSION(cltoma, listTasks, kWithProgress, 1)
 LIZARDFS_DEFINE_PACKET_SERIALIZATION(
-		cltoma, listTasks, LIZ_CLTOMA_LIST_TASKS, 0,
+		cltoma, listTasks, LIZ_CLTOMA_LIST_TASKS, kStandard,
 		bool, dummy)
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cltoma, listTasks, LIZ_CLTOMA_LIST_TASKS, kWithProgress)
 
 LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		cltoma, stopTask, LIZ_CLTOMA_STOP_TASK, 0,
@@ -422,6 +439,17 @@ LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		uint64_t, first_entry,
 		uint64_t, number_of_entries)
 
+// LIZ_CLTOMA_LIST_SESSION_QUEUES
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cltoma, listSessionQueues, LIZ_CLTOMA_LIST_SESSION_QUEUES, 0)
+
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		cltoma, fuseReadChunks, LIZ_CLTOMA_FUSE_READ_CHUNKS, 0,
+		uint32_t, message_id,
+		uint32_t, inode,
+		uint32_t, chunk_index,
+		uint32_t, chunk_count)
+
 namespace cltoma {
 
 namespace fuseReadChunk {
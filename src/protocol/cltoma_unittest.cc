@@ -41,6 +41,41 @@ TEST(CltomaCommunicationTests, FuseReadChunk) {
 	LIZARDFS_VERIFY_INOUT_PAIR(index);
 }
 
+TEST(CltomaCommunicationTests, FuseCompound) {
+	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, messageId, 512, 0);
+	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, uid, 1000, 0);
+	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, gid, 1001, 0);
+	LIZARDFS_DEFINE_INOUT_VECTOR_PAIR(CompoundMetadataOp, operations) = {
+		CompoundMetadataOp::mknod(112, "file", TYPE_FILE, 0644, 022, 0),
+		CompoundMetadataOp::open(CompoundMetadataOp::kPreviousInode, 3),
+		CompoundMetadataOp::setattr(CompoundMetadataOp::kPreviousInode, SET_MTIME_FLAG, 0,
+				0, 0, 0, 1234567, SugidClearMode::kNever),
+	};
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(buffer = cltoma::fuseCompound::build(messageIdIn, uidIn, gidIn, operationsIn));
+
+	verifyHeader(buffer, LIZ_CLTOMA_FUSE_COMPOUND);
+	removeHeaderInPlace(buffer);
+	ASSERT_NO_THROW(cltoma::fuseCompound::deserialize(buffer,
+			messageIdOut, uidOut, gidOut, operationsOut));
+
+	LIZARDFS_VERIFY_INOUT_PAIR(messageId);
+	LIZARDFS_VERIFY_INOUT_PAIR(uid);
+	LIZARDFS_VERIFY_INOUT_PAIR(gid);
+	ASSERT_EQ(operationsIn.size(), operationsOut.size());
+	for (size_t i = 0; i < operationsIn.size(); ++i) {
+		EXPECT_EQ(operationsIn[i].type, operationsOut[i].type);
+		EXPECT_EQ(operationsIn[i].inode, operationsOut[i].inode);
+		EXPECT_EQ(operationsIn[i].name, operationsOut[i].name);
+		EXPECT_EQ(operationsIn[i].mode, operationsOut[i].mode);
+		EXPECT_EQ(operationsIn[i].umask, operationsOut[i].umask);
+		EXPECT_EQ(operationsIn[i].flags, operationsOut[i].flags);
+		EXPECT_EQ(operationsIn[i].attr_mtime, operationsOut[i].attr_mtime);
+		EXPECT_EQ(operationsIn[i].sugid_clear_mode, operationsOut[i].sugid_clear_mode);
+	}
+}
+
 TEST(CltomaCommunicationTests, FuseWriteChunk) {
 	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, messageId, 512, 0);
 	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, inode, 112, 0);
@@ -0,0 +1,118 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/platform.h"
+
+#include <string>
+
+#include "common/attributes.h"
+#include "common/serialization_macros.h"
+#include "protocol/MFSCommunication.h"
+
+LIZARDFS_DEFINE_SERIALIZABLE_ENUM_CLASS(CompoundMetadataOpType,
+		kLookup, kGetattr, kMknod, kOpen, kSetattr)
+
+/*! \brief One step of a compound metadata request (LIZ_CLTOMA_FUSE_COMPOUND).
+ *
+ * A compound request can only batch operations which a client knows it has to execute in
+ * advance. The FUSE mount uses it for create (mknod + open); lookup, getattr and setattr are
+ * available for clients which get whole sequences at once.
+ * Fields which are not used by an operation of the given type are ignored.
+ * Instances should be created with the static functions below.
+ */
+SERIALIZABLE_CLASS_BEGIN(CompoundMetadataOp)
+	/// Value of 'inode' which refers to the inode returned by the previous operation.
+	static constexpr uint32_t kPreviousInode = 0;
+
+	static CompoundMetadataOp lookup(uint32_t parent, const std::string &name) {
+		CompoundMetadataOp op;
+		op.type = CompoundMetadataOpType::kLookup;
+		op.inode = parent;
+		op.name = name;
+		return op;
+	}
+
+	static CompoundMetadataOp getattr(uint32_t inode) {
+		CompoundMetadataOp op;
+		op.type = CompoundMetadataOpType::kGetattr;
+		op.inode = inode;
+		return op;
+	}
+
+	static CompoundMetadataOp mknod(uint32_t parent, const std::string &name, uint8_t nodeType,
+			uint16_t mode, uint16_t umask, uint32_t rdev) {
+		CompoundMetadataOp op;
+		op.type = CompoundMetadataOpType::kMknod;
+		op.inode = parent;
+		op.name = name;
+		op.node_type = nodeType;
+		op.mode = mode;
+		op.umask = umask;
+		op.rdev = rdev;
+		return op;
+	}
+
+	static CompoundMetadataOp open(uint32_t inode, uint8_t flags) {
+		CompoundMetadataOp op;
+		op.type = CompoundMetadataOpType::kOpen;
+		op.inode = inode;
+		op.flags = flags;
+		return op;
+	}
+
+	static CompoundMetadataOp setattr(uint32_t inode, uint8_t setmask, uint16_t mode,
+			uint32_t uid, uint32_t gid, uint32_t atime, uint32_t mtime,
+			SugidClearMode sugidClearMode) {
+		CompoundMetadataOp op;
+		op.type = CompoundMetadataOpType::kSetattr;
+		op.inode = inode;
+		op.flags = setmask;
+		op.mode = mode;
+		op.attr_uid = uid;
+		op.attr_gid = gid;
+		op.attr_atime = atime;
+		op.attr_mtime = mtime;
+		op.sugid_clear_mode = static_cast<uint8_t>(sugidClearMode);
+		return op;
+	}
+
+SERIALIZABLE_CLASS_BODY(CompoundMetadataOp,
+		CompoundMetadataOpType, type,
+		uint32_t, inode,
+		std::string, name,
+		uint8_t, node_type,
+		uint16_t, mode,
+		uint16_t, umask,
+		uint32_t, rdev,
+		uint8_t, flags, // open flags or setattr mask
+		uint32_t, attr_uid,
+		uint32_t, attr_gid,
+		uint32_t, attr_atime,
+		uint32_t, attr_mtime,
+		uint8_t, sugid_clear_mode)
+SERIALIZABLE_CLASS_END;
+
+/// Result of one step of a compound metadata request.
+SERIALIZABLE_CLASS_BEGIN(CompoundMetadataOpResult)
+SERIALIZABLE_CLASS_BODY(CompoundMetadataOpResult,
+		uint8_t, status,
+		uint32_t, inode,
+		Attributes, attr)
+SERIALIZABLE_CLASS_END;
@@ -101,6 +101,15 @@ struct InputPacket {
 		return data_;
 	}
 
+	/// Moves data of a message out of this \p InputPacket and prepares it for reading
+	/// a new packet. Valid iff hasData() == true.
+	MessageBuffer releaseData() {
+		MessageBuffer data;
+		data.swap(data_);
+		bytesRead_ = 0;
+		return data;
+	}
+
 private:
 	/// Maximum accepted length of a message.
 	const uint32_t maxPacketSize_;
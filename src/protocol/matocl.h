@@ -24,6 +24,7 @@
 #include "common/attributes.h"
 #include "common/chunk_type_with_address.h"
 #include "common/chunk_with_address_and_label.h"
+#include "common/chunk_with_locations.h"
 #include "common/chunks_availability_state.h"
 #include "common/defective_file_info.h"
 #include "common/io_limits_database.h"
@@ -37,12 +38,14 @@
 #include "common/serialized_goal.h"
 #include "common/tape_copy_location_info.h"
 #include "protocol/chunkserver_list_entry.h"
+#include "protocol/compound_metadata_op.h"
 #include "protocol/directory_entry.h"
 #include "protocol/lock_info.h"
 #include "protocol/named_inode_entry.h"
 #include "protocol/MFSCommunication.h"
 #include "protocol/packet.h"
 #include "protocol/quota.h"
+#include "protocol/session_queue_info.h"
 
 LIZARDFS_DEFINE_PACKET_SERIALIZATION(matocl, updateCredentials, LIZ_MATOCL_UPDATE_CREDENTIALS, 0,
 		uint32_t, messageId,
@@ -450,9 +453,14 @@ LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		uint32_t, msgid,
 		std::vector<NamedInodeEntry>, entries)
 
+LIZARDFS_DEFINE_PACKET_VERSION(matocl, listTasks, kStandard, 0)
+LIZARDFS_DEFINE_PACKET_VERSION(matocl, listTasks, kWithProgress, 1)
 LIZARDFS_DEFINE_PACKET_SERIALIZATION(
-		matocl, listTasks, LIZ_MATOCL_LIST_TASKS, 0,
+		matocl, listTasks, LIZ_MATOCL_LIST_TASKS, kStandard,
 		std::vector<JobInfo>, jobs_info)
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, listTasks, LIZ_MATOCL_LIST_TASKS, kWithProgress,
+		std::vector<JobProgressInfo>, jobs_info)
 
 LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		matocl, stopTask, LIZ_MATOCL_STOP_TASK, 0,
@@ -474,6 +482,71 @@ LIZARDFS_DEFINE_PACKET_SERIALIZATION(
 		uint64_t, last_entry_index,
 		std::vector<DefectiveFileInfo>, files_info)
 
+// LIZ_MATOCL_LIST_SESSION_QUEUES
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, listSessionQueues, LIZ_MATOCL_LIST_SESSION_QUEUES, 0,
+		std::vector<SessionQueueInfo>, sessions)
+
+// LIZ_MATOCL_FUSE_READ_CHUNKS
+namespace matocl {
+namespace fuseReadChunks {
+	static constexpr uint32_t kMaxNumberOfChunks = 64;
+}
+}
+
+LIZARDFS_DEFINE_PACKET_VERSION(matocl, fuseReadChunks, kStatusPacketVersion, 0)
+LIZARDFS_DEFINE_PACKET_VERSION(matocl, fuseReadChunks, kResponsePacketVersion, 1)
+
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, fuseReadChunks, LIZ_MATOCL_FUSE_READ_CHUNKS, kStatusPacketVersion,
+		uint32_t, message_id,
+		uint8_t, status)
+
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, fuseReadChunks, LIZ_MATOCL_FUSE_READ_CHUNKS, kResponsePacketVersion,
+		uint32_t, message_id,
+		uint64_t, file_length,
+		std::vector<ChunkWithLocations>, chunks)
+
+// LIZ_MATOCL_FUSE_COMPOUND
+namespace matocl {
+namespace fuseCompound {
+	static constexpr uint32_t kMaxNumberOfOperations = 16;
+}
+}
+
+LIZARDFS_DEFINE_PACKET_VERSION(matocl, fuseCompound, kStatusPacketVersion, 0)
+LIZARDFS_DEFINE_PACKET_VERSION(matocl, fuseCompound, kResponsePacketVersion, 1)
+
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, fuseCompound, LIZ_MATOCL_FUSE_COMPOUND, kStatusPacketVersion,
+		uint32_t, message_id,
+		uint8_t, status)
+
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, fuseCompound, LIZ_MATOCL_FUSE_COMPOUND, kResponsePacketVersion,
+		uint32_t, message_id,
+		std::vector<CompoundMetadataOpResult>, results)
+
+// LIZ_MATOCL_CACHE_INVALIDATION_SUBSCRIBE
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, cacheInvalidationSubscribe, LIZ_MATOCL_CACHE_INVALIDATION_SUBSCRIBE, 0,
+		uint32_t, message_id,
+		uint8_t, status)
+
+// LIZ_MATOCL_CACHE_INVALIDATE
+namespace matocl {
+namespace cacheInvalidate {
+	static constexpr uint32_t kMaxNumberOfItems = 4096;
+}
+}
+
+LIZARDFS_DEFINE_PACKET_SERIALIZATION(
+		matocl, cacheInvalidate, LIZ_MATOCL_CACHE_INVALIDATE, 0,
+		uint32_t, message_id,
+		std::vector<uint32_t>, inodes,
+		std::vector<NamedInodeEntry>, entries)
+
 namespace matocl {
 
 namespace fuseReadChunk {
@@ -72,6 +72,39 @@ TEST(MatoclCommunicationTests, FuseReadChunkStatus) {
 	LIZARDFS_VERIFY_INOUT_PAIR(status);
 }
 
+TEST(MatoclCommunicationTests, FuseReadChunks) {
+	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, messageId,  512, 0);
+	LIZARDFS_DEFINE_INOUT_PAIR(uint64_t, fileLength, 124, 0);
+	LIZARDFS_DEFINE_INOUT_VECTOR_PAIR(ChunkWithLocations, chunks) = {
+		ChunkWithLocations(87, 52, {
+			ChunkTypeWithAddress(NetworkAddress(0xC0A80001, 8080), standard, LIZARDFS_VERSHEX),
+			ChunkTypeWithAddress(NetworkAddress(0xC0A80002, 8081), xor_p_of_6, LIZARDFS_VERSHEX),
+		}),
+		ChunkWithLocations(0, 0, {}),
+		ChunkWithLocations(88, 1, {
+			ChunkTypeWithAddress(NetworkAddress(0xC0A80003, 8082), xor_1_of_6, LIZARDFS_VERSHEX),
+		}),
+	};
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(buffer = matocl::fuseReadChunks::build(messageIdIn, fileLengthIn, chunksIn));
+
+	verifyHeader(buffer, LIZ_MATOCL_FUSE_READ_CHUNKS);
+	removeHeaderInPlace(buffer);
+	verifyVersion(buffer, matocl::fuseReadChunks::kResponsePacketVersion);
+	ASSERT_NO_THROW(matocl::fuseReadChunks::deserialize(buffer.data(), buffer.size(),
+			messageIdOut, fileLengthOut, chunksOut));
+
+	LIZARDFS_VERIFY_INOUT_PAIR(messageId);
+	LIZARDFS_VERIFY_INOUT_PAIR(fileLength);
+	ASSERT_EQ(chunksIn.size(), chunksOut.size());
+	for (size_t i = 0; i < chunksIn.size(); ++i) {
+		EXPECT_EQ(chunksIn[i].chunk_id, chunksOut[i].chunk_id);
+		EXPECT_EQ(chunksIn[i].chunk_version, chunksOut[i].chunk_version);
+		EXPECT_EQ(chunksIn[i].locations, chunksOut[i].locations);
+	}
+}
+
 TEST(MatoclCommunicationTests, FuseWriteChunkData) {
 	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, messageId,    512, 0);
 	LIZARDFS_DEFINE_INOUT_PAIR(uint64_t, chunkId,      87,  0);
@@ -239,3 +272,76 @@ TEST(MatoclCommunicationTests, FuseSetAcl) {
 	LIZARDFS_VERIFY_INOUT_PAIR(messageId);
 	LIZARDFS_VERIFY_INOUT_PAIR(status);
 }
+
+TEST(MatoclCommunicationTests, CacheInvalidate) {
+	LIZARDFS_DEFINE_INOUT_PAIR(uint32_t, messageId, 0, 1);
+	LIZARDFS_DEFINE_INOUT_VECTOR_PAIR(uint32_t, inodes) = {1, 17, 0xFFFFFFF0};
+	LIZARDFS_DEFINE_INOUT_VECTOR_PAIR(NamedInodeEntry, entries) = {
+		NamedInodeEntry("file", 1),
+		NamedInodeEntry("", 17),
+	};
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(buffer = matocl::cacheInvalidate::build(messageIdIn, inodesIn, entriesIn));
+
+	verifyHeader(buffer, LIZ_MATOCL_CACHE_INVALIDATE);
+	removeHeaderInPlace(buffer);
+	ASSERT_NO_THROW(matocl::cacheInvalidate::deserialize(buffer.data(), buffer.size(),
+			messageIdOut, inodesOut, entriesOut));
+
+	LIZARDFS_VERIFY_INOUT_PAIR(messageId);
+	LIZARDFS_VERIFY_INOUT_PAIR(inodes);
+	ASSERT_EQ(entriesIn.size(), entriesOut.size());
+	for (size_t i = 0; i < entriesIn.size(); ++i) {
+		EXPECT_EQ(entriesIn[i].name, entriesOut[i].name);
+		EXPECT_EQ(entriesIn[i].inode, entriesOut[i].inode);
+	}
+}
+
+TEST(MatoclCommunicationTests, ListSessionQueues) {
+	LIZARDFS_DEFINE_INOUT_VECTOR_PAIR(SessionQueueInfo, sessions) = {
+		SessionQueueInfo(1, 1, 0, 12, 150, 2000),
+		SessionQueueInfo(0xFFFFFFF0, 100, 256, 1ULL << 40, 0, 0xFFFFFFFF),
+	};
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(buffer = matocl::listSessionQueues::build(sessionsIn));
+
+	verifyHeader(buffer, LIZ_MATOCL_LIST_SESSION_QUEUES);
+	removeHeaderInPlace(buffer);
+	ASSERT_NO_THROW(matocl::listSessionQueues::deserialize(buffer.data(), buffer.size(),
+			sessionsOut));
+
+	ASSERT_EQ(sessionsIn.size(), sessionsOut.size());
+	for (size_t i = 0; i < sessionsIn.size(); ++i) {
+		EXPECT_EQ(sessionsIn[i].sessionId, sessionsOut[i].sessionId);
+		EXPECT_EQ(sessionsIn[i].weight, sessionsOut[i].weight);
+		EXPECT_EQ(sessionsIn[i].queueDepth, sessionsOut[i].queueDepth);
+		EXPECT_EQ(sessionsIn[i].handledRequests, sessionsOut[i].handledRequests);
+		EXPECT_EQ(sessionsIn[i].avgLatencyUs, sessionsOut[i].avgLatencyUs);
+		EXPECT_EQ(sessionsIn[i].maxLatencyUs, sessionsOut[i].maxLatencyUs);
+	}
+}
+
+TEST(MatoclCommunicationTests, ListTasksWithProgress) {
+	LIZARDFS_DEFINE_INOUT_VECTOR_PAIR(JobProgressInfo, jobs) = {
+		JobProgressInfo(1, "Setting goal (2): /dir", 1ULL << 33, 3600),
+		JobProgressInfo(0xFFFFFFFF, "Removing: /tmp", 0, 0),
+	};
+
+	std::vector<uint8_t> buffer;
+	ASSERT_NO_THROW(buffer = matocl::listTasks::build(jobsIn));
+
+	verifyHeader(buffer, LIZ_MATOCL_LIST_TASKS);
+	removeHeaderInPlace(buffer);
+	verifyVersion(buffer, matocl::listTasks::kWithProgress);
+	ASSERT_NO_THROW(matocl::listTasks::deserialize(buffer.data(), buffer.size(), jobsOut));
+
+	ASSERT_EQ(jobsIn.size(), jobsOut.size());
+	for (size_t i = 0; i < jobsIn.size(); ++i) {
+		EXPECT_EQ(jobsIn[i].id, jobsOut[i].id);
+		EXPECT_EQ(jobsIn[i].description, jobsOut[i].description);
+		EXPECT_EQ(jobsIn[i].processed_nodes, jobsOut[i].processed_nodes);
+		EXPECT_EQ(jobsIn[i].running_time, jobsOut[i].running_time);
+	}
+}
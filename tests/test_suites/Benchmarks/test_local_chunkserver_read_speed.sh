@@ -0,0 +1,39 @@
+timeout_set 10 minutes
+
+# Reads files from a chunkserver running on the same host. Mount 0 connects it with TCP,
+# mount 1 with its UNIX socket. Reports read speed and CPU time used by mounts per GiB.
+socket_dir="$TEMP_DIR/local_sockets"
+mkdir -p "$socket_dir"
+CHUNKSERVERS=1 \
+	USE_RAMDISK=YES \
+	MOUNTS=2 \
+	CHUNKSERVER_EXTRA_CONFIG="CSSERV_LOCAL_SOCKET_DIR = $socket_dir" \
+	MOUNT_1_EXTRA_CONFIG="mfslocalchunkserversocketdir=$socket_dir" \
+	setup_local_empty_lizardfs info
+
+file_size_mb=1024
+
+# Prints CPU time (in clock ticks) used so far by the mount of the given directory
+mount_cpu_ticks() {
+	local pid=$(pgrep -f -u lizardfstest "mfsmount.*$1" | head -n 1)
+	awk '{print $14 + $15}' "/proc/$pid/stat"
+}
+
+cd "${info[mount0]}"
+dd if=/dev/zero of=speed_test_file bs=1M count=$file_size_mb conv=fsync
+
+for mount in 0 1; do
+	cd "${info[mount${mount}]}"
+	drop_caches
+	cpu_before=$(mount_cpu_ticks "${info[mount${mount}]}")
+	time_file=$TEMP_DIR/$(unique_file)
+	/usr/bin/time -o "$time_file" -f %e dd if=speed_test_file of=/dev/null bs=1M
+	cpu_after=$(mount_cpu_ticks "${info[mount${mount}]}")
+	read_time=$(cat "$time_file")
+	read_speed=$(echo "scale=3;${file_size_mb}/${read_time}" | bc)
+	cpu_per_gb=$(echo "scale=3;($cpu_after-$cpu_before)/$(getconf CLK_TCK)*1024/${file_size_mb}" | bc)
+	echo -e "Mount ${mount} MB/s,Mount ${mount} CPU s/GiB\n${read_speed},${cpu_per_gb}" \
+			> "${TEMP_DIR}/local_read_${mount}.csv"
+done
+
+paste -d, $TEMP_DIR/local_read_*.csv | tee "${TEST_OUTPUT_DIR}/local_chunkserver_read_speed_results.csv"
@@ -0,0 +1,36 @@
+timeout_set 10 minutes
+
+# Reads a file spanning many chunks using a big readahead window, so that requests sent
+# to chunkservers span many chunks, with chunks read one by one and in parallel.
+CHUNKSERVERS=4 \
+	USE_RAMDISK=YES \
+	MOUNTS=2 \
+	MOUNT_0_EXTRA_CONFIG="readaheadmaxwindowsize=262144,mfsparallelchunkreads=0" \
+	MOUNT_1_EXTRA_CONFIG="readaheadmaxwindowsize=262144,mfsparallelchunkreads=4" \
+	setup_local_empty_lizardfs info
+
+file_size_mb=1024
+
+for goal in 1 xor3; do
+	test_filename=speed_test_file_${goal}
+	cd "${info[mount0]}"
+	touch "$test_filename"
+	lizardfs setgoal $goal "$test_filename"
+	dd if=/dev/zero of="$test_filename" bs=1M count=$file_size_mb conv=fsync
+
+	for mount in 0 1; do
+		cd "${info[mount${mount}]}"
+		drop_caches
+		time_file=$TEMP_DIR/$(unique_file)
+		/usr/bin/time -o "$time_file" -f %e dd \
+			if="$test_filename" \
+			of=/dev/null \
+			bs=1M
+		read_time=$(cat "$time_file")
+		read_speed=$(echo "scale=3;${file_size_mb}/${read_time}" | bc)
+		echo -e "Goal ${goal} mount ${mount}\n${read_speed}" > "${TEMP_DIR}/read_${goal}_${mount}.csv"
+	done
+done
+
+# Mount 0 reads chunks one by one, mount 1 reads them in parallel
+paste -d, $TEMP_DIR/read_*.csv | tee "${TEST_OUTPUT_DIR}/parallel_chunk_reads_speed_results.csv"
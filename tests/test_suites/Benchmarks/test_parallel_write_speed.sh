@@ -0,0 +1,28 @@
+timeout_set 10 minutes
+
+# Writes many files in parallel from one mount, so that writers of different files compete
+# for the write cache of the mount.
+CHUNKSERVERS=3 \
+	USE_RAMDISK=YES \
+	MOUNT_EXTRA_CONFIG="mfswritecachesize=256,mfswriteworkers=20" \
+	setup_local_empty_lizardfs info
+
+file_size_mb=128
+cd "${info[mount0]}"
+
+for writers in 1 4 16; do
+	drop_caches
+	time_file=$TEMP_DIR/$(unique_file)
+	/usr/bin/time -o "$time_file" -f %e bash -c "
+		for i in \$(seq $writers); do
+			dd if=/dev/zero of=file_${writers}_\$i bs=64K count=$((file_size_mb * 16)) \
+					conv=fsync 2>/dev/null &
+		done
+		wait"
+	write_time=$(cat "$time_file")
+	write_speed=$(echo "scale=3;${file_size_mb} * ${writers} / ${write_time}" | bc)
+	echo -e "Writers ${writers}\n${write_speed}" > "${TEMP_DIR}/write_${writers}.csv"
+	rm -f file_${writers}_*
+done
+
+paste -d, $TEMP_DIR/write_*.csv | tee "${TEST_OUTPUT_DIR}/parallel_write_speed_results.csv"
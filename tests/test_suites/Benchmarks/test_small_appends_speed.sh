@@ -0,0 +1,32 @@
+timeout_set 10 minutes
+
+# Appends to files in small pieces. Mount 0 writes partial blocks and stripes to chunkservers
+# at once, mount 1 coalesces them into full blocks and stripes first.
+CHUNKSERVERS=5 \
+	USE_RAMDISK=YES \
+	MOUNTS=2 \
+	MASTER_CUSTOM_GOALS="10 ec32: \$ec(3,2)" \
+	MOUNT_0_EXTRA_CONFIG="mfswritecoalescedelay=0" \
+	MOUNT_1_EXTRA_CONFIG="mfswritecoalescedelay=5000" \
+	setup_local_empty_lizardfs info
+
+file_size_mb=64
+
+for goal in 1 xor3 ec32; do
+	for mount in 0 1; do
+		cd "${info[mount${mount}]}"
+		test_filename=appends_test_file_${goal}
+		touch "$test_filename"
+		lizardfs setgoal $goal "$test_filename"
+		time_file=$TEMP_DIR/$(unique_file)
+		/usr/bin/time -o "$time_file" -f %e dd if=/dev/zero of="$test_filename" \
+				bs=4K count=$((file_size_mb * 256)) oflag=append conv=notrunc,fsync
+		write_time=$(cat "$time_file")
+		write_speed=$(echo "scale=3;${file_size_mb}/${write_time}" | bc)
+		echo -e "Goal ${goal} mount ${mount}\n${write_speed}" \
+				> "${TEMP_DIR}/append_${goal}_${mount}.csv"
+		rm -f "$test_filename"
+	done
+done
+
+paste -d, $TEMP_DIR/append_*.csv | tee "${TEST_OUTPUT_DIR}/small_appends_speed_results.csv"
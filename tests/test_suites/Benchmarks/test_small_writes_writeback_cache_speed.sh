@@ -0,0 +1,33 @@
+timeout_set 10 minutes
+
+# Writes files in small pieces. Mount 0 gets each write as a separate FUSE request,
+# mount 1 lets the kernel cache them and send them in large requests.
+CHUNKSERVERS=2 \
+	USE_RAMDISK=YES \
+	MOUNTS=2 \
+	MOUNT_1_EXTRA_CONFIG="mfswritebackcache" \
+	setup_local_empty_lizardfs info
+
+file_size_mb=64
+
+for block_size in 512 4K; do
+	for mount in 0 1; do
+		cd "${info[mount${mount}]}"
+		test_filename=small_writes_test_file_${block_size}
+		time_file=$TEMP_DIR/$(unique_file)
+		/usr/bin/time -o "$time_file" -f %e dd if=/dev/zero of="$test_filename" \
+				bs=$block_size count=$((file_size_mb * 1024 * 1024 / $(numfmt --from=iec $block_size))) \
+				conv=fsync
+		write_time=$(cat "$time_file")
+		write_speed=$(echo "scale=3;${file_size_mb}/${write_time}" | bc)
+		echo -e "Block size ${block_size} mount ${mount} MB/s\n${write_speed}" \
+				> "${TEMP_DIR}/small_writes_${block_size}_${mount}.csv"
+		# size and data written through the kernel cache are visible from the other mount
+		other_mount=$((1 - mount))
+		assert_equals $((file_size_mb * 1024 * 1024)) \
+				"$(stat -c %s "${info[mount${other_mount}]}/$test_filename")"
+		rm -f "$test_filename"
+	done
+done
+
+paste -d, $TEMP_DIR/small_writes_*.csv | tee "${TEST_OUTPUT_DIR}/small_writes_writeback_cache_results.csv"
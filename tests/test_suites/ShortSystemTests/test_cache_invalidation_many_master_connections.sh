@@ -0,0 +1,37 @@
+timeout_set 2 minutes
+
+# Mount 0 caches metadata for long and relies on notifications about its changes. It uses
+# a few connections with the master, so lookups, getattrs and readdirs are sent through different
+# ones. Changes made by mount 1 have to be noticed long before cache timeouts pass.
+MOUNTS=2 \
+	USE_RAMDISK=YES \
+	MOUNT_0_EXTRA_CONFIG="mfscacheinvalidation|mfsmasterconnections=3|mfsattrcacheto=600|mfsentrycacheto=600|mfsdirentrycacheto=600" \
+	setup_local_empty_lizardfs info
+
+cd "${info[mount1]}"
+mkdir dir
+echo a > dir/file
+chmod 644 dir/file
+
+cd "${info[mount0]}"
+assert_equals "file" "$(ls dir)"
+assert_equals "644 2" "$(stat -c '%a %s' dir/file)"
+ls -l dir > /dev/null
+assert_equals "a" "$(cat dir/file)"
+
+cd "${info[mount1]}"
+chmod 600 dir/file
+echo bbb > dir/file
+touch dir/new_file
+
+cd "${info[mount0]}"
+assert_eventually_prints "600 4" "stat -c '%a %s' dir/file" "30 seconds"
+assert_eventually_prints "file new_file" "ls dir | xargs" "30 seconds"
+assert_equals "bbb" "$(cat dir/file)"
+
+cd "${info[mount1]}"
+mv dir/file dir/renamed_file
+
+cd "${info[mount0]}"
+assert_eventually_prints "new_file renamed_file" "ls dir | xargs" "30 seconds"
+assert_failure stat dir/file
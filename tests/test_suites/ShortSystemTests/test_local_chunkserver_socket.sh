@@ -0,0 +1,48 @@
+timeout_set 3 minutes
+
+# Reads and writes files through the UNIX socket of a chunkserver running on the same host,
+# after the chunkserver was killed and left a stale socket behind, and with TCP after
+# the socket was removed.
+socket_dir="$TEMP_DIR/local_sockets"
+mkdir -p "$socket_dir"
+CHUNKSERVERS=1 \
+	USE_RAMDISK=YES \
+	CHUNKSERVER_EXTRA_CONFIG="CSSERV_LOCAL_SOCKET_DIR = $socket_dir" \
+	MOUNT_EXTRA_CONFIG="mfslocalchunkserversocketdir=$socket_dir" \
+	setup_local_empty_lizardfs info
+
+# The chunkserver listens on all addresses, the mount looks for its address first
+socket="$socket_dir/chunkserver.0.0.0.0.${info[chunkserver0_port]}.sock"
+assert_file_exists "$socket"
+
+# Prints number of connections accepted by the chunkserver's UNIX socket which are still open
+# (connections are kept in the pool of the mount for a few seconds after being used). Accepted
+# sockets are listed with the path of the listening one, even if the path was removed.
+local_connections() {
+	echo $(($(grep -cF "$socket" /proc/net/unix) - 1))
+}
+
+cd "${info[mount0]}"
+FILE_SIZE=10M file-generate file0
+assert_less_than 0 "$(local_connections)"
+drop_caches
+assert_success file-validate file0
+assert_less_than 0 "$(local_connections)"
+
+# A socket left by a killed chunkserver is replaced by the new one
+lizardfs_chunkserver_daemon 0 kill
+assert_file_exists "$socket"
+lizardfs_chunkserver_daemon 0 start
+lizardfs_wait_for_all_ready_chunkservers
+FILE_SIZE=10M file-generate file1
+drop_caches
+assert_success file-validate file0 file1
+assert_less_than 0 "$(local_connections)"
+
+# Without the socket the mount falls back to TCP
+rm -f "$socket"
+assert_eventually '[[ $(local_connections) == 0 ]]'
+FILE_SIZE=10M file-generate file2
+drop_caches
+assert_success file-validate file0 file1 file2
+assert_equals 0 "$(local_connections)"
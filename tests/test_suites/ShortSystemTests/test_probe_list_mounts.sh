@@ -6,6 +6,6 @@ mounts=$(lizardfs-probe list-mounts --porcelain --verbose localhost "${info[mato
 expect_equals "4" $(wc -l <<< "$mounts")
 for i in {1..4}; do
 	expect_equals \
-		"$i ${info[mount$((i - 1))]} $LIZARDFS_VERSION / 0 0 999 999 no yes no no no 1 40 - -" \
-		"$(sed -n "${i}p" <<< "$mounts" | cut -d' ' -f 1,3-)"
+		"$i ${info[mount$((i - 1))]} $LIZARDFS_VERSION / 0 0 999 999 no yes no no no 1 40 - - 1" \
+		"$(sed -n "${i}p" <<< "$mounts" | cut -d' ' -f 1,3-19)"
 done
@@ -0,0 +1,163 @@
+/*
+   Copyright 2013-2018 Skytechnology sp. z o.o.
+
+   This file is part of LizardFS.
+
+   LizardFS is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, version 3.
+
+   LizardFS is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LizardFS. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures how many small replies per second a master-like server loop can push
+ * through a socket to a local stand-in client. Compares the old output queue
+ * (one malloc'ed packet and one write per reply) with OutputBufferChain.
+ */
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "common/datapack.h"
+#include "common/massert.h"
+#include "common/output_buffer_chain.h"
+#include "common/sockets.h"
+
+struct LegacyPacket {
+	LegacyPacket *next;
+	uint8_t *startptr;
+	uint32_t bytesleft;
+	uint8_t *packet;
+};
+
+struct LegacyQueue {
+	LegacyQueue() : head(nullptr), tail(&head) {}
+
+	uint8_t *createPacket(uint32_t type, uint32_t size) {
+		LegacyPacket *outpacket = (LegacyPacket*)malloc(sizeof(LegacyPacket));
+		passert(outpacket);
+		outpacket->packet = (uint8_t*)malloc(size + 8);
+		passert(outpacket->packet);
+		outpacket->bytesleft = size + 8;
+		uint8_t *ptr = outpacket->packet;
+		put32bit(&ptr, type);
+		put32bit(&ptr, size);
+		outpacket->startptr = outpacket->packet;
+		outpacket->next = nullptr;
+		*tail = outpacket;
+		tail = &(outpacket->next);
+		return ptr;
+	}
+
+	bool empty() const {
+		return head == nullptr;
+	}
+
+	void write(int fd) {
+		while (head) {
+			LegacyPacket *pack = head;
+			ssize_t i = ::write(fd, pack->startptr, pack->bytesleft);
+			if (i < 0) {
+				eassert(errno == EAGAIN);
+				return;
+			}
+			pack->startptr += i;
+			pack->bytesleft -= i;
+			if (pack->bytesleft > 0) {
+				return;
+			}
+			free(pack->packet);
+			head = pack->next;
+			if (head == nullptr) {
+				tail = &head;
+			}
+			free(pack);
+		}
+	}
+
+	LegacyPacket *head, **tail;
+};
+
+static uint64_t now_us() {
+	struct timeval tv;
+	gettimeofday(&tv, nullptr);
+	return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static void standInClient(int fd, uint64_t bytes) {
+	std::vector<uint8_t> buffer(256 * 1024);
+	while (bytes > 0) {
+		ssize_t ret = read(fd, buffer.data(), buffer.size());
+		eassert(ret > 0);
+		bytes -= ret;
+	}
+}
+
+/// Queues \p batch replies per loop iteration (as if they were answers for one poll round)
+/// and flushes them when the socket is writable.
+template <typename Queue, typename CreateFunction, typename WriteFunction>
+static double run(uint32_t count, uint32_t batch, uint32_t size,
+		CreateFunction createPacket, WriteFunction writePackets) {
+	int fds[2];
+	eassert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	eassert(tcpnonblock(fds[0]) == 0);
+	std::thread client(standInClient, fds[1], uint64_t(count) * (size + 8));
+
+	Queue queue;
+	uint64_t start = now_us();
+	uint32_t queued = 0;
+	while (queued < count || !queue.empty()) {
+		for (uint32_t i = 0; i < batch && queued < count; ++i, ++queued) {
+			uint8_t *ptr = createPacket(queue, size);
+			put32bit(&ptr, queued);
+			memset(ptr, 0, size - 4);
+		}
+		struct pollfd pfd = {fds[0], POLLOUT, 0};
+		eassert(poll(&pfd, 1, 1000) == 1);
+		writePackets(queue, fds[0]);
+	}
+	client.join();
+	uint64_t elapsed = now_us() - start;
+	close(fds[0]);
+	close(fds[1]);
+	return count * 1000000.0 / elapsed;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 4) {
+		std::cerr << "Usage: " << argv[0] << " count batch packet_size" << std::endl;
+		return 1;
+	}
+	uint32_t count = atoi(argv[1]);
+	uint32_t batch = atoi(argv[2]);
+	uint32_t size = atoi(argv[3]);
+	sassert(size >= 4 && batch > 0);
+
+	double legacy = run<LegacyQueue>(count, batch, size,
+		[](LegacyQueue& queue, uint32_t size) { return queue.createPacket(0, size); },
+		[](LegacyQueue& queue, int fd) { queue.write(fd); });
+	std::cout << "legacy queue: " << uint64_t(legacy) << " packets/s" << std::endl;
+
+	double chained = run<OutputBufferChain>(count, batch, size,
+		[](OutputBufferChain& queue, uint32_t size) { return queue.allocatePacket(0, size); },
+		[](OutputBufferChain& queue, int fd) {
+			while (!queue.empty() && queue.writeTo(fd) > 0) {
+			}
+		});
+	std::cout << "chained queue: " << uint64_t(chained) << " packets/s" << std::endl;
+	return 0;
+}